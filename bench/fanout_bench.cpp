@@ -0,0 +1,373 @@
+/*
+ * Output fan-out check and benchmark: one slow sink vs the splice loop
+ *
+ * A synthetic H.264 stream (~3.4 Mbps, 30 fps, one IDR per second) is
+ * written in real time, one burst per video frame, the way the main loop
+ * writes the spliced output. Every packet carries its sequence number in
+ * its last bytes, so sinks can tell when each packet was published.
+ *
+ *   direct:  the writer blocks on a sink that stalls for 2 s every 3 s
+ *            (ffmpeg stuck on its RTMP push) - today's single FIFOOutput
+ *   fan-out: FanoutOutput with a fast sink plus stalling sinks under each
+ *            policy, and one that hangs for 10 s once (the ring laps it)
+ *
+ * Reported per run: the writer's worst write() call and how far it fell
+ * behind its schedule; per sink: packets written / skipped, skips to an
+ * IDR, overruns, disconnects, publish -> sink latency (p50 / max), and
+ * errors: a sink that resumes after a gap anywhere but at an IDR PES.
+ *
+ * Build: cmake -DBUILD_BENCHMARKS=ON .. && make fanout_bench
+ */
+
+#include "FanoutOutput.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int SECONDS = 12;
+constexpr int FPS = 30;
+constexpr int GOP = 30;
+constexpr size_t P_FRAME_BYTES = 14000;
+constexpr size_t IDR_FRAME_BYTES = 60000;
+constexpr uint16_t PMT_PID = 0x1000;
+constexpr uint16_t VIDEO_PID = 0x100;
+constexpr size_t RING_PACKETS = 16384;     // ~7 s at this bitrate
+constexpr size_t MAX_LAG_PACKETS = 2000;   // ~0.9 s
+
+uint32_t crc32Mpeg(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= static_cast<uint32_t>(data[i]) << 24;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// Sequence number in the last 4 bytes, 7 bits each with the top bit set
+// (never a zero byte, so never part of a start code)
+void stamp(ts::TSPacket& pkt, uint32_t seq) {
+    for (int i = 0; i < 4; i++) {
+        pkt.b[184 + i] = static_cast<uint8_t>(0x80 | ((seq >> (7 * (3 - i))) & 0x7F));
+    }
+}
+
+uint32_t stampOf(const ts::TSPacket& pkt) {
+    uint32_t seq = 0;
+    for (int i = 0; i < 4; i++) {
+        seq = (seq << 7) | (pkt.b[184 + i] & 0x7F);
+    }
+    return seq;
+}
+
+// ---- Synthetic H.264 TS, one burst per frame ----
+
+std::vector<std::vector<ts::TSPacket>> generate(int seconds) {
+    std::vector<std::vector<ts::TSPacket>> bursts;
+    uint8_t pat_cc = 0, pmt_cc = 0, video_cc = 0;
+    uint32_t seed = 0;
+
+    auto section = [](std::vector<ts::TSPacket>& out, uint16_t pid, uint8_t& cc, std::vector<uint8_t> sec) {
+        uint32_t crc = crc32Mpeg(sec.data(), sec.size());
+        sec.insert(sec.end(), {static_cast<uint8_t>(crc >> 24), static_cast<uint8_t>(crc >> 16),
+                               static_cast<uint8_t>(crc >> 8), static_cast<uint8_t>(crc)});
+        ts::TSPacket pkt;
+        memset(pkt.b, 0xFF, sizeof(pkt.b));
+        pkt.b[0] = 0x47;
+        pkt.b[1] = static_cast<uint8_t>(0x40 | (pid >> 8));
+        pkt.b[2] = static_cast<uint8_t>(pid);
+        pkt.b[3] = static_cast<uint8_t>(0x10 | (cc++ & 0x0F));
+        pkt.b[4] = 0;
+        memcpy(pkt.b + 5, sec.data(), sec.size());
+        out.push_back(pkt);
+    };
+
+    for (int frame = 0; frame < seconds * FPS; frame++) {
+        std::vector<ts::TSPacket> burst;
+        bool idr = frame % GOP == 0;
+        if (idr) {
+            section(burst, 0, pat_cc, {0x00, 0xB0, 13, 0x00, 0x01, 0xC1, 0x00, 0x00, 0x00, 0x01,
+                                       static_cast<uint8_t>(0xE0 | (PMT_PID >> 8)), static_cast<uint8_t>(PMT_PID)});
+            section(burst, PMT_PID, pmt_cc, {0x02, 0xB0, 18, 0x00, 0x01, 0xC1, 0x00, 0x00,
+                                             static_cast<uint8_t>(0xE0 | (VIDEO_PID >> 8)), static_cast<uint8_t>(VIDEO_PID),
+                                             0xF0, 0x00, 0x1B, static_cast<uint8_t>(0xE0 | (VIDEO_PID >> 8)),
+                                             static_cast<uint8_t>(VIDEO_PID), 0xF0, 0x00});
+        }
+
+        std::vector<uint8_t> pes = {0x00, 0x00, 0x01, 0xE0, 0x00, 0x00, 0x80, 0x00, 0x00};
+        const uint8_t aud[] = {0, 0, 0, 1, 0x09, 0xF0};
+        pes.insert(pes.end(), aud, aud + sizeof(aud));
+        if (idr) {
+            const uint8_t sps[] = {0, 0, 0, 1, 0x67, 0x64, 0x00, 0x1F, 0xAC, 0xD9, 0x40, 0x50};
+            const uint8_t pps[] = {0, 0, 0, 1, 0x68, 0xEB, 0xE3, 0xCB, 0x22, 0xC0};
+            pes.insert(pes.end(), sps, sps + sizeof(sps));
+            pes.insert(pes.end(), pps, pps + sizeof(pps));
+        }
+        const uint8_t slice[] = {0, 0, 1, static_cast<uint8_t>(idr ? 0x65 : 0x41)};
+        pes.insert(pes.end(), slice, slice + sizeof(slice));
+        for (size_t i = 0; i < (idr ? IDR_FRAME_BYTES : P_FRAME_BYTES); i++) {
+            pes.push_back(static_cast<uint8_t>(0x10 + (seed++ % 0xE0)));
+        }
+
+        // Whole packets only: the stamp overwrites the payload's last bytes
+        for (size_t pos = 0; pos < pes.size(); pos += 184) {
+            ts::TSPacket pkt;
+            pkt.b[0] = 0x47;
+            pkt.b[1] = static_cast<uint8_t>((pos == 0 ? 0x40 : 0x00) | (VIDEO_PID >> 8));
+            pkt.b[2] = static_cast<uint8_t>(VIDEO_PID & 0xFF);
+            pkt.b[3] = static_cast<uint8_t>(0x10 | (video_cc++ & 0x0F));
+            size_t n = std::min<size_t>(184, pes.size() - pos);
+            memset(pkt.b + 4, 0xFF, 184);
+            memcpy(pkt.b + 4, pes.data() + pos, n);
+            burst.push_back(pkt);
+        }
+        bursts.push_back(std::move(burst));
+    }
+
+    uint32_t seq = 0;
+    for (auto& burst : bursts) {
+        for (auto& pkt : burst) {
+            stamp(pkt, seq++);
+        }
+    }
+    return bursts;
+}
+
+// ---- Sinks ----
+
+// Publish time per sequence number, written by the writer before the
+// packet is published (the ring's release/acquire orders the reads)
+std::vector<Clock::time_point> g_published;
+
+// What a sink saw; copied out on close() (the fan-out owns the sink)
+struct SinkResult {
+    std::vector<double> latencies_ms;
+    uint64_t errors = 0;
+};
+
+/**
+ * Test sink: optionally stalls inside writePackets(), records latency and
+ * checks that every gap in what it receives ends at an IDR PES start.
+ */
+class BenchSink : public PacketSink {
+public:
+    // Stall for stall_ms every period_ms (period 0: once, after first_ms)
+    BenchSink(SinkResult& result, int stall_ms, int period_ms, int first_ms = 1000)
+        : result_(result), stall_ms_(stall_ms), period_ms_(period_ms), first_ms_(first_ms) {}
+
+    bool open() override {
+        if (start_ == Clock::time_point()) {
+            start_ = Clock::now();
+            next_stall_ = start_ + std::chrono::milliseconds(first_ms_);
+        }
+        gap_ = true;    // Must start at an IDR, like after any gap
+        return true;
+    }
+    void close() override {
+        result_.latencies_ms = latencies_ms_;
+        result_.errors = errors_;
+    }
+
+    bool writePacket(const ts::TSPacket& packet) override { return writePackets(&packet, 1); }
+    bool writePackets(const ts::TSPacket* packets, size_t count) override {
+        auto now = Clock::now();
+        if (stall_ms_ > 0 && now >= next_stall_) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(stall_ms_));
+            next_stall_ = (period_ms_ > 0) ? now + std::chrono::milliseconds(period_ms_) : Clock::time_point::max();
+            now = Clock::now();
+        }
+        for (size_t i = 0; i < count; i++) {
+            check(packets[i], now);
+        }
+        packets_ += count;
+        return true;
+    }
+
+    ts::TSPacket* reserve(size_t) override { return nullptr; }
+    bool commit(size_t) override { return true; }
+    bool flush() override { return true; }
+    bool flushIfDue() override { return true; }
+    void setBatching(size_t, int) override {}
+    int getFlushWaitMs(int max_wait_ms) const override { return max_wait_ms; }
+    uint64_t getPacketsWritten() const override { return packets_; }
+    uint64_t getBytesWritten() const override { return packets_ * ts::PKT_SIZE; }
+
+private:
+    void check(const ts::TSPacket& pkt, Clock::time_point now) {
+        uint16_t pid = static_cast<uint16_t>(((pkt.b[1] & 0x1F) << 8) | pkt.b[2]);
+        if (pid != VIDEO_PID) {
+            return;     // PSI sent ahead of a resync point
+        }
+        uint32_t seq = stampOf(pkt);
+        if (gap_ || seq != next_seq_) {
+            bool idr_start = (pkt.b[1] & 0x40) &&
+                             std::search(pkt.b + 4, pkt.b + 184, IDR, IDR + sizeof(IDR)) != pkt.b + 184;
+            if (!idr_start) {
+                errors_++;
+            }
+        }
+        next_seq_ = seq + 1;
+        gap_ = false;
+        latencies_ms_.push_back(std::chrono::duration<double, std::milli>(now - g_published[seq]).count());
+    }
+
+    static constexpr uint8_t IDR[] = {0x00, 0x00, 0x01, 0x65};
+
+    SinkResult& result_;
+    std::vector<double> latencies_ms_;
+    uint64_t errors_ = 0;
+    int stall_ms_;
+    int period_ms_;
+    int first_ms_;
+    Clock::time_point start_;
+    Clock::time_point next_stall_;
+    uint32_t next_seq_ = 0;
+    bool gap_ = false;
+    uint64_t packets_ = 0;
+};
+
+// ---- Writer ----
+
+struct WriterResult {
+    double worst_write_ms = 0;
+    double max_slip_ms = 0;     // Behind the real-time schedule
+};
+
+WriterResult runWriter(PacketSink& output, const std::vector<std::vector<ts::TSPacket>>& bursts) {
+    WriterResult r;
+    auto start = Clock::now();
+    uint32_t seq = 0;
+    for (size_t i = 0; i < bursts.size(); i++) {
+        auto due = start + std::chrono::microseconds(static_cast<int64_t>(i) * 1000000 / FPS);
+        std::this_thread::sleep_until(due);
+        auto before = Clock::now();
+        r.max_slip_ms = std::max(r.max_slip_ms, std::chrono::duration<double, std::milli>(before - due).count());
+        for (size_t k = 0; k < bursts[i].size(); k++) {
+            g_published[seq++] = before;
+        }
+        output.writePackets(bursts[i]);
+        output.flushIfDue();
+        r.worst_write_ms = std::max(r.worst_write_ms,
+                                    std::chrono::duration<double, std::milli>(Clock::now() - before).count());
+    }
+    return r;
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+}
+
+void printWriter(std::ostream& out, const char* name, const WriterResult& r) {
+    out << "  writer (" << name << "): worst write " << std::fixed << std::setprecision(2) << r.worst_write_ms
+        << " ms, max schedule slip " << r.max_slip_ms << " ms" << std::endl;
+}
+
+}  // namespace
+
+int main() {
+    std::ostream out(std::cout.rdbuf());
+    std::stringstream log;
+
+    auto bursts = generate(SECONDS);
+    size_t total = 0;
+    for (const auto& burst : bursts) {
+        total += burst.size();
+    }
+    g_published.resize(total);
+    out << "Synthetic H.264: " << SECONDS << " s, " << FPS << " fps, GOP " << GOP << ", "
+        << total << " packets; ring " << RING_PACKETS << ", max lag " << MAX_LAG_PACKETS << " packets" << std::endl;
+
+    // Direct: the writer owns the stalling sink's blocking writes
+    {
+        SinkResult result;
+        BenchSink sink(result, 2000, 3000);
+        sink.open();
+        WriterResult r = runWriter(sink, bursts);
+        sink.close();
+        out << std::endl << "direct (one sink, 2 s stall every 3 s):" << std::endl;
+        printWriter(out, "direct", r);
+    }
+
+    // Fan-out: the same stalls, one sink per policy, next to a fast sink
+    {
+        std::atomic<bool> running(true);
+        std::cout.rdbuf(log.rdbuf());
+        std::cerr.rdbuf(log.rdbuf());
+
+        struct Entry {
+            const char* name;
+            FanoutOutput::Policy policy;
+            SinkResult result;
+        };
+        std::vector<Entry> entries;
+        entries.reserve(5);
+        FanoutOutput fanout(RING_PACKETS, running);
+        auto add = [&](const char* name, FanoutOutput::Policy policy, int stall_ms, int period_ms) {
+            entries.push_back({name, policy, {}});
+            fanout.addSink(name, std::make_unique<BenchSink>(entries.back().result, stall_ms, period_ms),
+                           policy, MAX_LAG_PACKETS);
+        };
+        add("fast", FanoutOutput::Policy::WAIT, 0, 0);
+        add("stall-wait", FanoutOutput::Policy::WAIT, 2000, 3000);
+        add("stall-drop", FanoutOutput::Policy::DROP_TO_IDR, 2000, 3000);
+        add("stall-disc", FanoutOutput::Policy::DISCONNECT, 2000, 3000);
+        add("hang-wait", FanoutOutput::Policy::WAIT, 10000, 0);
+
+        fanout.open();
+        WriterResult r = runWriter(fanout, bursts);
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));   // Let the sinks drain
+        std::vector<FanoutOutput::SinkStats> stats = fanout.getSinkStats();
+        running = false;
+        fanout.close();
+        std::cout.rdbuf(out.rdbuf());
+        std::cerr.rdbuf(out.rdbuf());
+
+        out << std::endl << "fan-out:" << std::endl;
+        printWriter(out, "fan-out", r);
+        out << "  " << std::left << std::setw(12) << "sink"
+            << std::setw(13) << "policy"
+            << std::setw(10) << "written"
+            << std::setw(10) << "skipped"
+            << std::setw(11) << "idr_skips"
+            << std::setw(10) << "overruns"
+            << std::setw(13) << "disconnects"
+            << std::setw(10) << "p50 ms"
+            << std::setw(10) << "max ms"
+            << std::setw(8) << "errors" << std::endl;
+        for (size_t i = 0; i < entries.size(); i++) {
+            const Entry& e = entries[i];
+            const FanoutOutput::SinkStats& s = stats[i];
+            out << "  " << std::left << std::setw(12) << e.name
+                << std::setw(13) << FanoutOutput::policyName(e.policy)
+                << std::setw(10) << s.packets_written
+                << std::setw(10) << s.packets_skipped
+                << std::setw(11) << s.idr_skips
+                << std::setw(10) << s.overruns
+                << std::setw(13) << s.disconnects
+                << std::fixed << std::setprecision(1)
+                << std::setw(10) << percentile(e.result.latencies_ms, 0.50)
+                << std::setw(10) << percentile(e.result.latencies_ms, 1.0)
+                << std::setw(8) << e.result.errors << std::endl;
+        }
+    }
+    return 0;
+}
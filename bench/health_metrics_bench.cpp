@@ -0,0 +1,184 @@
+/*
+ * Input health metrics benchmark: the lock-free time wheel against the
+ * mutex + deque window it replaced
+ *
+ *   record:  ns per recordDataReceived() with nobody querying
+ *   query:   ns per getCurrentBitrateBps() with a full 3 s window behind it
+ *   contend: a writer records 1316-byte reads (7 TS packets) every 20 us
+ *            while 3 threads poll the bitrate, packet rate and gap as fast
+ *            as they can; reported is the writer's slowest and mean record
+ *
+ * Then a check of the new metrics on a known pattern: reads of 7 packets
+ * every 2 ms (3500 packets/s, 658000 bytes/s), with a 150 ms stall and a
+ * period of alternating 1 ms / 3 ms spacing to give the jitter something.
+ *
+ * Build: cmake -DBUILD_BENCHMARKS=ON .. && make health_metrics_bench
+ */
+
+#include "StreamHealthMetrics.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t READ_BYTES = 7 * 188;
+constexpr int QUERY_THREADS = 3;
+constexpr int CONTEND_SECONDS = 2;
+
+// The previous implementation, bitrate part only
+class DequeWindow {
+public:
+    void recordDataReceived(size_t bytes, size_t) {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(mutex_);
+        window_.push_back({now, bytes});
+        auto cutoff = now - std::chrono::seconds(WINDOW_SECONDS);
+        while (!window_.empty() && window_.front().time < cutoff) {
+            window_.pop_front();
+        }
+    }
+
+    uint64_t getCurrentBitrateBps() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto window_start = Clock::now() - std::chrono::seconds(WINDOW_SECONDS);
+        uint64_t total = 0;
+        for (const auto& entry : window_) {
+            if (entry.time >= window_start) {
+                total += entry.bytes;
+            }
+        }
+        return total / WINDOW_SECONDS;
+    }
+
+    uint64_t getPacketRate() const { return 0; }
+    int64_t getMaxGapMs() const { return 0; }
+
+private:
+    static constexpr int WINDOW_SECONDS = 3;
+    struct DataPoint {
+        Clock::time_point time;
+        size_t bytes;
+    };
+    mutable std::mutex mutex_;
+    std::deque<DataPoint> window_;
+};
+
+void sleepUntil(Clock::time_point t) {
+    while (Clock::now() < t) {
+        std::this_thread::sleep_until(t);
+    }
+}
+
+template <typename Metrics>
+void run(const char* name) {
+    auto metrics = std::make_unique<Metrics>();
+
+    // Fill a 3 s window at the contention rate first, so queries walk a realistic deque
+    const int fill = 3 * 1000000 / 20;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < fill; i++) {
+        metrics->recordDataReceived(READ_BYTES, 7);
+    }
+    double record_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / fill;
+
+    const int queries = 2000;
+    uint64_t sink = 0;
+    start = Clock::now();
+    for (int i = 0; i < queries; i++) {
+        sink += metrics->getCurrentBitrateBps();
+    }
+    double query_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / queries;
+
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> query_count(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < QUERY_THREADS; t++) {
+        readers.emplace_back([&] {
+            uint64_t n = 0, local = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                local += metrics->getCurrentBitrateBps() + metrics->getPacketRate()
+                         + static_cast<uint64_t>(metrics->getMaxGapMs());
+                n++;
+            }
+            query_count += n + (local == 42 ? 1 : 0);
+        });
+    }
+
+    std::vector<int64_t> record_times;
+    Clock::time_point next = Clock::now();
+    Clock::time_point deadline = next + std::chrono::seconds(CONTEND_SECONDS);
+    while (next < deadline) {
+        next += std::chrono::microseconds(20);
+        sleepUntil(next);
+        Clock::time_point t0 = Clock::now();
+        metrics->recordDataReceived(READ_BYTES, 7);
+        record_times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count());
+    }
+    stop = true;
+    for (auto& r : readers) {
+        r.join();
+    }
+
+    int64_t total = 0;
+    for (int64_t t : record_times) total += t;
+    std::sort(record_times.begin(), record_times.end());
+    std::cout << name << ": record " << record_ns << " ns, query (3 s window) " << query_ns << " ns"
+              << " | contended: record mean " << total / static_cast<int64_t>(record_times.size())
+              << " ns, p99.9 " << record_times[record_times.size() * 999 / 1000]
+              << " ns, max " << record_times.back() / 1000 << " us, "
+              << query_count.load() / CONTEND_SECONDS << " queries/s"
+              << (sink == 42 ? " " : "") << std::endl;
+}
+
+void checkMetrics() {
+    StreamHealthMetrics metrics;
+    StreamHealthConfig config;
+    config.bitrate_window_seconds = 3;
+    metrics.configure(config);
+
+    Clock::time_point next = Clock::now();
+    auto readsFor = [&](int ms, int spacing_us, bool alternate) {
+        Clock::time_point end = Clock::now() + std::chrono::milliseconds(ms);
+        int i = 0;
+        while (next < end) {
+            int step = alternate ? (i++ % 2 ? spacing_us + 1000 : spacing_us - 1000) : spacing_us;
+            next += std::chrono::microseconds(step);
+            sleepUntil(next);
+            metrics.recordDataReceived(READ_BYTES, 7);
+        }
+    };
+
+    readsFor(3500, 2000, false);
+    std::cout << "steady 2 ms reads: bitrate " << metrics.getCurrentBitrateBps() << " B/s (expect ~658000), "
+              << metrics.getPacketRate() << " packets/s (expect ~3500), max gap "
+              << metrics.getMaxGapMs() << " ms, jitter " << metrics.getJitterUs() << " us" << std::endl;
+
+    next += std::chrono::milliseconds(150);
+    sleepUntil(next);
+    readsFor(500, 2000, false);
+    std::cout << "after a 150 ms stall: max gap " << metrics.getMaxGapMs() << " ms (expect ~150), bitrate "
+              << metrics.getCurrentBitrateBps() << " B/s" << std::endl;
+
+    readsFor(1000, 2000, true);
+    std::cout << "alternating 1/3 ms reads: jitter " << metrics.getJitterUs()
+              << " us (expect ~2000), packets " << metrics.getPacketRate() << "/s" << std::endl;
+}
+
+}  // namespace
+
+int main() {
+    run<DequeWindow>("mutex + deque");
+    run<StreamHealthMetrics>("time wheel   ");
+    checkMetrics();
+    return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * Latency tracking check and benchmark: cost of the stamps, and that
+ * lookups racing the writer never return a torn or wrong stamp
+ *
+ *   cost:  ns per stamp() (with its clock read), per lookup(), and per
+ *          read() with tracking disabled (the relaxed flag load)
+ *   race:  a writer thread stamps batches of 7 packets as fast as it can
+ *          (time = end_seq, so every answer can be checked) while a reader
+ *          looks up packets just behind it, wrapping the ring many times
+ *
+ * Reported: the costs, lookups found / pending / expired, and errors: a
+ * found stamp that does not cover the packet or is not the first that does.
+ *
+ * Build: cmake -DBUILD_BENCHMARKS=ON .. && make latency_tracking_bench
+ */
+
+#include "SequenceStamps.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int COST_ITERATIONS = 5000000;
+constexpr uint64_t BATCH = 7;
+constexpr int RACE_SECONDS = 3;
+
+double nsPer(Clock::time_point start, int iterations) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+}
+
+}  // namespace
+
+int main() {
+    auto stamps = std::make_unique<SequenceStamps>();
+
+    // Cost
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < COST_ITERATIONS; i++) {
+        stamps->stamp(static_cast<uint64_t>(i + 1) * BATCH, SequenceStamps::nowNs());
+    }
+    double stamp_ns = nsPer(start, COST_ITERATIONS);
+
+    uint64_t end = static_cast<uint64_t>(COST_ITERATIONS) * BATCH;
+    int64_t sink = 0;
+    start = Clock::now();
+    for (int i = 0; i < COST_ITERATIONS; i++) {
+        int64_t t = 0;
+        stamps->lookup(end - 1 - static_cast<uint64_t>(i) % (SequenceStamps::CAPACITY * BATCH / 2), t);
+        sink += t;
+    }
+    double lookup_ns = nsPer(start, COST_ITERATIONS);
+
+    std::atomic<bool> tracking(false);
+    start = Clock::now();
+    for (int i = 0; i < COST_ITERATIONS; i++) {
+        int64_t read_ns = tracking.load(std::memory_order_relaxed) ? SequenceStamps::nowNs() : 0;
+        sink += read_ns;
+    }
+    double disabled_ns = nsPer(start, COST_ITERATIONS);
+
+    std::cout << "stamp (incl. clock): " << stamp_ns << " ns, lookup: " << lookup_ns
+              << " ns, disabled read path: " << disabled_ns << " ns" << (sink == 42 ? " " : "") << std::endl;
+
+    // Race
+    auto race = std::make_unique<SequenceStamps>();
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> published(0);
+    std::thread writer([&] {
+        uint64_t end_seq = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            end_seq += BATCH;
+            race->stamp(end_seq, static_cast<int64_t>(end_seq));
+            published.store(end_seq, std::memory_order_relaxed);
+        }
+    });
+
+    uint64_t found = 0, pending = 0, expired = 0, errors = 0, i = 0;
+    Clock::time_point deadline = Clock::now() + std::chrono::seconds(RACE_SECONDS);
+    while (Clock::now() < deadline) {
+        uint64_t head = published.load(std::memory_order_relaxed);
+        // Mostly recent packets, some near the edge of the ring, some not yet stamped
+        uint64_t behind = (i++ % 3 == 0) ? (i * 7919) % (SequenceStamps::CAPACITY * BATCH + 64) : i % 50;
+        if (behind > head) continue;
+        uint64_t seq = head - behind + (i % 5 == 0 ? BATCH : 0);
+        int64_t t = 0;
+        switch (race->lookup(seq, t)) {
+            case SequenceStamps::Lookup::FOUND: {
+                found++;
+                uint64_t end_seq = static_cast<uint64_t>(t);
+                // Stamps are multiples of BATCH: the first covering seq ends at the next multiple
+                if (end_seq <= seq || end_seq - BATCH > seq) errors++;
+                break;
+            }
+            case SequenceStamps::Lookup::PENDING: pending++; break;
+            case SequenceStamps::Lookup::EXPIRED: expired++; break;
+        }
+    }
+    stop = true;
+    writer.join();
+
+    std::cout << "race: " << published.load() / BATCH << " stamps, lookups found=" << found
+              << " pending=" << pending << " expired=" << expired << ", errors=" << errors << std::endl;
+    return errors == 0 ? 0 : 1;
+}
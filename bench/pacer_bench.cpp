@@ -0,0 +1,224 @@
+/*
+ * Output pacing check and benchmark: PCR jitter at the sink around switches
+ *
+ * A synthetic CBR stream (~4 Mbps, PCR every 40 ms) is written the way the
+ * main loop writes the spliced output: in real time, in input-sized clumps,
+ * except that every 3 s a "switch" writes the buffered stream since its
+ * last IDR at
+ * once (the half-second GOP a newly selected source sends from its clean
+ * point).
+ *
+ *   direct: the writer hands packets straight to the sink
+ *   paced:  OutputPacer in front of the same sink
+ *
+ * Reported per run: output jitter at the sink (|wall time between two PCR
+ * packets - PCR time between them|, p50 / p99 / max), the largest burst
+ * (packets reaching the sink within any 10 ms, vs the ~35 the bitrate
+ * needs), the pacer's own jitter metric, its catch-ups and underruns, and
+ * errors: packets lost or reordered.
+ *
+ * Build: cmake -DBUILD_BENCHMARKS=ON .. && make pacer_bench
+ */
+
+#include "OutputPacer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int SECONDS = 12;
+constexpr int64_t BITRATE = 4000000;
+constexpr int64_t PACKETS_PER_SECOND = BITRATE / (188 * 8);    // ~2660
+constexpr int64_t PCR_INTERVAL_MS = 40;
+constexpr int64_t CLUMP_PACKETS = 7;                           // One 1316-byte datagram
+constexpr int SWITCH_EVERY_S = 3;
+constexpr int64_t BURST_MS = 500;
+constexpr uint16_t PID = 0x100;
+
+// Packet n of the stream, with a PCR every PCR_INTERVAL_MS; the sequence
+// number goes in the payload so the sink can check order
+ts::TSPacket makePacket(uint64_t n) {
+    ts::TSPacket pkt;
+    std::memset(pkt.b, 0xFF, ts::PKT_SIZE);
+    pkt.b[0] = 0x47;
+    pkt.b[1] = static_cast<uint8_t>(PID >> 8);
+    pkt.b[2] = static_cast<uint8_t>(PID & 0xFF);
+    pkt.b[3] = static_cast<uint8_t>(0x10 | (n & 0x0F));
+
+    int64_t pcr_every = PACKETS_PER_SECOND * PCR_INTERVAL_MS / 1000;
+    if (n % pcr_every == 0) {
+        int64_t pcr = static_cast<int64_t>(n) * 27000000 / PACKETS_PER_SECOND;
+        int64_t base = pcr / 300;
+        int64_t ext = pcr % 300;
+        pkt.b[3] = static_cast<uint8_t>(0x30 | (n & 0x0F));
+        pkt.b[4] = 7;
+        pkt.b[5] = 0x10;
+        pkt.b[6] = static_cast<uint8_t>(base >> 25);
+        pkt.b[7] = static_cast<uint8_t>(base >> 17);
+        pkt.b[8] = static_cast<uint8_t>(base >> 9);
+        pkt.b[9] = static_cast<uint8_t>(base >> 1);
+        pkt.b[10] = static_cast<uint8_t>(((base & 1) << 7) | 0x7E | (ext >> 8));
+        pkt.b[11] = static_cast<uint8_t>(ext);
+    }
+    std::memcpy(pkt.b + ts::PKT_SIZE - 8, &n, 8);
+    return pkt;
+}
+
+struct SinkResult {
+    std::vector<int64_t> jitter_us;
+    size_t max_burst = 0;
+    uint64_t packets = 0;
+    uint64_t errors = 0;
+};
+
+// Records when packets arrive; never blocks
+class TimingSink : public PacketSink {
+public:
+    explicit TimingSink(SinkResult& result) : result_(result) {}
+
+    bool open() override { return true; }
+    void close() override {}
+
+    bool writePacket(const ts::TSPacket& packet) override { return writePackets(&packet, 1); }
+    bool writePackets(const ts::TSPacket* packets, size_t count) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Clock::time_point now = Clock::now();
+        for (size_t i = 0; i < count; i++) {
+            const ts::TSPacket& pkt = packets[i];
+            uint64_t n;
+            std::memcpy(&n, pkt.b + ts::PKT_SIZE - 8, 8);
+            if (n != result_.packets) {
+                result_.errors++;
+            }
+            result_.packets = n + 1;
+
+            arrivals_.push_back(now);
+            while (now - arrivals_[window_start_] > std::chrono::milliseconds(10)) {
+                window_start_++;
+            }
+            result_.max_burst = std::max(result_.max_burst, arrivals_.size() - window_start_);
+
+            if ((pkt.b[3] & 0x20) && pkt.b[4] >= 7 && (pkt.b[5] & 0x10)) {
+                int64_t base = (static_cast<int64_t>(pkt.b[6]) << 25) | (static_cast<int64_t>(pkt.b[7]) << 17) |
+                               (static_cast<int64_t>(pkt.b[8]) << 9) | (static_cast<int64_t>(pkt.b[9]) << 1) |
+                               (pkt.b[10] >> 7);
+                int64_t pcr_us = base / 90 * 1000;
+                if (have_prev_) {
+                    int64_t wall_us = std::chrono::duration_cast<std::chrono::microseconds>(now - prev_wall_).count();
+                    result_.jitter_us.push_back(std::llabs(wall_us - (pcr_us - prev_pcr_us_)));
+                }
+                have_prev_ = true;
+                prev_wall_ = now;
+                prev_pcr_us_ = pcr_us;
+            }
+        }
+        return true;
+    }
+    using PacketSink::writePackets;
+
+    ts::TSPacket* reserve(size_t count) override { staging_.resize(count); return staging_.data(); }
+    bool commit(size_t count) override { return writePackets(staging_.data(), count); }
+    bool flush() override { return true; }
+    bool flushIfDue() override { return true; }
+    int getFlushWaitMs(int max_wait_ms) const override { return max_wait_ms; }
+    void setBatching(size_t, int) override {}
+    uint64_t getPacketsWritten() const override { return 0; }
+    uint64_t getBytesWritten() const override { return 0; }
+
+private:
+    SinkResult& result_;
+    std::mutex mutex_;
+    std::vector<ts::TSPacket> staging_;
+    std::vector<Clock::time_point> arrivals_;
+    size_t window_start_ = 0;
+    bool have_prev_ = false;
+    Clock::time_point prev_wall_;
+    int64_t prev_pcr_us_ = 0;
+};
+
+// Real time in clumps, plus BURST_MS of stream at once every SWITCH_EVERY_S
+void runWriter(PacketSink& output) {
+    Clock::time_point start = Clock::now();
+    uint64_t n = 0;
+    int64_t stream_offset_us = 0;      // Stream time written ahead of the wall clock
+    int next_switch_s = SWITCH_EVERY_S;
+    std::vector<ts::TSPacket> batch;
+
+    while (true) {
+        int64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+        if (elapsed_us >= SECONDS * 1000000LL) {
+            break;
+        }
+
+        batch.clear();
+        if (elapsed_us >= next_switch_s * 1000000LL) {
+            for (int64_t i = 0; i < PACKETS_PER_SECOND * BURST_MS / 1000; i++) {
+                batch.push_back(makePacket(n++));
+            }
+            stream_offset_us += BURST_MS * 1000;
+            next_switch_s += SWITCH_EVERY_S;
+        } else {
+            for (int64_t i = 0; i < CLUMP_PACKETS; i++) {
+                batch.push_back(makePacket(n++));
+            }
+        }
+        output.writePackets(batch.data(), batch.size());
+
+        int64_t due_us = static_cast<int64_t>(n) * 1000000 / PACKETS_PER_SECOND - stream_offset_us;
+        std::this_thread::sleep_until(start + std::chrono::microseconds(due_us));
+    }
+}
+
+void report(const char* name, SinkResult& r) {
+    std::sort(r.jitter_us.begin(), r.jitter_us.end());
+    auto q = [&](double p) -> int64_t {
+        return r.jitter_us.empty() ? 0 : r.jitter_us[static_cast<size_t>(p * (r.jitter_us.size() - 1))];
+    };
+    std::cout << std::left << std::setw(8) << name << std::right
+              << " packets=" << r.packets
+              << "  jitter p50=" << std::setw(6) << q(0.5) << " us"
+              << " p99=" << std::setw(7) << q(0.99) << " us"
+              << " max=" << std::setw(7) << q(1.0) << " us"
+              << "  max_burst/10ms=" << std::setw(5) << r.max_burst
+              << "  errors=" << r.errors << std::endl;
+}
+
+}  // namespace
+
+int main() {
+    std::cout << "Stream: " << BITRATE / 1000 << " kbps, PCR every " << PCR_INTERVAL_MS << " ms, "
+              << SECONDS << " s, a " << BURST_MS << " ms burst every " << SWITCH_EVERY_S << " s" << std::endl;
+
+    SinkResult direct;
+    {
+        TimingSink sink(direct);
+        runWriter(sink);
+    }
+    report("direct", direct);
+
+    SinkResult paced;
+    {
+        OutputPacer pacer(std::make_unique<TimingSink>(paced), OutputPacer::DEFAULT_LEAD_MS,
+                          OutputPacer::DEFAULT_MAX_RATE_PCT);
+        pacer.open();
+        runWriter(pacer);
+        LatencyHistogram::Snapshot jitter = pacer.getJitter();
+        std::cout << "pacer: jitter p50=" << jitter.quantileUs(0.5) << " us p99=" << jitter.quantileUs(0.99)
+                  << " us max=" << jitter.max_us << " us, catch_ups=" << pacer.getCatchUps()
+                  << ", underruns=" << pacer.getUnderruns() << ", backlog=" << pacer.getBacklogMs()
+                  << " ms, queued=" << pacer.getQueuedPackets() << std::endl;
+        pacer.close();
+    }
+    report("paced", paced);
+    return 0;
+}
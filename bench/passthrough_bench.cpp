@@ -0,0 +1,220 @@
+/*
+ * Output passthrough benchmark
+ *
+ * Pushes a TS stream from an input pipe to an output pipe the two ways the
+ * output can run, and measures what each costs the relay:
+ *
+ *   - userspace: read() into a scratch buffer, push into the ring, copy the
+ *     new packets out into the output batch, write() them to the output pipe
+ *   - passthrough: tee() the input pipe into the output pipe, then the same
+ *     read, ring push and copy-out (the reactor keeps indexing and the main
+ *     loop keeps tracking timestamps and CCs), but no write()
+ *
+ * A producer thread fills the input pipe and a consumer thread splice()s
+ * the output pipe to /dev/null, so neither adds userspace copies. Reports
+ * throughput, relay-thread CPU per MB (getrusage RUSAGE_THREAD) and, when
+ * the hardware counters are available (perf_event_open; not in most VMs and
+ * containers), cache misses of the relay thread as bytes of memory traffic
+ * per output byte. Without a PMU the CPU figures are the measurement.
+ *
+ * Build: cmake -DBUILD_BENCHMARKS=ON .. && make passthrough_bench
+ */
+
+#include "PacketRing.h"
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Stand-in for ts::TSPacket (same size and layout: 188 raw bytes)
+struct Packet {
+    uint8_t b[188];
+};
+
+constexpr size_t PACKET_SIZE = sizeof(Packet);
+constexpr size_t CHUNK = 348 * PACKET_SIZE;             // ~64 KB, whole packets
+constexpr size_t RING_CAPACITY = 8192;
+constexpr int PIPE_SIZE = 1024 * 1024;
+constexpr uint64_t TOTAL_BYTES = 4ULL * 1024 * 1024 * 1024 / PACKET_SIZE * PACKET_SIZE;   // ~4 GB
+
+enum class Mode { USERSPACE, PASSTHROUGH };
+
+struct Result {
+    double seconds = 0.0;
+    double cpu_seconds = 0.0;
+    uint64_t bytes = 0;
+    int64_t cache_misses = -1;      // -1: no hardware counter
+};
+
+double threadCpuSeconds() {
+    struct rusage ru;
+    getrusage(RUSAGE_THREAD, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+// Cache-miss counter for the calling thread, user + kernel where permitted
+int openCacheMissCounter() {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    if (fd < 0) {
+        attr.exclude_kernel = 1;    // perf_event_paranoid >= 2
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    return fd;
+}
+
+// Read whole packets; the pipe only ever holds whole packets here
+bool readFully(int fd, uint8_t* buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = read(fd, buf + done, len - done);
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool writeFully(int fd, const uint8_t* buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(fd, buf + done, len - done);
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+Result run(Mode mode) {
+    int in[2], out[2];
+    if (pipe(in) != 0 || pipe(out) != 0) {
+        std::cerr << "pipe() failed" << std::endl;
+        return {};
+    }
+    for (int fd : {in[0], out[0]}) {
+        fcntl(fd, F_SETPIPE_SZ, PIPE_SIZE);
+    }
+
+    std::thread producer([&] {
+        std::vector<uint8_t> data(CHUNK);
+        for (size_t i = 0; i < CHUNK; i += PACKET_SIZE) {
+            memset(&data[i], 0xFF, PACKET_SIZE);
+            data[i] = 0x47;
+        }
+        for (uint64_t sent = 0; sent < TOTAL_BYTES; sent += CHUNK) {
+            if (!writeFully(in[1], data.data(), CHUNK)) break;
+        }
+        close(in[1]);
+    });
+
+    std::thread consumer([&] {
+        int devnull = open("/dev/null", O_WRONLY);
+        while (splice(out[0], nullptr, devnull, nullptr, PIPE_SIZE, SPLICE_F_MOVE) > 0) {
+        }
+        close(devnull);
+    });
+
+    PacketRing<Packet> ring(RING_CAPACITY);
+    std::vector<uint8_t> scratch(CHUNK);
+    std::vector<Packet> batch(CHUNK / PACKET_SIZE);
+    uint64_t consumed = 0;
+
+    Result r;
+    int counter = openCacheMissCounter();
+    if (counter >= 0) ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    double cpu_start = threadCpuSeconds();
+    auto start = std::chrono::steady_clock::now();
+
+    while (r.bytes < TOTAL_BYTES) {
+        if (mode == Mode::PASSTHROUGH) {
+            // Duplicate the next chunk into the output before consuming it
+            size_t teed = 0;
+            while (teed < CHUNK) {
+                ssize_t t = tee(in[0], out[1], CHUNK - teed, 0);
+                if (t <= 0) break;
+                teed += static_cast<size_t>(t);
+            }
+            if (teed < CHUNK) break;
+        }
+        if (!readFully(in[0], scratch.data(), CHUNK)) break;
+
+        // Reactor: reassembled packets into the ring
+        const Packet* packets = reinterpret_cast<const Packet*>(scratch.data());
+        for (size_t i = 0; i < CHUNK / PACKET_SIZE; i++) {
+            ring.push(packets[i]);
+        }
+        if (ring.size() > RING_CAPACITY / 2) {
+            ring.trimTo(ring.headSequence() - RING_CAPACITY / 2);
+        }
+
+        // Main loop: copy the new packets out of the ring
+        uint64_t head = ring.headSequence();
+        size_t count = ring.view(consumed, head).copyTo(batch.data());
+        consumed = head;
+
+        if (mode == Mode::USERSPACE &&
+            !writeFully(out[1], reinterpret_cast<const uint8_t*>(batch.data()), count * PACKET_SIZE)) {
+            break;
+        }
+        r.bytes += CHUNK;
+    }
+
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    r.cpu_seconds = threadCpuSeconds() - cpu_start;
+    if (counter >= 0) {
+        ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+        long long misses = 0;
+        if (read(counter, &misses, sizeof(misses)) == sizeof(misses)) {
+            r.cache_misses = misses;
+        }
+        close(counter);
+    }
+
+    close(out[1]);
+    close(in[0]);
+    producer.join();
+    consumer.join();
+    close(out[0]);
+    return r;
+}
+
+} // namespace
+
+int main() {
+    std::cout << "Relay of " << TOTAL_BYTES / 1e9 << " GB, " << CHUNK / 1024 << " KB reads, "
+              << PIPE_SIZE / 1024 << " KB pipes" << std::endl;
+    std::cout << std::left << std::setw(14) << "mode"
+              << std::setw(10) << "MB/s"
+              << std::setw(16) << "relay cpu-ms/MB"
+              << std::setw(22) << "mem traffic B/out B" << std::endl;
+
+    for (Mode mode : {Mode::USERSPACE, Mode::PASSTHROUGH}) {
+        Result r = run(mode);
+        double mb = r.bytes / 1e6;
+        std::cout << std::left << std::setw(14) << (mode == Mode::USERSPACE ? "userspace" : "passthrough")
+                  << std::setw(10) << std::fixed << std::setprecision(0) << mb / r.seconds
+                  << std::setw(16) << std::setprecision(3) << 1000.0 * r.cpu_seconds / mb;
+        if (r.cache_misses >= 0) {
+            std::cout << std::setprecision(2) << 64.0 * r.cache_misses / r.bytes;
+        } else {
+            std::cout << "n/a (no PMU)";
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
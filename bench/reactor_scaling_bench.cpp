@@ -0,0 +1,192 @@
+/*
+ * InputReactor scaling benchmark
+ *
+ * Starts N UdpInputs on one InputReactor and reports the process thread
+ * count and CPU use for N = 3, 8 and 32: idle (sockets open, no traffic)
+ * and loaded (every input receiving a paced MPEG-TS stream over loopback).
+ * With one reactor thread for all inputs, the thread count must not grow
+ * with N and CPU should grow only with the received bitrate.
+ *
+ * The senders run in a forked child so their CPU is not counted; the
+ * reported CPU is user + system time of this process over wall time
+ * (100% = one core).
+ *
+ * Build: cmake -DBUILD_BENCHMARKS=ON .. && make reactor_scaling_bench
+ */
+
+#include "UdpInput.h"
+#include "InputReactor.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t TS_PER_DATAGRAM = 7;
+constexpr size_t DATAGRAM_SIZE = TS_PER_DATAGRAM * 188;
+constexpr uint16_t BASE_PORT = 43000;
+constexpr double STREAM_MBPS = 6.0;                     // Per input, a typical 1080p contribution feed
+constexpr auto SEND_TICK = std::chrono::milliseconds(10);
+constexpr auto MEASURE = std::chrono::seconds(3);
+
+// Threads of this process, from /proc/self/status
+int threadCount() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 8, "Threads:") == 0) {
+            return std::stoi(line.substr(8));
+        }
+    }
+    return -1;
+}
+
+double cpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+// Child process: paced datagrams to every port until killed
+[[noreturn]] void sendPaced(size_t inputs) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    std::vector<uint8_t> dgram(DATAGRAM_SIZE);
+    std::vector<uint8_t> cc(inputs, 0);
+
+    // Datagrams per tick per input, carrying the fraction over
+    const double per_tick = STREAM_MBPS * 1e6 / 8.0 / DATAGRAM_SIZE *
+                            std::chrono::duration<double>(SEND_TICK).count();
+    double credit = 0.0;
+
+    auto next = std::chrono::steady_clock::now();
+    for (;;) {
+        credit += per_tick;
+        size_t count = static_cast<size_t>(credit);
+        credit -= static_cast<double>(count);
+
+        for (size_t i = 0; i < inputs; i++) {
+            struct sockaddr_in dest;
+            memset(&dest, 0, sizeof(dest));
+            dest.sin_family = AF_INET;
+            dest.sin_port = htons(static_cast<uint16_t>(BASE_PORT + i));
+            dest.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+            for (size_t d = 0; d < count; d++) {
+                for (size_t p = 0; p < TS_PER_DATAGRAM; p++) {
+                    uint8_t* b = dgram.data() + p * 188;
+                    memset(b, 0xFF, 188);
+                    b[0] = 0x47;
+                    b[1] = 0x01;
+                    b[2] = 0x00;
+                    b[3] = 0x10 | (cc[i]++ & 0x0F);
+                }
+                sendto(fd, dgram.data(), dgram.size(), 0,
+                       reinterpret_cast<struct sockaddr*>(&dest), sizeof(dest));
+            }
+        }
+        next += SEND_TICK;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+struct Sample {
+    int threads = 0;
+    double cpu_percent = 0.0;
+    uint64_t datagrams = 0;
+};
+
+Sample measure(const std::vector<std::unique_ptr<UdpInput>>& inputs) {
+    uint64_t before = 0;
+    for (const auto& input : inputs) before += input->getDatagramsReceived();
+    double cpu_start = cpuSeconds();
+    auto start = std::chrono::steady_clock::now();
+
+    std::this_thread::sleep_for(MEASURE);
+
+    Sample s;
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    s.cpu_percent = 100.0 * (cpuSeconds() - cpu_start) / wall;
+    s.threads = threadCount();
+    for (const auto& input : inputs) s.datagrams += input->getDatagramsReceived();
+    s.datagrams -= before;
+    return s;
+}
+
+} // namespace
+
+int main() {
+    // The inputs and reassemblers log every open/close and sync; keep the table readable
+    std::stringstream input_log;
+    std::streambuf* saved_cout = std::cout.rdbuf();
+    std::streambuf* saved_cerr = std::cerr.rdbuf();
+    std::ostream out(saved_cout);
+
+    out << "One InputReactor (epoll), N UdpInputs, " << STREAM_MBPS << " Mbps per input when loaded, "
+        << std::chrono::duration<double>(MEASURE).count() << " s per sample" << std::endl;
+    out << "Threads before any input: " << threadCount() << std::endl;
+    out << std::left << std::setw(8) << "inputs"
+        << std::setw(14) << "threads idle"
+        << std::setw(12) << "CPU % idle"
+        << std::setw(16) << "threads loaded"
+        << std::setw(14) << "CPU % loaded"
+        << std::setw(12) << "Mbps recv"
+        << std::setw(14) << "CPU %/100Mbps" << std::endl;
+
+    for (size_t n : {3, 8, 32}) {
+        std::cout.rdbuf(input_log.rdbuf());
+        std::cerr.rdbuf(input_log.rdbuf());
+        std::vector<std::unique_ptr<UdpInput>> inputs;
+        InputReactor reactor;
+        reactor.setUseIoUring(false);
+        for (size_t i = 0; i < n; i++) {
+            inputs.push_back(std::make_unique<UdpInput>("Bench" + std::to_string(i), "127.0.0.1",
+                                                         static_cast<uint16_t>(BASE_PORT + i)));
+            reactor.addInput(*inputs.back());
+        }
+        reactor.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));   // Sockets bound
+
+        Sample idle = measure(inputs);
+
+        pid_t child = fork();
+        if (child == 0) {
+            sendPaced(n);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));   // Senders up to rate
+        Sample loaded = measure(inputs);
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+
+        reactor.stop();
+        std::cout.rdbuf(saved_cout);
+        std::cerr.rdbuf(saved_cerr);
+
+        double mbps = loaded.datagrams * DATAGRAM_SIZE * 8.0 / 1e6 /
+                      std::chrono::duration<double>(MEASURE).count();
+        out << std::left << std::setw(8) << n
+            << std::setw(14) << idle.threads
+            << std::setw(12) << std::fixed << std::setprecision(2) << idle.cpu_percent
+            << std::setw(16) << loaded.threads
+            << std::setw(14) << loaded.cpu_percent
+            << std::setw(12) << std::setprecision(1) << mbps
+            << std::setw(14) << std::setprecision(2) << (mbps > 0 ? loaded.cpu_percent * 100.0 / mbps : 0.0)
+            << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * Ring ingest microbenchmark
+ *
+ * Compares the per-packet ingest cost of the old rolling buffer
+ * (std::vector + erase-from-front + index rewrite) against PacketRing
+ * at typical input bitrates. Each run simulates 10 seconds of input
+ * with the buffer already full, which is the steady state of a reader.
+ *
+ * Build: cmake -DBUILD_BENCHMARKS=ON .. && make ring_ingest_bench
+ */
+
+#include "PacketRing.h"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+namespace {
+
+// Stand-in for ts::TSPacket (same size and layout: 188 raw bytes)
+struct Packet {
+    uint8_t b[188];
+};
+
+constexpr size_t MAX_BUFFER_PACKETS = 1500;
+constexpr size_t RING_CAPACITY = 2048;
+constexpr int SIMULATED_SECONDS = 10;
+
+// Previous implementation: vector with erase-from-front and five index fixups
+struct VectorBuffer {
+    std::vector<Packet> buffer;
+    size_t idr_index = 0, latest_idr_index = 0, audio_sync_index = 0;
+    size_t consume_index = 0, last_snapshot_end = 0;
+
+    void push(const Packet& pkt) {
+        buffer.push_back(pkt);
+        if (buffer.size() > MAX_BUFFER_PACKETS) {
+            size_t to_remove = buffer.size() - MAX_BUFFER_PACKETS;
+            buffer.erase(buffer.begin(), buffer.begin() + to_remove);
+            idr_index = idr_index >= to_remove ? idr_index - to_remove : 0;
+            latest_idr_index = latest_idr_index >= to_remove ? latest_idr_index - to_remove : 0;
+            consume_index = consume_index >= to_remove ? consume_index - to_remove : 0;
+            last_snapshot_end = last_snapshot_end >= to_remove ? last_snapshot_end - to_remove : 0;
+            audio_sync_index = audio_sync_index >= to_remove ? audio_sync_index - to_remove : 0;
+        }
+    }
+};
+
+// New implementation: sequence-numbered ring, O(1) trim
+struct RingBuffer {
+    PacketRing<Packet> ring{RING_CAPACITY};
+
+    void push(const Packet& pkt) {
+        ring.push(pkt);
+        if (ring.size() > MAX_BUFFER_PACKETS) {
+            ring.trimTo(ring.headSequence() - MAX_BUFFER_PACKETS);
+        }
+    }
+};
+
+template <typename Buffer>
+double nsPerPacket(size_t packets) {
+    Buffer buffer;
+    Packet pkt;
+    std::memset(pkt.b, 0xFF, sizeof(pkt.b));
+    pkt.b[0] = 0x47;
+
+    // Fill to steady state before timing
+    for (size_t i = 0; i < MAX_BUFFER_PACKETS; i++) buffer.push(pkt);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < packets; i++) {
+        pkt.b[3] = static_cast<uint8_t>(i);
+        buffer.push(pkt);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns / static_cast<double>(packets);
+}
+
+} // namespace
+
+int main() {
+    const uint64_t bitrates_mbps[] = {2, 10, 50};
+
+    std::cout << "Rolling buffer ingest cost (buffer full, " << MAX_BUFFER_PACKETS << " packets)" << std::endl;
+    std::cout << std::left << std::setw(10) << "bitrate"
+              << std::setw(12) << "pkts/s"
+              << std::setw(18) << "vector ns/pkt"
+              << std::setw(18) << "ring ns/pkt"
+              << std::setw(14) << "vector %cpu"
+              << std::setw(14) << "ring %cpu" << std::endl;
+
+    for (uint64_t mbps : bitrates_mbps) {
+        size_t pps = static_cast<size_t>(mbps * 1000000 / (188 * 8));
+        size_t packets = pps * SIMULATED_SECONDS;
+
+        double vec_ns = nsPerPacket<VectorBuffer>(packets);
+        double ring_ns = nsPerPacket<RingBuffer>(packets);
+
+        // Share of one core spent on buffering at this packet rate
+        double vec_cpu = vec_ns * pps / 1e7;
+        double ring_cpu = ring_ns * pps / 1e7;
+
+        std::cout << std::left << std::setw(10) << (std::to_string(mbps) + " Mbps")
+                  << std::setw(12) << pps
+                  << std::setw(18) << std::fixed << std::setprecision(1) << vec_ns
+                  << std::setw(18) << ring_ns
+                  << std::setw(14) << std::setprecision(3) << vec_cpu
+                  << std::setw(14) << ring_cpu << std::endl;
+    }
+
+    return 0;
+}
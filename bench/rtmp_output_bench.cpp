@@ -0,0 +1,753 @@
+/*
+ * RTMP output check and benchmark: in-process RTMPOutput vs the ffmpeg path
+ *
+ * A stub RTMP server on 127.0.0.1 accepts one publisher (handshake,
+ * connect / createStream / publish answers) and checks what arrives: the
+ * AVC sequence header comes first, every video message's AVCC NAL lengths
+ * add up, timestamps never go backwards. It records when each video frame
+ * arrives.
+ *
+ * The stream is paced in real time, one burst of TS packets per video
+ * frame (the frame plus the audio and PSI that go with it), and sent down
+ *   - in-process: RTMPOutput (FLVRemuxer + RTMPPublisher)
+ *   - ffmpeg: FIFOOutput -> named pipe -> ffmpeg -c copy -f flv (the
+ *     ffmpeg-rtmp-output container's command), if ffmpeg is in PATH and a
+ *     real clip is given (ffmpeg must be able to parse its SPS)
+ *
+ * Latency is measured per video frame from the write of its burst to the
+ * arrival of its RTMP message, over the frames after the first
+ * WARMUP_SECONDS (ffmpeg spends its first seconds probing the input). A
+ * video PES has no length, so both paths emit a frame when the next one
+ * starts: one frame interval is inherent. CPU is the output side only:
+ * the writing thread's CPU inside the output calls, plus RTMPOutput's
+ * sender thread or ffmpeg's own. "write" is the time the writing thread
+ * (the main loop) spends in one burst's output calls.
+ *
+ * A last run points RTMPOutput at a server that accepts the TCP connection
+ * and never answers: connecting times out in the sender thread, and the
+ * writes must stay as short as with a healthy server.
+ *
+ * Usage: rtmp_output_bench [clip.ts]   (synthetic H.264 / AAC without a clip;
+ *        a clip should start with an IDR, e.g. ffmpeg -f lavfi -i testsrc2
+ *        -f lavfi -i sine -c:v libx264 -g 30 -c:a aac -t 30 clip.ts)
+ *
+ * Against SRS instead of the stub: RTMP_OUTPUT_URL=rtmp://127.0.0.1/live/stream
+ * ts-multiplexer ..., then ffprobe rtmp://127.0.0.1/live/stream
+ *
+ * Build: cmake -DBUILD_BENCHMARKS=ON .. && make rtmp_output_bench
+ */
+
+#include "RTMPOutput.h"
+#include "FIFOOutput.h"
+#include "RTMPProtocol.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint16_t PORT = 42200;
+constexpr int SECONDS = 20;
+constexpr int WARMUP_SECONDS = 5;
+constexpr uint16_t PMT_PID = 0x1000;
+constexpr uint16_t VIDEO_PID = 0x100;
+constexpr uint16_t AUDIO_PID = 0x101;
+constexpr int FPS = 30;
+constexpr int GOP = 30;
+constexpr size_t P_FRAME_BYTES = 14000;    // ~3.4 Mbps with the IDRs
+constexpr size_t IDR_FRAME_BYTES = 60000;
+constexpr size_t AAC_FRAME_BYTES = 340;    // ~128 kbps at 48 kHz
+
+// One video frame's worth of TS, written at once
+struct Burst {
+    std::vector<ts::TSPacket> packets;
+    uint64_t dts = 0;               // 90 kHz, of the video frame
+    bool video = false;             // Starts a video PES (counts as a frame)
+};
+
+double threadCpuSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+uint32_t crc32Mpeg(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= static_cast<uint32_t>(data[i]) << 24;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// ---- Synthetic H.264 / AAC TS ----
+
+class SyntheticSource {
+public:
+    std::vector<Burst> generate(int seconds) {
+        std::vector<Burst> bursts;
+        uint64_t audio_pts = BASE;
+        for (int frame = 0; frame < seconds * FPS; frame++) {
+            Burst burst;
+            burst.video = true;
+            burst.dts = BASE + static_cast<uint64_t>(frame) * 90000 / FPS;
+            bool idr = frame % GOP == 0;
+            if (idr) {
+                psi(burst.packets);
+            }
+            // PTS two frames after DTS, like a stream with B-frames
+            packetize(burst.packets, VIDEO_PID, video_cc_, videoPES(idr, burst.dts + 2 * 90000 / FPS, burst.dts));
+
+            uint64_t next_dts = burst.dts + 90000 / FPS;
+            while (audio_pts < next_dts) {
+                packetize(burst.packets, AUDIO_PID, audio_cc_, audioPES(audio_pts));
+                audio_pts += 1024 * 90000 / 48000;
+            }
+            bursts.push_back(std::move(burst));
+        }
+        return bursts;
+    }
+
+private:
+    static constexpr uint64_t BASE = 900000;   // 10 s
+
+    static void putTimestamp(std::vector<uint8_t>& out, uint8_t prefix, uint64_t ts) {
+        out.push_back(static_cast<uint8_t>((prefix << 4) | ((ts >> 29) & 0x0E) | 1));
+        out.push_back(static_cast<uint8_t>(ts >> 22));
+        out.push_back(static_cast<uint8_t>(((ts >> 14) & 0xFE) | 1));
+        out.push_back(static_cast<uint8_t>(ts >> 7));
+        out.push_back(static_cast<uint8_t>(((ts << 1) & 0xFE) | 1));
+    }
+
+    // Filler that never forms a start code
+    void fill(std::vector<uint8_t>& out, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            out.push_back(static_cast<uint8_t>(0x10 + (seed_++ % 0xE0)));
+        }
+    }
+
+    std::vector<uint8_t> videoPES(bool idr, uint64_t pts, uint64_t dts) {
+        std::vector<uint8_t> pes = {0x00, 0x00, 0x01, 0xE0, 0x00, 0x00, 0x80, 0xC0, 10};
+        putTimestamp(pes, 3, pts);
+        putTimestamp(pes, 1, dts);
+        const uint8_t aud[] = {0, 0, 0, 1, 0x09, 0xF0};
+        pes.insert(pes.end(), aud, aud + sizeof(aud));
+        if (idr) {
+            const uint8_t sps[] = {0, 0, 0, 1, 0x67, 0x64, 0x00, 0x1F, 0xAC, 0xD9, 0x40, 0x50, 0x05, 0xBB, 0x01, 0x10};
+            const uint8_t pps[] = {0, 0, 0, 1, 0x68, 0xEB, 0xE3, 0xCB, 0x22, 0xC0};
+            pes.insert(pes.end(), sps, sps + sizeof(sps));
+            pes.insert(pes.end(), pps, pps + sizeof(pps));
+        }
+        const uint8_t slice[] = {0, 0, 1, static_cast<uint8_t>(idr ? 0x65 : 0x41)};
+        pes.insert(pes.end(), slice, slice + sizeof(slice));
+        fill(pes, idr ? IDR_FRAME_BYTES : P_FRAME_BYTES);
+        return pes;
+    }
+
+    std::vector<uint8_t> audioPES(uint64_t pts) {
+        size_t frame_length = 7 + AAC_FRAME_BYTES;
+        size_t pes_length = 3 + 5 + frame_length;
+        std::vector<uint8_t> pes = {0x00, 0x00, 0x01, 0xC0, static_cast<uint8_t>(pes_length >> 8),
+                                    static_cast<uint8_t>(pes_length), 0x80, 0x80, 5};
+        putTimestamp(pes, 2, pts);
+        // ADTS: AAC LC, 48 kHz, stereo, no CRC
+        pes.insert(pes.end(), {0xFF, 0xF1, 0x4C, static_cast<uint8_t>(0x80 | (frame_length >> 11)),
+                               static_cast<uint8_t>(frame_length >> 3),
+                               static_cast<uint8_t>(((frame_length & 7) << 5) | 0x1F), 0xFC});
+        fill(pes, AAC_FRAME_BYTES);
+        return pes;
+    }
+
+    void section(std::vector<ts::TSPacket>& out, uint16_t pid, uint8_t& cc, std::vector<uint8_t> sec) {
+        uint32_t crc = crc32Mpeg(sec.data(), sec.size());
+        sec.insert(sec.end(), {static_cast<uint8_t>(crc >> 24), static_cast<uint8_t>(crc >> 16),
+                               static_cast<uint8_t>(crc >> 8), static_cast<uint8_t>(crc)});
+        ts::TSPacket pkt;
+        memset(pkt.b, 0xFF, sizeof(pkt.b));
+        pkt.b[0] = 0x47;
+        pkt.b[1] = static_cast<uint8_t>(0x40 | (pid >> 8));
+        pkt.b[2] = static_cast<uint8_t>(pid);
+        pkt.b[3] = static_cast<uint8_t>(0x10 | (cc++ & 0x0F));
+        pkt.b[4] = 0;   // Pointer field
+        memcpy(pkt.b + 5, sec.data(), sec.size());
+        out.push_back(pkt);
+    }
+
+    void psi(std::vector<ts::TSPacket>& out) {
+        section(out, 0, pat_cc_, {0x00, 0xB0, 13, 0x00, 0x01, 0xC1, 0x00, 0x00,
+                                  0x00, 0x01, static_cast<uint8_t>(0xE0 | (PMT_PID >> 8)),
+                                  static_cast<uint8_t>(PMT_PID)});
+        section(out, PMT_PID, pmt_cc_, {0x02, 0xB0, 23, 0x00, 0x01, 0xC1, 0x00, 0x00,
+                                        static_cast<uint8_t>(0xE0 | (VIDEO_PID >> 8)), static_cast<uint8_t>(VIDEO_PID),
+                                        0xF0, 0x00,
+                                        0x1B, static_cast<uint8_t>(0xE0 | (VIDEO_PID >> 8)),
+                                        static_cast<uint8_t>(VIDEO_PID), 0xF0, 0x00,
+                                        0x0F, static_cast<uint8_t>(0xE0 | (AUDIO_PID >> 8)),
+                                        static_cast<uint8_t>(AUDIO_PID), 0xF0, 0x00});
+    }
+
+    // PES -> TS packets; the last one is padded with adaptation field stuffing
+    void packetize(std::vector<ts::TSPacket>& out, uint16_t pid, uint8_t& cc, const std::vector<uint8_t>& pes) {
+        size_t pos = 0;
+        while (pos < pes.size()) {
+            ts::TSPacket pkt;
+            pkt.b[0] = 0x47;
+            pkt.b[1] = static_cast<uint8_t>((pos == 0 ? 0x40 : 0x00) | (pid >> 8));
+            pkt.b[2] = static_cast<uint8_t>(pid);
+            size_t n = std::min<size_t>(184, pes.size() - pos);
+            size_t header = 4;
+            if (n < 184) {
+                size_t af_length = 183 - n;     // Adaptation field length byte excluded
+                pkt.b[3] = static_cast<uint8_t>(0x30 | (cc++ & 0x0F));
+                pkt.b[4] = static_cast<uint8_t>(af_length);
+                if (af_length > 0) {
+                    pkt.b[5] = 0x00;
+                    memset(pkt.b + 6, 0xFF, af_length - 1);
+                }
+                header = 5 + af_length;
+            } else {
+                pkt.b[3] = static_cast<uint8_t>(0x10 | (cc++ & 0x0F));
+            }
+            memcpy(pkt.b + header, pes.data() + pos, n);
+            pos += n;
+            out.push_back(pkt);
+        }
+    }
+
+    uint8_t pat_cc_ = 0;
+    uint8_t pmt_cc_ = 0;
+    uint8_t video_cc_ = 0;
+    uint8_t audio_cc_ = 0;
+    uint32_t seed_ = 0;
+};
+
+// ---- TS clip ----
+
+uint64_t pesDts(const uint8_t* pes) {
+    uint8_t flags = pes[7];
+    const uint8_t* p = ((flags & 0xC0) == 0xC0) ? pes + 14 : pes + 9;
+    return (static_cast<uint64_t>((p[0] >> 1) & 0x07) << 30) | (static_cast<uint64_t>(p[1]) << 22) |
+           (static_cast<uint64_t>(p[2] >> 1) << 15) | (static_cast<uint64_t>(p[3]) << 7) | (p[4] >> 1);
+}
+
+// Split a clip into bursts at each video PES start (stream_id 0xE0-0xEF)
+std::vector<Burst> loadClip(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::vector<Burst> bursts(1);
+    ts::TSPacket pkt;
+    while (in.read(reinterpret_cast<char*>(pkt.b), ts::PKT_SIZE)) {
+        if (pkt.b[0] != 0x47) {
+            std::cerr << "Lost TS sync in " << path << std::endl;
+            break;
+        }
+        size_t offset = 4 + ((pkt.b[3] & 0x20) ? 1 + pkt.b[4] : 0);
+        const uint8_t* pl = pkt.b + offset;
+        if ((pkt.b[1] & 0x40) && (pkt.b[3] & 0x10) && offset + 19 <= ts::PKT_SIZE &&
+            pl[0] == 0 && pl[1] == 0 && pl[2] == 1 && (pl[3] & 0xF0) == 0xE0 && (pl[7] & 0x80)) {
+            bursts.push_back(Burst());
+            bursts.back().video = true;
+            bursts.back().dts = pesDts(pl);
+        }
+        bursts.back().packets.push_back(pkt);
+    }
+    if (!bursts.empty() && !bursts.front().video) {
+        // PSI ahead of the first frame goes out with it
+        if (bursts.size() > 1) {
+            bursts[1].packets.insert(bursts[1].packets.begin(), bursts[0].packets.begin(), bursts[0].packets.end());
+        }
+        bursts.erase(bursts.begin());
+    }
+    return bursts;
+}
+
+// ---- Stub RTMP server ----
+
+class StubServer {
+public:
+    std::vector<Clock::time_point> video_arrivals;  // Frames, not sequence headers
+    uint64_t audio_messages = 0;
+    uint64_t config_messages = 0;
+    uint64_t errors = 0;
+    uint64_t bytes = 0;
+    bool published = false;
+
+    bool start(uint16_t port) {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int one = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            listen(listen_fd_, 1) < 0) {
+            std::cerr << "Stub server: cannot listen on " << port << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        running_ = true;
+        thread_ = std::thread(&StubServer::run, this);
+        return true;
+    }
+
+    void stop() {
+        running_ = false;
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        close(listen_fd_);
+    }
+
+private:
+    bool readFully(int fd, uint8_t* buf, size_t size) {
+        size_t have = 0;
+        while (have < size && running_) {
+            struct pollfd pfd = {fd, POLLIN, 0};
+            if (::poll(&pfd, 1, 100) != 1) {
+                continue;
+            }
+            ssize_t n = recv(fd, buf + have, size - have, 0);
+            if (n <= 0) {
+                return false;
+            }
+            have += n;
+        }
+        return have == size;
+    }
+
+    void send(int fd, uint8_t type, uint32_t stream_id, const std::vector<uint8_t>& payload) {
+        std::vector<uint8_t> out;
+        writer_.write(out, 3, type, 0, stream_id, payload.data(), payload.size());
+        ssize_t ret = ::send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+        (void)ret;
+    }
+
+    void sendStatus(int fd, double transaction, uint32_t stream_id, const std::string& code) {
+        std::vector<uint8_t> p;
+        rtmp::amfWriteString(p, "onStatus");
+        rtmp::amfWriteNumber(p, transaction);
+        rtmp::amfWriteNull(p);
+        rtmp::amfWriteObjectStart(p);
+        rtmp::amfWriteKey(p, "level");
+        rtmp::amfWriteString(p, "status");
+        rtmp::amfWriteKey(p, "code");
+        rtmp::amfWriteString(p, code);
+        rtmp::amfWriteKey(p, "description");
+        rtmp::amfWriteString(p, "Start publishing");
+        rtmp::amfWriteObjectEnd(p);
+        send(fd, rtmp::COMMAND_AMF0, stream_id, p);
+    }
+
+    void handleCommand(int fd, const rtmp::Message& msg) {
+        std::vector<rtmp::AMFValue> v = rtmp::amfReadAll(msg.payload.data(), msg.payload.size());
+        if (v.size() < 2) {
+            errors++;
+            return;
+        }
+        const std::string& name = v[0].string;
+        std::vector<uint8_t> p;
+        if (name == "connect") {
+            send(fd, rtmp::WINDOW_ACK_SIZE, 0, rtmp::uint32Payload(2500000));
+            // More than one 128-byte chunk: exercises the client's reassembly
+            rtmp::amfWriteString(p, "_result");
+            rtmp::amfWriteNumber(p, v[1].number);
+            rtmp::amfWriteObjectStart(p);
+            rtmp::amfWriteKey(p, "fmsVer");
+            rtmp::amfWriteString(p, "FMS/3,5,3,888");
+            rtmp::amfWriteKey(p, "capabilities");
+            rtmp::amfWriteNumber(p, 127);
+            rtmp::amfWriteObjectEnd(p);
+            rtmp::amfWriteObjectStart(p);
+            rtmp::amfWriteKey(p, "level");
+            rtmp::amfWriteString(p, "status");
+            rtmp::amfWriteKey(p, "code");
+            rtmp::amfWriteString(p, "NetConnection.Connect.Success");
+            rtmp::amfWriteKey(p, "description");
+            rtmp::amfWriteString(p, "Connection succeeded.");
+            rtmp::amfWriteKey(p, "objectEncoding");
+            rtmp::amfWriteNumber(p, 0);
+            rtmp::amfWriteObjectEnd(p);
+            send(fd, rtmp::COMMAND_AMF0, 0, p);
+        } else if (name == "createStream") {
+            rtmp::amfWriteString(p, "_result");
+            rtmp::amfWriteNumber(p, v[1].number);
+            rtmp::amfWriteNull(p);
+            rtmp::amfWriteNumber(p, 1);
+            send(fd, rtmp::COMMAND_AMF0, 0, p);
+        } else if (name == "publish") {
+            sendStatus(fd, 0, msg.stream_id, "NetStream.Publish.Start");
+            published = true;
+        }
+    }
+
+    void handleMedia(const rtmp::Message& msg) {
+        const std::vector<uint8_t>& d = msg.payload;
+        uint32_t& last = (msg.type == rtmp::VIDEO) ? last_video_ts_ : last_audio_ts_;
+        if (msg.timestamp < last) {
+            errors++;
+        }
+        last = msg.timestamp;
+
+        if (msg.type == rtmp::AUDIO) {
+            if (d.size() < 2 || d[0] != 0xAF) {
+                errors++;
+            } else if (d[1] == 0) {
+                config_messages++;
+            } else {
+                audio_messages++;
+            }
+            return;
+        }
+
+        if (d.size() < 5 || (d[0] & 0x0F) != 7) {
+            errors++;
+            return;
+        }
+        if (d[1] == 0) {
+            config_messages++;
+            have_video_config_ = true;
+            return;
+        }
+        if (!have_video_config_) {
+            errors++;   // Frame before the sequence header
+        }
+        size_t pos = 5;
+        while (pos + 4 <= d.size()) {
+            pos += 4 + rtmp::getBE32(&d[pos]);
+        }
+        if (pos != d.size()) {
+            errors++;   // NAL lengths don't add up
+        }
+        video_arrivals.push_back(Clock::now());
+    }
+
+    void run() {
+        int fd = -1;
+        while (running_ && fd < 0) {
+            struct pollfd pfd = {listen_fd_, POLLIN, 0};
+            if (::poll(&pfd, 1, 100) == 1) {
+                fd = accept(listen_fd_, nullptr, nullptr);
+            }
+        }
+        if (fd < 0) {
+            return;
+        }
+
+        // C0 + C1 -> S0 + S1 + S2 (S2 echoes C1), then C2
+        std::vector<uint8_t> c0c1(1 + rtmp::HANDSHAKE_SIZE);
+        std::vector<uint8_t> c2(rtmp::HANDSHAKE_SIZE);
+        if (!readFully(fd, c0c1.data(), c0c1.size())) {
+            close(fd);
+            return;
+        }
+        std::vector<uint8_t> s(1 + 2 * rtmp::HANDSHAKE_SIZE, 0);
+        s[0] = rtmp::VERSION;
+        std::copy(c0c1.begin() + 1, c0c1.end(), s.begin() + 1 + rtmp::HANDSHAKE_SIZE);
+        ssize_t ret = ::send(fd, s.data(), s.size(), MSG_NOSIGNAL);
+        (void)ret;
+        if (!readFully(fd, c2.data(), c2.size())) {
+            close(fd);
+            return;
+        }
+
+        rtmp::ChunkReader reader;
+        uint8_t buf[65536];
+        while (running_) {
+            struct pollfd pfd = {fd, POLLIN, 0};
+            if (::poll(&pfd, 1, 100) != 1) {
+                continue;
+            }
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n <= 0) {
+                break;
+            }
+            bytes += n;
+            reader.append(buf, static_cast<size_t>(n));
+            rtmp::Message msg;
+            while (reader.readMessage(msg)) {
+                if (msg.type == rtmp::COMMAND_AMF0) {
+                    handleCommand(fd, msg);
+                } else if (msg.type == rtmp::AUDIO || msg.type == rtmp::VIDEO) {
+                    handleMedia(msg);
+                }
+            }
+            if (reader.failed()) {
+                errors++;
+                break;
+            }
+        }
+        close(fd);
+    }
+
+    int listen_fd_ = -1;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    rtmp::ChunkWriter writer_;
+    uint32_t last_video_ts_ = 0;
+    uint32_t last_audio_ts_ = 0;
+    bool have_video_config_ = false;
+};
+
+// ---- Runs ----
+
+struct Result {
+    std::vector<Clock::time_point> sent;    // Per video frame
+    std::vector<double> write_ms;           // Per burst
+    double output_cpu_seconds = 0.0;
+    double seconds = 0.0;
+    bool ran = false;
+};
+
+// Write the bursts in real time; write_fn(burst) does the output calls
+template <typename WriteFn>
+void pace(const std::vector<Burst>& bursts, Result& r, WriteFn&& write_fn) {
+    auto start = Clock::now();
+    uint64_t first_dts = bursts.empty() ? 0 : bursts.front().dts;
+    for (const Burst& burst : bursts) {
+        auto due = start + std::chrono::microseconds(((burst.dts - first_dts) & ((1ULL << 33) - 1)) * 1000 / 90);
+        std::this_thread::sleep_until(due);
+        double cpu = threadCpuSeconds();
+        auto write_start = Clock::now();
+        write_fn(burst);
+        r.write_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - write_start).count());
+        r.output_cpu_seconds += threadCpuSeconds() - cpu;
+        if (burst.video) {
+            r.sent.push_back(Clock::now());
+        }
+    }
+    r.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// wait_publish: hold the stream until the sender thread has published,
+// so the first frames are not dropped while it connects
+Result runInProcess(const std::vector<Burst>& bursts, uint16_t port, bool wait_publish) {
+    Result r;
+    std::atomic<bool> running(true);
+    RTMPOutput output("rtmp://127.0.0.1:" + std::to_string(port) + "/live/bench", running);
+    if (!output.open()) {
+        return r;
+    }
+    auto deadline = Clock::now() + std::chrono::seconds(5);
+    while (wait_publish && !output.isPublishing() && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    pace(bursts, r, [&](const Burst& burst) {
+        output.writePackets(burst.packets.data(), burst.packets.size());
+        output.flushIfDue();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    r.output_cpu_seconds += output.getSenderCpuSeconds();
+    output.close();
+    r.ran = true;
+    return r;
+}
+
+Result runFfmpeg(const std::vector<Burst>& bursts, double& ffmpeg_cpu_seconds) {
+    Result r;
+    std::string pipe = "/tmp/rtmp_output_bench_" + std::to_string(getpid()) + ".ts";
+    unlink(pipe.c_str());
+    if (mkfifo(pipe.c_str(), 0600) < 0) {
+        std::cerr << "mkfifo failed: " << strerror(errno) << std::endl;
+        return r;
+    }
+
+    std::string url = "rtmp://127.0.0.1:" + std::to_string(PORT) + "/live/bench";
+    pid_t pid = fork();
+    if (pid == 0) {
+        execlp("ffmpeg", "ffmpeg", "-hide_banner", "-loglevel", "error", "-f", "mpegts", "-i", pipe.c_str(),
+               "-c", "copy", "-flvflags", "no_duration_filesize", "-rtmp_live", "live", "-rtmp_buffer", "0",
+               "-f", "flv", url.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+
+    std::atomic<bool> running(true);
+    {
+        FIFOOutput output(pipe, running);
+        if (output.open()) {
+            pace(bursts, r, [&](const Burst& burst) {
+                output.writePackets(burst.packets.data(), burst.packets.size());
+                output.flush();
+            });
+            r.ran = true;
+        }
+        output.close();     // EOF: ffmpeg drains and exits
+    }
+
+    int status = 0;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    ffmpeg_cpu_seconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+                         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    unlink(pipe.c_str());
+    return r;
+}
+
+double percentile(std::vector<double> v, double p) {
+    if (v.empty()) {
+        return 0.0;
+    }
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, static_cast<size_t>(p * v.size()))];
+}
+
+// Accepts connections into the backlog and never reads: the RTMP handshake stalls
+int listenSilently(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void report(std::ostream& out, const std::string& name, const Result& r, const StubServer& server,
+            double extra_cpu_seconds) {
+    size_t matched = std::min(r.sent.size(), server.video_arrivals.size());
+    std::vector<double> latency_ms;
+    size_t warmup = static_cast<size_t>(WARMUP_SECONDS * FPS);
+    for (size_t i = warmup; i < matched; i++) {
+        latency_ms.push_back(std::chrono::duration<double, std::milli>(server.video_arrivals[i] - r.sent[i]).count());
+    }
+    double startup_ms = server.video_arrivals.empty() || r.sent.empty() ? 0.0 :
+        std::chrono::duration<double, std::milli>(server.video_arrivals[0] - r.sent[0]).count();
+    double cpu = r.output_cpu_seconds + extra_cpu_seconds;
+
+    out << std::left << std::setw(12) << name
+        << std::setw(10) << r.sent.size()
+        << std::setw(10) << server.video_arrivals.size()
+        << std::setw(10) << server.audio_messages
+        << std::setw(10) << std::fixed << std::setprecision(1) << startup_ms
+        << std::setw(10) << percentile(latency_ms, 0.50)
+        << std::setw(10) << percentile(latency_ms, 0.95)
+        << std::setw(10) << percentile(latency_ms, 1.0)
+        << std::setw(10) << std::setprecision(2) << percentile(r.write_ms, 0.99)
+        << std::setw(10) << percentile(r.write_ms, 1.0)
+        << std::setw(12) << 100.0 * cpu / std::max(1e-9, r.seconds)
+        << std::setw(8) << server.errors << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    signal(SIGPIPE, SIG_IGN);
+    std::streambuf* saved_cout = std::cout.rdbuf();
+    std::ostream out(saved_cout);
+    std::stringstream output_log;
+
+    std::vector<Burst> bursts;
+    bool clip = argc > 1;
+    if (clip) {
+        bursts = loadClip(argv[1]);
+        out << "Clip " << argv[1] << ": " << bursts.size() << " video frames" << std::endl;
+    } else {
+        bursts = SyntheticSource().generate(SECONDS);
+        out << "Synthetic H.264/AAC: " << SECONDS << " s, " << FPS << " fps, GOP " << GOP << std::endl;
+    }
+    if (bursts.empty()) {
+        return 1;
+    }
+
+    out << "Latency: burst write -> RTMP message at the server, after the first " << WARMUP_SECONDS
+        << " s (ms); CPU: output side, % of one core" << std::endl;
+    out << std::left << std::setw(12) << "path"
+        << std::setw(10) << "frames"
+        << std::setw(10) << "received"
+        << std::setw(10) << "audio"
+        << std::setw(10) << "startup"
+        << std::setw(10) << "p50"
+        << std::setw(10) << "p95"
+        << std::setw(10) << "max"
+        << std::setw(10) << "write p99"
+        << std::setw(10) << "write max"
+        << std::setw(12) << "cpu %"
+        << std::setw(8) << "errors" << std::endl;
+
+    {
+        StubServer server;
+        if (!server.start(PORT)) {
+            return 1;
+        }
+        std::cout.rdbuf(output_log.rdbuf());
+        Result r = runInProcess(bursts, PORT, true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        server.stop();
+        std::cout.rdbuf(saved_cout);
+        if (!r.ran || !server.published) {
+            out << "in-process: publish failed" << std::endl << output_log.str();
+            return 1;
+        }
+        report(out, "in-process", r, server, 0.0);
+    }
+
+    {
+        // Server accepts TCP but never answers: the writes must not notice
+        int silent = listenSilently(PORT + 1);
+        if (silent < 0) {
+            return 1;
+        }
+        std::vector<Burst> stall(bursts.begin(), bursts.begin() + std::min<size_t>(bursts.size(), 8 * FPS));
+        std::streambuf* saved_cerr = std::cerr.rdbuf();
+        std::cout.rdbuf(output_log.rdbuf());
+        std::cerr.rdbuf(output_log.rdbuf());
+        Result r = runInProcess(stall, PORT + 1, false);
+        std::cout.rdbuf(saved_cout);
+        std::cerr.rdbuf(saved_cerr);
+        ::close(silent);
+        out << "Silent server, " << stall.size() / FPS << " s: write p99 " << std::setprecision(3)
+            << percentile(r.write_ms, 0.99) << " ms, max " << percentile(r.write_ms, 1.0) << " ms" << std::endl;
+    }
+
+    bool have_ffmpeg = system("command -v ffmpeg >/dev/null 2>&1") == 0;
+    if (!have_ffmpeg || !clip) {
+        out << "ffmpeg path skipped (" << (have_ffmpeg ? "needs a real clip" : "ffmpeg not in PATH") << ")"
+            << std::endl;
+        return 0;
+    }
+
+    StubServer server;
+    if (!server.start(PORT)) {
+        return 1;
+    }
+    std::cout.rdbuf(output_log.rdbuf());
+    double ffmpeg_cpu = 0.0;
+    Result r = runFfmpeg(bursts, ffmpeg_cpu);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    server.stop();
+    std::cout.rdbuf(saved_cout);
+    if (!r.ran) {
+        out << "ffmpeg path failed" << std::endl;
+        return 1;
+    }
+    report(out, "ffmpeg", r, server, ffmpeg_cpu);
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * SrtInput loopback check and benchmark
+ *
+ * Starts an SrtInput listener on 127.0.0.1 behind an InputReactor and
+ * connects a local libsrt caller to it that sends live-mode TS messages
+ * (7 packets = 1316 bytes each) at a fixed bitrate, like an encoder would.
+ * Reports what arrived through the full input path (reactor -> SrtInput ->
+ * reassembler -> ring) and the SRT statistics the input exported into
+ * StreamHealthMetrics. Then three callers connect one after the other to
+ * the same listener, each as soon as the previous one has closed, which
+ * is what an encoder restart looks like.
+ *
+ * Exits non-zero if any run loses more than MAX_LOSS_PERCENT of the TS
+ * packets sent, so it doubles as the SrtInput check in CI.
+ *
+ * The same listener can be exercised with ffmpeg as the sender:
+ *   CAMERA_SRT=127.0.0.1:1937 ts-multiplexer ...
+ *   ffmpeg -re -i clip.ts -c copy -f mpegts "srt://127.0.0.1:1937?mode=caller&latency=80000&pkt_size=1316"
+ *
+ * Build: cmake -DBUILD_BENCHMARKS=ON .. && make srt_loopback_bench (needs libsrt)
+ */
+
+#include "SrtInput.h"
+#include "InputReactor.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t TS_PER_MESSAGE = 7;
+constexpr size_t MESSAGE_SIZE = TS_PER_MESSAGE * 188;
+constexpr uint16_t BASE_PORT = 42100;
+constexpr int SECONDS = 10;
+constexpr int RECONNECT_CALLERS = 3;
+constexpr int RECONNECT_SECONDS = 3;
+constexpr double MAX_LOSS_PERCENT = 1.0;
+
+// Live-mode caller sending TS on one PID at `mbps`
+uint64_t sendStream(uint16_t port, double mbps, int seconds) {
+    SRTSOCKET s = srt_create_socket();
+    SRT_TRANSTYPE transtype = SRTT_LIVE;
+    srt_setsockflag(s, SRTO_TRANSTYPE, &transtype, sizeof(transtype));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (srt_connect(s, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == SRT_ERROR) {
+        std::cerr << "connect failed: " << srt_getlasterror_str() << std::endl;
+        srt_close(s);
+        return 0;
+    }
+
+    uint8_t msg[MESSAGE_SIZE];
+    uint8_t cc = 0;
+    double messages_per_second = mbps * 1e6 / 8 / MESSAGE_SIZE;
+    auto interval = std::chrono::duration<double>(1.0 / messages_per_second);
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::seconds(seconds);
+    uint64_t sent = 0;
+
+    while (std::chrono::steady_clock::now() < end) {
+        for (size_t p = 0; p < TS_PER_MESSAGE; p++) {
+            uint8_t* b = msg + p * 188;
+            memset(b, 0xFF, 188);
+            b[0] = 0x47;
+            b[1] = 0x01;
+            b[2] = 0x00;
+            b[3] = 0x10 | (cc++ & 0x0F);
+        }
+        if (srt_sendmsg(s, reinterpret_cast<const char*>(msg), MESSAGE_SIZE, -1, 1) != SRT_ERROR) {
+            sent++;
+        }
+        std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                  interval * static_cast<double>(sent)));
+    }
+
+    // Let the receiver's latency window drain before closing
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    srt_close(s);
+    return sent * TS_PER_MESSAGE;
+}
+
+double lossPercent(uint64_t sent, uint64_t received) {
+    return sent > 0 ? 100.0 * (static_cast<double>(sent) - static_cast<double>(received)) / sent : 100.0;
+}
+
+} // namespace
+
+int main() {
+    std::ostream out(std::cout.rdbuf());
+    std::stringstream input_log;
+
+    out << "SRT loopback: " << SECONDS << " s per bitrate, 80 ms latency" << std::endl;
+    out << std::left << std::setw(8) << "Mbps"
+        << std::setw(12) << "TS sent"
+        << std::setw(12) << "TS recv"
+        << std::setw(10) << "loss %"
+        << std::setw(10) << "rtt ms"
+        << std::setw(10) << "retrans"
+        << std::setw(10) << "dropped"
+        << std::setw(12) << "rcvbuf ms" << std::endl;
+
+    bool ok = true;
+    uint16_t port = BASE_PORT;
+    for (double mbps : {5.0, 20.0, 50.0}) {
+        std::cout.rdbuf(input_log.rdbuf());
+        SrtInput input("Bench", "127.0.0.1", port);
+        InputReactor reactor;
+        reactor.setUseIoUring(false);
+        reactor.addInput(input);
+        reactor.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        // Sample the buffer while the stream is running
+        TransportStats during;
+        std::thread sampler([&] {
+            std::this_thread::sleep_for(std::chrono::seconds(SECONDS / 2));
+            during = input.getTransportStats();
+        });
+        uint64_t sent = sendStream(port++, mbps, SECONDS);
+        sampler.join();
+        TransportStats after = input.getTransportStats();
+        uint64_t received = input.getPacketsReceived();
+        reactor.stop();
+        std::cout.rdbuf(out.rdbuf());
+
+        double loss = lossPercent(sent, received);
+        ok = ok && loss <= MAX_LOSS_PERCENT;
+        out << std::left << std::setw(8) << mbps
+            << std::setw(12) << sent
+            << std::setw(12) << received
+            << std::setw(10) << std::fixed << std::setprecision(2) << loss
+            << std::setw(10) << std::setprecision(1) << during.rtt_ms
+            << std::setw(10) << std::max(during.retransmitted_packets, after.retransmitted_packets)
+            << std::setw(10) << std::max(during.dropped_packets, after.dropped_packets)
+            << std::setw(12) << during.rcv_buffer_ms << std::endl;
+    }
+
+    // Callers back to back on one listener
+    out << std::endl << "Reconnects: " << RECONNECT_CALLERS << " callers in a row, "
+        << RECONNECT_SECONDS << " s each at 5 Mbps" << std::endl;
+    out << std::left << std::setw(8) << "caller"
+        << std::setw(12) << "TS sent"
+        << std::setw(12) << "TS recv"
+        << std::setw(10) << "loss %" << std::endl;
+    {
+        std::cout.rdbuf(input_log.rdbuf());
+        SrtInput input("Bench", "127.0.0.1", port);
+        InputReactor reactor;
+        reactor.setUseIoUring(false);
+        reactor.addInput(input);
+        reactor.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        for (int caller = 1; caller <= RECONNECT_CALLERS; caller++) {
+            uint64_t before = input.getPacketsReceived();
+            uint64_t sent = sendStream(port, 5.0, RECONNECT_SECONDS);
+            uint64_t received = input.getPacketsReceived() - before;
+            double loss = lossPercent(sent, received);
+            ok = ok && loss <= MAX_LOSS_PERCENT;
+            std::cout.rdbuf(out.rdbuf());
+            out << std::left << std::setw(8) << caller
+                << std::setw(12) << sent
+                << std::setw(12) << received
+                << std::setw(10) << std::fixed << std::setprecision(2) << loss << std::endl;
+            std::cout.rdbuf(input_log.rdbuf());
+        }
+        reactor.stop();
+        std::cout.rdbuf(out.rdbuf());
+    }
+
+    out << (ok ? "OK" : "FAILED: loss above " + std::to_string(MAX_LOSS_PERCENT) + "%") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+/*
+ * UdpInput loopback benchmark
+ *
+ * Sends MPEG-TS over UDP to 127.0.0.1 (7 TS packets = 1316 bytes per
+ * datagram, like ffmpeg / OBS / SRT gateways) and receives it through the
+ * full input path: InputReactor -> UdpInput (recvmmsg) -> reassembler ->
+ * indexing -> ring.
+ *
+ *   - throughput: the sender floods as fast as it can; reports received
+ *     datagrams/s and TS packets/s, datagrams per recvmmsg() call and loss,
+ *     for several batch sizes (1 = one datagram per system call)
+ *   - burst: back-to-back bursts (an IDR worth of data arriving at once)
+ *     paced at a sustainable average rate; reports loss per burst size for
+ *     a small and a large socket receive buffer
+ *
+ * Loss on loopback is pure receiver overrun (socket buffer full), which is
+ * also what SO_RXQ_OVFL counts. Large buffers need net.core.rmem_max (or
+ * CAP_NET_ADMIN) to take effect; the input warns when they are capped.
+ *
+ * Build: cmake -DBUILD_BENCHMARKS=ON .. && make udp_input_bench
+ */
+
+#include "UdpInput.h"
+#include "InputReactor.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t TS_PER_DATAGRAM = 7;
+constexpr size_t DATAGRAM_SIZE = TS_PER_DATAGRAM * 188;
+constexpr size_t SEND_BATCH = 64;
+constexpr uint16_t BASE_PORT = 42000;
+
+struct Result {
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    uint64_t recv_calls = 0;
+    uint64_t kernel_drops = 0;
+    double seconds = 0.0;
+};
+
+// Datagrams of TS packets on one PID with running continuity counters
+class Sender {
+public:
+    explicit Sender(uint16_t port) : fd_(socket(AF_INET, SOCK_DGRAM, 0)), cc_(0) {
+        memset(&dest_, 0, sizeof(dest_));
+        dest_.sin_family = AF_INET;
+        dest_.sin_port = htons(port);
+        dest_.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int bufsize = 4 * 1024 * 1024;
+        setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+        buffer_.resize(SEND_BATCH * DATAGRAM_SIZE);
+    }
+
+    ~Sender() { close(fd_); }
+
+    // Send count datagrams back to back with sendmmsg()
+    uint64_t send(size_t count) {
+        uint64_t sent = 0;
+        while (sent < count) {
+            size_t batch = std::min(SEND_BATCH, count - sent);
+            struct mmsghdr msgs[SEND_BATCH];
+            struct iovec iov[SEND_BATCH];
+            for (size_t i = 0; i < batch; i++) {
+                uint8_t* dgram = buffer_.data() + i * DATAGRAM_SIZE;
+                for (size_t p = 0; p < TS_PER_DATAGRAM; p++) {
+                    uint8_t* b = dgram + p * 188;
+                    memset(b, 0xFF, 188);
+                    b[0] = 0x47;
+                    b[1] = 0x01;
+                    b[2] = 0x00;
+                    b[3] = 0x10 | (cc_++ & 0x0F);
+                }
+                iov[i].iov_base = dgram;
+                iov[i].iov_len = DATAGRAM_SIZE;
+                memset(&msgs[i], 0, sizeof(msgs[i]));
+                msgs[i].msg_hdr.msg_iov = &iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+                msgs[i].msg_hdr.msg_name = &dest_;
+                msgs[i].msg_hdr.msg_namelen = sizeof(dest_);
+            }
+            int n = sendmmsg(fd_, msgs, static_cast<unsigned>(batch), 0);
+            if (n <= 0) {
+                continue;   // ENOBUFS: retry
+            }
+            sent += n;
+        }
+        return sent;
+    }
+
+private:
+    int fd_;
+    struct sockaddr_in dest_;
+    uint8_t cc_;
+    std::vector<uint8_t> buffer_;
+};
+
+// Wait until the input has seen everything or stopped receiving
+void waitQuiet(const UdpInput& input, uint64_t expected) {
+    uint64_t last = input.getDatagramsReceived();
+    auto last_change = std::chrono::steady_clock::now();
+    while (last < expected &&
+           std::chrono::steady_clock::now() - last_change < std::chrono::milliseconds(200)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        uint64_t now = input.getDatagramsReceived();
+        if (now != last) {
+            last = now;
+            last_change = std::chrono::steady_clock::now();
+        }
+    }
+}
+
+// Run one scenario against a fresh reactor + input
+template <typename SendFn>
+Result run(uint16_t port, size_t recv_batch, int rcvbuf, SendFn&& send_fn) {
+    UdpInput input("Bench", "127.0.0.1", port);
+    input.setRecvBatch(recv_batch);
+    input.setReceiveBufferSize(rcvbuf);
+
+    InputReactor reactor;
+    reactor.setUseIoUring(false);
+    reactor.addInput(input);
+    reactor.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));   // Socket bound
+
+    Sender sender(port);
+    Result r;
+    auto start = std::chrono::steady_clock::now();
+    r.sent = send_fn(sender);
+    waitQuiet(input, r.sent);
+    auto end = std::chrono::steady_clock::now();
+
+    r.received = input.getDatagramsReceived();
+    r.recv_calls = input.getRecvCalls();
+    r.kernel_drops = input.getKernelDrops();
+    r.seconds = std::chrono::duration<double>(end - start).count();
+    reactor.stop();
+    return r;
+}
+
+double lossPercent(const Result& r) {
+    return r.sent > 0 ? 100.0 * static_cast<double>(r.sent - r.received) / static_cast<double>(r.sent) : 0.0;
+}
+
+} // namespace
+
+int main() {
+    // The inputs log every open/close; keep the tables readable
+    std::stringstream input_log;
+    std::streambuf* saved_cout = std::cout.rdbuf();
+    std::ostream out(saved_cout);
+
+    uint16_t port = BASE_PORT;
+
+    const size_t FLOOD_DATAGRAMS = 500000;
+    out << "Throughput: " << FLOOD_DATAGRAMS << " datagrams flooded over loopback, 8 MB rcvbuf" << std::endl;
+    out << std::left << std::setw(8) << "batch"
+        << std::setw(14) << "dgram/s"
+        << std::setw(14) << "TS pkt/s"
+        << std::setw(12) << "dgram/call"
+        << std::setw(10) << "loss %"
+        << std::setw(12) << "kern drops" << std::endl;
+
+    for (size_t batch : {1, 8, 32, 64}) {
+        std::cout.rdbuf(input_log.rdbuf());
+        Result r = run(port++, batch, 8 * 1024 * 1024,
+                       [&](Sender& s) { return s.send(FLOOD_DATAGRAMS); });
+        std::cout.rdbuf(saved_cout);
+
+        double dps = r.received / r.seconds;
+        out << std::left << std::setw(8) << batch
+            << std::setw(14) << std::fixed << std::setprecision(0) << dps
+            << std::setw(14) << dps * TS_PER_DATAGRAM
+            << std::setw(12) << std::setprecision(1)
+            << (r.recv_calls > 0 ? static_cast<double>(r.received) / r.recv_calls : 0.0)
+            << std::setw(10) << std::setprecision(2) << lossPercent(r)
+            << std::setw(12) << r.kernel_drops << std::endl;
+    }
+
+    // Bursts every 100 ms: 100 bursts of N datagrams each. 2000 datagrams is
+    // ~2.6 MB at once (a large IDR at high bitrate), ~210 Mbps on average.
+    out << std::endl << "Burst loss: 100 bursts every 100 ms, batch 32" << std::endl;
+    out << std::left << std::setw(14) << "burst dgrams"
+        << std::setw(14) << "burst bytes"
+        << std::setw(16) << "loss % (256K)"
+        << std::setw(16) << "loss % (8M)" << std::endl;
+
+    for (size_t burst : {100, 500, 1000, 2000}) {
+        double loss[2];
+        int buffers[2] = {256 * 1024, 8 * 1024 * 1024};
+        for (int b = 0; b < 2; b++) {
+            std::cout.rdbuf(input_log.rdbuf());
+            Result r = run(port++, 32, buffers[b], [&](Sender& s) {
+                uint64_t sent = 0;
+                auto next = std::chrono::steady_clock::now();
+                for (int i = 0; i < 100; i++) {
+                    sent += s.send(burst);
+                    next += std::chrono::milliseconds(100);
+                    std::this_thread::sleep_until(next);
+                }
+                return sent;
+            });
+            std::cout.rdbuf(saved_cout);
+            loss[b] = lossPercent(r);
+        }
+        out << std::left << std::setw(14) << burst
+            << std::setw(14) << burst * DATAGRAM_SIZE
+            << std::setw(16) << std::fixed << std::setprecision(2) << loss[0]
+            << std::setw(16) << loss[1] << std::endl;
+    }
+
+    return 0;
+}
@@ -10,6 +10,7 @@ const multer = require('multer');
 const AggregatorService = require('./services/aggregator');
 const ControllerService = require('./services/controller');
 const ControllerWebSocketClient = require('./services/controllerWebSocket');
+const MultiplexerEventsClient = require('./services/multiplexerEvents');
 const SceneService = require('./services/scene');
 const metricsService = require('./services/metrics');
 const uploadProcessor = require('./services/uploadProcessor');
@@ -44,6 +45,7 @@ console.log('='.repeat(60));
 
 const controller = new ControllerService(CONTROLLER_API);
 const controllerWs = new ControllerWebSocketClient(CONTROLLER_API);
+const muxerEvents = new MultiplexerEventsClient(MUXER_API);
 
 // Initialize aggregator with reference to controller WebSocket for scene state
 const aggregator = new AggregatorService({
@@ -53,7 +55,8 @@ const aggregator = new AggregatorService({
   pollingInterval: POLLING_INTERVAL,
   srtPort: SRT_PORT,
   srtDomain: SRT_DOMAIN,
-  controllerWs: controllerWs  // Pass reference to get scene state
+  controllerWs: controllerWs,  // Pass reference to get scene state
+  multiplexerEvents: muxerEvents  // Pushed input metrics instead of polling
 });
 // Note: SceneService not initialized - no compositor in this project
 // const sceneService = new SceneService(COMPOSITOR_API);
@@ -339,6 +342,26 @@ controllerWs.on('error', (error) => {
   console.error('[main] Controller WebSocket error:', error.message);
 });
 
+// Multiplexer event stream: scene switches reach the frontend as they happen
+// instead of after the round trip through the controller
+muxerEvents.on('scene', (data) => {
+  console.log(`[main] Multiplexer scene changed to: ${data.scene}`);
+  broadcast({
+    type: 'scene_change',
+    currentScene: data.scene,
+    privacyEnabled: controllerWs.getPrivacyEnabled(),
+    timestamp: new Date().toISOString(),
+    sceneStartedAt: data.scene_started_at
+  });
+});
+
+muxerEvents.on('metrics', (inputMetrics) => {
+  broadcast({
+    type: 'aggregated_data',
+    inputMetrics
+  });
+});
+
 // REST API endpoints
 
 // Health check
@@ -1176,6 +1199,9 @@ server.listen(PORT, '0.0.0.0', () => {
   controllerWs.connect();
   console.log('[main][startup-debug] controllerWs.connect() called - connection in progress');
   
+  // Subscribe to multiplexer events (scene changes, health, input metrics)
+  muxerEvents.connect();
+  
   // Start aggregator polling to fetch input metrics and other data
   console.log('[main] Starting aggregator polling...');
   aggregator.startPolling((data) => {
@@ -1202,8 +1228,9 @@ process.on('SIGTERM', () => {
     console.log('[main] Metrics polling stopped');
   }
   
-  // Disconnect from controller WebSocket
+  // Disconnect from controller WebSocket and multiplexer event stream
   controllerWs.disconnect();
+  muxerEvents.disconnect();
   
   // Close all frontend WebSocket connections immediately
   console.log(`[main] Closing ${wss.clients.size} frontend WebSocket connection(s)`);
@@ -1231,8 +1258,9 @@ process.on('SIGINT', () => {
     console.log('[main] Metrics polling stopped');
   }
   
-  // Disconnect from controller WebSocket
+  // Disconnect from controller WebSocket and multiplexer event stream
   controllerWs.disconnect();
+  muxerEvents.disconnect();
   
   // Close all frontend WebSocket connections immediately
   console.log(`[main] Closing ${wss.clients.size} frontend WebSocket connection(s)`);
@@ -41,6 +41,9 @@ class AggregatorService {
     // Controller WebSocket client for scene/privacy state
     this.controllerWs = config.controllerWs;
     
+    // Multiplexer event stream, pushes input metrics (see getInputMetrics)
+    this.multiplexerEvents = config.multiplexerEvents;
+    
     // SRT configuration from environment
     this.srtPort = config.srtPort;
     this.srtDomain = config.srtDomain;
@@ -105,8 +108,15 @@ class AggregatorService {
 
   /**
    * Get input metrics from multiplexer
+   * Taken from the /events stream while it is connected; /input-metrics
+   * is only polled while it is not.
    */
   async getInputMetrics() {
+    const streamed = this.multiplexerEvents?.getInputMetrics();
+    if (streamed) {
+      return streamed;
+    }
+
     return new Promise((resolve) => {
       // Parse multiplexer URL
       const url = new URL(this.multiplexerUrl);
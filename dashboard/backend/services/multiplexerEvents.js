@@ -0,0 +1,179 @@
+const http = require('http');
+const EventEmitter = require('events');
+
+/**
+ * Server-Sent Events client for the multiplexer's GET /events stream
+ * Replaces polling /input-metrics: the multiplexer pushes a snapshot on
+ * connect, then scene changes as they happen, health transitions and
+ * once a second the inputs whose metrics changed.
+ *
+ * Emits 'scene' ({scene, scene_started_at}), 'health' ({output, inputs})
+ * and 'metrics' (the merged metrics of all inputs).
+ */
+class MultiplexerEventsClient extends EventEmitter {
+  constructor(multiplexerUrl) {
+    super();
+
+    this.url = new URL(multiplexerUrl);
+    this.req = null;
+    this.reconnectAttempts = 0;
+    this.reconnectDelay = 2000; // Start with 2 seconds
+    this.maxReconnectDelay = 30000; // Max 30 seconds
+    this.isConnected = false;
+    this.shouldReconnect = true;
+
+    // Latest state from the stream, merged across deltas
+    this.inputMetrics = null;
+    this.health = null;
+    this.scene = null;
+
+    console.log(`[muxer-events] Initialized with URL: ${this.url.origin}/events`);
+  }
+
+  connect() {
+    if (this.req) {
+      return;
+    }
+
+    this.shouldReconnect = true;
+    console.log(`[muxer-events] Connecting to ${this.url.origin}/events...`);
+
+    const req = http.get({
+      hostname: this.url.hostname,
+      port: this.url.port || 8091,
+      path: '/events',
+      headers: { Accept: 'text/event-stream' }
+    }, (res) => {
+      if (res.statusCode !== 200) {
+        console.error(`[muxer-events] Unexpected status ${res.statusCode}`);
+        res.resume();
+        this.handleClose(req);
+        req.destroy();
+        return;
+      }
+
+      console.log('[muxer-events] Connected to multiplexer event stream');
+      this.isConnected = true;
+      this.reconnectAttempts = 0;
+      this.reconnectDelay = 2000;
+      this.emit('connected');
+
+      let buffer = '';
+      res.setEncoding('utf8');
+      res.on('data', (chunk) => {
+        buffer += chunk;
+        // Messages end with a blank line
+        let end;
+        while ((end = buffer.indexOf('\n\n')) !== -1) {
+          this.handleMessage(buffer.slice(0, end));
+          buffer = buffer.slice(end + 2);
+        }
+      });
+      res.on('close', () => this.handleClose(req));
+    });
+    this.req = req;
+
+    req.on('error', (error) => {
+      console.error('[muxer-events] Connection error:', error.message);
+      this.handleClose(req);
+    });
+  }
+
+  handleClose(req) {
+    // Only once per request, and not for one disconnect() already dropped
+    if (this.req !== req) {
+      return;
+    }
+    this.req = null;
+    if (this.isConnected) {
+      console.log('[muxer-events] Event stream closed');
+      this.isConnected = false;
+      this.emit('disconnected');
+    }
+    if (this.shouldReconnect) {
+      this.scheduleReconnect();
+    }
+  }
+
+  scheduleReconnect() {
+    this.reconnectAttempts++;
+    console.log(`[muxer-events] Reconnecting in ${this.reconnectDelay / 1000}s (attempt ${this.reconnectAttempts})...`);
+
+    this.reconnectTimer = setTimeout(() => {
+      this.reconnectTimer = null;
+      this.connect();
+    }, this.reconnectDelay);
+
+    // Exponential backoff with max cap
+    this.reconnectDelay = Math.min(this.reconnectDelay * 2, this.maxReconnectDelay);
+  }
+
+  handleMessage(text) {
+    let event = 'message';
+    let data = '';
+    for (const line of text.split('\n')) {
+      if (line.startsWith('event:')) {
+        event = line.slice(6).trim();
+      } else if (line.startsWith('data:')) {
+        data += line.slice(5).trim();
+      }
+      // Comments (": ping") and retry: need no handling
+    }
+    if (!data) {
+      return;
+    }
+
+    let payload;
+    try {
+      payload = JSON.parse(data);
+    } catch (error) {
+      console.error(`[muxer-events] Error parsing ${event} event:`, error.message);
+      return;
+    }
+
+    switch (event) {
+      case 'scene':
+        console.log(`[muxer-events] Scene change received: ${payload.scene}`);
+        this.scene = payload;
+        this.emit('scene', payload);
+        break;
+
+      case 'health':
+        this.health = payload;
+        this.emit('health', payload);
+        break;
+
+      case 'metrics':
+        // Only the inputs that changed are sent
+        this.inputMetrics = { ...this.inputMetrics, ...payload };
+        this.emit('metrics', this.inputMetrics);
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  disconnect() {
+    console.log('[muxer-events] Disconnecting...');
+    this.shouldReconnect = false;
+    if (this.reconnectTimer) {
+      clearTimeout(this.reconnectTimer);
+      this.reconnectTimer = null;
+    }
+    if (this.req) {
+      this.req.destroy();
+      this.req = null;
+    }
+    this.isConnected = false;
+  }
+
+  /**
+   * Latest input metrics, null until the stream delivered them
+   */
+  getInputMetrics() {
+    return this.isConnected ? this.inputMetrics : null;
+  }
+}
+
+module.exports = MultiplexerEventsClient;
@@ -0,0 +1,211 @@
+#include "ControllerNotifier.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+ControllerNotifier::ControllerNotifier()
+    : thread_(&ControllerNotifier::threadFunc, this) {
+}
+
+ControllerNotifier::~ControllerNotifier() {
+    stop();
+}
+
+void ControllerNotifier::notify(const std::string& controller_url, const std::string& scene, int64_t timestamp_ms) {
+    if (timestamp_ms <= 0) {
+        timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_) {
+            coalesced_++;
+        }
+        pending_ = Notification{controller_url, scene, timestamp_ms};
+    }
+    cv_.notify_one();
+}
+
+void ControllerNotifier::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void ControllerNotifier::threadFunc() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return stopping_ || pending_.has_value(); });
+        if (stopping_) {
+            return;
+        }
+        Notification notification = std::move(*pending_);
+        pending_.reset();
+
+        int delay_ms = RETRY_INITIAL_MS;
+        for (int attempt = 1; ; attempt++) {
+            lock.unlock();
+            SendResult result = send(notification);
+            lock.lock();
+
+            if (result == SendResult::OK) {
+                sent_++;
+                std::cout << "[ControllerNotifier] Scene change sent: " << notification.scene << std::endl;
+                break;
+            }
+            if (result == SendResult::REJECTED || attempt >= MAX_ATTEMPTS) {
+                failed_++;
+                std::cerr << "[ControllerNotifier] Giving up on scene " << notification.scene
+                          << " after " << attempt << " attempt(s)" << std::endl;
+                break;
+            }
+
+            // Back off, unless a newer scene makes this one moot
+            if (cv_.wait_for(lock, std::chrono::milliseconds(delay_ms),
+                             [this] { return stopping_ || pending_.has_value(); })) {
+                if (!stopping_) {
+                    std::cout << "[ControllerNotifier] Scene " << notification.scene
+                              << " superseded before it was delivered" << std::endl;
+                }
+                break;
+            }
+            delay_ms = std::min(delay_ms * 2, RETRY_MAX_MS);
+        }
+    }
+}
+
+ControllerNotifier::SendResult ControllerNotifier::send(const Notification& notification) {
+    // http://host:port or http://host
+    std::string url_part = notification.url;
+    size_t protocol_end = url_part.find("://");
+    if (protocol_end != std::string::npos) {
+        url_part = url_part.substr(protocol_end + 3);
+    }
+    url_part = url_part.substr(0, url_part.find('/'));
+    std::string host = url_part;
+    std::string port = std::to_string(DEFAULT_PORT);
+    size_t port_pos = url_part.find(':');
+    if (port_pos != std::string::npos) {
+        host = url_part.substr(0, port_pos);
+        port = url_part.substr(port_pos + 1);
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* addrs = nullptr;
+    int rc = getaddrinfo(host.c_str(), port.c_str(), &hints, &addrs);
+    if (rc != 0) {
+        std::cerr << "[ControllerNotifier] Cannot resolve " << host << ": " << gai_strerror(rc) << std::endl;
+        return SendResult::RETRY;
+    }
+
+    int sock = -1;
+    for (struct addrinfo* ai = addrs; ai != nullptr && sock < 0; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            continue;
+        }
+        struct pollfd pfd = {fd, POLLOUT, 0};
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if ((::connect(fd, ai->ai_addr, ai->ai_addrlen) < 0 && errno != EINPROGRESS) ||
+            ::poll(&pfd, 1, IO_TIMEOUT_MS) != 1 ||
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+            ::close(fd);
+            continue;
+        }
+        sock = fd;
+    }
+    freeaddrinfo(addrs);
+    if (sock < 0) {
+        std::cerr << "[ControllerNotifier] Cannot connect to controller at " << host << ":" << port << std::endl;
+        return SendResult::RETRY;
+    }
+
+    // Blocking from here, every call bounded by the timeout
+    int flags = fcntl(sock, F_GETFL, 0);
+    fcntl(sock, F_SETFL, flags & ~O_NONBLOCK);
+    struct timeval tv = {IO_TIMEOUT_MS / 1000, (IO_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    std::string body = "{\"scene\": \"" + notification.scene + "\", \"timestamp\": \"" +
+                       isoTimestamp(notification.timestamp_ms) + "\"}";
+    std::ostringstream request;
+    request << "POST /scene HTTP/1.1\r\n"
+            << "Host: " << host << "\r\n"
+            << "Content-Type: application/json\r\n"
+            << "Content-Length: " << body.length() << "\r\n"
+            << "Connection: close\r\n"
+            << "\r\n"
+            << body;
+    std::string request_str = request.str();
+
+    size_t sent = 0;
+    while (sent < request_str.size()) {
+        ssize_t n = ::send(sock, request_str.data() + sent, request_str.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            std::cerr << "[ControllerNotifier] Failed to send request: " << strerror(errno) << std::endl;
+            ::close(sock);
+            return SendResult::RETRY;
+        }
+        sent += static_cast<size_t>(n);
+    }
+
+    // Status line: "HTTP/1.1 200 OK"
+    char buffer[256];
+    size_t have = 0;
+    while (have < sizeof(buffer) - 1) {
+        ssize_t n = ::recv(sock, buffer + have, sizeof(buffer) - 1 - have, 0);
+        if (n <= 0) {
+            break;
+        }
+        have += static_cast<size_t>(n);
+        if (memchr(buffer, '\n', have)) {
+            break;
+        }
+    }
+    ::close(sock);
+    buffer[have] = '\0';
+
+    int status = 0;
+    if (sscanf(buffer, "HTTP/%*d.%*d %d", &status) != 1) {
+        std::cerr << "[ControllerNotifier] No answer from controller" << std::endl;
+        return SendResult::RETRY;
+    }
+    if (status >= 200 && status < 300) {
+        return SendResult::OK;
+    }
+    std::cerr << "[ControllerNotifier] Controller answered " << status << std::endl;
+    return status >= 400 && status < 500 ? SendResult::REJECTED : SendResult::RETRY;
+}
+
+std::string ControllerNotifier::isoTimestamp(int64_t timestamp_ms) {
+    std::time_t time = static_cast<std::time_t>(timestamp_ms / 1000);
+    std::tm tm;
+    gmtime_r(&time, &tm);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm);
+    std::ostringstream out;
+    out << buffer << "." << std::setfill('0') << std::setw(3) << timestamp_ms % 1000 << "Z";
+    return out.str();
+}
@@ -0,0 +1,81 @@
+#ifndef CONTROLLER_NOTIFIER_H
+#define CONTROLLER_NOTIFIER_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <optional>
+#include <cstdint>
+
+/**
+ * ControllerNotifier - Sends scene changes to the controller (POST /scene)
+ *
+ * One sender thread for every notification, instead of a detached thread
+ * with its own blocking socket per switch. notify() only queues and never
+ * touches the network.
+ *
+ * The controller only cares about the current scene, so notifications
+ * coalesce: one queued while another is waiting or being retried replaces
+ * it, and a burst of switches costs one POST. A failed send is retried
+ * with exponential backoff (RETRY_INITIAL_MS doubling up to RETRY_MAX_MS)
+ * until it succeeds, a newer scene supersedes it, or MAX_ATTEMPTS is
+ * reached. 4xx answers are not retried. Connect, send and the wait for the
+ * answer are each bounded by IO_TIMEOUT_MS.
+ */
+class ControllerNotifier {
+public:
+    ControllerNotifier();
+    ~ControllerNotifier();
+
+    ControllerNotifier(const ControllerNotifier&) = delete;
+    ControllerNotifier& operator=(const ControllerNotifier&) = delete;
+
+    // Any thread: queue a scene change. controller_url is http://host[:port];
+    // timestamp_ms is when the scene changed (ms since the epoch, 0 = now).
+    void notify(const std::string& controller_url, const std::string& scene, int64_t timestamp_ms);
+
+    // Stop the sender; a notification still queued is dropped
+    void stop();
+
+    uint64_t getSentCount() const { return sent_.load(); }
+    uint64_t getCoalescedCount() const { return coalesced_.load(); }
+    uint64_t getFailedCount() const { return failed_.load(); }
+
+    static constexpr int MAX_ATTEMPTS = 6;
+    static constexpr int RETRY_INITIAL_MS = 250;
+    static constexpr int RETRY_MAX_MS = 4000;
+    static constexpr int IO_TIMEOUT_MS = 2000;
+    static constexpr int DEFAULT_PORT = 8089;
+
+private:
+    struct Notification {
+        std::string url;
+        std::string scene;
+        int64_t timestamp_ms = 0;
+    };
+
+    enum class SendResult {
+        OK,
+        RETRY,          // Network error or 5xx
+        REJECTED        // 4xx, retrying will not help
+    };
+
+    void threadFunc();
+    SendResult send(const Notification& notification);
+    static std::string isoTimestamp(int64_t timestamp_ms);
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::optional<Notification> pending_;   // Guarded by mutex_
+    bool stopping_ = false;                 // Guarded by mutex_
+
+    std::atomic<uint64_t> sent_{0};
+    std::atomic<uint64_t> coalesced_{0};
+    std::atomic<uint64_t> failed_{0};
+
+    std::thread thread_;                    // Last: starts in the constructor
+};
+
+#endif // CONTROLLER_NOTIFIER_H
@@ -13,7 +13,9 @@ FIFOOutput::FIFOOutput(const std::string& pipe_path, const std::atomic<bool>& ru
       fd_(-1),
       running_(running),
       packets_written_(0),
-      bytes_written_(0) {
+      bytes_written_(0),
+      packets_accepted_(0),
+      egress_stamps_(nullptr) {
 }
 
 FIFOOutput::~FIFOOutput() {
@@ -71,6 +73,11 @@ bool FIFOOutput::open() {
 }
 
 void FIFOOutput::close() {
+    // Push out queued packets unless shutting down (a broken pipe would block on reopen)
+    if (fd_ >= 0 && running_.load()) {
+        flush();
+    }
+    
     if (fd_ >= 0) {
         std::cout << "[FIFOOutput] Closing pipe..." << std::endl;
         ::close(fd_);
@@ -83,62 +90,116 @@ void FIFOOutput::close() {
 }
 
 bool FIFOOutput::writePacket(const ts::TSPacket& packet) {
+    packets_accepted_++;
+    if (batcher_.stage(packet)) {
+        return flush();
+    }
+    return true;
+}
+
+bool FIFOOutput::writePackets(const std::vector<ts::TSPacket>& packets) {
+    return writePackets(packets.data(), packets.size());
+}
+
+bool FIFOOutput::writePackets(const ts::TSPacket* packets, size_t count) {
+    packets_accepted_ += count;
+    
+    // A full batch's worth: write queued + caller packets with one writev, no copy
+    if (batcher_.stagedPackets() + count >= batcher_.flushPackets()) {
+        return flushWith(packets, count);
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        batcher_.stage(packets[i]);
+    }
+    return flushIfDue();
+}
+
+bool FIFOOutput::commit(size_t count) {
+    packets_accepted_ += count;
+    if (batcher_.commit(count)) {
+        return flush();
+    }
+    return true;
+}
+
+bool FIFOOutput::flush() {
+    return flushWith(nullptr, 0);
+}
+
+bool FIFOOutput::flushIfDue() {
+    if (batcher_.isFlushDue()) {
+        return flush();
+    }
+    return true;
+}
+
+void FIFOOutput::setBatching(size_t flush_packets, int flush_deadline_ms) {
+    flush();
+    batcher_.configure(flush_packets, flush_deadline_ms);
+    std::cout << "[FIFOOutput] Batching: flush at " << batcher_.flushPackets()
+              << " packets or " << flush_deadline_ms << " ms" << std::endl;
+}
+
+bool FIFOOutput::flushWith(const ts::TSPacket* extra, size_t count) {
+    size_t expected = batcher_.stagedPackets() + count;
+    if (expected == 0) {
+        return true;
+    }
+    
     // Check if pipe is open
     if (fd_ < 0) {
         std::cerr << "[FIFOOutput] Pipe not open, attempting to open..." << std::endl;
         if (!open()) {
+            batcher_.discard();
             return false;
         }
     }
     
-    // Write 188-byte TS packet
-    // This is a blocking write - it will wait if the pipe buffer is full
-    ssize_t written = write(fd_, packet.b, ts::PKT_SIZE);
+    // Blocking writev - it will wait if the pipe buffer is full
+    size_t written = 0;
+    int err = batcher_.flush(fd_, extra, count, written);
     
-    if (written != ts::PKT_SIZE) {
-        int err = errno;
-        
-        // EPIPE means the reader closed the pipe (ffmpeg crashed/restarted)
-        if (err == EPIPE) {
-            std::cerr << "[FIFOOutput] Broken pipe (reader disconnected) - FFmpeg likely restarting" << std::endl;
-            std::cout << "[FIFOOutput] Closing and reopening pipe..." << std::endl;
-            
-            // Close the pipe
-            ::close(fd_);
-            fd_ = -1;
-            
-            // Wait a moment for FFmpeg to restart
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            
-            // Try to reopen (will block until FFmpeg opens for reading)
-            if (!open()) {
-                std::cerr << "[FIFOOutput] Failed to reopen pipe" << std::endl;
-                return false;
-            }
-            
-            // Packet was lost during reconnection
-            std::cout << "[FIFOOutput] Pipe reopened - packet dropped during reconnection" << std::endl;
-            return false;
-        }
-        
-        // Other write errors
-        std::cerr << "[FIFOOutput] Write failed - expected " << ts::PKT_SIZE
-                  << " bytes, wrote " << written << " bytes, errno=" << err
-                  << " (" << strerror(err) << ")" << std::endl;
-        return false;
-    }
-    
-    packets_written_++;
-    bytes_written_ += ts::PKT_SIZE;
+    packets_written_ += written;
+    bytes_written_ += written * ts::PKT_SIZE;
     
+    if (err != 0) {
+        return handleWriteError(err, written, expected);
+    }
+    if (egress_stamps_) {
+        egress_stamps_->stamp(packets_accepted_, SequenceStamps::nowNs());
+    }
     return true;
 }
 
-bool FIFOOutput::writePackets(const std::vector<ts::TSPacket>& packets) {
-    for (const auto& packet : packets) {
-        if (!writePacket(packet)) {
+bool FIFOOutput::handleWriteError(int err, size_t packets_written, size_t packets_expected) {
+    // EPIPE means the reader closed the pipe (ffmpeg crashed/restarted)
+    if (err == EPIPE) {
+        std::cerr << "[FIFOOutput] Broken pipe (reader disconnected) - FFmpeg likely restarting" << std::endl;
+        std::cout << "[FIFOOutput] Closing and reopening pipe..." << std::endl;
+        
+        // Close the pipe
+        ::close(fd_);
+        fd_ = -1;
+        
+        // Wait a moment for FFmpeg to restart
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        
+        // Try to reopen (will block until FFmpeg opens for reading)
+        if (!open()) {
+            std::cerr << "[FIFOOutput] Failed to reopen pipe" << std::endl;
             return false;
         }
+        
+        // The rest of the batch was lost; the new reader starts on a packet boundary
+        std::cout << "[FIFOOutput] Pipe reopened - " << (packets_expected - packets_written)
+                  << " packets dropped during reconnection" << std::endl;
+        return false;
     }
-    return true;
+    
+    // Other write errors
+    std::cerr << "[FIFOOutput] Write failed - expected " << packets_expected
+              << " packets, wrote " << packets_written << " packets, errno=" << err
+              << " (" << strerror(err) << ")" << std::endl;
+    return false;
 }
@@ -2,9 +2,13 @@
 #define FIFO_OUTPUT_H
 
 #include <string>
+#include <vector>
 #include <atomic>
 #include <cstdint>
 #include <tsduck.h>
+#include "OutputBatcher.h"
+#include "PacketSink.h"
+#include "SequenceStamps.h"
 
 /**
  * FIFOOutput - Named pipe (FIFO) writer for TS packets
@@ -12,38 +16,79 @@
  * Writes MPEG-TS packets to a named pipe for consumption by FFmpeg.
  * Blocking writes ensure no packet drops (pipe blocks when full).
  * Automatically increases pipe buffer size to 1MB for better performance.
+ * Packets are batched (see OutputBatcher) and written with writev(), so the
+ * caller must flushIfDue() periodically and flush() before blocking elsewhere.
  */
-class FIFOOutput {
+class FIFOOutput : public PacketSink {
 public:
     FIFOOutput(const std::string& pipe_path, const std::atomic<bool>& running);
-    ~FIFOOutput();
+    ~FIFOOutput() override;
     
     // Open the named pipe for writing (blocks until reader connects)
-    bool open();
+    bool open() override;
     
     // Close the pipe
-    void close();
+    void close() override;
     
-    // Write a single TS packet (blocks if pipe is full)
-    bool writePacket(const ts::TSPacket& packet);
+    // Queue a single TS packet, flushing when the batch is due (blocks if pipe is full)
+    bool writePacket(const ts::TSPacket& packet) override;
     
-    // Write multiple TS packets
+    // Write multiple TS packets (large batches go straight to writev without copying)
     bool writePackets(const std::vector<ts::TSPacket>& packets);
+    bool writePackets(const ts::TSPacket* packets, size_t count) override;
+    
+    // Room for `count` packets in the output batch, to be filled in place
+    // (nullptr on allocation failure). commit() queues them and flushes if due.
+    ts::TSPacket* reserve(size_t count) override { return batcher_.reserve(count); }
+    bool commit(size_t count) override;
+    
+    // Write all queued packets now
+    bool flush() override;
+    
+    // Write queued packets if the batch deadline has passed
+    bool flushIfDue() override;
+    
+    // Batch size and latency deadline (see OutputBatcher::configure)
+    void setBatching(size_t flush_packets, int flush_deadline_ms) override;
+    
+    // How long a caller may block before the next flushIfDue() is needed
+    int getFlushWaitMs(int max_wait_ms) const override { return batcher_.msUntilDeadline(max_wait_ms); }
     
     // Check if pipe is open
     bool isOpen() const { return fd_ >= 0; }
     
+    // Pipe descriptor, for tee() passthrough (-1 when closed)
+    int getFd() const override { return fd_; }
+    
     // Statistics
-    uint64_t getPacketsWritten() const { return packets_written_.load(); }
-    uint64_t getBytesWritten() const { return bytes_written_.load(); }
+    uint64_t getPacketsWritten() const override { return packets_written_.load(); }
+    uint64_t getBytesWritten() const override { return bytes_written_.load(); }
+    uint64_t getWriteCalls() const { return batcher_.getWriteCallCount(); }
+    
+    // Packets handed to this output so far, written or not (writer thread)
+    uint64_t getPacketsAccepted() const { return packets_accepted_; }
+    
+    // Stamp getPacketsAccepted() after every completed write (latency
+    // tracking); nullptr to stop. Must outlive the output.
+    void setEgressStamps(SequenceStamps* stamps) { egress_stamps_ = stamps; }
     
 private:
+    // Write queued packets plus `count` caller packets in one writev pass
+    bool flushWith(const ts::TSPacket* extra, size_t count);
+    
+    // Reopen on EPIPE / log other errors. Always returns false (batch lost).
+    bool handleWriteError(int err, size_t packets_written, size_t packets_expected);
+    
     std::string pipe_path_;
     int fd_;
     const std::atomic<bool>& running_;
     
     std::atomic<uint64_t> packets_written_;
     std::atomic<uint64_t> bytes_written_;
+    uint64_t packets_accepted_;
+    SequenceStamps* egress_stamps_;
+    
+    OutputBatcher batcher_;
     
     static constexpr int PIPE_BUFFER_SIZE = 1 * 1024 * 1024;  // 1MB
 };
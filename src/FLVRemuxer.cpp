@@ -0,0 +1,380 @@
+#include "FLVRemuxer.h"
+#include "NALParser.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint64_t TS_MASK = (1ULL << 33) - 1;
+
+const uint32_t AAC_SAMPLE_RATES[13] = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350
+};
+
+uint64_t readTimestamp(const uint8_t* p) {
+    return (static_cast<uint64_t>((p[0] >> 1) & 0x07) << 30) |
+           (static_cast<uint64_t>(p[1]) << 22) |
+           (static_cast<uint64_t>(p[2] >> 1) << 15) |
+           (static_cast<uint64_t>(p[3]) << 7) |
+           (static_cast<uint64_t>(p[4]) >> 1);
+}
+
+// Start of the next 00 00 01 start code at or after `from`, or size
+size_t findStartCode(const uint8_t* data, size_t size, size_t from) {
+    for (size_t i = from; i + 2 < size; i++) {
+        if (data[i + 2] > 1) {
+            i += 2;     // Can't be part of a start code ending before i + 3
+        } else if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            return i;
+        }
+    }
+    return size;
+}
+
+void appendBE32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back(static_cast<uint8_t>(v >> 24));
+    out.push_back(static_cast<uint8_t>(v >> 16));
+    out.push_back(static_cast<uint8_t>(v >> 8));
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+} // namespace
+
+FLVRemuxer::FLVRemuxer(TagCallback on_tag)
+    : on_tag_(std::move(on_tag)),
+      video_pid_(ts::PID_NULL),
+      audio_pid_(ts::PID_NULL),
+      audio_specific_config_(0),
+      video_started_(false),
+      have_base_(false),
+      base_(0),
+      last_unwrapped_(0),
+      last_video_ms_(0),
+      last_audio_ms_(0),
+      video_frames_(0),
+      audio_frames_(0),
+      dropped_frames_(0),
+      timestamp_fixups_(0) {
+}
+
+void FLVRemuxer::reset() {
+    pmt_pids_.clear();
+    video_pid_ = ts::PID_NULL;
+    audio_pid_ = ts::PID_NULL;
+    video_pes_ = PESBuffer();
+    audio_pes_ = PESBuffer();
+    sps_.clear();
+    pps_.clear();
+    video_config_ = FLVTag();
+    audio_config_ = FLVTag();
+    audio_specific_config_ = 0;
+    video_started_ = false;
+    have_base_ = false;
+    last_video_ms_ = 0;
+    last_audio_ms_ = 0;
+}
+
+void FLVRemuxer::feed(const ts::TSPacket* packets, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* b = packets[i].b;
+        if (b[0] != 0x47 || !(b[3] & 0x10)) {
+            continue;   // No payload
+        }
+        size_t offset = 4;
+        if (b[3] & 0x20) {
+            offset += 1 + b[4];
+        }
+        if (offset >= ts::PKT_SIZE) {
+            continue;
+        }
+
+        uint16_t pid = static_cast<uint16_t>(((b[1] & 0x1F) << 8) | b[2]);
+        if (pid == ts::PID_NULL) {
+            continue;   // Stuffing; also what video_pid_ / audio_pid_ hold until the PMT
+        }
+        bool pusi = (b[1] & 0x40) != 0;
+        const uint8_t* payload = b + offset;
+        size_t size = ts::PKT_SIZE - offset;
+
+        if (pid == video_pid_) {
+            handlePES(video_pes_, true, payload, size, pusi);
+        } else if (pid == audio_pid_) {
+            handlePES(audio_pes_, false, payload, size, pusi);
+        } else if (pusi && pid == ts::PID_PAT) {
+            handlePAT(payload, size);
+        } else if (pusi && std::find(pmt_pids_.begin(), pmt_pids_.end(), pid) != pmt_pids_.end()) {
+            handlePMT(payload, size);
+        }
+    }
+}
+
+// PSI sections here always fit one packet (our PAT/PMT and the encoders')
+void FLVRemuxer::handlePAT(const uint8_t* payload, size_t size) {
+    size_t start = 1 + payload[0];
+    if (start + 8 > size || payload[start] != 0x00) {
+        return;
+    }
+    const uint8_t* s = payload + start;
+    size_t end = std::min<size_t>(3 + (((s[1] & 0x0F) << 8) | s[2]), size - start);
+    for (size_t i = 8; i + 4 + 4 <= end; i += 4) {
+        uint16_t program = static_cast<uint16_t>((s[i] << 8) | s[i + 1]);
+        uint16_t pid = static_cast<uint16_t>(((s[i + 2] & 0x1F) << 8) | s[i + 3]);
+        if (program != 0 && std::find(pmt_pids_.begin(), pmt_pids_.end(), pid) == pmt_pids_.end()) {
+            pmt_pids_.push_back(pid);
+        }
+    }
+}
+
+void FLVRemuxer::handlePMT(const uint8_t* payload, size_t size) {
+    size_t start = 1 + payload[0];
+    if (start + 12 > size || payload[start] != 0x02) {
+        return;
+    }
+    const uint8_t* s = payload + start;
+    size_t end = std::min<size_t>(3 + (((s[1] & 0x0F) << 8) | s[2]), size - start);
+    if (end < 4) {
+        return;
+    }
+    end -= 4;   // CRC
+    size_t i = 12 + (((s[10] & 0x0F) << 8) | s[11]);
+
+    uint16_t video_pid = ts::PID_NULL;
+    uint16_t audio_pid = ts::PID_NULL;
+    while (i + 5 <= end) {
+        uint8_t stream_type = s[i];
+        uint16_t pid = static_cast<uint16_t>(((s[i + 1] & 0x1F) << 8) | s[i + 2]);
+        if (stream_type == STREAM_TYPE_H264 && video_pid == ts::PID_NULL) {
+            video_pid = pid;
+        } else if (stream_type == STREAM_TYPE_AAC_ADTS && audio_pid == ts::PID_NULL) {
+            audio_pid = pid;
+        }
+        i += 5 + (((s[i + 3] & 0x0F) << 8) | s[i + 4]);
+    }
+
+    if (video_pid != video_pid_ || audio_pid != audio_pid_) {
+        std::cout << "[FLVRemuxer] Video PID " << video_pid << ", audio PID " << audio_pid << std::endl;
+        if (video_pid == ts::PID_NULL) {
+            std::cerr << "[FLVRemuxer] Warning: no H.264 stream in PMT" << std::endl;
+        }
+        video_pid_ = video_pid;
+        audio_pid_ = audio_pid;
+        video_pes_ = PESBuffer();
+        audio_pes_ = PESBuffer();
+    }
+}
+
+void FLVRemuxer::handlePES(PESBuffer& pes, bool video, const uint8_t* payload, size_t size, bool pusi) {
+    if (pusi) {
+        if (pes.active) {
+            finishPES(pes, video);
+        }
+        pes.data.assign(payload, payload + size);
+        pes.active = true;
+        pes.expected = 0;
+        if (size >= 6) {
+            uint32_t length = (payload[4] << 8) | payload[5];
+            pes.expected = length > 0 ? 6 + length : 0;
+        }
+    } else if (pes.active) {
+        if (pes.data.size() + size > MAX_PES_SIZE) {
+            std::cerr << "[FLVRemuxer] PES exceeds " << MAX_PES_SIZE << " bytes, dropped" << std::endl;
+            pes = PESBuffer();
+            dropped_frames_++;
+            return;
+        }
+        pes.data.insert(pes.data.end(), payload, payload + size);
+    } else {
+        return;     // Joined mid-PES
+    }
+
+    if (pes.expected > 0 && pes.data.size() >= pes.expected) {
+        pes.data.resize(pes.expected);
+        finishPES(pes, video);
+    }
+}
+
+void FLVRemuxer::finishPES(PESBuffer& pes, bool video) {
+    pes.active = false;
+    const std::vector<uint8_t>& d = pes.data;
+    if (d.size() < 9 || d[0] != 0 || d[1] != 0 || d[2] != 1) {
+        return;
+    }
+    uint8_t flags = d[7];
+    size_t es = 9 + d[8];
+    if (!(flags & 0x80) || es > d.size() || 9 + 5 > es) {
+        dropped_frames_++;     // No PTS: nothing to place it on the timeline
+        return;
+    }
+    uint64_t pts = readTimestamp(&d[9]);
+    uint64_t dts = ((flags & 0xC0) == 0xC0 && 14 + 5 <= es) ? readTimestamp(&d[14]) : pts;
+
+    if (video) {
+        emitVideo(d.data() + es, d.size() - es, pts, dts);
+    } else {
+        emitAudio(d.data() + es, d.size() - es, pts);
+    }
+}
+
+void FLVRemuxer::emitVideo(const uint8_t* es, size_t size, uint64_t pts, uint64_t dts) {
+    uint32_t timestamp_ms = toMs(dts, last_video_ms_);
+
+    // AVC video tag header: frame type / codec, packet type 1, composition time
+    tag_.data.clear();
+    tag_.data.resize(5);
+
+    bool keyframe = false;
+    bool has_slice = false;
+    bool config_changed = false;
+    size_t nal = findStartCode(es, size, 0);
+    while (nal < size) {
+        size_t begin = nal + 3;
+        size_t next = findStartCode(es, size, begin);
+        size_t end = next;
+        while (end > begin && es[end - 1] == 0) {
+            end--;      // Leading zero of a 4-byte start code / trailing_zero_8bits
+        }
+        nal = next;
+        if (end <= begin) {
+            continue;
+        }
+
+        auto type = static_cast<NALUnitType>(es[begin] & 0x1F);
+        if (type == NALUnitType::ACCESS_UNIT_DELIMITER) {
+            continue;
+        }
+        if (type == NALUnitType::SPS || type == NALUnitType::PPS) {
+            std::vector<uint8_t>& stored = (type == NALUnitType::SPS) ? sps_ : pps_;
+            if (stored.size() != end - begin || !std::equal(stored.begin(), stored.end(), es + begin)) {
+                stored.assign(es + begin, es + end);
+                config_changed = true;
+            }
+        }
+        if (type == NALUnitType::CODED_SLICE_IDR) {
+            keyframe = true;
+        }
+        if (type >= NALUnitType::CODED_SLICE_NON_IDR && type <= NALUnitType::CODED_SLICE_IDR) {
+            has_slice = true;
+        }
+        appendBE32(tag_.data, static_cast<uint32_t>(end - begin));
+        tag_.data.insert(tag_.data.end(), es + begin, es + end);
+    }
+
+    // AVCDecoderConfigurationRecord, ahead of the frames that need it
+    if (config_changed && sps_.size() >= 4 && !pps_.empty()) {
+        video_config_.type = FLVTag::VIDEO;
+        video_config_.timestamp_ms = timestamp_ms;
+        video_config_.keyframe = true;
+        video_config_.config = true;
+        std::vector<uint8_t>& c = video_config_.data;
+        c.assign({0x17, 0x00, 0x00, 0x00, 0x00,
+                  0x01, sps_[1], sps_[2], sps_[3], 0xFF, 0xE1});
+        c.push_back(static_cast<uint8_t>(sps_.size() >> 8));
+        c.push_back(static_cast<uint8_t>(sps_.size()));
+        c.insert(c.end(), sps_.begin(), sps_.end());
+        c.push_back(0x01);
+        c.push_back(static_cast<uint8_t>(pps_.size() >> 8));
+        c.push_back(static_cast<uint8_t>(pps_.size()));
+        c.insert(c.end(), pps_.begin(), pps_.end());
+        on_tag_(video_config_);
+    }
+
+    if (!has_slice) {
+        return;     // Parameter sets only (injected ahead of a splice)
+    }
+    if (!hasVideoConfig() || (!video_started_ && !keyframe)) {
+        dropped_frames_++;
+        return;
+    }
+    video_started_ = true;
+
+    // Composition time offset (PTS - DTS), signed 24-bit ms
+    int64_t cts = static_cast<int64_t>((pts - dts) & TS_MASK);
+    if (cts >= (1LL << 32)) {
+        cts -= (1LL << 33);
+    }
+    int32_t cts_ms = static_cast<int32_t>(cts / 90);
+    tag_.data[0] = static_cast<uint8_t>((keyframe ? 0x10 : 0x20) | 0x07);
+    tag_.data[1] = 0x01;
+    tag_.data[2] = static_cast<uint8_t>(cts_ms >> 16);
+    tag_.data[3] = static_cast<uint8_t>(cts_ms >> 8);
+    tag_.data[4] = static_cast<uint8_t>(cts_ms);
+
+    tag_.type = FLVTag::VIDEO;
+    tag_.timestamp_ms = timestamp_ms;
+    tag_.keyframe = keyframe;
+    tag_.config = false;
+    video_frames_++;
+    on_tag_(tag_);
+}
+
+void FLVRemuxer::emitAudio(const uint8_t* es, size_t size, uint64_t pts) {
+    size_t pos = 0;
+    uint64_t frame_index = 0;
+    while (pos + 7 <= size) {
+        const uint8_t* h = es + pos;
+        if (h[0] != 0xFF || (h[1] & 0xF0) != 0xF0) {
+            pos++;      // Resync on the next ADTS header
+            continue;
+        }
+        size_t header = (h[1] & 0x01) ? 7 : 9;
+        size_t frame_length = ((h[3] & 0x03) << 11) | (h[4] << 3) | (h[5] >> 5);
+        uint8_t sample_rate_index = (h[2] >> 2) & 0x0F;
+        if (frame_length <= header || pos + frame_length > size || sample_rate_index >= 13) {
+            break;
+        }
+
+        // AudioSpecificConfig: object type (profile + 1), rate index, channels
+        uint8_t object_type = ((h[2] >> 6) & 0x03) + 1;
+        uint8_t channels = static_cast<uint8_t>(((h[2] & 0x01) << 2) | (h[3] >> 6));
+        uint16_t asc = static_cast<uint16_t>((object_type << 11) | (sample_rate_index << 7) | (channels << 3));
+
+        uint64_t frame_pts = (pts + frame_index * 1024 * 90000 / AAC_SAMPLE_RATES[sample_rate_index]) & TS_MASK;
+        uint32_t timestamp_ms = toMs(frame_pts, last_audio_ms_);
+
+        if (asc != audio_specific_config_ || !hasAudioConfig()) {
+            audio_specific_config_ = asc;
+            audio_config_.type = FLVTag::AUDIO;
+            audio_config_.timestamp_ms = timestamp_ms;
+            audio_config_.config = true;
+            audio_config_.data.assign({0xAF, 0x00, static_cast<uint8_t>(asc >> 8), static_cast<uint8_t>(asc)});
+            on_tag_(audio_config_);
+        }
+
+        // AAC, 44 kHz / 16 bit / stereo flags (fixed for AAC), raw frame
+        tag_.type = FLVTag::AUDIO;
+        tag_.timestamp_ms = timestamp_ms;
+        tag_.keyframe = false;
+        tag_.config = false;
+        tag_.data.assign({0xAF, 0x01});
+        tag_.data.insert(tag_.data.end(), h + header, h + frame_length);
+        audio_frames_++;
+        on_tag_(tag_);
+
+        pos += frame_length;
+        frame_index++;
+    }
+}
+
+uint32_t FLVRemuxer::toMs(uint64_t ts90k, uint32_t& last_ms) {
+    if (!have_base_) {
+        have_base_ = true;
+        base_ = static_cast<int64_t>(ts90k);
+        last_unwrapped_ = base_;
+    }
+
+    // Nearest 33-bit neighbour of the last timestamp (audio and video share it)
+    int64_t delta = static_cast<int64_t>((ts90k - static_cast<uint64_t>(last_unwrapped_)) & TS_MASK);
+    if (delta >= (1LL << 32)) {
+        delta -= (1LL << 33);
+    }
+    last_unwrapped_ += delta;
+
+    int64_t ms = (last_unwrapped_ - base_) / 90;
+    if (ms < static_cast<int64_t>(last_ms)) {
+        timestamp_fixups_++;
+        ms = last_ms;
+    }
+    last_ms = static_cast<uint32_t>(ms);
+    return last_ms;
+}
@@ -0,0 +1,117 @@
+#ifndef FLV_REMUXER_H
+#define FLV_REMUXER_H
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <tsduck.h>
+
+/**
+ * FLVTag - One FLV tag body (= one RTMP audio / video message payload)
+ */
+struct FLVTag {
+    enum Type : uint8_t { AUDIO = 8, VIDEO = 9, SCRIPT = 18 };
+
+    uint8_t type = VIDEO;
+    uint32_t timestamp_ms = 0;      // DTS on the FLV timeline (starts at 0)
+    bool keyframe = false;          // Video: access unit with an IDR slice
+    bool config = false;            // AVC / AAC sequence header
+    std::vector<uint8_t> data;      // Tag data, starting with the codec byte
+};
+
+/**
+ * FLVRemuxer - In-process MPEG-TS -> FLV remux (H.264 + AAC)
+ *
+ * Does what ffmpeg's `-c copy -f flv` does for the spliced output, without
+ * the pipe and the second process:
+ * - PAT/PMT are followed to find the H.264 (0x1B) and AAC ADTS (0x0F) PIDs
+ * - PES are reassembled per PID. A PES with a length goes out as soon as it
+ *   is complete; video PES carry no length, so an access unit goes out when
+ *   the next one starts (the same point ffmpeg's demuxer emits it).
+ * - H.264 Annex-B access units become AVCC (4-byte lengths, AUDs dropped);
+ *   SPS/PPS produce an AVCDecoderConfigurationRecord, re-sent whenever they
+ *   change (e.g. on a switch to a source with other encoder settings)
+ * - ADTS frames lose their header; the first one produces the
+ *   AudioSpecificConfig, again re-sent on change
+ * - 90 kHz DTS are unwrapped (33 bits) and rebased to ms starting at 0;
+ *   each stream's timestamps are kept monotonic
+ *
+ * Video before the first sequence header + keyframe is dropped. Tags are
+ * delivered through the callback; the tag is only valid during the call.
+ *
+ * Thread-safety: none, used from the main loop only.
+ */
+class FLVRemuxer {
+public:
+    using TagCallback = std::function<void(const FLVTag&)>;
+
+    explicit FLVRemuxer(TagCallback on_tag);
+
+    // Remux TS packets; complete frames go to the callback as they finish
+    void feed(const ts::TSPacket* packets, size_t count);
+
+    // Forget PSI, partial PES, parameter sets and the timeline
+    void reset();
+
+    // Current sequence headers, for a new RTMP session
+    bool hasVideoConfig() const { return !video_config_.data.empty(); }
+    bool hasAudioConfig() const { return !audio_config_.data.empty(); }
+    const FLVTag& getVideoConfig() const { return video_config_; }
+    const FLVTag& getAudioConfig() const { return audio_config_; }
+
+    // Statistics
+    uint64_t getVideoFrames() const { return video_frames_; }
+    uint64_t getAudioFrames() const { return audio_frames_; }
+    uint64_t getDroppedFrames() const { return dropped_frames_; }
+    uint64_t getTimestampFixups() const { return timestamp_fixups_; }
+
+private:
+    struct PESBuffer {
+        std::vector<uint8_t> data;
+        size_t expected = 0;        // Total PES size when the header gives one, else 0
+        bool active = false;        // Started with PUSI
+    };
+
+    void handlePAT(const uint8_t* payload, size_t size);
+    void handlePMT(const uint8_t* payload, size_t size);
+    void handlePES(PESBuffer& pes, bool video, const uint8_t* payload, size_t size, bool pusi);
+    void finishPES(PESBuffer& pes, bool video);
+    void emitVideo(const uint8_t* es, size_t size, uint64_t pts, uint64_t dts);
+    void emitAudio(const uint8_t* es, size_t size, uint64_t pts);
+
+    // 33-bit 90 kHz timestamp -> ms on the FLV timeline, monotonic per stream
+    uint32_t toMs(uint64_t ts90k, uint32_t& last_ms);
+
+    TagCallback on_tag_;
+    FLVTag tag_;                    // Reused for every frame
+
+    std::vector<uint16_t> pmt_pids_;
+    uint16_t video_pid_;
+    uint16_t audio_pid_;
+    PESBuffer video_pes_;
+    PESBuffer audio_pes_;
+
+    std::vector<uint8_t> sps_;
+    std::vector<uint8_t> pps_;
+    FLVTag video_config_;
+    FLVTag audio_config_;
+    uint16_t audio_specific_config_;
+    bool video_started_;            // Sequence header and first keyframe sent
+
+    bool have_base_;
+    int64_t base_;                  // First timestamp (90 kHz, unwrapped)
+    int64_t last_unwrapped_;
+    uint32_t last_video_ms_;
+    uint32_t last_audio_ms_;
+
+    uint64_t video_frames_;
+    uint64_t audio_frames_;
+    uint64_t dropped_frames_;
+    uint64_t timestamp_fixups_;
+
+    static constexpr uint8_t STREAM_TYPE_H264 = 0x1B;
+    static constexpr uint8_t STREAM_TYPE_AAC_ADTS = 0x0F;
+    static constexpr size_t MAX_PES_SIZE = 8 * 1024 * 1024;
+};
+
+#endif // FLV_REMUXER_H
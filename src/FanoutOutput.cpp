@@ -0,0 +1,441 @@
+#include "FanoutOutput.h"
+#include "OutputBatcher.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <new>
+
+bool FanoutOutput::parsePolicy(const std::string& name, Policy& policy) {
+    if (name == "wait") {
+        policy = Policy::WAIT;
+    } else if (name == "drop_to_idr") {
+        policy = Policy::DROP_TO_IDR;
+    } else if (name == "disconnect") {
+        policy = Policy::DISCONNECT;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* FanoutOutput::policyName(Policy policy) {
+    switch (policy) {
+        case Policy::WAIT: return "wait";
+        case Policy::DROP_TO_IDR: return "drop_to_idr";
+        case Policy::DISCONNECT: return "disconnect";
+    }
+    return "unknown";
+}
+
+FanoutOutput::FanoutOutput(size_t ring_packets, const std::atomic<bool>& running)
+    : running_(running),
+      stopping_(false),
+      started_(false),
+      ring_(ring_packets),
+      packets_published_(0),
+      flush_packets_(OutputBatcher::DEFAULT_FLUSH_PACKETS),
+      flush_deadline_ms_(OutputBatcher::DEFAULT_FLUSH_DEADLINE_MS),
+      pmt_pid_(ts::PID_NULL),
+      video_pid_(ts::PID_NULL),
+      has_pat_(false),
+      has_pmt_(false),
+      pes_seq_(0),
+      param_pes_seq_(0),
+      param_pes_valid_(false) {
+}
+
+FanoutOutput::~FanoutOutput() {
+    close();
+}
+
+void FanoutOutput::addSink(const std::string& name, std::unique_ptr<PacketSink> sink, Policy policy,
+                           size_t max_lag_packets, bool transient) {
+    auto consumer = std::make_unique<Consumer>();
+    consumer->name = name;
+    consumer->sink = std::move(sink);
+    consumer->policy = policy;
+    consumer->max_lag_packets = max_lag_packets;
+    consumer->transient = transient;
+
+    std::lock_guard<std::mutex> lock(consumers_mutex_);
+    reapFinished();
+    if (stopping_.load()) {
+        std::cerr << "[FanoutOutput] Not adding " << name << ": output is closed" << std::endl;
+        return;
+    }
+    std::cout << "[FanoutOutput] Adding sink " << name << " (policy " << policyName(policy)
+              << ", max lag " << max_lag_packets << " packets" << (transient ? ", transient" : "") << ")" << std::endl;
+    consumers_.push_back(std::move(consumer));
+    if (started_) {
+        startConsumer(*consumers_.back());
+    }
+}
+
+bool FanoutOutput::open() {
+    std::lock_guard<std::mutex> lock(consumers_mutex_);
+    if (stopping_.load()) {
+        return false;
+    }
+    if (started_) {
+        return true;
+    }
+    started_ = true;
+    for (auto& consumer : consumers_) {
+        startConsumer(*consumer);
+    }
+    std::cout << "[FanoutOutput] Started " << consumers_.size() << " sink(s), ring of "
+              << ring_.capacity() << " packets" << std::endl;
+    return true;
+}
+
+void FanoutOutput::close() {
+    std::list<std::unique_ptr<Consumer>> consumers;
+    {
+        std::lock_guard<std::mutex> lock(consumers_mutex_);
+        if (stopping_.exchange(true)) {
+            return;
+        }
+        consumers.swap(consumers_);
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(STOP_TIMEOUT_MS);
+    for (auto& consumer : consumers) {
+        consumer->wakeup.notify();
+    }
+    for (auto& consumer : consumers) {
+        if (!consumer->thread.joinable()) {
+            continue;
+        }
+        while (!consumer->finished.load() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (consumer->finished.load()) {
+            consumer->thread.join();
+        } else {
+            // Stuck in a blocking open() or write() (e.g. nobody reading the
+            // pipe). We are shutting down: leave the thread and its sink be.
+            std::cerr << "[FanoutOutput] " << consumer->name << " did not stop - abandoning it" << std::endl;
+            consumer->thread.detach();
+            consumer.release();
+        }
+    }
+
+    std::cout << "[FanoutOutput] Statistics:" << std::endl;
+    std::cout << "  Packets published: " << packets_published_.load() << std::endl;
+}
+
+bool FanoutOutput::writePackets(const ts::TSPacket* packets, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint64_t seq = ring_.push(packets[i]);
+        indexPacket(packets[i], seq);
+    }
+    packets_published_ += count;
+
+    std::lock_guard<std::mutex> lock(consumers_mutex_);
+    for (auto& consumer : consumers_) {
+        consumer->wakeup.notify();
+    }
+    return true;
+}
+
+ts::TSPacket* FanoutOutput::reserve(size_t count) {
+    try {
+        staging_.resize(count);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+    return staging_.data();
+}
+
+bool FanoutOutput::commit(size_t count) {
+    return writePackets(staging_.data(), std::min(count, staging_.size()));
+}
+
+void FanoutOutput::setBatching(size_t flush_packets, int flush_deadline_ms) {
+    flush_packets_ = flush_packets;
+    flush_deadline_ms_ = flush_deadline_ms;
+}
+
+std::vector<FanoutOutput::SinkStats> FanoutOutput::getSinkStats() {
+    std::lock_guard<std::mutex> lock(consumers_mutex_);
+    reapFinished();
+    std::vector<SinkStats> stats;
+    stats.reserve(consumers_.size());
+    for (const auto& consumer : consumers_) {
+        SinkStats s;
+        s.name = consumer->name;
+        s.policy = consumer->policy;
+        s.open = consumer->open.load();
+        s.lag_packets = consumer->lag_packets.load();
+        s.packets_written = consumer->packets_written.load();
+        s.packets_skipped = consumer->packets_skipped.load();
+        s.idr_skips = consumer->idr_skips.load();
+        s.overruns = consumer->overruns.load();
+        s.disconnects = consumer->disconnects.load();
+        stats.push_back(std::move(s));
+    }
+    return stats;
+}
+
+size_t FanoutOutput::getSinkCount() const {
+    std::lock_guard<std::mutex> lock(consumers_mutex_);
+    return consumers_.size();
+}
+
+void FanoutOutput::indexPacket(const ts::TSPacket& packet, uint64_t seq) {
+    const uint8_t* b = packet.b;
+    if (b[0] != 0x47 || !(b[3] & 0x10)) {
+        return;     // No payload
+    }
+    size_t offset = 4;
+    if (b[3] & 0x20) {
+        offset += 1 + b[4];
+    }
+    if (offset >= ts::PKT_SIZE) {
+        return;
+    }
+
+    uint16_t pid = static_cast<uint16_t>(((b[1] & 0x1F) << 8) | b[2]);
+    if (pid == ts::PID_NULL) {
+        return;     // Stuffing; also what pmt_pid_ / video_pid_ hold until known
+    }
+    bool pusi = (b[1] & 0x40) != 0;
+    const uint8_t* payload = b + offset;
+    size_t size = ts::PKT_SIZE - offset;
+
+    if (pid == ts::PID_PAT) {
+        if (pusi) {
+            pat_ = packet;
+            has_pat_ = true;
+            handlePAT(payload, size);
+        }
+        return;
+    }
+    if (pid == pmt_pid_) {
+        if (pusi) {
+            pmt_ = packet;
+            has_pmt_ = true;
+            handlePMT(payload, size);
+        }
+        return;
+    }
+    if (pid != video_pid_) {
+        return;
+    }
+
+    if (pusi) {
+        // A PES that ended with SPS/PPS but no slice belongs to the next access unit
+        param_pes_valid_ = scanner_.scanning() && scanner_.sawNAL(NALUnitType::SPS);
+        param_pes_seq_ = pes_seq_;
+        scanner_.beginPES();
+        pes_seq_ = seq;
+    }
+    if (scanner_.scanning() && scanner_.feed(payload, size) == NALStartCodeScanner::Result::IDR_SLICE) {
+        std::lock_guard<std::mutex> lock(resync_mutex_);
+        resync_.seq = param_pes_valid_ ? param_pes_seq_ : pes_seq_;
+        resync_.valid = true;
+        resync_.has_psi = has_pat_ && has_pmt_;
+        resync_.pat = pat_;
+        resync_.pmt = pmt_;
+    }
+}
+
+// PSI sections here always fit one packet (our PAT/PMT and the encoders')
+void FanoutOutput::handlePAT(const uint8_t* payload, size_t size) {
+    size_t start = 1 + payload[0];
+    if (start + 8 > size || payload[start] != 0x00) {
+        return;
+    }
+    const uint8_t* s = payload + start;
+    size_t end = std::min<size_t>(3 + (((s[1] & 0x0F) << 8) | s[2]), size - start);
+    for (size_t i = 8; i + 4 + 4 <= end; i += 4) {
+        uint16_t program = static_cast<uint16_t>((s[i] << 8) | s[i + 1]);
+        if (program != 0) {
+            pmt_pid_ = static_cast<uint16_t>(((s[i + 2] & 0x1F) << 8) | s[i + 3]);
+            return;
+        }
+    }
+}
+
+void FanoutOutput::handlePMT(const uint8_t* payload, size_t size) {
+    size_t start = 1 + payload[0];
+    if (start + 12 > size || payload[start] != 0x02) {
+        return;
+    }
+    const uint8_t* s = payload + start;
+    size_t end = std::min<size_t>(3 + (((s[1] & 0x0F) << 8) | s[2]), size - start);
+    if (end < 4) {
+        return;
+    }
+    end -= 4;   // CRC
+    size_t i = 12 + (((s[10] & 0x0F) << 8) | s[11]);
+
+    uint16_t video_pid = ts::PID_NULL;
+    while (i + 5 <= end) {
+        uint16_t pid = static_cast<uint16_t>(((s[i + 1] & 0x1F) << 8) | s[i + 2]);
+        if (s[i] == STREAM_TYPE_H264) {
+            video_pid = pid;
+            break;
+        }
+        i += 5 + (((s[i + 3] & 0x0F) << 8) | s[i + 4]);
+    }
+
+    if (video_pid != video_pid_) {
+        std::cout << "[FanoutOutput] Indexing IDRs on video PID " << video_pid << std::endl;
+        video_pid_ = video_pid;
+        scanner_ = NALStartCodeScanner();
+        param_pes_valid_ = false;
+    }
+}
+
+void FanoutOutput::startConsumer(Consumer& consumer) {
+    consumer.thread = std::thread(&FanoutOutput::runConsumer, this, std::ref(consumer));
+}
+
+void FanoutOutput::runConsumer(Consumer& consumer) {
+    while (!stopRequested()) {
+        if (!consumer.sink->open()) {
+            if (consumer.transient) {
+                break;
+            }
+            std::cerr << "[FanoutOutput] " << consumer.name << ": open failed, retrying in "
+                      << REOPEN_DELAY_MS << " ms" << std::endl;
+            std::this_thread::sleep_for(std::chrono::milliseconds(REOPEN_DELAY_MS));
+            continue;
+        }
+        consumer.sink->setBatching(flush_packets_.load(), flush_deadline_ms_.load());
+
+        // Start decodable: at the newest resync point if the ring still has it
+        ResyncPoint point;
+        {
+            std::lock_guard<std::mutex> lock(resync_mutex_);
+            point = resync_;
+        }
+        if (point.valid && ring_.contains(point.seq)) {
+            if (point.has_psi) {
+                ts::TSPacket psi[2] = {point.pat, point.pmt};
+                consumer.sink->writePackets(psi, 2);
+            }
+            consumer.cursor = point.seq;
+        } else {
+            consumer.cursor = ring_.headSequence();
+        }
+        consumer.open = true;
+        std::cout << "[FanoutOutput] " << consumer.name << " started "
+                  << (ring_.headSequence() - consumer.cursor) << " packets behind the head" << std::endl;
+
+        bool ok = pump(consumer);
+
+        consumer.open = false;
+        consumer.lag_packets = 0;
+        consumer.sink->close();
+        if (!ok || consumer.transient) {
+            break;
+        }
+    }
+    consumer.finished = true;
+}
+
+bool FanoutOutput::pump(Consumer& consumer) {
+    std::vector<ts::TSPacket> batch;
+    batch.reserve(BATCH_PACKETS);
+
+    // Starting at (or skipping to) a resync point can leave the sink up to a
+    // GOP behind; only growing lag beyond that counts against the policy
+    uint64_t lag_limit = std::max<uint64_t>(consumer.max_lag_packets, ring_.headSequence() - consumer.cursor);
+
+    while (!stopRequested()) {
+        uint64_t head = ring_.headSequence();
+        if (consumer.cursor >= head) {
+            // Caught up: flush on the sink's deadline, sleep until more is published
+            consumer.lag_packets = 0;
+            if (!consumer.sink->flushIfDue() && consumer.transient) {
+                return false;
+            }
+            consumer.wakeup.prepareWait();
+            if (ring_.headSequence() != consumer.cursor || stopRequested()) {
+                consumer.wakeup.cancelWait();
+                continue;
+            }
+            consumer.wakeup.wait(consumer.sink->getFlushWaitMs(IDLE_WAIT_MS));
+            continue;
+        }
+
+        uint64_t lag = head - consumer.cursor;
+        consumer.lag_packets = lag;
+        if (lag <= consumer.max_lag_packets) {
+            lag_limit = consumer.max_lag_packets;
+        } else if (lag > lag_limit && consumer.policy != Policy::WAIT) {
+            if (consumer.policy == Policy::DISCONNECT) {
+                std::cout << "[FanoutOutput] " << consumer.name << " is " << lag
+                          << " packets behind - disconnecting" << std::endl;
+                consumer.disconnects++;
+                return true;
+            }
+            if (skipToResyncPoint(consumer)) {
+                lag_limit = std::max<uint64_t>(consumer.max_lag_packets, head - consumer.cursor);
+                continue;
+            }
+        }
+
+        batch.clear();
+        uint64_t first = ring_.copyRange(consumer.cursor, std::min(head, consumer.cursor + BATCH_PACKETS), batch);
+        if (first != consumer.cursor) {
+            // The ring lapped this sink: what it had not read yet is gone
+            consumer.overruns++;
+            std::cerr << "[FanoutOutput] " << consumer.name << " overrun: "
+                      << (first - consumer.cursor) << " packets overwritten before it read them" << std::endl;
+            if (skipToResyncPoint(consumer)) {
+                continue;
+            }
+            consumer.packets_skipped += first - consumer.cursor;
+            consumer.cursor = first;
+        }
+        if (batch.empty()) {
+            continue;
+        }
+
+        bool ok = consumer.sink->writePackets(batch.data(), batch.size());
+        consumer.cursor = first + batch.size();
+        consumer.packets_written += batch.size();
+        if (!ok && consumer.transient) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FanoutOutput::skipToResyncPoint(Consumer& consumer) {
+    ResyncPoint point;
+    {
+        std::lock_guard<std::mutex> lock(resync_mutex_);
+        point = resync_;
+    }
+    if (!point.valid || point.seq <= consumer.cursor || !ring_.contains(point.seq)) {
+        return false;
+    }
+
+    if (point.has_psi) {
+        ts::TSPacket psi[2] = {point.pat, point.pmt};
+        consumer.sink->writePackets(psi, 2);
+    }
+    uint64_t skipped = point.seq - consumer.cursor;
+    consumer.packets_skipped += skipped;
+    consumer.idr_skips++;
+    consumer.cursor = point.seq;
+    std::cout << "[FanoutOutput] " << consumer.name << " skipped " << skipped
+              << " packets to the newest IDR" << std::endl;
+    return true;
+}
+
+void FanoutOutput::reapFinished() {
+    for (auto it = consumers_.begin(); it != consumers_.end();) {
+        Consumer& consumer = **it;
+        if (consumer.transient && consumer.finished.load()) {
+            consumer.thread.join();
+            it = consumers_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,205 @@
+#ifndef FANOUT_OUTPUT_H
+#define FANOUT_OUTPUT_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <tsduck.h>
+#include "PacketSink.h"
+#include "PacketRing.h"
+#include "WakeupSignal.h"
+#include "NALParser.h"
+
+/**
+ * FanoutOutput - One spliced stream, many sinks with independent backpressure
+ *
+ * The main loop writes into this sink like into any other: every packet is
+ * pushed once into a shared PacketRing and the call returns. Each attached
+ * sink (FIFOOutput, TCPOutput, FileOutput, HTTP-TS clients, ...) runs on its
+ * own thread with its own ring cursor, so a blocking write only stalls that
+ * sink. The ring overwrites its oldest packets when full - the splice loop
+ * and the inputs never wait for a consumer.
+ *
+ * While publishing, the ring indexes resync points: the start of each H.264
+ * IDR access unit (or of the parameter-set PES just ahead of it), together
+ * with the PAT and PMT that were current there. A sink that (re)opens starts
+ * at the newest resync point, and a sink that has to skip ahead jumps to one,
+ * so what it writes always decodes from a keyframe. Continuity counters jump
+ * at a skip; downstream demuxers resync on the PAT/PMT/IDR that follow.
+ *
+ * Per-sink policy once a sink lags more than max_lag_packets behind:
+ * - WAIT: keep writing in order, never skip. Lossless as long as the lag
+ *   stays within the ring; a sink the ring laps resumes at a resync point.
+ * - DROP_TO_IDR: skip to the newest resync point and carry on.
+ * - DISCONNECT: close the sink. Persistent sinks are reopened (and start at
+ *   a resync point), transient ones (HTTP clients) are removed.
+ *
+ * Thread-safety: writePacket / writePackets / reserve / commit belong to one
+ * producer thread (the main loop). addSink() and getSinkStats() may be
+ * called from any thread.
+ */
+class FanoutOutput : public PacketSink {
+public:
+    enum class Policy {
+        WAIT,           // Block on the sink, keep every packet
+        DROP_TO_IDR,    // Skip to the newest IDR when lagging
+        DISCONNECT      // Close the sink when lagging
+    };
+
+    // "wait" / "drop_to_idr" / "disconnect"
+    static bool parsePolicy(const std::string& name, Policy& policy);
+    static const char* policyName(Policy policy);
+
+    struct SinkStats {
+        std::string name;
+        Policy policy = Policy::WAIT;
+        bool open = false;
+        uint64_t lag_packets = 0;       // Behind the ring head at the last batch
+        uint64_t packets_written = 0;   // Handed to the sink
+        uint64_t packets_skipped = 0;   // Never written: skipped ahead or overrun
+        uint64_t idr_skips = 0;         // Jumps to a resync point
+        uint64_t overruns = 0;          // Times the ring lapped the sink
+        uint64_t disconnects = 0;       // Closed by the DISCONNECT policy
+    };
+
+    // ring_packets: shared history; bounds how far a WAIT sink may fall behind
+    FanoutOutput(size_t ring_packets, const std::atomic<bool>& running);
+    ~FanoutOutput() override;
+
+    FanoutOutput(const FanoutOutput&) = delete;
+    FanoutOutput& operator=(const FanoutOutput&) = delete;
+
+    /**
+     * Attach a sink. Its thread starts right away if the fan-out is open,
+     * else at open().
+     * @param name Used in logs and statistics
+     * @param sink Opened, written and closed on the sink's own thread only
+     * @param policy What to do once the sink lags max_lag_packets behind
+     * @param transient Remove the sink once it closes or a write fails,
+     *                  instead of reopening it (accepted clients)
+     */
+    void addSink(const std::string& name, std::unique_ptr<PacketSink> sink, Policy policy,
+                 size_t max_lag_packets, bool transient = false);
+
+    // Start the sink threads. Never blocks on a sink.
+    bool open() override;
+
+    // Stop the sink threads and close the sinks
+    void close() override;
+
+    bool writePacket(const ts::TSPacket& packet) override { return writePackets(&packet, 1); }
+    bool writePackets(const ts::TSPacket* packets, size_t count) override;
+    using PacketSink::writePackets;
+
+    // Staging area for in-place fills (snapshots); commit() publishes them
+    ts::TSPacket* reserve(size_t count) override;
+    bool commit(size_t count) override;
+
+    // Packets are published as they are written; sinks flush on their own threads
+    bool flush() override { return true; }
+    bool flushIfDue() override { return true; }
+    int getFlushWaitMs(int max_wait_ms) const override { return max_wait_ms; }
+
+    // Applied by each sink thread whenever its sink (re)opens
+    void setBatching(size_t flush_packets, int flush_deadline_ms) override;
+
+    // Statistics
+    uint64_t getPacketsWritten() const override { return packets_published_.load(); }
+    uint64_t getBytesWritten() const override { return packets_published_.load() * ts::PKT_SIZE; }
+    std::vector<SinkStats> getSinkStats();     // Also drops finished transient sinks
+    size_t getSinkCount() const;
+
+private:
+    struct Consumer {
+        std::string name;
+        std::unique_ptr<PacketSink> sink;
+        Policy policy;
+        size_t max_lag_packets;
+        bool transient;
+
+        uint64_t cursor = 0;                // Next sequence number to write (sink thread)
+        WakeupSignal wakeup;
+        std::thread thread;
+        std::atomic<bool> open{false};
+        std::atomic<bool> finished{false};
+
+        std::atomic<uint64_t> lag_packets{0};
+        std::atomic<uint64_t> packets_written{0};
+        std::atomic<uint64_t> packets_skipped{0};
+        std::atomic<uint64_t> idr_skips{0};
+        std::atomic<uint64_t> overruns{0};
+        std::atomic<uint64_t> disconnects{0};
+    };
+
+    // Where a sink can start decoding, with the PSI to send ahead of it
+    struct ResyncPoint {
+        uint64_t seq = 0;
+        bool valid = false;
+        bool has_psi = false;
+        ts::TSPacket pat;
+        ts::TSPacket pmt;
+    };
+
+    // Producer: track PAT / PMT / video PID and record resync points
+    void indexPacket(const ts::TSPacket& packet, uint64_t seq);
+    void handlePAT(const uint8_t* payload, size_t size);
+    void handlePMT(const uint8_t* payload, size_t size);
+
+    void startConsumer(Consumer& consumer);
+    void runConsumer(Consumer& consumer);
+
+    // Write ring packets until the sink has to be closed. False if the sink
+    // failed (transient sinks only; persistent sinks handle their own errors).
+    bool pump(Consumer& consumer);
+
+    // Move the cursor to the newest resync point ahead of it, writing its
+    // PAT / PMT first. False if there is none.
+    bool skipToResyncPoint(Consumer& consumer);
+
+    bool stopRequested() const { return !running_.load() || stopping_.load(); }
+
+    // Join the threads of finished transient sinks (caller holds consumers_mutex_)
+    void reapFinished();
+
+    const std::atomic<bool>& running_;
+    std::atomic<bool> stopping_;
+    bool started_;
+
+    PacketRing<ts::TSPacket> ring_;
+    std::vector<ts::TSPacket> staging_;
+    std::atomic<uint64_t> packets_published_;
+
+    mutable std::mutex consumers_mutex_;
+    std::list<std::unique_ptr<Consumer>> consumers_;
+
+    std::atomic<size_t> flush_packets_;
+    std::atomic<int> flush_deadline_ms_;
+
+    // Stream index (producer thread)
+    uint16_t pmt_pid_;
+    uint16_t video_pid_;
+    ts::TSPacket pat_;
+    ts::TSPacket pmt_;
+    bool has_pat_;
+    bool has_pmt_;
+    NALStartCodeScanner scanner_;
+    uint64_t pes_seq_;                  // PUSI packet of the current video PES
+    uint64_t param_pes_seq_;            // Previous PES, if it carried SPS/PPS but no slice
+    bool param_pes_valid_;
+
+    mutable std::mutex resync_mutex_;
+    ResyncPoint resync_;
+
+    static constexpr size_t BATCH_PACKETS = 256;        // Per sink write, ~47 KB
+    static constexpr int IDLE_WAIT_MS = 100;
+    static constexpr int REOPEN_DELAY_MS = 1000;
+    static constexpr int STOP_TIMEOUT_MS = 2000;
+    static constexpr uint8_t STREAM_TYPE_H264 = 0x1B;
+};
+
+#endif // FANOUT_OUTPUT_H
@@ -0,0 +1,69 @@
+#ifndef FILE_OUTPUT_H
+#define FILE_OUTPUT_H
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <tsduck.h>
+#include "OutputBatcher.h"
+#include "PacketSink.h"
+
+/**
+ * FileOutput - Records the TS stream to a file
+ *
+ * Appends to the file (a reopen continues the same recording), batched
+ * through OutputBatcher like the other outputs. Meant to run as a
+ * FanoutOutput sink, so slow storage only ever stalls the recorder.
+ */
+class FileOutput : public PacketSink {
+public:
+    explicit FileOutput(const std::string& path);
+    ~FileOutput() override;
+    
+    // Open (create) the file for appending
+    bool open() override;
+    
+    // Flush and close the file
+    void close() override;
+    
+    // Queue a single TS packet, flushing when the batch is due
+    bool writePacket(const ts::TSPacket& packet) override;
+    
+    // Write multiple TS packets (large batches go straight to writev without copying)
+    bool writePackets(const ts::TSPacket* packets, size_t count) override;
+    using PacketSink::writePackets;
+    
+    // Room for `count` packets in the output batch, to be filled in place
+    ts::TSPacket* reserve(size_t count) override { return batcher_.reserve(count); }
+    bool commit(size_t count) override;
+    
+    // Write all queued packets now
+    bool flush() override;
+    
+    // Write queued packets if the batch deadline has passed
+    bool flushIfDue() override;
+    
+    // Batch size and latency deadline (see OutputBatcher::configure)
+    void setBatching(size_t flush_packets, int flush_deadline_ms) override;
+    
+    // How long a caller may block before the next flushIfDue() is needed
+    int getFlushWaitMs(int max_wait_ms) const override { return batcher_.msUntilDeadline(max_wait_ms); }
+    
+    // Statistics
+    uint64_t getPacketsWritten() const override { return packets_written_.load(); }
+    uint64_t getBytesWritten() const override { return bytes_written_.load(); }
+    
+private:
+    // Write queued packets plus `count` caller packets in one writev pass
+    bool flushWith(const ts::TSPacket* extra, size_t count);
+    
+    std::string path_;
+    int fd_;
+    
+    std::atomic<uint64_t> packets_written_;
+    std::atomic<uint64_t> bytes_written_;
+    
+    OutputBatcher batcher_;
+};
+
+#endif // FILE_OUTPUT_H
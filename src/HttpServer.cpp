@@ -9,18 +9,178 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
-#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <thread>
 #include <sys/types.h>
 #include <netdb.h>
 #include <chrono>
 #include <time.h>
 
+// ", "transport": {...}" for inputs with transport statistics, else nothing
+static std::string transportJson(const TransportStats& t) {
+    if (!t.valid) {
+        return "";
+    }
+    std::ostringstream out;
+    out << ", \"transport\": {"
+        << "\"rtt_ms\": " << std::fixed << std::setprecision(1) << t.rtt_ms << ", "
+        << "\"retransmitted_packets\": " << t.retransmitted_packets << ", "
+        << "\"lost_packets\": " << t.lost_packets << ", "
+        << "\"dropped_packets\": " << t.dropped_packets << ", "
+        << "\"rcv_buffer_ms\": " << t.rcv_buffer_ms << ", "
+        << "\"rcv_buffer_fill\": " << std::setprecision(3) << t.rcv_buffer_fill
+        << "}";
+    return out.str();
+}
+
+// ", "ts_health": {...}" - transport score, error counts, ongoing outages
+static std::string transportHealthJson(const TransportAnalyzer::Report& report) {
+    std::ostringstream out;
+    out << ", \"ts_health\": {\"score\": " << report.score << ", \"errors\": {";
+    for (int i = 0; i < TransportAnalyzer::INDICATOR_COUNT; i++) {
+        out << (i > 0 ? ", " : "") << "\"" << TransportAnalyzer::indicatorName(static_cast<TransportAnalyzer::Indicator>(i))
+            << "\": " << report.errors[i];
+    }
+    out << "}, \"active\": [";
+    for (size_t i = 0; i < report.active.size(); i++) {
+        out << (i > 0 ? ", " : "") << "\"" << TransportAnalyzer::indicatorName(report.active[i]) << "\"";
+    }
+    out << "], \"pcr_jitter_us\": " << report.pcr_jitter_us << "}";
+    return out.str();
+}
+
+// String value of "key" in a flat JSON object, empty if absent
+static std::string jsonStringField(const std::string& body, const std::string& key) {
+    size_t pos = body.find("\"" + key + "\"");
+    if (pos == std::string::npos) return "";
+    pos = body.find(':', pos);
+    if (pos == std::string::npos) return "";
+    pos = body.find('"', pos);
+    if (pos == std::string::npos) return "";
+    size_t end = body.find('"', pos + 1);
+    if (end == std::string::npos) return "";
+    return body.substr(pos + 1, end - pos - 1);
+}
+
+// Integer value of "key" in a flat JSON object; false if absent or not a number
+static bool jsonIntField(const std::string& body, const std::string& key, int& value) {
+    size_t pos = body.find("\"" + key + "\"");
+    if (pos == std::string::npos) return false;
+    pos = body.find(':', pos);
+    if (pos == std::string::npos) return false;
+    pos = body.find_first_not_of(" \t\r\n", pos + 1);
+    if (pos == std::string::npos) return false;
+    try {
+        value = std::stoi(body.substr(pos));
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+// {"policy": ..., "target_latency_ms": ..., "added_latency_ms": ...}
+static std::string switchPolicyJson(const HttpServer::SwitchPolicyInfo& info) {
+    std::ostringstream out;
+    out << "{\"policy\": \"" << info.policy << "\", "
+        << "\"target_latency_ms\": " << info.target_latency_ms << ", "
+        << "\"added_latency_ms\": " << info.added_latency_ms << "}";
+    return out.str();
+}
+
+// Value of a request header (name matched case-insensitively), empty if absent
+static std::string headerValue(const std::string& headers, const std::string& name) {
+    size_t pos = headers.find("\r\n");
+    while (pos != std::string::npos && pos + 2 < headers.size()) {
+        size_t line = pos + 2;
+        size_t end = headers.find("\r\n", line);
+        if (end == std::string::npos) end = headers.size();
+        size_t colon = headers.find(':', line);
+        if (colon != std::string::npos && colon < end && colon - line == name.size() &&
+            std::equal(name.begin(), name.end(), headers.begin() + line,
+                       [](char a, char b) { return std::tolower(a) == std::tolower(b); })) {
+            size_t value = headers.find_first_not_of(" \t", colon + 1);
+            return value < end ? headers.substr(value, headers.find_last_not_of(" \t", end - 1) + 1 - value) : "";
+        }
+        pos = end;
+    }
+    return "";
+}
+
+static bool equalsIgnoreCase(const std::string& a, const char* b) {
+    size_t n = strlen(b);
+    return a.size() == n && std::equal(a.begin(), a.end(), b,
+                                       [](char x, char y) { return std::tolower(x) == std::tolower(y); });
+}
+
+// ISO 8601 UTC with milliseconds; timestamp_ms <= 0 means now
+static std::string isoTimestamp(int64_t timestamp_ms) {
+    if (timestamp_ms <= 0) {
+        timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    std::time_t time = static_cast<std::time_t>(timestamp_ms / 1000);
+    std::tm tm;
+    gmtime_r(&time, &tm);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm);
+    std::ostringstream out;
+    out << buffer << "." << std::setfill('0') << std::setw(3) << timestamp_ms % 1000 << "Z";
+    return out.str();
+}
+
+// {"scene": ..., "scene_started_at": ...} - GET /scene and the "scene" event
+static std::string sceneJson(const std::string& scene, int64_t timestamp_ms) {
+    return "{\"scene\": \"" + scene + "\", \"scene_started_at\": \"" + isoTimestamp(timestamp_ms) + "\"}";
+}
+
+// GET /health body; healthy if connected and wrote packets recently (within 5 seconds)
+static std::string healthJson(const HealthStatus& status, bool& healthy) {
+    healthy = status.rtmp_connected &&
+              status.ms_since_last_write >= 0 &&
+              status.ms_since_last_write < 5000;
+    std::ostringstream out;
+    out << "{"
+        << "\"status\": \"" << (healthy ? "healthy" : "unhealthy") << "\", "
+        << "\"rtmp\": {"
+        << "\"connected\": " << (status.rtmp_connected ? "true" : "false") << ", "
+        << "\"packets_written\": " << status.packets_written << ", "
+        << "\"ms_since_last_write\": " << status.ms_since_last_write
+        << "}"
+        << "}";
+    return out.str();
+}
+
+// One input's object in GET /input-metrics and the "metrics" event
+static std::string inputJson(const HttpServer::InputMetrics& metrics) {
+    std::ostringstream out;
+    out << "{"
+        << "\"connected\": " << (metrics.connected ? "true" : "false") << ", "
+        << "\"bitrate_kbps\": " << (metrics.bitrate_bps / 1024) << ", "
+        << "\"packet_rate\": " << metrics.packet_rate << ", "
+        << "\"jitter_us\": " << metrics.jitter_us << ", "
+        << "\"max_gap_ms\": " << metrics.max_gap_ms << ", "
+        << "\"data_age_ms\": " << metrics.data_age_ms
+        << transportHealthJson(metrics.ts_health)
+        << transportJson(metrics.transport)
+        << "}";
+    return out.str();
+}
+
+// One Server-Sent Events message; data must not contain newlines
+static std::string eventText(const std::string& event, const std::string& data) {
+    return "event: " + event + "\ndata: " + data + "\n\n";
+}
+
 HttpServer::HttpServer(uint16_t port)
     : port_(port),
       running_(false),
-      server_fd_(-1) {
+      server_fd_(-1),
+      epoll_fd_(-1),
+      wake_fd_(-1) {
 }
 
 HttpServer::~HttpServer() {
@@ -68,13 +228,32 @@ bool HttpServer::start() {
     }
     
     // Listen
-    if (listen(server_fd_, 5) < 0) {
+    if (listen(server_fd_, SOMAXCONN) < 0) {
         std::cerr << "[HttpServer] Failed to listen: " << strerror(errno) << std::endl;
         close(server_fd_);
         server_fd_ = -1;
         return false;
     }
     
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+        std::cerr << "[HttpServer] Failed to create epoll / eventfd: " << strerror(errno) << std::endl;
+        for (int* fd : {&server_fd_, &epoll_fd_, &wake_fd_}) {
+            if (*fd >= 0) {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+        return false;
+    }
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = server_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, server_fd_, &ev);
+    ev.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+    
     running_ = true;
     server_thread_ = std::thread(&HttpServer::serverLoop, this);
     
@@ -89,17 +268,21 @@ void HttpServer::stop() {
     
     running_ = false;
     
-    // Close server socket to unblock accept
-    if (server_fd_ >= 0) {
-        close(server_fd_);
-        server_fd_ = -1;
-    }
+    // Wake the loop; it closes the client connections on its way out
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
     
     // Wait for server thread
     if (server_thread_.joinable()) {
         server_thread_.join();
     }
     
+    for (int* fd : {&server_fd_, &epoll_fd_, &wake_fd_}) {
+        close(*fd);
+        *fd = -1;
+    }
+    
     std::cout << "[HttpServer] Stopped" << std::endl;
 }
 
@@ -141,244 +324,501 @@ void HttpServer::setGetInputMetricsCallback(GetInputMetricsCallback callback) {
     std::cout << "[HttpServer] setGetInputMetricsCallback called - callback is " << (get_input_metrics_callback_ ? "SET" : "NULL") << std::endl;
 }
 
-void HttpServer::notifySceneChange(const std::string& scene, const std::string& controllerUrl) {
-    // Send HTTP POST in a background thread to avoid blocking
-    // Capture scene timestamp callback by reference
-    std::thread([this, scene, controllerUrl]() {
-        try {
-            std::cout << "[HttpServer] Notifying controller of scene change: " << scene << std::endl;
-            
-            // Get scene timestamp
-            int64_t timestamp_ms = 0;
-            {
-                std::lock_guard<std::mutex> lock(callback_mutex_);
-                if (get_scene_timestamp_callback_) {
-                    timestamp_ms = get_scene_timestamp_callback_();
-                }
-            }
-            
-            // Convert timestamp to ISO8601 format
-            std::string iso_timestamp;
-            if (timestamp_ms > 0) {
-                auto tp = std::chrono::system_clock::time_point(std::chrono::milliseconds(timestamp_ms));
-                std::time_t time = std::chrono::system_clock::to_time_t(tp);
-                std::tm tm;
-                gmtime_r(&time, &tm);
-                char buffer[32];
-                std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm);
-                int millis = timestamp_ms % 1000;
-                std::ostringstream oss;
-                oss << buffer << "." << std::setfill('0') << std::setw(3) << millis << "Z";
-                iso_timestamp = oss.str();
+void HttpServer::setGetSwitchPoliciesCallback(GetSwitchPoliciesCallback callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    get_switch_policies_callback_ = std::move(callback);
+}
+
+void HttpServer::setSwitchPolicyCallback(SetSwitchPolicyCallback callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    set_switch_policy_callback_ = std::move(callback);
+}
+
+void HttpServer::setGetSwitchLatencyCallback(GetSwitchLatencyCallback callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    get_switch_latency_callback_ = std::move(callback);
+}
+
+void HttpServer::setGetOutputJitterCallback(GetOutputJitterCallback callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    get_output_jitter_callback_ = std::move(callback);
+}
+
+void HttpServer::setGetMetricsCallback(GetMetricsCallback callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    get_metrics_callback_ = std::move(callback);
+}
+
+void HttpServer::setGetFrameCallback(GetFrameCallback callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    get_frame_callback_ = std::move(callback);
+}
+
+std::string HttpServer::prometheusText(const std::vector<HistogramMetric>& metrics) {
+    std::ostringstream out;
+    const std::string* previous = nullptr;
+    for (const HistogramMetric& metric : metrics) {
+        if (!previous || *previous != metric.name) {
+            out << "# HELP " << metric.name << " " << metric.help << "\n"
+                << "# TYPE " << metric.name << " histogram\n";
+            previous = &metric.name;
+        }
+        std::string sep = metric.labels.empty() ? "" : ",";
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; i++) {
+            cumulative += metric.snapshot.buckets[i];
+            out << metric.name << "_bucket{" << metric.labels << sep << "le=\"";
+            if (i < LatencyHistogram::BUCKET_BOUNDS_US.size()) {
+                out << LatencyHistogram::BUCKET_BOUNDS_US[i] / 1e6;
             } else {
-                // Fallback to current time if timestamp not available
-                auto now = std::chrono::system_clock::now();
-                std::time_t time = std::chrono::system_clock::to_time_t(now);
-                std::tm tm;
-                gmtime_r(&time, &tm);
-                char buffer[32];
-                std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S.000Z", &tm);
-                iso_timestamp = buffer;
+                out << "+Inf";
             }
-            
-            // Parse controller URL to get host and port
-            std::string host;
-            int port = 8089;  // Default port
-            
-            // Simple URL parsing - expect format http://host:port or http://host
-            size_t protocol_end = controllerUrl.find("://");
-            std::string url_part = controllerUrl;
-            if (protocol_end != std::string::npos) {
-                url_part = controllerUrl.substr(protocol_end + 3);
+            out << "\"} " << cumulative << "\n";
+        }
+        std::string braces = metric.labels.empty() ? "" : "{" + metric.labels + "}";
+        out << metric.name << "_sum" << braces << " " << metric.snapshot.sum_us / 1e6 << "\n"
+            << metric.name << "_count" << braces << " " << metric.snapshot.count << "\n";
+    }
+    return out.str();
+}
+
+std::string HttpServer::histogramJson(const LatencyHistogram::Snapshot& snapshot) {
+    // Buckets are cumulative with their upper bound, like Prometheus "le"
+    std::ostringstream body;
+    body << "{"
+         << "\"count\": " << snapshot.count << ", "
+         << "\"sum_us\": " << snapshot.sum_us << ", "
+         << "\"mean_us\": " << static_cast<uint64_t>(snapshot.meanUs()) << ", "
+         << "\"p50_us\": " << snapshot.quantileUs(0.50) << ", "
+         << "\"p90_us\": " << snapshot.quantileUs(0.90) << ", "
+         << "\"p99_us\": " << snapshot.quantileUs(0.99) << ", "
+         << "\"max_us\": " << snapshot.max_us << ", "
+         << "\"buckets\": [";
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; i++) {
+        cumulative += snapshot.buckets[i];
+        if (i > 0) body << ", ";
+        body << "{\"le_us\": ";
+        if (i < LatencyHistogram::BUCKET_BOUNDS_US.size()) {
+            body << LatencyHistogram::BUCKET_BOUNDS_US[i];
+        } else {
+            body << "\"+Inf\"";
+        }
+        body << ", \"count\": " << cumulative << "}";
+    }
+    body << "]}";
+    return body.str();
+}
+
+void HttpServer::notifySceneChange(const std::string& scene, const std::string& controllerUrl) {
+    int64_t timestamp_ms = 0;
+    {
+        std::lock_guard<std::mutex> lock(callback_mutex_);
+        if (get_scene_timestamp_callback_) {
+            timestamp_ms = get_scene_timestamp_callback_();
+        }
+    }
+    std::cout << "[HttpServer] Notifying controller of scene change: " << scene << std::endl;
+    notifier_.notify(controllerUrl, scene, timestamp_ms);
+    publishEvent("scene", sceneJson(scene, timestamp_ms));
+}
+
+void HttpServer::publishEvent(const std::string& event, const std::string& data) {
+    if (!running_.load()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(event_mutex_);
+        queued_events_.emplace_back(event, data);
+    }
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+    (void)ignored;
+}
+
+void HttpServer::serverLoop() {
+    struct epoll_event events[MAX_EVENTS];
+    
+    while (running_.load()) {
+        // Wake at least once a second to expire idle connections, and in
+        // time for the next /events sample
+        int timeout_ms = 1000;
+        if (event_streams_ > 0) {
+            auto until_sample = std::chrono::duration_cast<std::chrono::milliseconds>(
+                next_sample_ - std::chrono::steady_clock::now()).count();
+            timeout_ms = static_cast<int>(std::clamp<int64_t>(until_sample, 0, 1000));
+        }
+        int n = epoll_wait(epoll_fd_, events, MAX_EVENTS, timeout_ms);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[HttpServer] epoll_wait error: " << strerror(errno) << std::endl;
+            break;
+        }
+        
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd_) {
+                // stop() (running_ is already false) or publishEvent()
+                uint64_t count;
+                ssize_t ignored = read(wake_fd_, &count, sizeof(count));
+                (void)ignored;
+                sendQueuedEvents();
+                continue;
             }
-            
-            size_t port_pos = url_part.find(':');
-            if (port_pos != std::string::npos) {
-                host = url_part.substr(0, port_pos);
-                port = std::stoi(url_part.substr(port_pos + 1));
-            } else {
-                host = url_part;
+            if (fd == server_fd_) {
+                acceptConnections();
+                continue;
             }
             
-            std::cout << "[HttpServer] Connecting to " << host << ":" << port << std::endl;
-            
-            // Create socket
-            int sock = socket(AF_INET, SOCK_STREAM, 0);
-            if (sock < 0) {
-                std::cerr << "[HttpServer] Failed to create socket: " << strerror(errno) << std::endl;
-                return;
+            auto it = connections_.find(fd);
+            if (it == connections_.end()) {
+                continue;
             }
-            
-            // Set timeout
-            struct timeval timeout;
-            timeout.tv_sec = 5;
-            timeout.tv_usec = 0;
-            setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
-            setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
-            
-            // Resolve hostname
-            struct hostent *server = gethostbyname(host.c_str());
-            if (server == nullptr) {
-                std::cerr << "[HttpServer] Failed to resolve host: " << host << std::endl;
-                close(sock);
-                return;
+            Connection& conn = it->second;
+            bool keep = true;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                keep = readConnection(fd, conn);
             }
-            
-            // Connect to server
-            struct sockaddr_in serv_addr;
-            memset(&serv_addr, 0, sizeof(serv_addr));
-            serv_addr.sin_family = AF_INET;
-            memcpy(&serv_addr.sin_addr.s_addr, server->h_addr, server->h_length);
-            serv_addr.sin_port = htons(port);
-            
-            if (connect(sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0) {
-                std::cerr << "[HttpServer] Failed to connect to controller: " << strerror(errno) << std::endl;
-                close(sock);
-                return;
+            if (keep && !conn.out.empty()) {
+                keep = writeConnection(fd, conn);
             }
-            
-            // Build JSON body
-            std::ostringstream body_stream;
-            body_stream << "{\"scene\": \"" << scene << "\", \"timestamp\": \"" << iso_timestamp << "\"}";
-            std::string body = body_stream.str();
-            
-            // Build HTTP POST request with JSON body
-            std::ostringstream request;
-            request << "POST /scene HTTP/1.1\r\n"
-                    << "Host: " << host << "\r\n"
-                    << "Content-Type: application/json\r\n"
-                    << "Content-Length: " << body.length() << "\r\n"
-                    << "Connection: close\r\n"
-                    << "\r\n"
-                    << body;
-            
-            std::string request_str = request.str();
-            
-            // Send request
-            ssize_t sent = send(sock, request_str.c_str(), request_str.length(), 0);
-            if (sent < 0) {
-                std::cerr << "[HttpServer] Failed to send request: " << strerror(errno) << std::endl;
-                close(sock);
-                return;
+            if (keep) {
+                updateEvents(fd, conn);
+            } else {
+                closeConnection(fd);
             }
-            
-            // Read response (just check if we get something back)
-            char buffer[1024];
-            ssize_t received = recv(sock, buffer, sizeof(buffer) - 1, 0);
-            if (received > 0) {
-                buffer[received] = '\0';
-                std::cout << "[HttpServer] Controller response received" << std::endl;
+        }
+        
+        if (event_streams_ > 0) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= next_sample_) {
+                next_sample_ = now + std::chrono::milliseconds(EVENT_INTERVAL_MS);
+                std::string text = sampleEvents(false);
+                if (!text.empty()) {
+                    sendToEventStreams(text);
+                }
+            }
+            if (event_streams_ > 0 && now >= next_heartbeat_) {
+                sendToEventStreams(": ping\n\n");
             }
-            
-            close(sock);
-            std::cout << "[HttpServer] Scene change notification sent successfully" << std::endl;
-            
-        } catch (const std::exception& e) {
-            std::cerr << "[HttpServer] Error notifying controller: " << e.what() << std::endl;
         }
-    }).detach();
+        
+        closeIdleConnections();
+    }
+    
+    while (!connections_.empty()) {
+        closeConnection(connections_.begin()->first);
+    }
 }
 
-void HttpServer::serverLoop() {
-    while (running_.load()) {
-        // Use poll to wait for connections with timeout
-        struct pollfd pfd;
-        pfd.fd = server_fd_;
-        pfd.events = POLLIN;
-        
-        int ret = poll(&pfd, 1, 500); // 500ms timeout
-        
-        if (ret < 0) {
-            if (errno == EINTR) continue;
-            if (running_.load()) {
-                std::cerr << "[HttpServer] Poll error: " << strerror(errno) << std::endl;
+void HttpServer::acceptConnections() {
+    while (true) {
+        int client_fd = accept4(server_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "[HttpServer] Accept error: " << strerror(errno) << std::endl;
             }
-            break;
+            return;
         }
         
-        if (ret == 0) {
-            // Timeout, check running flag and continue
+        if (connections_.size() >= MAX_CONNECTIONS) {
+            // Best effort: the socket buffer takes a response this small
+            static const char busy[] = "HTTP/1.1 503 Service Unavailable\r\n"
+                                       "Content-Length: 0\r\nConnection: close\r\n\r\n";
+            ssize_t ignored = send(client_fd, busy, sizeof(busy) - 1, MSG_NOSIGNAL);
+            (void)ignored;
+            close(client_fd);
             continue;
         }
         
-        // Accept connection
-        struct sockaddr_in client_addr;
-        socklen_t client_len = sizeof(client_addr);
-        int client_fd = accept(server_fd_, (struct sockaddr*)&client_addr, &client_len);
-        
-        if (client_fd < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                continue;
-            }
-            if (running_.load()) {
-                std::cerr << "[HttpServer] Accept error: " << strerror(errno) << std::endl;
+        Connection& conn = connections_[client_fd];
+        conn.last_active = std::chrono::steady_clock::now();
+        conn.events = EPOLLIN;
+        struct epoll_event ev = {};
+        ev.events = conn.events;
+        ev.data.fd = client_fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client_fd, &ev) < 0) {
+            std::cerr << "[HttpServer] epoll_ctl failed: " << strerror(errno) << std::endl;
+            connections_.erase(client_fd);
+            close(client_fd);
+        }
+    }
+}
+
+bool HttpServer::readConnection(int fd, Connection& conn) {
+    char buffer[4096];
+    bool peer_closed = false;
+    while (true) {
+        ssize_t bytes_read = read(fd, buffer, sizeof(buffer));
+        if (bytes_read > 0) {
+            conn.in.append(buffer, bytes_read);
+            conn.last_active = std::chrono::steady_clock::now();
+            if (conn.in.size() > MAX_REQUEST_BYTES) {
+                break;      // handleBufferedRequests() rejects it
             }
             continue;
         }
+        if (bytes_read == 0) {
+            peer_closed = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return false;
+        }
+        break;
+    }
+    
+    if (conn.event_stream) {
+        conn.in.clear();    // Nothing more is expected from an event stream client
+        return !peer_closed;
+    }
+    if (!handleBufferedRequests(conn)) {
+        return false;
+    }
+    if (peer_closed) {
+        // Half-closed: still answer what it sent, then close
+        conn.close_after_write = true;
+        conn.in.clear();
+        return !conn.out.empty();
+    }
+    return true;
+}
+
+bool HttpServer::handleBufferedRequests(Connection& conn) {
+    while (!conn.close_after_write && !conn.event_stream) {
+        size_t header_end = conn.in.find("\r\n\r\n");
+        size_t content_length = 0;
+        if (header_end != std::string::npos) {
+            std::string length = headerValue(conn.in.substr(0, header_end + 2), "Content-Length");
+            content_length = length.empty() ? 0 : static_cast<size_t>(std::strtoull(length.c_str(), nullptr, 10));
+        }
         
-        // Read request with timeout - may need multiple reads for body
-        char buffer[4096];
-        memset(buffer, 0, sizeof(buffer));
-        std::string full_request;
+        std::string error;
+        if (header_end == std::string::npos && conn.in.size() > MAX_REQUEST_BYTES) {
+            error = "431 Request Header Fields Too Large";
+        } else if (header_end != std::string::npos && content_length > MAX_REQUEST_BYTES) {
+            error = "413 Payload Too Large";
+        }
+        if (!error.empty()) {
+            conn.out += "HTTP/1.1 " + error + "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            conn.close_after_write = true;
+            break;
+        }
+        if (header_end == std::string::npos || conn.in.size() < header_end + 4 + content_length) {
+            break;      // Incomplete, wait for more
+        }
         
-        struct pollfd read_pfd;
-        read_pfd.fd = client_fd;
-        read_pfd.events = POLLIN;
+        size_t request_size = header_end + 4 + content_length;
+        std::string request = conn.in.substr(0, request_size);
+        conn.in.erase(0, request_size);
         
-        // Read initial chunk (headers + possibly body)
-        if (poll(&read_pfd, 1, 1000) > 0) {
-            ssize_t bytes_read = read(client_fd, buffer, sizeof(buffer) - 1);
-            if (bytes_read > 0) {
-                full_request.append(buffer, bytes_read);
-                
-                // Check if we have the complete request by looking for \r\n\r\n
-                size_t header_end = full_request.find("\r\n\r\n");
-                if (header_end != std::string::npos) {
-                    // Parse Content-Length to see if we need more data
-                    size_t cl_pos = full_request.find("Content-Length:");
-                    if (cl_pos != std::string::npos && cl_pos < header_end) {
-                        size_t cl_start = cl_pos + 15; // strlen("Content-Length:")
-                        size_t cl_end = full_request.find("\r\n", cl_start);
-                        if (cl_end != std::string::npos) {
-                            std::string cl_str = full_request.substr(cl_start, cl_end - cl_start);
-                            // Trim whitespace
-                            size_t first = cl_str.find_first_not_of(" \t");
-                            if (first != std::string::npos) {
-                                cl_str = cl_str.substr(first);
-                            }
-                            int content_length = std::atoi(cl_str.c_str());
-                            
-                            // Check if we have all the body data
-                            size_t body_start = header_end + 4;
-                            int body_received = full_request.length() - body_start;
-                            
-                            // Read more if needed
-                            while (body_received < content_length && poll(&read_pfd, 1, 500) > 0) {
-                                memset(buffer, 0, sizeof(buffer));
-                                bytes_read = read(client_fd, buffer, sizeof(buffer) - 1);
-                                if (bytes_read > 0) {
-                                    full_request.append(buffer, bytes_read);
-                                    body_received = full_request.length() - body_start;
-                                } else {
-                                    break;
-                                }
-                            }
-                        }
-                    }
-                }
-                
-                std::string method, path, body;
-                if (parseRequest(full_request, method, path, body)) {
-                    std::string response = handleRequest(method, path, body);
-                    write(client_fd, response.c_str(), response.length());
-                } else {
-                    std::string response = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
-                    write(client_fd, response.c_str(), response.length());
-                }
+        std::string method, path, body;
+        if (!parseRequest(request, method, path, body)) {
+            conn.out += "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            conn.close_after_write = true;
+            break;
+        }
+        
+        // HTTP/1.1 keeps the connection unless told otherwise, 1.0 only when asked
+        std::string headers = request.substr(0, header_end + 2);
+        std::string connection = headerValue(headers, "Connection");
+        size_t line_end = request.find("\r\n");
+        bool http10 = line_end >= 8 && request.compare(line_end - 8, 8, "HTTP/1.0") == 0;
+        bool keep_alive = http10 ? equalsIgnoreCase(connection, "keep-alive") : !equalsIgnoreCase(connection, "close");
+        
+        // GET /events turns the connection into an event stream for good
+        if (method == "GET" && (path == "/events" || path.rfind("/events?", 0) == 0)) {
+            auto now = std::chrono::steady_clock::now();
+            if (event_streams_ == 0) {
+                next_sample_ = now + std::chrono::milliseconds(EVENT_INTERVAL_MS);
+                sampleEvents(false);    // Baseline for the deltas, stale while nobody listened
             }
+            next_heartbeat_ = now + std::chrono::milliseconds(EVENT_HEARTBEAT_MS);
+            conn.out += "HTTP/1.1 200 OK\r\n"
+                        "Content-Type: text/event-stream\r\n"
+                        "Cache-Control: no-cache\r\n"
+                        "Connection: keep-alive\r\n"
+                        "X-Accel-Buffering: no\r\n"
+                        "\r\n"
+                        "retry: 2000\n\n";
+            conn.out += sampleEvents(true);
+            conn.event_stream = true;
+            conn.in.clear();
+            event_streams_++;
+            std::cout << "[HttpServer] GET /events: stream opened (" << event_streams_ << " open)" << std::endl;
+            break;
         }
         
-        close(client_fd);
+        std::string response = handleRequest(method, path, body);
+        response.insert(response.find("\r\n") + 2, keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n");
+        conn.out += response;
+        if (!keep_alive) {
+            conn.close_after_write = true;
+        }
+    }
+    if (conn.close_after_write) {
+        conn.in.clear();
+    }
+    return true;
+}
+
+bool HttpServer::writeConnection(int fd, Connection& conn) {
+    while (conn.out_offset < conn.out.size()) {
+        ssize_t sent = send(fd, conn.out.data() + conn.out_offset, conn.out.size() - conn.out_offset, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;    // EPOLLOUT picks it up
+            }
+            return false;
+        }
+        conn.out_offset += static_cast<size_t>(sent);
+        conn.last_active = std::chrono::steady_clock::now();
+    }
+    conn.out.clear();
+    conn.out_offset = 0;
+    return !conn.close_after_write;
+}
+
+void HttpServer::updateEvents(int fd, Connection& conn) {
+    // Stop reading while a response is stuck, and once closing
+    uint32_t events = conn.out.empty() ? EPOLLIN : EPOLLOUT;
+    if (conn.close_after_write) {
+        events = EPOLLOUT;
+    }
+    if (events != conn.events) {
+        conn.events = events;
+        struct epoll_event ev = {};
+        ev.events = events;
+        ev.data.fd = fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev);
+    }
+}
+
+void HttpServer::closeConnection(int fd) {
+    auto it = connections_.find(fd);
+    if (it != connections_.end() && it->second.event_stream) {
+        event_streams_--;
+        std::cout << "[HttpServer] /events stream closed (" << event_streams_ << " open)" << std::endl;
+    }
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections_.erase(fd);
+}
+
+void HttpServer::closeIdleConnections() {
+    auto cutoff = std::chrono::steady_clock::now() - std::chrono::milliseconds(KEEPALIVE_TIMEOUT_MS);
+    for (auto it = connections_.begin(); it != connections_.end();) {
+        int fd = it->first;
+        bool idle = !it->second.event_stream && it->second.last_active < cutoff;
+        ++it;
+        if (idle) {
+            closeConnection(fd);
+        }
+    }
+}
+
+std::string HttpServer::sampleEvents(bool snapshot) {
+    static const char* const names[] = {"fallback", "camera", "drone"};
+    std::string text;
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    
+    if (snapshot && get_current_scene_callback_) {
+        int64_t timestamp_ms = get_scene_timestamp_callback_ ? get_scene_timestamp_callback_() : 0;
+        text += eventText("scene", sceneJson(get_current_scene_callback_(), timestamp_ms));
+    }
+    
+    AllInputMetrics metrics{};
+    bool have_metrics = static_cast<bool>(get_input_metrics_callback_);
+    if (have_metrics) {
+        metrics = get_input_metrics_callback_();
+    }
+    const InputMetrics* inputs[] = {&metrics.fallback, &metrics.camera, &metrics.drone};
+    
+    // Health: output status and which inputs are connected, sent when either changes
+    int healthy = -1;
+    std::string output = "null";
+    if (health_callback_) {
+        bool is_healthy = false;
+        output = healthJson(health_callback_(), is_healthy);
+        healthy = is_healthy ? 1 : 0;
+    }
+    std::string input_health = "null";
+    if (have_metrics) {
+        input_health = "{";
+        for (int i = 0; i < 3; i++) {
+            input_health += std::string(i > 0 ? ", " : "") + "\"" + names[i] + "\": {\"connected\": " +
+                            (inputs[i]->connected ? "true" : "false") + "}";
+        }
+        input_health += "}";
+    }
+    if (snapshot || healthy != last_output_healthy_ || input_health != last_input_health_) {
+        text += eventText("health", "{\"output\": " + output + ", \"inputs\": " + input_health + "}");
+    }
+    
+    // Metrics: the inputs whose numbers changed since the last sample
+    if (have_metrics) {
+        std::string changed;
+        for (int i = 0; i < 3; i++) {
+            std::string json = inputJson(*inputs[i]);
+            if (snapshot || json != last_input_json_[i]) {
+                changed += std::string(changed.empty() ? "" : ", ") + "\"" + names[i] + "\": " + json;
+            }
+            if (!snapshot) {
+                last_input_json_[i] = std::move(json);
+            }
+        }
+        if (!changed.empty()) {
+            text += eventText("metrics", "{" + changed + "}");
+        }
+    }
+    
+    if (!snapshot) {
+        last_output_healthy_ = healthy;
+        last_input_health_ = input_health;
+    }
+    return text;
+}
+
+void HttpServer::sendToEventStreams(const std::string& text) {
+    std::vector<int> dropped;
+    for (auto& [fd, conn] : connections_) {
+        if (!conn.event_stream) {
+            continue;
+        }
+        if (conn.out.size() - conn.out_offset + text.size() > EVENT_BACKLOG_BYTES) {
+            std::cerr << "[HttpServer] /events client is not reading, dropping it" << std::endl;
+            dropped.push_back(fd);
+            continue;
+        }
+        conn.out += text;
+        if (!writeConnection(fd, conn)) {
+            dropped.push_back(fd);
+            continue;
+        }
+        updateEvents(fd, conn);
+    }
+    for (int fd : dropped) {
+        closeConnection(fd);
+    }
+    next_heartbeat_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(EVENT_HEARTBEAT_MS);
+}
+
+void HttpServer::sendQueuedEvents() {
+    std::vector<std::pair<std::string, std::string>> queued;
+    {
+        std::lock_guard<std::mutex> lock(event_mutex_);
+        queued.swap(queued_events_);
+    }
+    if (event_streams_ == 0) {
+        return;
+    }
+    std::string text;
+    for (const auto& [event, data] : queued) {
+        text += eventText(event, data);
+    }
+    if (!text.empty()) {
+        sendToEventStreams(text);
     }
 }
 
@@ -592,37 +1032,13 @@ std::string HttpServer::handleRequest(const std::string& method, const std::stri
                 std::string current_scene = get_current_scene_callback_();
                 std::cout << "[HttpServer][startup-debug] get_current_scene_callback_ returned: " << current_scene << std::endl;
                 
-                // Get scene timestamp if available
+                // Get scene timestamp if available (0 = now)
                 int64_t timestamp_ms = 0;
                 if (get_scene_timestamp_callback_) {
                     timestamp_ms = get_scene_timestamp_callback_();
                 }
                 
-                // Convert timestamp to ISO8601 format
-                std::string iso_timestamp;
-                if (timestamp_ms > 0) {
-                    auto tp = std::chrono::system_clock::time_point(std::chrono::milliseconds(timestamp_ms));
-                    std::time_t time = std::chrono::system_clock::to_time_t(tp);
-                    std::tm tm;
-                    gmtime_r(&time, &tm);
-                    char buffer[32];
-                    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm);
-                    int millis = timestamp_ms % 1000;
-                    std::ostringstream oss;
-                    oss << buffer << "." << std::setfill('0') << std::setw(3) << millis << "Z";
-                    iso_timestamp = oss.str();
-                } else {
-                    // Fallback to current time if timestamp not available
-                    auto now = std::chrono::system_clock::now();
-                    std::time_t time = std::chrono::system_clock::to_time_t(now);
-                    std::tm tm;
-                    gmtime_r(&time, &tm);
-                    char buffer[32];
-                    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S.000Z", &tm);
-                    iso_timestamp = buffer;
-                }
-                
-                response_body << "{\"scene\": \"" << current_scene << "\", \"scene_started_at\": \"" << iso_timestamp << "\"}";
+                response_body << sceneJson(current_scene, timestamp_ms);
             } else {
                 // No callback set - return unknown  
                 std::cout << "[HttpServer][startup-debug] WARNING: get_current_scene_callback_ is NULL, returning unknown" << std::endl;
@@ -649,26 +1065,11 @@ std::string HttpServer::handleRequest(const std::string& method, const std::stri
         {
             std::lock_guard<std::mutex> lock(callback_mutex_);
             if (health_callback_) {
-                HealthStatus status = health_callback_();
-                
-                // Determine overall health
-                // Healthy if connected and wrote packets recently (within 5 seconds)
-                bool is_healthy = status.rtmp_connected &&
-                                  status.ms_since_last_write >= 0 &&
-                                  status.ms_since_last_write < 5000;
-                
+                bool is_healthy = false;
+                response_body << healthJson(health_callback_(), is_healthy);
                 if (!is_healthy) {
                     http_status = "503 Service Unavailable";
                 }
-                
-                response_body << "{"
-                              << "\"status\": \"" << (is_healthy ? "healthy" : "unhealthy") << "\", "
-                              << "\"rtmp\": {"
-                              << "\"connected\": " << (status.rtmp_connected ? "true" : "false") << ", "
-                              << "\"packets_written\": " << status.packets_written << ", "
-                              << "\"ms_since_last_write\": " << status.ms_since_last_write
-                              << "}"
-                              << "}";
             } else {
                 // No callback set - return basic status
                 response_body << "{\"status\": \"ok\", \"rtmp\": null}";
@@ -699,39 +1100,36 @@ std::string HttpServer::handleRequest(const std::string& method, const std::stri
                 std::cout << "[HttpServer] Input metrics retrieved:" << std::endl;
                 std::cout << "  Fallback: connected=" << metrics.fallback.connected 
                           << ", bitrate=" << (metrics.fallback.bitrate_bps / 1024) << " Kbps"
+                          << ", packets=" << metrics.fallback.packet_rate << "/s"
+                          << ", max_gap=" << metrics.fallback.max_gap_ms << " ms"
+                          << ", ts_score=" << metrics.fallback.ts_health.score
                           << ", data_age=" << metrics.fallback.data_age_ms << " ms" << std::endl;
                 std::cout << "  Camera: connected=" << metrics.camera.connected 
                           << ", bitrate=" << (metrics.camera.bitrate_bps / 1024) << " Kbps"
+                          << ", packets=" << metrics.camera.packet_rate << "/s"
+                          << ", max_gap=" << metrics.camera.max_gap_ms << " ms"
+                          << ", ts_score=" << metrics.camera.ts_health.score
                           << ", data_age=" << metrics.camera.data_age_ms << " ms" << std::endl;
                 std::cout << "  Drone: connected=" << metrics.drone.connected 
                           << ", bitrate=" << (metrics.drone.bitrate_bps / 1024) << " Kbps"
+                          << ", packets=" << metrics.drone.packet_rate << "/s"
+                          << ", max_gap=" << metrics.drone.max_gap_ms << " ms"
+                          << ", ts_score=" << metrics.drone.ts_health.score
                           << ", data_age=" << metrics.drone.data_age_ms << " ms" << std::endl;
                 
                 // Build JSON response with metrics for all three inputs
                 response_body << "{"
-                              << "\"fallback\": {"
-                              << "\"connected\": " << (metrics.fallback.connected ? "true" : "false") << ", "
-                              << "\"bitrate_kbps\": " << (metrics.fallback.bitrate_bps / 1024) << ", "
-                              << "\"data_age_ms\": " << metrics.fallback.data_age_ms
-                              << "}, "
-                              << "\"camera\": {"
-                              << "\"connected\": " << (metrics.camera.connected ? "true" : "false") << ", "
-                              << "\"bitrate_kbps\": " << (metrics.camera.bitrate_bps / 1024) << ", "
-                              << "\"data_age_ms\": " << metrics.camera.data_age_ms
-                              << "}, "
-                              << "\"drone\": {"
-                              << "\"connected\": " << (metrics.drone.connected ? "true" : "false") << ", "
-                              << "\"bitrate_kbps\": " << (metrics.drone.bitrate_bps / 1024) << ", "
-                              << "\"data_age_ms\": " << metrics.drone.data_age_ms
-                              << "}"
+                              << "\"fallback\": " << inputJson(metrics.fallback) << ", "
+                              << "\"camera\": " << inputJson(metrics.camera) << ", "
+                              << "\"drone\": " << inputJson(metrics.drone)
                               << "}";
             } else {
                 std::cout << "[HttpServer] WARNING: get_input_metrics_callback_ is NULL" << std::endl;
                 // No callback set - return zeros
                 response_body << "{"
-                              << "\"fallback\": {\"connected\": false, \"bitrate_kbps\": 0, \"data_age_ms\": -1}, "
-                              << "\"camera\": {\"connected\": false, \"bitrate_kbps\": 0, \"data_age_ms\": -1}, "
-                              << "\"drone\": {\"connected\": false, \"bitrate_kbps\": 0, \"data_age_ms\": -1}"
+                              << "\"fallback\": {\"connected\": false, \"bitrate_kbps\": 0, \"packet_rate\": 0, \"jitter_us\": 0, \"max_gap_ms\": -1, \"data_age_ms\": -1}, "
+                              << "\"camera\": {\"connected\": false, \"bitrate_kbps\": 0, \"packet_rate\": 0, \"jitter_us\": 0, \"max_gap_ms\": -1, \"data_age_ms\": -1}, "
+                              << "\"drone\": {\"connected\": false, \"bitrate_kbps\": 0, \"packet_rate\": 0, \"jitter_us\": 0, \"max_gap_ms\": -1, \"data_age_ms\": -1}"
                               << "}";
             }
         }
@@ -747,6 +1145,160 @@ std::string HttpServer::handleRequest(const std::string& method, const std::stri
         return response.str();
     }
 
+    // Handle GET /metrics
+    if (method == "GET" && path == "/metrics") {
+        std::vector<HistogramMetric> metrics;
+        {
+            std::lock_guard<std::mutex> lock(callback_mutex_);
+            if (get_metrics_callback_) {
+                metrics = get_metrics_callback_();
+            }
+        }
+        
+        std::string body_str = prometheusText(metrics);
+        std::ostringstream response;
+        response << "HTTP/1.1 200 OK\r\n"
+                 << "Content-Type: text/plain; version=0.0.4\r\n"
+                 << "Content-Length: " << body_str.length() << "\r\n"
+                 << "\r\n"
+                 << body_str;
+        return response.str();
+    }
+    
+    // Handle GET /switch-policy
+    if (method == "GET" && path == "/switch-policy") {
+        std::lock_guard<std::mutex> lock(callback_mutex_);
+        if (!get_switch_policies_callback_) {
+            std::string response_body = "{\"error\": \"Switch policy not available\"}";
+            std::ostringstream response;
+            response << "HTTP/1.1 503 Service Unavailable\r\n"
+                     << "Content-Type: application/json\r\n"
+                     << "Content-Length: " << response_body.length() << "\r\n"
+                     << "\r\n"
+                     << response_body;
+            return response.str();
+        }
+        
+        AllSwitchPolicies policies = get_switch_policies_callback_();
+        std::string body_str = "{\"fallback\": " + switchPolicyJson(policies.fallback) +
+                               ", \"camera\": " + switchPolicyJson(policies.camera) +
+                               ", \"drone\": " + switchPolicyJson(policies.drone) + "}";
+        std::ostringstream response;
+        response << "HTTP/1.1 200 OK\r\n"
+                 << "Content-Type: application/json\r\n"
+                 << "Content-Length: " << body_str.length() << "\r\n"
+                 << "\r\n"
+                 << body_str;
+        return response.str();
+    }
+    
+    // Handle POST /switch-policy - {"source": "camera", "policy": "target_latency", "target_latency_ms": 300}
+    if (method == "POST" && path == "/switch-policy") {
+        std::string source = jsonStringField(body, "source");
+        std::string policy = jsonStringField(body, "policy");
+        int target_latency_ms = -1;
+        jsonIntField(body, "target_latency_ms", target_latency_ms);
+        
+        bool ok = false;
+        {
+            std::lock_guard<std::mutex> lock(callback_mutex_);
+            if (set_switch_policy_callback_) {
+                ok = set_switch_policy_callback_(source, policy, target_latency_ms);
+            }
+        }
+        
+        std::string response_body;
+        std::ostringstream response;
+        if (ok) {
+            std::cout << "[HttpServer] POST /switch-policy: " << source << " -> " << policy << std::endl;
+            response_body = "{\"status\": \"ok\", \"source\": \"" + source + "\", \"policy\": \"" + policy + "\"}";
+            response << "HTTP/1.1 200 OK\r\n";
+        } else {
+            response_body = "{\"error\": \"Expected {\\\"source\\\": \\\"fallback|camera|drone\\\", "
+                            "\\\"policy\\\": \\\"oldest|newest|target_latency\\\", \\\"target_latency_ms\\\": N}\"}";
+            response << "HTTP/1.1 400 Bad Request\r\n";
+        }
+        response << "Content-Type: application/json\r\n"
+                 << "Content-Length: " << response_body.length() << "\r\n"
+                 << "\r\n"
+                 << response_body;
+        return response.str();
+    }
+    
+    // Handle GET /switch-latency and GET /output-jitter
+    if (method == "GET" && (path == "/switch-latency" || path == "/output-jitter")) {
+        LatencyHistogram::Snapshot snapshot;
+        {
+            std::lock_guard<std::mutex> lock(callback_mutex_);
+            const GetSwitchLatencyCallback& callback = (path == "/switch-latency") ?
+                get_switch_latency_callback_ : get_output_jitter_callback_;
+            if (callback) {
+                snapshot = callback();
+            }
+        }
+        
+        std::string body = histogramJson(snapshot);
+        std::ostringstream response;
+        response << "HTTP/1.1 200 OK\r\n"
+                 << "Content-Type: application/json\r\n"
+                 << "Content-Length: " << body.length() << "\r\n"
+                 << "\r\n"
+                 << body;
+        return response.str();
+    }
+
+    // Handle GET /frame?pts=N, GET /frame?pts=latest (or ?latest)
+    if (method == "GET" && (path == "/frame" || path.rfind("/frame?", 0) == 0)) {
+        std::string query = path.size() > 7 ? path.substr(7) : "";
+        bool latest = query.empty() || query == "latest" || query == "pts=latest";
+        uint64_t pts = 0;
+        bool valid = latest;
+        if (!latest && query.rfind("pts=", 0) == 0 && query.size() > 4 &&
+            query.find_first_not_of("0123456789", 4) == std::string::npos) {
+            try {
+                pts = std::stoull(query.substr(4)) & ((1ULL << 33) - 1);
+                valid = true;
+            } catch (const std::exception&) {
+            }
+        }
+        
+        std::string error;
+        std::string status;
+        FrameGrab frame;
+        if (!valid) {
+            status = "400 Bad Request";
+            error = "Expected /frame?pts=N (90 kHz output PTS) or /frame?pts=latest";
+        } else {
+            std::lock_guard<std::mutex> lock(callback_mutex_);
+            if (!get_frame_callback_) {
+                status = "503 Service Unavailable";
+                error = "Frame index disabled (FRAME_INDEX_MB)";
+            } else if (!get_frame_callback_(latest, pts, frame)) {
+                status = "404 Not Found";
+                error = "No aired IDR frame indexed at that PTS";
+            }
+        }
+        
+        std::ostringstream response;
+        if (!error.empty()) {
+            std::string response_body = "{\"error\": \"" + error + "\"}";
+            response << "HTTP/1.1 " << status << "\r\n"
+                     << "Content-Type: application/json\r\n"
+                     << "Content-Length: " << response_body.length() << "\r\n"
+                     << "\r\n"
+                     << response_body;
+            return response.str();
+        }
+        response << "HTTP/1.1 200 OK\r\n"
+                 << "Content-Type: video/h264\r\n"
+                 << "Content-Length: " << frame.data.length() << "\r\n"
+                 << "X-PTS: " << frame.pts << "\r\n"
+                 << "X-Source: " << frame.source << "\r\n"
+                 << "\r\n"
+                 << frame.data;
+        return response.str();
+    }
+    
     // 404 for other paths
     std::string response_body = "{\"error\": \"Not found\"}";
     std::ostringstream response;
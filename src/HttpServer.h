@@ -6,7 +6,15 @@
 #include <thread>
 #include <mutex>
 #include <memory>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+#include "ControllerNotifier.h"
 #include "InputSourceManager.h"
+#include "LatencyHistogram.h"
+#include "StreamHealthMetrics.h"
+#include "TransportAnalyzer.h"
 
 /**
  * Health status structure returned by health callback
@@ -19,11 +27,38 @@ struct HealthStatus {
 
 /**
  * Simple HTTP server for receiving callbacks from the controller.
+ *
+ * One thread serves every connection from an epoll loop: sockets are
+ * nonblocking, HTTP/1.1 connections stay open between requests
+ * (keep-alive, pipelined requests answered in order), and a slow or idle
+ * client cannot hold up the others. At most MAX_CONNECTIONS are open; more
+ * get a 503. Connections idle for KEEPALIVE_TIMEOUT_MS are closed.
+ * Handlers run on the server thread, so callbacks must not block.
+ *
+ * Scene change notifications to the controller go out through a
+ * ControllerNotifier (one sender thread, coalescing, retries).
+ *
+ * GET /events is a Server-Sent Events stream, so the dashboard does not
+ * have to poll: a snapshot (scene, health, metrics) on connect, then a
+ * "scene" event the moment notifySceneChange() is called, a "health"
+ * event when output or input health changes, and once every
+ * EVENT_INTERVAL_MS a "metrics" event with the inputs whose metrics
+ * changed. Nothing is sampled while no stream is open. A stream that
+ * falls EVENT_BACKLOG_BYTES behind is dropped (the client reconnects);
+ * idle streams get a comment every EVENT_HEARTBEAT_MS.
+ *
  * Listens on a specified port and handles:
  * - POST /privacy - Privacy mode changes
  * - GET /health - Health status
  * - GET /input - Get current input source
  * - POST /input - Set input source
+ * - GET /switch-policy - Clean point policy per input, latency its last switch added
+ * - POST /switch-policy - Set an input's clean point policy
+ * - GET /switch-latency - Switch latency histogram
+ * - GET /output-jitter - Output PCR jitter histogram (OUTPUT_PACING=1)
+ * - GET /metrics - Histograms in Prometheus text format
+ * - GET /frame?pts=N|latest - Aired IDR access unit (H.264 Annex B) from the frame index
+ * - GET /events - Server-Sent Events: scene, health, metrics
  */
 class HttpServer {
 public:
@@ -39,6 +74,11 @@ public:
         bool connected;
         int64_t data_age_ms;
         uint64_t bitrate_bps;
+        uint64_t packet_rate;       // TS packets per second
+        int64_t jitter_us;          // Variation between read intervals
+        int64_t max_gap_ms;         // Longest read interval in the bitrate window
+        TransportAnalyzer::Report ts_health;    // TR 101 290 score and error counts
+        TransportStats transport;   // SRT inputs only (valid == false otherwise)
     };
     struct AllInputMetrics {
         InputMetrics fallback;
@@ -47,6 +87,42 @@ public:
     };
     using GetInputMetricsCallback = std::function<AllInputMetrics()>;
     
+    // Clean point policy per input (see StreamInput::CleanPointPolicy)
+    struct SwitchPolicyInfo {
+        std::string policy;
+        int target_latency_ms;
+        int64_t added_latency_ms;   // -1 before the first switch
+    };
+    struct AllSwitchPolicies {
+        SwitchPolicyInfo fallback;
+        SwitchPolicyInfo camera;
+        SwitchPolicyInfo drone;
+    };
+    using GetSwitchPoliciesCallback = std::function<AllSwitchPolicies()>;
+    // target_latency_ms < 0 keeps the input's current target; false = unknown source or policy
+    using SetSwitchPolicyCallback = std::function<bool(const std::string& source, const std::string& policy,
+                                                       int target_latency_ms)>;
+    using GetSwitchLatencyCallback = std::function<LatencyHistogram::Snapshot()>;
+    using GetOutputJitterCallback = std::function<LatencyHistogram::Snapshot()>;
+    
+    // One histogram series for GET /metrics; series of one name must be adjacent
+    struct HistogramMetric {
+        std::string name;       // Base name, e.g. "multiplexer_residence_seconds"
+        std::string help;
+        std::string labels;     // e.g. source="camera", or empty
+        LatencyHistogram::Snapshot snapshot;
+    };
+    using GetMetricsCallback = std::function<std::vector<HistogramMetric>()>;
+    
+    // IDR access unit for GET /frame (see StreamInput::grabFrame)
+    struct FrameGrab {
+        uint64_t pts = 0;           // Output PTS, 33-bit
+        std::string source;         // Input it came from
+        std::string data;           // Annex B, SPS/PPS first
+    };
+    // latest, or the last aired at or before output PTS pts; false = none indexed
+    using GetFrameCallback = std::function<bool(bool latest, uint64_t pts, FrameGrab& frame)>;
+    
     explicit HttpServer(uint16_t port);
     ~HttpServer();
     
@@ -81,26 +157,106 @@ public:
     // Register callback for getting input metrics
     void setGetInputMetricsCallback(GetInputMetricsCallback callback);
     
-    // Notify controller of scene change
+    // Register callbacks for reading / setting the per-input switch policy
+    void setGetSwitchPoliciesCallback(GetSwitchPoliciesCallback callback);
+    void setSwitchPolicyCallback(SetSwitchPolicyCallback callback);
+    
+    // Register callback for getting the switch latency histogram
+    void setGetSwitchLatencyCallback(GetSwitchLatencyCallback callback);
+    
+    // Register callback for getting the output jitter histogram
+    void setGetOutputJitterCallback(GetOutputJitterCallback callback);
+    
+    // Register callback for the histograms served on /metrics
+    void setGetMetricsCallback(GetMetricsCallback callback);
+    
+    // Register callback for GET /frame (only when the frame index is enabled)
+    void setGetFrameCallback(GetFrameCallback callback);
+    
+    // Notify controller and /events streams of scene change (queued, never blocks)
     void notifySceneChange(const std::string& scene, const std::string& controllerUrl);
     
+    // Any thread: send an event to every /events stream. data is one line of JSON.
+    void publishEvent(const std::string& event, const std::string& data);
+    
     // Check if server is running
     bool isRunning() const { return running_.load(); }
     
 private:
+    // One client connection (server thread only)
+    struct Connection {
+        std::string in;             // Received, not yet handled
+        std::string out;            // Response bytes not yet sent
+        size_t out_offset = 0;
+        bool close_after_write = false;
+        bool event_stream = false;  // GET /events: no more requests, only events
+        uint32_t events = 0;        // Registered with epoll
+        std::chrono::steady_clock::time_point last_active;
+    };
+    
     // Server main loop
     void serverLoop();
     
+    void acceptConnections();
+    
+    // Read what the socket has and answer every complete request.
+    // false = close the connection.
+    bool readConnection(int fd, Connection& conn);
+    bool handleBufferedRequests(Connection& conn);
+    
+    // Send pending response bytes. false = close the connection.
+    bool writeConnection(int fd, Connection& conn);
+    
+    void updateEvents(int fd, Connection& conn);
+    void closeConnection(int fd);
+    void closeIdleConnections();
+    
+    // /events payload from the callbacks: everything (snapshot for a new
+    // stream) or only what changed since the last sample
+    std::string sampleEvents(bool snapshot);
+    void sendToEventStreams(const std::string& text);
+    void sendQueuedEvents();
+    
     // Parse HTTP request and extract path and body
     bool parseRequest(const std::string& request, std::string& method, std::string& path, std::string& body);
     
     // Handle incoming request
     std::string handleRequest(const std::string& method, const std::string& path, const std::string& body);
     
+    // JSON body for a histogram endpoint
+    static std::string histogramJson(const LatencyHistogram::Snapshot& snapshot);
+    
+    // Prometheus text exposition of histogram series (seconds)
+    static std::string prometheusText(const std::vector<HistogramMetric>& metrics);
+    
     uint16_t port_;
     std::atomic<bool> running_;
     std::thread server_thread_;
     int server_fd_;
+    int epoll_fd_;
+    int wake_fd_;                   // eventfd, wakes the loop for stop() and publishEvent()
+    std::unordered_map<int, Connection> connections_;   // Server thread only
+    
+    std::mutex event_mutex_;
+    std::vector<std::pair<std::string, std::string>> queued_events_;    // Guarded by event_mutex_
+    
+    // Last sample sent to /events (server thread only)
+    size_t event_streams_ = 0;
+    std::chrono::steady_clock::time_point next_sample_;
+    std::chrono::steady_clock::time_point next_heartbeat_;
+    int last_output_healthy_ = -1;  // -1 = not sampled yet
+    std::string last_input_health_;
+    std::string last_input_json_[3];    // fallback, camera, drone
+    
+    ControllerNotifier notifier_;
+    
+    static constexpr size_t MAX_CONNECTIONS = 64;
+    static constexpr int KEEPALIVE_TIMEOUT_MS = 10000;
+    static constexpr size_t MAX_REQUEST_BYTES = 64 * 1024;
+    static constexpr int MAX_EVENTS = 64;
+    static constexpr int EVENT_INTERVAL_MS = 1000;
+    static constexpr int EVENT_HEARTBEAT_MS = 15000;
+    static constexpr size_t EVENT_BACKLOG_BYTES = 256 * 1024;
     
     std::mutex callback_mutex_;
     PrivacyCallback privacy_callback_;
@@ -109,5 +265,11 @@ private:
     GetCurrentSceneCallback get_current_scene_callback_;
     GetSceneTimestampCallback get_scene_timestamp_callback_;
     GetInputMetricsCallback get_input_metrics_callback_;
+    GetSwitchPoliciesCallback get_switch_policies_callback_;
+    SetSwitchPolicyCallback set_switch_policy_callback_;
+    GetSwitchLatencyCallback get_switch_latency_callback_;
+    GetOutputJitterCallback get_output_jitter_callback_;
+    GetMetricsCallback get_metrics_callback_;
+    GetFrameCallback get_frame_callback_;
     std::shared_ptr<InputSourceManager> input_source_manager_;
 };
\ No newline at end of file
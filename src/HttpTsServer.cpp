@@ -0,0 +1,245 @@
+#include "HttpTsServer.h"
+#include "OutputBatcher.h"
+#include "PacketSink.h"
+#include <iostream>
+#include <cstring>
+#include <chrono>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+namespace {
+
+/**
+ * One HTTP-TS client: writes the stream to the accepted socket. open()
+ * succeeds once; after close() (lag, write error) the client is gone.
+ */
+class HttpTsClient : public PacketSink {
+public:
+    HttpTsClient(int fd, const std::string& peer, std::shared_ptr<std::atomic<size_t>> clients)
+        : fd_(fd), peer_(peer), clients_(std::move(clients)), packets_written_(0), bytes_written_(0) {
+        (*clients_)++;
+    }
+    ~HttpTsClient() override {
+        close();
+        (*clients_)--;
+    }
+
+    bool open() override { return fd_ >= 0; }
+
+    void close() override {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+            std::cout << "[HttpTsServer] Client " << peer_ << " closed ("
+                      << bytes_written_.load() << " bytes sent)" << std::endl;
+        }
+    }
+
+    bool writePacket(const ts::TSPacket& packet) override { return writePackets(&packet, 1); }
+
+    bool writePackets(const ts::TSPacket* packets, size_t count) override {
+        if (batcher_.stagedPackets() + count >= batcher_.flushPackets()) {
+            return flushWith(packets, count);
+        }
+        for (size_t i = 0; i < count; i++) {
+            batcher_.stage(packets[i]);
+        }
+        return flushIfDue();
+    }
+
+    ts::TSPacket* reserve(size_t count) override { return batcher_.reserve(count); }
+    bool commit(size_t count) override { return batcher_.commit(count) ? flush() : true; }
+    bool flush() override { return flushWith(nullptr, 0); }
+    bool flushIfDue() override { return batcher_.isFlushDue() ? flush() : true; }
+    void setBatching(size_t flush_packets, int flush_deadline_ms) override {
+        flush();
+        batcher_.configure(flush_packets, flush_deadline_ms);
+    }
+    int getFlushWaitMs(int max_wait_ms) const override { return batcher_.msUntilDeadline(max_wait_ms); }
+
+    uint64_t getPacketsWritten() const override { return packets_written_.load(); }
+    uint64_t getBytesWritten() const override { return bytes_written_.load(); }
+
+private:
+    bool flushWith(const ts::TSPacket* extra, size_t count) {
+        if (batcher_.stagedPackets() + count == 0) {
+            return true;
+        }
+        if (fd_ < 0) {
+            batcher_.discard();
+            return false;
+        }
+        size_t written = 0;
+        int err = batcher_.flush(fd_, extra, count, written);
+        packets_written_ += written;
+        bytes_written_ += written * ts::PKT_SIZE;
+        if (err != 0) {
+            // EPIPE / ECONNRESET: the client left. EAGAIN: send timeout, it stalled.
+            std::cout << "[HttpTsServer] Client " << peer_ << " write failed: " << strerror(err) << std::endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    int fd_;
+    std::string peer_;
+    std::shared_ptr<std::atomic<size_t>> clients_;
+    std::atomic<uint64_t> packets_written_;
+    std::atomic<uint64_t> bytes_written_;
+    OutputBatcher batcher_;
+};
+
+}  // namespace
+
+HttpTsServer::HttpTsServer(uint16_t port, FanoutOutput& fanout, FanoutOutput::Policy policy,
+                           size_t max_lag_packets)
+    : port_(port),
+      fanout_(fanout),
+      policy_(policy),
+      max_lag_packets_(max_lag_packets),
+      running_(false),
+      server_fd_(-1),
+      clients_(std::make_shared<std::atomic<size_t>>(0)) {
+}
+
+HttpTsServer::~HttpTsServer() {
+    stop();
+}
+
+bool HttpTsServer::start() {
+    if (running_.load()) {
+        return true;
+    }
+    
+    server_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server_fd_ < 0) {
+        std::cerr << "[HttpTsServer] Failed to create socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+    
+    int opt = 1;
+    setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port_);
+    
+    if (bind(server_fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(server_fd_, 16) < 0) {
+        std::cerr << "[HttpTsServer] Failed to listen on port " << port_ << ": " << strerror(errno) << std::endl;
+        ::close(server_fd_);
+        server_fd_ = -1;
+        return false;
+    }
+    
+    running_ = true;
+    server_thread_ = std::thread(&HttpTsServer::serverLoop, this);
+    
+    std::cout << "[HttpTsServer] Serving HTTP-TS on port " << port_ << " (GET /stream.ts, policy "
+              << FanoutOutput::policyName(policy_) << ")" << std::endl;
+    return true;
+}
+
+void HttpTsServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (server_thread_.joinable()) {
+        server_thread_.join();
+    }
+    if (server_fd_ >= 0) {
+        ::close(server_fd_);
+        server_fd_ = -1;
+    }
+    std::cout << "[HttpTsServer] Stopped" << std::endl;
+}
+
+void HttpTsServer::serverLoop() {
+    while (running_.load()) {
+        struct pollfd pfd;
+        pfd.fd = server_fd_;
+        pfd.events = POLLIN;
+        
+        int ret = poll(&pfd, 1, 500);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[HttpTsServer] Poll error: " << strerror(errno) << std::endl;
+            break;
+        }
+        if (ret == 0) {
+            continue;
+        }
+        
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        int client_fd = accept4(server_fd_, (struct sockaddr*)&client_addr, &client_len, SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "[HttpTsServer] Accept error: " << strerror(errno) << std::endl;
+            }
+            continue;
+        }
+        
+        char ip[INET_ADDRSTRLEN] = {0};
+        inet_ntop(AF_INET, &client_addr.sin_addr, ip, sizeof(ip));
+        acceptClient(client_fd, std::string(ip) + ":" + std::to_string(ntohs(client_addr.sin_port)));
+    }
+}
+
+void HttpTsServer::acceptClient(int client_fd, const std::string& peer) {
+    // Read the request head (a GET has no body)
+    std::string request;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(REQUEST_TIMEOUT_MS);
+    char buffer[2048];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        int remaining = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count());
+        struct pollfd pfd;
+        pfd.fd = client_fd;
+        pfd.events = POLLIN;
+        if (remaining <= 0 || poll(&pfd, 1, remaining) <= 0) {
+            break;
+        }
+        ssize_t n = read(client_fd, buffer, sizeof(buffer));
+        if (n <= 0) {
+            break;
+        }
+        request.append(buffer, static_cast<size_t>(n));
+    }
+    
+    std::string response;
+    bool accepted = false;
+    if (request.rfind("GET /stream.ts ", 0) != 0 && request.rfind("GET / ", 0) != 0) {
+        response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    } else if (clients_->load() >= MAX_CLIENTS) {
+        response = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    } else {
+        response = "HTTP/1.1 200 OK\r\nContent-Type: video/mp2t\r\nCache-Control: no-cache\r\n"
+                   "Connection: close\r\n\r\n";
+        accepted = true;
+    }
+    
+    // A client that stops reading fails its next write instead of holding its sink forever
+    struct timeval tv;
+    tv.tv_sec = SEND_TIMEOUT_MS / 1000;
+    tv.tv_usec = (SEND_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    
+    if (send(client_fd, response.data(), response.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(response.size()) ||
+        !accepted) {
+        ::close(client_fd);
+        return;
+    }
+    
+    std::cout << "[HttpTsServer] Client " << peer << " connected" << std::endl;
+    fanout_.addSink("HTTP-TS " + peer, std::make_unique<HttpTsClient>(client_fd, peer, clients_),
+                    policy_, max_lag_packets_, true);
+}
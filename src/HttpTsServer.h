@@ -0,0 +1,58 @@
+#ifndef HTTP_TS_SERVER_H
+#define HTTP_TS_SERVER_H
+
+#include <string>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <cstdint>
+#include "FanoutOutput.h"
+
+/**
+ * HttpTsServer - Serves the spliced stream as HTTP-TS (GET /stream.ts)
+ *
+ * Every accepted client becomes a transient FanoutOutput sink with its own
+ * cursor: it starts at the newest IDR, gets the stream as a close-delimited
+ * video/mp2t response, and is dropped when it disconnects or falls behind
+ * (per its policy). Clients never slow down the splice loop or each other.
+ */
+class HttpTsServer {
+public:
+    HttpTsServer(uint16_t port, FanoutOutput& fanout, FanoutOutput::Policy policy, size_t max_lag_packets);
+    ~HttpTsServer();
+
+    HttpTsServer(const HttpTsServer&) = delete;
+    HttpTsServer& operator=(const HttpTsServer&) = delete;
+
+    // Listen and accept clients in a background thread
+    bool start();
+
+    // Stop accepting (connected clients stay with the fan-out)
+    void stop();
+
+    size_t getClientCount() const { return clients_->load(); }
+
+private:
+    void serverLoop();
+
+    // Read the request and hand the socket to the fan-out (closes it on error)
+    void acceptClient(int client_fd, const std::string& peer);
+
+    uint16_t port_;
+    FanoutOutput& fanout_;
+    FanoutOutput::Policy policy_;
+    size_t max_lag_packets_;
+
+    std::atomic<bool> running_;
+    std::thread server_thread_;
+    int server_fd_;
+
+    // Shared with the client sinks, which outlive the server in the fan-out
+    std::shared_ptr<std::atomic<size_t>> clients_;
+
+    static constexpr size_t MAX_CLIENTS = 16;
+    static constexpr int REQUEST_TIMEOUT_MS = 2000;
+    static constexpr int SEND_TIMEOUT_MS = 5000;
+};
+
+#endif // HTTP_TS_SERVER_H
@@ -0,0 +1,457 @@
+#include "InputReactor.h"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+InputReactor::InputReactor()
+    : epoll_fd_(-1),
+      stop_fd_(-1),
+      running_(false),
+      use_uring_(true),
+      uring_active_(false),
+      scratch_(SCRATCH_SIZE) {
+#ifdef HAVE_LIBURING
+    buffers_registered_ = false;
+#endif
+}
+
+InputReactor::~InputReactor() {
+    stop();
+}
+
+void InputReactor::addInput(StreamInput& input) {
+    if (running_.load()) {
+        std::cerr << "[InputReactor] Cannot add " << input.getName() << " while running" << std::endl;
+        return;
+    }
+    slots_.push_back({&input, -1, SlotState::CLOSED, std::chrono::steady_clock::now(), 0, false});
+}
+
+bool InputReactor::start() {
+    if (running_.load()) {
+        std::cerr << "[InputReactor] Already running" << std::endl;
+        return false;
+    }
+    
+    stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop_fd_ < 0) {
+        std::cerr << "[InputReactor] eventfd failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    
+#ifdef HAVE_LIBURING
+    if (use_uring_) {
+        uring_active_ = initUring();
+    }
+    if (uring_active_) {
+        running_ = true;
+        thread_ = std::thread(&InputReactor::uringThreadFunc, this);
+        std::cout << "[InputReactor] Started (io_uring), servicing " << slots_.size()
+                  << " inputs on one thread" << std::endl;
+        return true;
+    }
+#endif
+    
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        std::cerr << "[InputReactor] epoll_create1 failed: " << strerror(errno) << std::endl;
+        close(stop_fd_);
+        stop_fd_ = -1;
+        return false;
+    }
+    
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = STOP_TOKEN;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, stop_fd_, &ev);
+    
+    running_ = true;
+    thread_ = std::thread(&InputReactor::threadFunc, this);
+    
+    std::cout << "[InputReactor] Started (epoll), servicing " << slots_.size() << " inputs on one thread" << std::endl;
+    return true;
+}
+
+void InputReactor::stop() {
+    if (!running_.load() && !thread_.joinable()) {
+        return;
+    }
+    
+    std::cout << "[InputReactor] Stopping..." << std::endl;
+    running_ = false;
+    
+    uint64_t one = 1;
+    ssize_t ignored = write(stop_fd_, &one, sizeof(one));
+    (void)ignored;
+    
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    
+#ifdef HAVE_LIBURING
+    // Cancels the reads still in flight before their descriptors and
+    // buffers go away
+    if (uring_active_) {
+        io_uring_queue_exit(&ring_);
+    }
+#endif
+    
+    for (size_t i = 0; i < slots_.size(); i++) {
+        if (slots_[i].state != SlotState::CLOSED) {
+            closeSlot(i, false);
+        }
+        std::cout << "[" << slots_[i].input->getName() << "] Stopped. Total packets: "
+                  << slots_[i].input->getPacketsReceived() << std::endl;
+    }
+    
+    close(stop_fd_);
+    stop_fd_ = -1;
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+    uring_active_ = false;
+    std::cout << "[InputReactor] Stopped" << std::endl;
+}
+
+void InputReactor::openSlot(size_t index) {
+    Slot& slot = slots_[index];
+    StreamInput::OpenResult result = slot.input->openSource(slot.fd);
+    
+    if (result == StreamInput::OpenResult::FAILED) {
+        slot.fd = -1;
+        slot.retry_at = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(slot.input->getReconnectDelayMs());
+        std::cout << "[" << slot.input->getName() << "] Retrying in "
+                  << (slot.input->getReconnectDelayMs() / 1000.0) << "s..." << std::endl;
+        return;
+    }
+    
+    slot.blocking = false;  // Sources open nonblocking
+    if (result == StreamInput::OpenResult::IN_PROGRESS) {
+        slot.state = SlotState::CONNECTING;
+    } else {
+        slot.state = SlotState::OPEN;
+        slot.input->handleOpened();
+    }
+    
+#ifdef HAVE_LIBURING
+    if (uring_active_) {
+        // Wait for the first data (or the connect) before reading: a pipe
+        // without a writer reads as EOF rather than blocking
+        uringPoll(index, slot.state == SlotState::CONNECTING ? POLLOUT : POLLIN);
+        return;
+    }
+#endif
+    
+    struct epoll_event ev = {};
+    ev.events = slot.state == SlotState::CONNECTING ? EPOLLOUT : EPOLLIN;
+    ev.data.u64 = index;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, slot.fd, &ev) < 0) {
+        std::cerr << "[" << slot.input->getName() << "] epoll_ctl failed: " << strerror(errno) << std::endl;
+        closeSlot(index, true);
+    }
+}
+
+void InputReactor::closeSlot(size_t index, bool retry_later) {
+    Slot& slot = slots_[index];
+    if (slot.fd >= 0) {
+        if (epoll_fd_ >= 0) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, slot.fd, nullptr);
+        }
+        slot.input->closeSource(slot.fd);
+        slot.fd = -1;
+    }
+    if (slot.state == SlotState::OPEN) {
+        std::cout << "[" << slot.input->getName() << "] Connection closed" << std::endl;
+        slot.input->handleClosed();
+    }
+    slot.state = SlotState::CLOSED;
+    
+    // A lost connection is reopened right away (like the old reader threads);
+    // only a failed open or connect waits out the reconnect delay
+    auto now = std::chrono::steady_clock::now();
+    slot.retry_at = retry_later ? now + std::chrono::milliseconds(slot.input->getReconnectDelayMs()) : now;
+}
+
+void InputReactor::handleEvent(size_t index, uint32_t events) {
+    Slot& slot = slots_[index];
+    
+    if (slot.state == SlotState::CONNECTING) {
+        if (!slot.input->finishOpen(slot.fd)) {
+            closeSlot(index, true);
+            return;
+        }
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = index;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, slot.fd, &ev);
+        slot.state = SlotState::OPEN;
+        slot.input->handleOpened();
+        return;
+    }
+    
+    if (slot.state != SlotState::OPEN) {
+        return;
+    }
+    
+    // EPOLLHUP / EPOLLERR: read anyway, the read reports EOF or the error
+    // after draining whatever is still buffered
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        if (!slot.input->handleReadable(slot.fd, scratch_.data(), scratch_.size())) {
+            closeSlot(index, false);
+        }
+    }
+}
+
+void InputReactor::reopenDueSlots() {
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < slots_.size(); i++) {
+        if (slots_[i].state == SlotState::CLOSED && slots_[i].retry_at <= now) {
+            openSlot(i);
+        }
+    }
+}
+
+int InputReactor::nextTimeoutMs() const {
+    auto now = std::chrono::steady_clock::now();
+    int64_t timeout = MAX_WAIT_MS;
+    for (const Slot& slot : slots_) {
+        if (slot.state == SlotState::CLOSED) {
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(slot.retry_at - now).count();
+            timeout = std::min<int64_t>(timeout, std::max<int64_t>(ms, 0));
+        }
+    }
+    return static_cast<int>(timeout);
+}
+
+void InputReactor::threadFunc() {
+    std::cout << "[InputReactor] Thread started" << std::endl;
+    struct epoll_event events[MAX_EVENTS];
+    
+    while (running_.load()) {
+        // (Re)open closed inputs whose retry time has come
+        reopenDueSlots();
+        
+        int n = epoll_wait(epoll_fd_, events, MAX_EVENTS, nextTimeoutMs());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[InputReactor] epoll_wait failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.u64 == STOP_TOKEN) {
+                continue;
+            }
+            handleEvent(static_cast<size_t>(events[i].data.u64), events[i].events);
+        }
+    }
+    
+    std::cout << "[InputReactor] Thread stopped" << std::endl;
+}
+
+#ifdef HAVE_LIBURING
+
+// user_data layout: slot index << 8 | operation
+static inline uint64_t uringToken(size_t index, uint64_t op) {
+    return (static_cast<uint64_t>(index) << 8) | op;
+}
+
+bool InputReactor::initUring() {
+    int ret = io_uring_queue_init(URING_QUEUE_DEPTH, &ring_, 0);
+    if (ret < 0) {
+        std::cerr << "[InputReactor] io_uring unavailable (" << strerror(-ret)
+                  << "), falling back to epoll" << std::endl;
+        return false;
+    }
+    
+    // Fixed buffers save the per-read page pinning; if the kernel refuses
+    // (RLIMIT_MEMLOCK on older kernels) the same memory is used unregistered
+    uring_buffers_.assign(slots_.size() * 2 * SCRATCH_SIZE, 0);
+    std::vector<struct iovec> iovecs(slots_.size() * 2);
+    for (size_t i = 0; i < iovecs.size(); i++) {
+        iovecs[i].iov_base = uring_buffers_.data() + i * SCRATCH_SIZE;
+        iovecs[i].iov_len = SCRATCH_SIZE;
+    }
+    ret = iovecs.empty() ? -EINVAL : io_uring_register_buffers(&ring_, iovecs.data(), iovecs.size());
+    buffers_registered_ = ret == 0;
+    if (!buffers_registered_) {
+        std::cerr << "[InputReactor] Warning: io_uring buffer registration failed ("
+                  << strerror(-ret) << "), using unregistered buffers" << std::endl;
+    }
+    
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+    io_uring_prep_poll_add(sqe, stop_fd_, POLLIN);
+    sqe->user_data = STOP_TOKEN;
+    return true;
+}
+
+uint8_t* InputReactor::uringBuffer(size_t index, int buffer) {
+    return uring_buffers_.data() + (index * 2 + buffer) * SCRATCH_SIZE;
+}
+
+// The reactor may read into its own buffers only while the input needs no
+// say in the read: passthrough has to tee() each chunk before it is read
+static bool directRead(const StreamInput& input) {
+    return input.allowsDirectRead() && !input.isPassthroughRequested();
+}
+
+void InputReactor::uringSetBlocking(size_t index, bool blocking) {
+    Slot& slot = slots_[index];
+    if (slot.blocking == blocking) {
+        return;
+    }
+    int flags = fcntl(slot.fd, F_GETFL);
+    if (flags >= 0) {
+        fcntl(slot.fd, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
+    }
+    slot.blocking = blocking;
+}
+
+void InputReactor::uringPoll(size_t index, uint32_t events) {
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+    io_uring_prep_poll_add(sqe, slots_[index].fd, events);
+    sqe->user_data = uringToken(index, OP_POLL);
+}
+
+void InputReactor::uringRead(size_t index) {
+    Slot& slot = slots_[index];
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+    uint8_t* buf = uringBuffer(index, slot.buffer);
+    if (buffers_registered_) {
+        io_uring_prep_read_fixed(sqe, slot.fd, buf, SCRATCH_SIZE, 0, static_cast<int>(index * 2 + slot.buffer));
+    } else {
+        io_uring_prep_read(sqe, slot.fd, buf, SCRATCH_SIZE, 0);
+    }
+    sqe->user_data = uringToken(index, OP_READ);
+}
+
+void InputReactor::uringComplete(size_t index, uint64_t op, int res, uint8_t* data) {
+    Slot& slot = slots_[index];
+    StreamInput& input = *slot.input;
+    
+    if (op == OP_POLL) {
+        if (res < 0) {
+            std::cerr << "[" << input.getName() << "] Poll failed: " << strerror(-res) << std::endl;
+            closeSlot(index, slot.state == SlotState::CONNECTING);
+            return;
+        }
+        if (slot.state == SlotState::CONNECTING) {
+            if (!input.finishOpen(slot.fd)) {
+                closeSlot(index, true);
+                return;
+            }
+            slot.state = SlotState::OPEN;
+            input.handleOpened();
+        } else if (!directRead(input)) {
+            // Inputs with their own readSource() (or in passthrough) stay
+            // readiness-driven
+            uringSetBlocking(index, false);
+            if (!input.handleReadable(slot.fd, scratch_.data(), scratch_.size())) {
+                closeSlot(index, false);
+                return;
+            }
+            if (!directRead(input)) {
+                uringPoll(index, POLLIN);
+                return;
+            }
+        }
+        
+        // Readable (or connected): from here on a read is always in flight.
+        // Blocking mode lets the kernel park the read until data arrives
+        // instead of completing it with EAGAIN.
+        uringSetBlocking(index, true);
+        uringRead(index);
+        return;
+    }
+    
+    // OP_READ. On success the follow-up read was already queued.
+    if (res > 0) {
+        input.handleData(data, static_cast<size_t>(res));
+    } else if (res == 0) {
+        std::cout << "[" << input.getName() << "] EOF (writer disconnected)" << std::endl;
+        closeSlot(index, false);
+    } else if (res == -EINTR || res == -EAGAIN) {
+        uringRead(index);
+    } else {
+        std::cerr << "[" << input.getName() << "] Read error: " << strerror(-res) << std::endl;
+        closeSlot(index, false);
+    }
+}
+
+void InputReactor::uringThreadFunc() {
+    std::cout << "[InputReactor] Thread started (io_uring)" << std::endl;
+    
+    struct Completion {
+        size_t index;
+        uint64_t op;
+        int res;
+        uint8_t* data;
+    };
+    struct io_uring_cqe* cqes[MAX_EVENTS];
+    Completion done[MAX_EVENTS];
+    
+    while (running_.load()) {
+        reopenDueSlots();
+        io_uring_submit(&ring_);
+        
+        int timeout_ms = nextTimeoutMs();
+        struct __kernel_timespec ts;
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+        struct io_uring_cqe* cqe = nullptr;
+        int ret = io_uring_wait_cqe_timeout(&ring_, &cqe, &ts);
+        if (ret == -ETIME || ret == -EINTR) {
+            continue;
+        }
+        if (ret < 0) {
+            std::cerr << "[InputReactor] io_uring wait failed: " << strerror(-ret) << std::endl;
+            break;
+        }
+        
+        // Reap the batch and queue each input's next read into its other
+        // buffer before parsing, so the kernel fills it in the meantime
+        unsigned n = io_uring_peek_batch_cqe(&ring_, cqes, MAX_EVENTS);
+        size_t count = 0;
+        for (unsigned i = 0; i < n; i++) {
+            uint64_t token = cqes[i]->user_data;
+            if (token == STOP_TOKEN) {
+                continue;
+            }
+            Completion c;
+            c.index = static_cast<size_t>(token >> 8);
+            c.op = token & 0xFF;
+            c.res = cqes[i]->res;
+            c.data = nullptr;
+            if (c.op == OP_READ && c.res > 0) {
+                Slot& slot = slots_[c.index];
+                c.data = uringBuffer(c.index, slot.buffer);
+                slot.buffer ^= 1;
+                if (directRead(*slot.input)) {
+                    uringRead(c.index);
+                } else {
+                    uringPoll(c.index, POLLIN);
+                }
+            }
+            done[count++] = c;
+        }
+        io_uring_cq_advance(&ring_, n);
+        io_uring_submit(&ring_);
+        
+        for (size_t i = 0; i < count; i++) {
+            uringComplete(done[i].index, done[i].op, done[i].res, done[i].data);
+        }
+    }
+    
+    std::cout << "[InputReactor] Thread stopped" << std::endl;
+}
+
+#endif // HAVE_LIBURING
@@ -0,0 +1,117 @@
+#ifndef INPUT_REACTOR_H
+#define INPUT_REACTOR_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "StreamInput.h"
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+/**
+ * InputReactor - Services every StreamInput from one thread
+ *
+ * Replaces the thread-per-reader model. Two backends:
+ *
+ * - epoll (always available): each input's descriptor is registered
+ *   level-triggered, and readiness is dispatched to
+ *   StreamInput::handleReadable(), which reads a bounded amount so a busy
+ *   source cannot starve the others.
+ *
+ * - io_uring (built with liburing, HAVE_LIBURING): the reactor keeps a read
+ *   in flight on every input, into buffers registered with the kernel. As
+ *   soon as a read completes the next one is queued into the input's other
+ *   buffer, and the completed buffer goes straight to the reassembler, so
+ *   parsing overlaps the next read and one io_uring_enter() covers all
+ *   inputs. Only one read per input is in flight at a time: completions of
+ *   concurrent reads on the same pipe or socket are not ordered.
+ *   Falls back to epoll when the kernel refuses io_uring (old kernels,
+ *   seccomp profiles). While an input has passthrough requested it goes
+ *   back to readiness polls and handleReadable(), which owns the tee()s.
+ *
+ * Opens, nonblocking connects and reconnect delays are driven from the same
+ * loop (the wait timeout is the next pending retry), so inputs never sleep
+ * or block it.
+ *
+ * Inputs must be added before start() and outlive the reactor.
+ */
+class InputReactor {
+public:
+    InputReactor();
+    ~InputReactor();
+
+    InputReactor(const InputReactor&) = delete;
+    InputReactor& operator=(const InputReactor&) = delete;
+
+    // Register an input (before start())
+    void addInput(StreamInput& input);
+
+    // Prefer the io_uring backend when it was compiled in (default: true)
+    void setUseIoUring(bool enable) { use_uring_ = enable; }
+
+    // Start the reactor thread
+    bool start();
+
+    // Stop the thread and close every input
+    void stop();
+
+    // Backend in use ("epoll" or "io_uring")
+    const char* getBackendName() const { return uring_active_ ? "io_uring" : "epoll"; }
+
+private:
+    enum class SlotState { CLOSED, CONNECTING, OPEN };
+
+    struct Slot {
+        StreamInput* input;
+        int fd;
+        SlotState state;
+        std::chrono::steady_clock::time_point retry_at;
+        int buffer;             // io_uring: buffer the next read goes into (0/1)
+        bool blocking;          // io_uring: O_NONBLOCK cleared for parked reads
+    };
+
+    void threadFunc();
+    void openSlot(size_t index);
+    void closeSlot(size_t index, bool retry_later);
+    void handleEvent(size_t index, uint32_t events);
+    void reopenDueSlots();
+    int nextTimeoutMs() const;
+
+#ifdef HAVE_LIBURING
+    bool initUring();
+    void uringThreadFunc();
+    void uringPoll(size_t index, uint32_t events);
+    void uringRead(size_t index);
+    void uringComplete(size_t index, uint64_t op, int res, uint8_t* data);
+    uint8_t* uringBuffer(size_t index, int buffer);
+    void uringSetBlocking(size_t index, bool blocking);
+
+    struct io_uring ring_;
+    std::vector<uint8_t> uring_buffers_;    // Two SCRATCH_SIZE buffers per input
+    bool buffers_registered_;
+
+    static constexpr unsigned URING_QUEUE_DEPTH = 64;
+    static constexpr uint64_t OP_POLL = 0;
+    static constexpr uint64_t OP_READ = 1;
+#endif
+
+    std::vector<Slot> slots_;
+    int epoll_fd_;
+    int stop_fd_;               // eventfd, wakes the wait on stop()
+    std::thread thread_;
+    std::atomic<bool> running_;
+    bool use_uring_;
+    bool uring_active_;
+    std::vector<uint8_t> scratch_;  // Shared read buffer (reactor thread only)
+
+    static constexpr size_t SCRATCH_SIZE = 64 * 1024;   // 64 KB
+    static constexpr int MAX_EVENTS = 16;
+    static constexpr int MAX_WAIT_MS = 500;
+    static constexpr uint64_t STOP_TOKEN = UINT64_MAX;
+};
+
+#endif // INPUT_REACTOR_H
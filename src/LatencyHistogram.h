@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * LatencyHistogram - Fixed-bucket latency histogram with lock-free recording
+ *
+ * Bucket upper bounds are fixed (100 us .. 10 s, roughly 1-2.5-5 steps) so
+ * snapshots from different processes or times can be compared directly,
+ * and a Prometheus-style exporter can emit them as cumulative "le" buckets.
+ *
+ * Thread-safety: record() may be called from any thread; snapshot() may
+ * run concurrently and returns a consistent-enough copy (each counter is
+ * read atomically, the set is not).
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t BUCKET_COUNT = 16;
+
+    // Upper bounds in microseconds; the last bucket catches everything above
+    static constexpr std::array<uint64_t, BUCKET_COUNT - 1> BUCKET_BOUNDS_US = {
+        100, 250, 500,
+        1000, 2500, 5000,
+        10000, 25000, 50000,
+        100000, 250000, 500000,
+        1000000, 2500000, 10000000
+    };
+
+    struct Snapshot {
+        std::array<uint64_t, BUCKET_COUNT> buckets{};  // Per bucket, not cumulative
+        uint64_t count = 0;
+        uint64_t sum_us = 0;
+        uint64_t max_us = 0;
+
+        double meanUs() const { return count > 0 ? static_cast<double>(sum_us) / count : 0.0; }
+
+        // Upper bound of the bucket holding quantile q (0..1); max_us for the overflow bucket
+        uint64_t quantileUs(double q) const {
+            if (count == 0) return 0;
+            uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < BUCKET_COUNT - 1; i++) {
+                seen += buckets[i];
+                if (seen >= rank) {
+                    return BUCKET_BOUNDS_US[i] < max_us ? BUCKET_BOUNDS_US[i] : max_us;
+                }
+            }
+            return max_us;
+        }
+    };
+
+    void record(std::chrono::steady_clock::duration latency) {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+        recordUs(us > 0 ? static_cast<uint64_t>(us) : 0);
+    }
+
+    void recordUs(uint64_t us) {
+        size_t bucket = 0;
+        while (bucket < BUCKET_COUNT - 1 && us > BUCKET_BOUNDS_US[bucket]) {
+            bucket++;
+        }
+        buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+        sum_us_.fetch_add(us, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t prev = max_us_.load(std::memory_order_relaxed);
+        while (us > prev && !max_us_.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+        }
+    }
+
+    Snapshot snapshot() const {
+        Snapshot s;
+        for (size_t i = 0; i < BUCKET_COUNT; i++) {
+            s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        }
+        s.count = count_.load(std::memory_order_relaxed);
+        s.sum_us = sum_us_.load(std::memory_order_relaxed);
+        s.max_us = max_us_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_us_{0};
+    std::atomic<uint64_t> max_us_{0};
+};
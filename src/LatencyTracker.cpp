@@ -0,0 +1,52 @@
+#include "LatencyTracker.h"
+
+LatencyTracker::LatencyTracker(const std::vector<std::string>& sources, const SequenceStamps* egress)
+    : egress_(egress) {
+    for (const std::string& name : sources) {
+        auto source = std::make_unique<Source>();
+        source->name = name;
+        sources_.push_back(std::move(source));
+    }
+}
+
+void LatencyTracker::recordBatch(size_t source, int64_t ingest_ns, int64_t dequeue_ns, uint64_t out_seq) {
+    if (source >= sources_.size()) {
+        return;
+    }
+    recordNs(sources_[source]->ingest_to_dequeue, dequeue_ns - ingest_ns);
+
+    if (egress_ && pending_.size() < MAX_PENDING_SAMPLES) {
+        pending_.push_back({source, ingest_ns, dequeue_ns, out_seq});
+    }
+}
+
+void LatencyTracker::poll() {
+    while (!pending_.empty()) {
+        const Sample& sample = pending_.front();
+        int64_t egress_ns;
+        SequenceStamps::Lookup result = egress_->lookup(sample.out_seq, egress_ns);
+        if (result == SequenceStamps::Lookup::PENDING) {
+            break;      // Later samples can't be out before this one
+        }
+        if (result == SequenceStamps::Lookup::FOUND) {
+            Source& source = *sources_[sample.source];
+            recordNs(source.dequeue_to_egress, egress_ns - sample.dequeue_ns);
+            recordNs(source.residence, egress_ns - sample.ingest_ns);
+        }
+        pending_.pop_front();
+    }
+}
+
+std::vector<LatencyTracker::SourceStats> LatencyTracker::snapshot() const {
+    std::vector<SourceStats> stats;
+    stats.reserve(sources_.size());
+    for (const auto& source : sources_) {
+        SourceStats s;
+        s.name = source->name;
+        s.ingest_to_dequeue = source->ingest_to_dequeue.snapshot();
+        s.dequeue_to_egress = source->dequeue_to_egress.snapshot();
+        s.residence = source->residence.snapshot();
+        stats.push_back(std::move(s));
+    }
+    return stats;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include "LatencyHistogram.h"
+#include "SequenceStamps.h"
+
+/**
+ * LatencyTracker - How long packets spend inside the multiplexer, per source
+ *
+ * Three points per packet:
+ * - ingest: read() returned it (StreamInput stamps its ring sequence)
+ * - dequeue: the main loop took it off the input ring
+ * - egress: the output's write of it completed (FIFOOutput stamps the
+ *   count of packets it has been handed)
+ *
+ * Not every packet is followed: the main loop reports one sample per
+ * dequeued batch, its oldest packet, with that packet's ingest time and
+ * its position in the output stream. poll() matches pending samples to the
+ * egress stamps once the output has written them. Without egress stamps
+ * (outputs other than the FIFO, see main) only ingest -> dequeue is kept.
+ *
+ * Thread-safety: recordBatch() and poll() belong to the main loop;
+ * snapshot() may be called from any thread.
+ */
+class LatencyTracker {
+public:
+    struct SourceStats {
+        std::string name;
+        LatencyHistogram::Snapshot ingest_to_dequeue;
+        LatencyHistogram::Snapshot dequeue_to_egress;
+        LatencyHistogram::Snapshot residence;   // ingest -> egress
+    };
+
+    // egress: stamps in output packet order, or nullptr if the output has none
+    LatencyTracker(const std::vector<std::string>& sources, const SequenceStamps* egress);
+
+    LatencyTracker(const LatencyTracker&) = delete;
+    LatencyTracker& operator=(const LatencyTracker&) = delete;
+
+    // A batch from `source` whose oldest packet was read at ingest_ns was
+    // dequeued at dequeue_ns and is handed to the output as packet out_seq
+    void recordBatch(size_t source, int64_t ingest_ns, int64_t dequeue_ns, uint64_t out_seq);
+
+    // Resolve samples the output has written since the last call
+    void poll();
+
+    std::vector<SourceStats> snapshot() const;
+
+    bool hasEgress() const { return egress_ != nullptr; }
+
+private:
+    struct Source {
+        std::string name;
+        LatencyHistogram ingest_to_dequeue;
+        LatencyHistogram dequeue_to_egress;
+        LatencyHistogram residence;
+    };
+
+    struct Sample {
+        size_t source;
+        int64_t ingest_ns;
+        int64_t dequeue_ns;
+        uint64_t out_seq;
+    };
+
+    static void recordNs(LatencyHistogram& histogram, int64_t ns) {
+        histogram.recordUs(ns > 0 ? static_cast<uint64_t>(ns / 1000) : 0);
+    }
+
+    std::vector<std::unique_ptr<Source>> sources_;
+    const SequenceStamps* egress_;
+    std::deque<Sample> pending_;    // Main loop only, oldest first
+
+    static constexpr size_t MAX_PENDING_SAMPLES = 4096;
+};
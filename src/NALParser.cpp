@@ -1,6 +1,7 @@
 #include "NALParser.h"
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 
 NALParser::NALParser() {
     std::cout << "[NALParser] Initialized - H.264 NAL unit parser ready" << std::endl;
@@ -195,4 +196,99 @@ void NALParser::reset() {
     last_pps_.clear();
     
     std::cout << "[NALParser] Reset - cleared stored parameter sets" << std::endl;
-}
\ No newline at end of file
+}
+
+void NALStartCodeScanner::beginPES() {
+    active_ = true;
+    result_ = Result::NEED_MORE;
+    pes_offset_ = 0;
+    header_end_ = 9;
+    zeros_ = 0;
+    header_pending_ = false;
+    nal_mask_ = 0;
+}
+
+void NALStartCodeScanner::classify(uint8_t nal_header) {
+    uint8_t type = nal_header & 0x1F;
+    nal_mask_ |= 1u << type;
+    if (type == static_cast<uint8_t>(NALUnitType::CODED_SLICE_IDR)) {
+        result_ = Result::IDR_SLICE;
+    } else if (type >= static_cast<uint8_t>(NALUnitType::CODED_SLICE_NON_IDR) &&
+               type <= static_cast<uint8_t>(NALUnitType::CODED_SLICE_DATA_PARTITION_C)) {
+        result_ = Result::NON_IDR_SLICE;
+    }
+}
+
+NALStartCodeScanner::Result NALStartCodeScanner::feed(const uint8_t* data, size_t size) {
+    if (!scanning() || data == nullptr) {
+        return result_;
+    }
+    
+    size_t i = 0;
+    
+    // Skip the PES header: 9 fixed bytes, byte 8 is PES_header_data_length
+    while (i < size && pes_offset_ < header_end_) {
+        if (pes_offset_ == 8) {
+            header_end_ = 9 + data[i];
+        }
+        if (pes_offset_ >= 9) {
+            size_t n = std::min(size - i, header_end_ - pes_offset_);
+            i += n;
+            pes_offset_ += n;
+        } else {
+            i++;
+            pes_offset_++;
+        }
+    }
+    if (i == size) {
+        return result_;
+    }
+    size_t es_start = i;
+    pes_offset_ += size - i;
+    
+    // Start code completed at the very end of the previous chunk
+    if (header_pending_) {
+        header_pending_ = false;
+        classify(data[i]);
+        i++;
+    }
+    
+    // Jump between 0x01 bytes and look back for the two zeros in front
+    while (i < size && result_ == Result::NEED_MORE) {
+        const void* hit = std::memchr(data + i, 0x01, size - i);
+        if (!hit) {
+            break;
+        }
+        size_t pos = static_cast<size_t>(static_cast<const uint8_t*>(hit) - data);
+        size_t in_chunk = pos - es_start;  // ES bytes in this chunk before the 0x01
+        bool start_code;
+        if (in_chunk >= 2) {
+            start_code = data[pos - 1] == 0x00 && data[pos - 2] == 0x00;
+        } else if (in_chunk == 1) {
+            start_code = data[pos - 1] == 0x00 && zeros_ >= 1;
+        } else {
+            start_code = zeros_ >= 2;
+        }
+        
+        i = pos + 1;
+        if (start_code) {
+            if (i < size) {
+                classify(data[i]);
+                i++;
+            } else {
+                header_pending_ = true;
+            }
+        }
+    }
+    
+    // Carry trailing zeros so a start code split across TS packets is found
+    size_t trailing = 0;
+    while (trailing < 2 && trailing < size - es_start && data[size - 1 - trailing] == 0x00) {
+        trailing++;
+    }
+    zeros_ = (trailing == size - es_start) ? std::min<uint32_t>(2, zeros_ + static_cast<uint32_t>(trailing))
+                                           : static_cast<uint32_t>(trailing);
+    
+    return result_;
+}
+
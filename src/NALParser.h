@@ -168,4 +168,56 @@ private:
     // Statistics for debugging
     uint64_t frames_parsed_ = 0;
     uint64_t idr_frames_found_ = 0;
-};
\ No newline at end of file
+};
+
+/**
+ * Streaming H.264 start-code scanner for IDR detection on the ingest path
+ *
+ * Fed TS payloads of one video PES as they arrive; start codes split
+ * across TS packets are handled by carrying the trailing zero count.
+ * The PES header is skipped, NAL types are recorded as they are seen, and
+ * scanning stops at the first slice NAL (which decides IDR vs non-IDR),
+ * so the rest of a large IDR PES is never touched and nothing is buffered.
+ *
+ * Usage:
+ *   on PUSI:            scanner.beginPES();
+ *   for every payload:  if (scanner.scanning() &&
+ *                           scanner.feed(payload, size) == Result::IDR_SLICE) { ... }
+ */
+class NALStartCodeScanner {
+public:
+    enum class Result {
+        NEED_MORE,      // No slice NAL seen yet in this PES
+        IDR_SLICE,      // First slice of the PES is IDR (type 5)
+        NON_IDR_SLICE   // First slice of the PES is non-IDR (types 1-4)
+    };
+
+    // Start a new PES (call on PUSI, before feeding its first payload)
+    void beginPES();
+
+    // Feed the next chunk of PES bytes. Returns the classification once the
+    // first slice NAL has been seen, NEED_MORE until then.
+    Result feed(const uint8_t* data, size_t size);
+
+    // True between beginPES() and the first slice NAL
+    bool scanning() const { return active_ && result_ == Result::NEED_MORE; }
+
+    Result result() const { return result_; }
+
+    // True if a NAL of this type was seen in the current PES before the first slice
+    bool sawNAL(NALUnitType type) const {
+        return (nal_mask_ >> static_cast<uint8_t>(type)) & 1u;
+    }
+
+private:
+    void classify(uint8_t nal_header);
+
+    bool active_ = false;           // Inside a PES that started with PUSI
+    Result result_ = Result::NEED_MORE;
+    size_t pes_offset_ = 0;         // Bytes of the PES seen so far (header skipping)
+    size_t header_end_ = 9;         // Offset of the first ES byte once byte 8 is known
+    uint32_t zeros_ = 0;            // Trailing 0x00 bytes of the previous chunk (max 2)
+    bool header_pending_ = false;   // Previous chunk ended right after 00 00 01
+    uint32_t nal_mask_ = 0;         // Bit per NAL type seen
+};
+
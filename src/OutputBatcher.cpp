@@ -0,0 +1,164 @@
+#include "OutputBatcher.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <errno.h>
+#include <poll.h>
+#include <sys/uio.h>
+
+OutputBatcher::OutputBatcher()
+    : staging_(nullptr),
+      staging_capacity_(0),
+      staged_(0),
+      flush_packets_(DEFAULT_FLUSH_PACKETS),
+      flush_deadline_(DEFAULT_FLUSH_DEADLINE_MS),
+      flush_count_(0),
+      write_calls_(0),
+      dropped_packets_(0) {
+    ensureCapacity(flush_packets_);
+}
+
+OutputBatcher::~OutputBatcher() {
+    std::free(staging_);
+}
+
+void OutputBatcher::configure(size_t flush_packets, int flush_deadline_ms) {
+    flush_packets_ = std::clamp<size_t>(flush_packets, 1, MAX_FLUSH_PACKETS);
+    flush_deadline_ = std::chrono::milliseconds(std::max(flush_deadline_ms, 0));
+    ensureCapacity(flush_packets_);
+}
+
+void OutputBatcher::ensureCapacity(size_t packets) {
+    if (packets <= staging_capacity_) {
+        return;
+    }
+
+    // aligned_alloc requires the size to be a multiple of the alignment
+    size_t bytes = packets * ts::PKT_SIZE;
+    bytes = (bytes + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+
+    uint8_t* buffer = static_cast<uint8_t*>(std::aligned_alloc(STAGING_ALIGNMENT, bytes));
+    if (!buffer) {
+        return;  // Keep the old buffer, isFull() triggers earlier flushes
+    }
+    if (staged_ > 0) {
+        std::memcpy(buffer, staging_, staged_ * ts::PKT_SIZE);
+    }
+    std::free(staging_);
+    staging_ = buffer;
+    staging_capacity_ = bytes / ts::PKT_SIZE;
+}
+
+bool OutputBatcher::stage(const ts::TSPacket& packet) {
+    if (staged_ >= staging_capacity_) {
+        discard();
+    }
+    if (staged_ == 0) {
+        first_staged_at_ = Clock::now();
+    }
+    std::memcpy(staging_ + staged_ * ts::PKT_SIZE, packet.b, ts::PKT_SIZE);
+    staged_++;
+    return isFull() || staged_ >= staging_capacity_ || isDeadlineExpired(Clock::now());
+}
+
+ts::TSPacket* OutputBatcher::reserve(size_t count) {
+    ensureCapacity(staged_ + count);
+    if (staged_ + count > staging_capacity_) {
+        return nullptr;
+    }
+    // TSPacket is a plain 188-byte array, so staged bytes can be addressed as packets
+    return reinterpret_cast<ts::TSPacket*>(staging_ + staged_ * ts::PKT_SIZE);
+}
+
+bool OutputBatcher::commit(size_t count) {
+    if (count == 0) {
+        return isFlushDue();
+    }
+    if (staged_ == 0) {
+        first_staged_at_ = Clock::now();
+    }
+    staged_ += count;
+    return isFull() || staged_ >= staging_capacity_ || isDeadlineExpired(Clock::now());
+}
+
+void OutputBatcher::discard() {
+    dropped_packets_ += staged_;
+    staged_ = 0;
+}
+
+bool OutputBatcher::isDeadlineExpired(Clock::time_point now) const {
+    return staged_ > 0 && now - first_staged_at_ >= flush_deadline_;
+}
+
+int OutputBatcher::msUntilDeadline(int max_wait_ms) const {
+    if (staged_ == 0) {
+        return max_wait_ms;
+    }
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        first_staged_at_ + flush_deadline_ - Clock::now()).count();
+    return static_cast<int>(std::clamp<int64_t>(remaining, 0, max_wait_ms));
+}
+
+int OutputBatcher::flush(int fd, const ts::TSPacket* extra, size_t count, size_t& packets_written) {
+    struct iovec iov[2];
+    int iovcnt = 0;
+    if (staged_ > 0) {
+        iov[iovcnt].iov_base = staging_;
+        iov[iovcnt].iov_len = staged_ * ts::PKT_SIZE;
+        iovcnt++;
+    }
+    if (extra && count > 0) {
+        // TSPacket is a plain 188-byte array, so the caller's vector is contiguous wire data
+        iov[iovcnt].iov_base = const_cast<uint8_t*>(extra[0].b);
+        iov[iovcnt].iov_len = count * ts::PKT_SIZE;
+        iovcnt++;
+    }
+    staged_ = 0;
+    packets_written = 0;
+
+    if (iovcnt == 0) {
+        return 0;
+    }
+
+    size_t total_written = 0;
+    int first = 0;
+    int err = 0;
+
+    while (first < iovcnt) {
+        ssize_t n = writev(fd, iov + first, iovcnt - first);
+        write_calls_++;
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Non-blocking descriptor is full: wait for room, never spin
+                struct pollfd pfd;
+                pfd.fd = fd;
+                pfd.events = POLLOUT;
+                if (poll(&pfd, 1, -1) >= 0 || errno == EINTR) {
+                    continue;
+                }
+            }
+            err = errno;
+            break;
+        }
+
+        // Partial write: advance past whatever was accepted and go again
+        total_written += static_cast<size_t>(n);
+        size_t remaining = static_cast<size_t>(n);
+        while (first < iovcnt && remaining >= iov[first].iov_len) {
+            remaining -= iov[first].iov_len;
+            first++;
+        }
+        if (first < iovcnt) {
+            iov[first].iov_base = static_cast<uint8_t*>(iov[first].iov_base) + remaining;
+            iov[first].iov_len -= remaining;
+        }
+    }
+
+    packets_written = total_written / ts::PKT_SIZE;
+    flush_count_++;
+    return err;
+}
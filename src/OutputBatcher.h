@@ -0,0 +1,108 @@
+#ifndef OUTPUT_BATCHER_H
+#define OUTPUT_BATCHER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <tsduck.h>
+
+/**
+ * OutputBatcher - Staging buffer for batched TS packet writes
+ *
+ * Shared by FIFOOutput and TCPOutput. Packets are copied into a
+ * page-aligned staging buffer and written with a single writev() once
+ * either flush_packets are staged or the oldest staged packet is older
+ * than the flush deadline. Large caller batches bypass the copy: the
+ * staged bytes and the caller's packet array go out as two iovecs.
+ * Producers that can build packets in place (snapshot rebasing) use
+ * reserve()/commit() to write straight into the staging buffer.
+ *
+ * writeAll() keeps writing until everything is out, retrying on EINTR
+ * and partial writes, so a batch is never split at an arbitrary byte.
+ *
+ * Owners must flush() or discard() on every path, including failures to
+ * (re)open their descriptor. As a backstop, stage() into a full buffer
+ * drops the staged packets rather than write past the end.
+ *
+ * Thread-safety: none, owned by the output's writer thread.
+ */
+class OutputBatcher {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t DEFAULT_FLUSH_PACKETS = 32;     // ~6 KB per write
+    static constexpr int DEFAULT_FLUSH_DEADLINE_MS = 5;
+    static constexpr size_t MAX_FLUSH_PACKETS = 2048;
+
+    OutputBatcher();
+    ~OutputBatcher();
+
+    OutputBatcher(const OutputBatcher&) = delete;
+    OutputBatcher& operator=(const OutputBatcher&) = delete;
+
+    // Set flush thresholds. Drops nothing: callers flush before reconfiguring.
+    // flush_packets <= 1 or a deadline of 0 disables batching (write-through).
+    void configure(size_t flush_packets, int flush_deadline_ms);
+
+    // Copy a packet into the staging buffer. Returns true if a flush is due.
+    // If the buffer is already full (the last flush never happened), the
+    // staged packets are dropped first.
+    bool stage(const ts::TSPacket& packet);
+    
+    // Room for `count` packets after the staged ones, growing the buffer if
+    // needed (nullptr if that fails). Nothing is staged until commit().
+    ts::TSPacket* reserve(size_t count);
+    
+    // Stage `count` packets filled in after reserve(). Returns true if a flush is due.
+    bool commit(size_t count);
+
+    // True if the staging buffer is full or its deadline has passed
+    bool isFlushDue() const { return isFull() || isDeadlineExpired(Clock::now()); }
+    bool isFull() const { return staged_ >= flush_packets_; }
+    bool isDeadlineExpired(Clock::time_point now) const;
+
+    // Milliseconds until the deadline expires (0 if due, max_wait_ms if empty)
+    int msUntilDeadline(int max_wait_ms) const;
+
+    bool empty() const { return staged_ == 0; }
+    size_t stagedPackets() const { return staged_; }
+    size_t flushPackets() const { return flush_packets_; }
+
+    /**
+     * Write all staged packets followed by `count` packets from `extra`
+     * with one writev() per pass. The staging buffer is cleared whether
+     * or not the write succeeds.
+     * @param fd Destination descriptor
+     * @param extra Optional caller packets written after the staged ones
+     * @param count Number of packets in extra
+     * @param packets_written Receives the number of complete packets written
+     * @return 0 on success, otherwise the errno of the failed write
+     */
+    int flush(int fd, const ts::TSPacket* extra, size_t count, size_t& packets_written);
+    
+    // Drop the staged packets without writing them (descriptor unavailable)
+    void discard();
+
+    // Statistics
+    uint64_t getFlushCount() const { return flush_count_; }
+    uint64_t getWriteCallCount() const { return write_calls_; }
+    uint64_t getDroppedCount() const { return dropped_packets_; }
+
+private:
+    static constexpr size_t STAGING_ALIGNMENT = 4096;
+
+    uint8_t* staging_;
+    size_t staging_capacity_;        // In packets
+    size_t staged_;
+    size_t flush_packets_;
+    std::chrono::milliseconds flush_deadline_;
+    Clock::time_point first_staged_at_;
+
+    uint64_t flush_count_;
+    uint64_t write_calls_;
+    uint64_t dropped_packets_;
+
+    void ensureCapacity(size_t packets);
+};
+
+#endif // OUTPUT_BATCHER_H
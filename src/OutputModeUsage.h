@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <sys/resource.h>
+
+/**
+ * OutputModeUsage - CPU time per output mode
+ *
+ * The output runs in one of two modes: the userspace path (main loop
+ * rebases packets and writes them) or tee() passthrough (the reactor
+ * duplicates the input pipe into the output pipe). Each interval of wall
+ * time, process CPU time (getrusage, user + system, all threads) and output
+ * bytes is charged to the mode that was active, so the two can be compared
+ * on the same stream.
+ *
+ * Memory traffic is not tracked here (no hardware counters in most
+ * containers); bench/passthrough_bench measures the two data paths.
+ *
+ * Thread-safety: none, used from the main loop only.
+ */
+class OutputModeUsage {
+public:
+    enum Mode { USERSPACE = 0, PASSTHROUGH = 1, MODE_COUNT = 2 };
+
+    struct Totals {
+        uint64_t bytes = 0;
+        double cpu_seconds = 0.0;
+        double wall_seconds = 0.0;
+    };
+
+    // Start charging to USERSPACE; total_bytes is the running output byte count
+    void start(uint64_t total_bytes) {
+        mode_ = USERSPACE;
+        bytes_mark_ = total_bytes;
+        cpu_mark_ = cpuSeconds();
+        wall_mark_ = std::chrono::steady_clock::now();
+    }
+
+    Mode getMode() const { return mode_; }
+
+    // Close the current interval and continue in `mode`
+    void setMode(Mode mode, uint64_t total_bytes) {
+        account(total_bytes);
+        mode_ = mode;
+    }
+
+    // Charge everything since the last call to the current mode
+    void account(uint64_t total_bytes) {
+        double cpu = cpuSeconds();
+        auto now = std::chrono::steady_clock::now();
+        Totals& t = totals_[mode_];
+        t.bytes += total_bytes - bytes_mark_;
+        t.cpu_seconds += cpu - cpu_mark_;
+        t.wall_seconds += std::chrono::duration<double>(now - wall_mark_).count();
+        bytes_mark_ = total_bytes;
+        cpu_mark_ = cpu;
+        wall_mark_ = now;
+    }
+
+    const Totals& getTotals(Mode mode) const { return totals_[mode]; }
+
+    void log(std::ostream& out) const {
+        static const char* const NAMES[MODE_COUNT] = {"userspace", "passthrough"};
+        for (int m = 0; m < MODE_COUNT; m++) {
+            const Totals& t = totals_[m];
+            if (t.wall_seconds <= 0.0) {
+                continue;
+            }
+            double mb = t.bytes / 1e6;
+            out << "  " << NAMES[m] << ": " << std::fixed << std::setprecision(1)
+                << t.wall_seconds << " s, " << mb << " MB (" << mb / t.wall_seconds << " MB/s)"
+                << ", cpu " << 100.0 * t.cpu_seconds / t.wall_seconds << "%"
+                << ", " << std::setprecision(2) << (mb > 0 ? 1000.0 * t.cpu_seconds / mb : 0.0) << " cpu-ms/MB"
+                << std::defaultfloat << std::endl;
+        }
+    }
+
+private:
+    static double cpuSeconds() {
+        struct rusage ru;
+        if (getrusage(RUSAGE_SELF, &ru) != 0) {
+            return 0.0;
+        }
+        return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+               (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+    }
+
+    Mode mode_ = USERSPACE;
+    Totals totals_[MODE_COUNT];
+    uint64_t bytes_mark_ = 0;
+    double cpu_mark_ = 0.0;
+    std::chrono::steady_clock::time_point wall_mark_ = std::chrono::steady_clock::now();
+};
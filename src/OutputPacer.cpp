@@ -0,0 +1,347 @@
+#include "OutputPacer.h"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <new>
+#include <time.h>
+
+OutputPacer::OutputPacer(std::unique_ptr<PacketSink> inner, int lead_ms, int max_rate_pct)
+    : inner_(std::move(inner)),
+      lead_ticks_(static_cast<int64_t>(std::max(lead_ms, 1)) * (PCR_HZ / 1000)),
+      max_rate_(std::max(max_rate_pct, 100) / 100.0),
+      released_seq_(0),
+      pcr_pid_(ts::PID_NULL),
+      last_raw_pcr_(-1),
+      last_ext_pcr_(0),
+      last_pcr_ns_(0),
+      stop_(false),
+      opened_(false),
+      state_(State::PREBUFFER),
+      edge_(0.0),
+      edge_valid_(false),
+      last_advance_ns_(0),
+      catching_up_(false),
+      have_prev_release_(false),
+      prev_release_ns_(0),
+      prev_release_pcr_(0),
+      packets_accepted_(0),
+      backlog_ms_(0),
+      queued_packets_(0),
+      underruns_(0),
+      catch_ups_(0),
+      pcr_discontinuities_(0) {
+}
+
+OutputPacer::~OutputPacer() {
+    close();
+}
+
+bool OutputPacer::open() {
+    if (opened_) {
+        return true;
+    }
+    if (!inner_->open()) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = false;
+        state_ = State::PREBUFFER;
+        edge_valid_ = false;
+        catching_up_ = false;
+        have_prev_release_ = false;
+    }
+    opened_ = true;
+    thread_ = std::thread(&OutputPacer::run, this);
+
+    std::cout << "[OutputPacer] Pacing output on PCR (lead " << lead_ticks_ / (PCR_HZ / 1000)
+              << "ms, catch-up " << static_cast<int>(std::lround(max_rate_ * 100)) << "%)" << std::endl;
+    return true;
+}
+
+void OutputPacer::close() {
+    if (!opened_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    data_cv_.notify_all();
+    space_cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!queue_.empty()) {
+            std::cout << "[OutputPacer] Dropping " << queue_.size() << " queued packets" << std::endl;
+        }
+        released_seq_ += queue_.size();
+        queue_.clear();
+        marks_.clear();
+        queued_packets_ = 0;
+    }
+    opened_ = false;
+    inner_->close();
+}
+
+bool OutputPacer::writePackets(const ts::TSPacket* packets, size_t count) {
+    if (count == 0) {
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Lossless like a direct blocking write: wait for the pacer instead of dropping
+    space_cv_.wait(lock, [&] {
+        return stop_ || queue_.empty() || queue_.size() + count <= MAX_QUEUE_PACKETS;
+    });
+    if (stop_) {
+        return false;
+    }
+
+    bool was_empty = queue_.empty();
+    int64_t now_ns = monotonicNs();
+    for (size_t i = 0; i < count; i++) {
+        uint64_t seq = released_seq_ + queue_.size();
+        queue_.push_back(packets[i]);
+        trackPCR(packets[i], seq, now_ns);
+    }
+    queued_packets_ = queue_.size();
+    lock.unlock();
+    packets_accepted_ += count;
+
+    if (was_empty) {
+        data_cv_.notify_one();
+    }
+    return true;
+}
+
+ts::TSPacket* OutputPacer::reserve(size_t count) {
+    try {
+        staging_.resize(count);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+    return staging_.data();
+}
+
+bool OutputPacer::commit(size_t count) {
+    return writePackets(staging_.data(), std::min(count, staging_.size()));
+}
+
+void OutputPacer::setBatching(size_t flush_packets, int flush_deadline_ms) {
+    inner_->setBatching(flush_packets, flush_deadline_ms);
+}
+
+void OutputPacer::trackPCR(const ts::TSPacket& packet, uint64_t seq, int64_t now_ns) {
+    const uint8_t* b = packet.b;
+    // Adaptation field present, long enough for a PCR, PCR flag set
+    if (!(b[3] & 0x20) || b[4] < 7 || !(b[5] & 0x10)) {
+        return;
+    }
+
+    uint16_t pid = packet.getPID();
+    bool relocked = false;
+    if (pid != pcr_pid_) {
+        // Follow a new PCR PID only once the old one has gone quiet
+        if (pcr_pid_ != ts::PID_NULL && now_ns - last_pcr_ns_ < NO_PCR_TIMEOUT_MS * 1000000) {
+            return;
+        }
+        if (pcr_pid_ != ts::PID_NULL) {
+            std::cout << "[OutputPacer] PCR PID changed to " << pid << std::endl;
+        }
+        pcr_pid_ = pid;
+        relocked = true;
+    }
+
+    int64_t base = (static_cast<int64_t>(b[6]) << 25) | (static_cast<int64_t>(b[7]) << 17) |
+                   (static_cast<int64_t>(b[8]) << 9) | (static_cast<int64_t>(b[9]) << 1) | (b[10] >> 7);
+    int64_t ext = (static_cast<int64_t>(b[10] & 0x01) << 8) | b[11];
+    int64_t raw = base * 300 + ext;
+
+    bool discontinuity = false;
+    int64_t ext_pcr;
+    if (last_raw_pcr_ < 0) {
+        ext_pcr = raw;
+        discontinuity = true;
+    } else {
+        int64_t delta = raw - last_raw_pcr_;
+        if (delta < -PCR_WRAP / 2) {
+            delta += PCR_WRAP;
+        } else if (delta > PCR_WRAP / 2) {
+            delta -= PCR_WRAP;
+        }
+        bool flagged = (b[5] & 0x80) != 0;  // discontinuity_indicator
+        if (relocked || flagged || delta < 0 || delta > MAX_PCR_JUMP_MS * (PCR_HZ / 1000)) {
+            // Bridge the jump with the wall time that passed, keeping the timeline monotonic
+            delta = std::max<int64_t>(0, (now_ns - last_pcr_ns_) * (PCR_HZ / 1000000) / 1000);
+            delta = std::min<int64_t>(delta, MAX_PCR_JUMP_MS * (PCR_HZ / 1000));
+            discontinuity = true;
+            pcr_discontinuities_++;
+        }
+        ext_pcr = last_ext_pcr_ + delta;
+    }
+
+    last_raw_pcr_ = raw;
+    last_ext_pcr_ = ext_pcr;
+    last_pcr_ns_ = now_ns;
+    marks_.push_back({seq, ext_pcr, discontinuity});
+}
+
+uint64_t OutputPacer::releaseBound(double edge) const {
+    if (marks_.empty()) {
+        return released_seq_;
+    }
+
+    size_t next = 0;
+    while (next < marks_.size() && static_cast<double>(marks_[next].pcr) <= edge) {
+        next++;
+    }
+
+    uint64_t bound;
+    if (next == marks_.size()) {
+        // Edge is at the newest PCR: release through it, hold what follows
+        bound = marks_.back().seq + 1;
+    } else if (next == 0) {
+        // Packets ahead of the first PCR seen have nothing to pace against
+        bound = marks_.front().seq;
+    } else {
+        const PcrMark& a = marks_[next - 1];
+        const PcrMark& b = marks_[next];
+        double frac = (edge - static_cast<double>(a.pcr)) / static_cast<double>(b.pcr - a.pcr);
+        bound = a.seq + 1 + static_cast<uint64_t>(frac * static_cast<double>(b.seq - a.seq));
+        bound = std::min(bound, b.seq);
+    }
+    return std::max(bound, released_seq_);
+}
+
+void OutputPacer::releaseDue(int64_t now_ns) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (queue_.empty()) {
+        return;
+    }
+
+    uint64_t bound;
+    if (marks_.empty() || now_ns - last_pcr_ns_ > NO_PCR_TIMEOUT_MS * 1000000) {
+        // No usable PCR: pass through, prebuffer again once one shows up
+        bound = released_seq_ + queue_.size();
+        state_ = State::PREBUFFER;
+        edge_valid_ = false;
+        catching_up_ = false;
+        backlog_ms_ = 0;
+    } else {
+        int64_t newest = marks_.back().pcr;
+        if (!edge_valid_) {
+            edge_ = static_cast<double>(marks_.front().pcr);
+            edge_valid_ = true;
+        }
+
+        if (state_ == State::PREBUFFER && newest - edge_ >= static_cast<double>(lead_ticks_)) {
+            state_ = State::RUNNING;
+            last_advance_ns_ = now_ns;
+        }
+
+        if (state_ == State::RUNNING) {
+            double backlog = static_cast<double>(newest) - edge_;
+            if (!catching_up_ && backlog > 2.0 * static_cast<double>(lead_ticks_)) {
+                catching_up_ = true;
+                catch_ups_++;
+            } else if (catching_up_ && backlog <= static_cast<double>(lead_ticks_)) {
+                catching_up_ = false;
+            }
+
+            double rate = catching_up_ ? max_rate_ : 1.0;
+            edge_ += static_cast<double>(now_ns - last_advance_ns_) * (PCR_HZ / 1e9) * rate;
+            last_advance_ns_ = now_ns;
+
+            if (edge_ >= static_cast<double>(newest)) {
+                // Input fell behind by more than the lead
+                edge_ = static_cast<double>(newest);
+                state_ = State::PREBUFFER;
+                catching_up_ = false;
+                underruns_++;
+            }
+        }
+
+        backlog_ms_ = static_cast<int64_t>((static_cast<double>(newest) - edge_) / (PCR_HZ / 1000));
+        bound = (state_ == State::RUNNING) ? releaseBound(edge_) : released_seq_;
+    }
+
+    size_t count = static_cast<size_t>(bound - released_seq_);
+    if (count == 0) {
+        return;
+    }
+
+    // Output jitter, measured on the PCR packets going out now
+    for (const PcrMark& mark : marks_) {
+        if (mark.seq < released_seq_) {
+            continue;
+        }
+        if (mark.seq >= bound) {
+            break;
+        }
+        if (have_prev_release_ && !mark.discontinuity) {
+            int64_t wall_ns = now_ns - prev_release_ns_;
+            int64_t pcr_ns = (mark.pcr - prev_release_pcr_) * 1000 / (PCR_HZ / 1000000);
+            jitter_.recordUs(static_cast<uint64_t>(std::llabs(wall_ns - pcr_ns) / 1000));
+        }
+        have_prev_release_ = true;
+        prev_release_ns_ = now_ns;
+        prev_release_pcr_ = mark.pcr;
+    }
+
+    out_.assign(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(count));
+    queue_.erase(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(count));
+    released_seq_ = bound;
+    // Keep the last released mark as the interpolation anchor
+    while (marks_.size() >= 2 && marks_[1].seq < released_seq_) {
+        marks_.pop_front();
+    }
+    queued_packets_ = queue_.size();
+    lock.unlock();
+    space_cv_.notify_all();
+
+    inner_->writePackets(out_.data(), out_.size());
+    inner_->flush();
+}
+
+void OutputPacer::run() {
+    int64_t next_ns = monotonicNs();
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!stop_ && queue_.empty()) {
+                data_cv_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+                next_ns = monotonicNs();
+            }
+            if (stop_) {
+                break;
+            }
+        }
+
+        releaseDue(monotonicNs());
+
+        next_ns += TICK_US * 1000;
+        int64_t now_ns = monotonicNs();
+        if (next_ns < now_ns - 10 * TICK_US * 1000) {
+            // A blocking write overran many ticks; don't fire them back to back
+            next_ns = now_ns;
+        }
+        struct timespec deadline;
+        deadline.tv_sec = static_cast<time_t>(next_ns / 1000000000);
+        deadline.tv_nsec = static_cast<long>(next_ns % 1000000000);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+        }
+    }
+}
+
+int64_t OutputPacer::monotonicNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
@@ -0,0 +1,162 @@
+#ifndef OUTPUT_PACER_H
+#define OUTPUT_PACER_H
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <tsduck.h>
+#include "PacketSink.h"
+#include "LatencyHistogram.h"
+
+/**
+ * OutputPacer - Releases the output stream against its (rebased) PCR
+ *
+ * Sits in front of the real output as a PacketSink. The main loop's writes
+ * only queue packets; a pacer thread wakes every TICK_US (clock_nanosleep on
+ * CLOCK_MONOTONIC, absolute deadlines) and hands the inner sink whatever is
+ * due. Without it a switch writes a whole buffered GOP in one burst and
+ * steady-state packets go out in input-sized clumps.
+ *
+ * Schedule: a release edge E moves along the PCR timeline. Packets between
+ * two PCRs get interpolated PCRs (constant bitrate between PCRs) and are
+ * released once E passes them. E advances at real time while the backlog
+ * (newest queued PCR - E) stays near the lead; a backlog above twice the
+ * lead (the GOP dumped at a switch) is drained at max_rate_pct of real time
+ * until it is back at the lead, so bursts are spread out and the extra
+ * latency they add is paid back at a bounded rate. E never passes the newest
+ * PCR; when it gets there (input stalled longer than the lead) the pacer
+ * prebuffers a lead's worth again before resuming.
+ *
+ * PCRs are taken from one PID, unwrapped and made continuous across
+ * discontinuities (a jump of over MAX_PCR_JUMP_MS or backwards is bridged at
+ * the current rate). A stream with no PCR for NO_PCR_TIMEOUT_MS is passed
+ * through unpaced.
+ *
+ * Jitter metric: for each released PCR packet, |wall time since the previous
+ * PCR release - PCR time between the two|, i.e. how far the output's own
+ * timing strays from the clock it carries.
+ *
+ * Thread-safety: one producer thread (the main loop) writes; the inner sink
+ * is written and flushed on the pacer thread only.
+ */
+class OutputPacer : public PacketSink {
+public:
+    static constexpr int DEFAULT_LEAD_MS = 100;
+    static constexpr int DEFAULT_MAX_RATE_PCT = 125;
+
+    OutputPacer(std::unique_ptr<PacketSink> inner, int lead_ms, int max_rate_pct);
+    ~OutputPacer() override;
+
+    OutputPacer(const OutputPacer&) = delete;
+    OutputPacer& operator=(const OutputPacer&) = delete;
+
+    // Open the inner sink, then start the pacer thread
+    bool open() override;
+
+    // Stop the pacer thread (queued packets are dropped) and close the inner sink
+    void close() override;
+
+    // Queue packets. Blocks only if MAX_QUEUE_PACKETS are already waiting.
+    bool writePacket(const ts::TSPacket& packet) override { return writePackets(&packet, 1); }
+    bool writePackets(const ts::TSPacket* packets, size_t count) override;
+    using PacketSink::writePackets;
+
+    // Staging area for in-place fills (snapshots); commit() queues them
+    ts::TSPacket* reserve(size_t count) override;
+    bool commit(size_t count) override;
+
+    // Release timing belongs to the pacer thread; nothing to do for callers
+    bool flush() override { return true; }
+    bool flushIfDue() override { return true; }
+    int getFlushWaitMs(int max_wait_ms) const override { return max_wait_ms; }
+
+    // Forwarded to the inner sink (caps the size of one release write)
+    void setBatching(size_t flush_packets, int flush_deadline_ms) override;
+
+    // Statistics (written = reached the inner sink)
+    uint64_t getPacketsWritten() const override { return inner_->getPacketsWritten(); }
+    uint64_t getBytesWritten() const override { return inner_->getBytesWritten(); }
+    uint64_t getPacketsAccepted() const { return packets_accepted_; }   // Queued so far (producer thread)
+    LatencyHistogram::Snapshot getJitter() const { return jitter_.snapshot(); }
+    int64_t getBacklogMs() const { return backlog_ms_.load(); }
+    size_t getQueuedPackets() const { return queued_packets_.load(); }
+    uint64_t getUnderruns() const { return underruns_.load(); }
+    uint64_t getCatchUps() const { return catch_ups_.load(); }
+    uint64_t getPcrDiscontinuities() const { return pcr_discontinuities_.load(); }
+
+private:
+    // A PCR-carrying packet: sequence number and continuous PCR (27 MHz)
+    struct PcrMark {
+        uint64_t seq;
+        int64_t pcr;
+        bool discontinuity;     // Bridged, not a real interval to the previous one
+    };
+
+    enum class State { PREBUFFER, RUNNING };
+
+    void run();
+
+    // Decide what is due at now_ns, write it to the inner sink
+    void releaseDue(int64_t now_ns);
+
+    // Producer: record a PCR mark if the packet carries the tracked PCR (lock held)
+    void trackPCR(const ts::TSPacket& packet, uint64_t seq, int64_t now_ns);
+
+    // Exclusive end of the packets whose interpolated PCR is <= edge (lock held)
+    uint64_t releaseBound(double edge) const;
+
+    static int64_t monotonicNs();
+
+    std::unique_ptr<PacketSink> inner_;
+    const int64_t lead_ticks_;          // 27 MHz
+    const double max_rate_;
+
+    std::mutex mutex_;
+    std::condition_variable data_cv_;   // Producer -> pacer: packets queued
+    std::condition_variable space_cv_;  // Pacer -> producer: room in the queue
+    std::deque<ts::TSPacket> queue_;
+    std::deque<PcrMark> marks_;         // Front may be the last released mark (interpolation anchor)
+    uint64_t released_seq_;             // Sequence number of queue_.front()
+    uint16_t pcr_pid_;
+    int64_t last_raw_pcr_;              // -1 until the first PCR
+    int64_t last_ext_pcr_;              // Continuous PCR of the last mark
+    int64_t last_pcr_ns_;               // Wall time the last PCR was queued
+    bool stop_;
+    bool opened_;
+
+    // Pacer thread state
+    State state_;
+    double edge_;                       // Release edge E, continuous PCR
+    bool edge_valid_;
+    int64_t last_advance_ns_;
+    bool catching_up_;
+    bool have_prev_release_;
+    int64_t prev_release_ns_;
+    int64_t prev_release_pcr_;
+
+    std::thread thread_;
+    std::vector<ts::TSPacket> staging_;
+    std::vector<ts::TSPacket> out_;
+    uint64_t packets_accepted_;         // Producer thread only
+
+    LatencyHistogram jitter_;
+    std::atomic<int64_t> backlog_ms_;
+    std::atomic<size_t> queued_packets_;
+    std::atomic<uint64_t> underruns_;
+    std::atomic<uint64_t> catch_ups_;
+    std::atomic<uint64_t> pcr_discontinuities_;
+
+    static constexpr int64_t TICK_US = 2000;
+    static constexpr int64_t PCR_HZ = 27000000;
+    static constexpr int64_t PCR_WRAP = (int64_t(1) << 33) * 300;
+    static constexpr int64_t MAX_PCR_JUMP_MS = 1000;
+    static constexpr int64_t NO_PCR_TIMEOUT_MS = 500;
+    static constexpr size_t MAX_QUEUE_PACKETS = 32768;   // ~6 MB
+};
+
+#endif // OUTPUT_PACER_H
@@ -0,0 +1,314 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <vector>
+#include <algorithm>
+
+// ThreadSanitizer builds: see PACKET_RING_SPECULATIVE_READ below
+#if defined(__SANITIZE_THREAD__)
+#define PACKET_RING_TSAN 1
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define PACKET_RING_TSAN 1
+#endif
+#endif
+
+#ifdef PACKET_RING_TSAN
+extern "C" void AnnotateIgnoreReadsBegin(const char* file, int line);
+extern "C" void AnnotateIgnoreReadsEnd(const char* file, int line);
+#define PACKET_RING_SPECULATIVE_READ_BEGIN() AnnotateIgnoreReadsBegin(__FILE__, __LINE__)
+#define PACKET_RING_SPECULATIVE_READ_END() AnnotateIgnoreReadsEnd(__FILE__, __LINE__)
+#else
+#define PACKET_RING_SPECULATIVE_READ_BEGIN() ((void)0)
+#define PACKET_RING_SPECULATIVE_READ_END() ((void)0)
+#endif
+
+/**
+ * PacketRing - Fixed-capacity ring of packets addressed by sequence number
+ *
+ * Replaces the erase-from-front rolling buffers in the input readers (StreamInput).
+ * Every pushed packet gets a monotonically increasing 64-bit sequence number,
+ * so positions such as "IDR index" or "consume index" stay valid while the
+ * ring wraps - there is nothing to rewrite when old packets are dropped.
+ *
+ * - Capacity is rounded up to a power of two (slot = seq & mask)
+ * - push() overwrites the oldest packet once the ring is full
+ * - trimTo() drops packets older than a sequence number in O(1)
+ *
+ * Sequence numbers are never reused, including across clear().
+ *
+ * Thread-safety: single producer, any number of readers, no locks.
+ * push()/trimTo()/clear()/at() belong to the producer thread. Readers use
+ * copyRange(), which works like a seqlock: the producer advances tail
+ * before reusing a slot, and readers re-check tail after copying and
+ * discard anything that may have been overwritten mid-copy. The ordering
+ * comes from read-modify-writes rather than fences (Boehm, "Can Seqlocks
+ * Get Along With Programming Language Memory Models?"): the producer
+ * advances tail_/history_ with an acq_rel exchange, and the reader's
+ * re-check is an acq_rel fetch_add(0). Both are RMWs on the same atomic,
+ * so either the re-check comes first and the copy happens-before the
+ * producer's slot writes, or it sees the advanced value and drops the
+ * copy.
+ *
+ * Trimmed packets stay in their slots until the producer reuses them.
+ * copyHistory() reads that history (e.g. frames indexed seconds ago in a
+ * ring sized for it), validated against slot reuse the same way.
+ *
+ * view() hands out a zero-copy View of a range instead. While any View is
+ * alive trimTo() will not drop packets at or after its start, so the main
+ * loop can read a whole GOP straight out of the ring without stalling the
+ * producer. A trim already under way when the pin lands can still move
+ * tail past the start, but a trim leaves the slots alone, so a View (like
+ * copyHistory()) is clamped and validated against slot reuse, not the
+ * tail: only packets the producer lapped are dropped. Views belong to one
+ * consumer thread (the main loop).
+ *
+ * The seqlock copy reads slots the producer may be overwriting at that
+ * moment. That is a data race by the letter of the memory model, made
+ * harmless by the validation after it: whatever the producer could have
+ * touched is dropped, never returned. Copying word by word through
+ * relaxed atomics would need the producer to store the same way and cost
+ * the memcpy speed on every switch snapshot, so the copy stays plain and
+ * ThreadSanitizer builds ignore the accesses of the speculative copy only
+ * (PACKET_RING_SPECULATIVE_READ_*). TSan models the RMWs, so it still
+ * checks tail_/head_/history_ and the happens-before edges they give, but
+ * not the slot contents: tests/packet_ring_test.cpp checks those by value,
+ * failing on any copy that returns a torn item.
+ */
+template <typename T>
+class PacketRing {
+public:
+    explicit PacketRing(size_t min_capacity)
+        : slots_(roundUpPowerOfTwo(min_capacity)),
+          mask_(slots_.size() - 1) {}
+
+    // Producer: append a packet, dropping the oldest one if the ring is full.
+    // Returns the sequence number assigned to the packet.
+    uint64_t push(const T& item) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head >= slots_.size()) {
+            // Invalidate the slot for readers before overwriting it
+            uint64_t reused = head + 1 - slots_.size();
+            if (history_.load(std::memory_order_relaxed) < reused) {
+                if (tail_.load(std::memory_order_relaxed) < reused) {
+                    tail_.exchange(reused, std::memory_order_acq_rel);
+                }
+                history_.exchange(reused, std::memory_order_acq_rel);
+            }
+        }
+        slots_[head & mask_] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return head;
+    }
+
+    // Producer: access a retained packet by sequence number
+    T& at(uint64_t seq) { return slots_[seq & mask_]; }
+    const T& at(uint64_t seq) const { return slots_[seq & mask_]; }
+
+    // Sequence number the next push() will receive (one past the newest packet)
+    uint64_t headSequence() const { return head_.load(std::memory_order_acquire); }
+
+    // Sequence number of the oldest retained packet
+    uint64_t tailSequence() const { return tail_.load(std::memory_order_acquire); }
+
+    // Sequence number of the oldest packet still in its slot, trimmed or not
+    uint64_t historySequence() const { return history_.load(std::memory_order_acquire); }
+
+    bool contains(uint64_t seq) const { return seq >= tailSequence() && seq < headSequence(); }
+    bool empty() const { return size() == 0; }
+    size_t size() const {
+        uint64_t tail = tailSequence();
+        return static_cast<size_t>(headSequence() - tail);
+    }
+    size_t capacity() const { return slots_.size(); }
+
+    // Clamp a sequence number into the retained range [tail, head]
+    uint64_t clamp(uint64_t seq) const {
+        uint64_t tail = tailSequence();
+        return std::clamp(seq, tail, std::max(tail, headSequence()));
+    }
+
+    // Producer: drop every packet older than seq (but none a live View starts at)
+    void trimTo(uint64_t seq) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        seq = std::min(seq, pin_floor_.load(std::memory_order_acquire));
+        tail_.exchange(std::max(tail, std::min(seq, head)), std::memory_order_acq_rel);
+    }
+
+    // Producer: drop all packets (sequence numbers keep counting up)
+    void clear() { tail_.exchange(head_.load(std::memory_order_relaxed), std::memory_order_acq_rel); }
+
+    // Producer, before any reader exists: change the capacity, dropping all packets
+    void resize(size_t min_capacity) {
+        slots_.assign(roundUpPowerOfTwo(min_capacity), T());
+        mask_ = slots_.size() - 1;
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        tail_.store(head, std::memory_order_relaxed);
+        history_.store(head, std::memory_order_release);
+    }
+
+    // Reader: append packets [from, to) to out, clamped to the retained range.
+    // Packets overwritten by the producer during the copy are removed again.
+    // Returns the sequence number of the first packet left in out.
+    uint64_t copyRange(uint64_t from, uint64_t to, std::vector<T>& out) const {
+        return copyFrom(tail_, from, to, out);
+    }
+
+    // Reader: like copyRange(), but trimmed packets count as long as their
+    // slot has not been reused
+    uint64_t copyHistory(uint64_t from, uint64_t to, std::vector<T>& out) const {
+        return copyFrom(history_, from, to, out);
+    }
+
+    /**
+     * Read-only, pinned view of a sequence range. Move-only; the pin is
+     * released when the last View covering the range goes away.
+     */
+    class View {
+    public:
+        View() = default;
+        ~View() { release(); }
+
+        View(View&& other) noexcept
+            : ring_(other.ring_), from_(other.from_), to_(other.to_) {
+            other.ring_ = nullptr;
+        }
+        View& operator=(View&& other) noexcept {
+            if (this != &other) {
+                release();
+                ring_ = other.ring_;
+                from_ = other.from_;
+                to_ = other.to_;
+                other.ring_ = nullptr;
+            }
+            return *this;
+        }
+        View(const View&) = delete;
+        View& operator=(const View&) = delete;
+
+        uint64_t beginSequence() const { return from_; }
+        uint64_t endSequence() const { return to_; }
+        size_t size() const { return static_cast<size_t>(to_ - from_); }
+        bool empty() const { return to_ == from_; }
+
+        // Copy the range to dst (room for size() items). Items whose slot the
+        // producer reused during the copy are dropped from the front; trimmed
+        // ones are kept. Returns the number of valid items now at dst.
+        size_t copyTo(T* dst) const {
+            if (!ring_ || empty()) return 0;
+            std::span<const T> a = first();
+            std::span<const T> b = second();
+            PACKET_RING_SPECULATIVE_READ_BEGIN();
+            std::copy(a.begin(), a.end(), dst);
+            std::copy(b.begin(), b.end(), dst + a.size());
+            PACKET_RING_SPECULATIVE_READ_END();
+
+            uint64_t history = ring_->history_.fetch_add(0, std::memory_order_acq_rel);
+            if (history <= from_) return size();
+            size_t torn = static_cast<size_t>(std::min(history, to_) - from_);
+            std::copy(dst + torn, dst + size(), dst);
+            return size() - torn;
+        }
+
+        void release() {
+            if (ring_) {
+                ring_->unpin();
+                ring_ = nullptr;
+            }
+        }
+
+    private:
+        friend class PacketRing;
+        View(const PacketRing* ring, uint64_t from, uint64_t to)
+            : ring_(ring), from_(from), to_(to) {}
+
+        // The range as (at most) two contiguous runs of ring slots. Not
+        // validated: only copyTo() reads them, and checks afterwards.
+        std::span<const T> first() const {
+            if (!ring_ || empty()) return {};
+            size_t start = static_cast<size_t>(from_ & ring_->mask_);
+            return {ring_->slots_.data() + start, std::min(size(), ring_->slots_.size() - start)};
+        }
+        std::span<const T> second() const {
+            if (!ring_ || empty()) return {};
+            return {ring_->slots_.data(), size() - first().size()};
+        }
+
+        const PacketRing* ring_ = nullptr;
+        uint64_t from_ = 0;
+        uint64_t to_ = 0;
+    };
+
+    // Reader: pin [from, to), clamped to the packets still in their slots,
+    // and view it in place
+    View view(uint64_t from, uint64_t to) const {
+        pin(from);
+        from = std::max(from, historySequence());
+        to = std::max(from, std::min(to, headSequence()));
+        return View(this, from, to);
+    }
+
+private:
+    // Copy [from, to) clamped to [floor, head), dropping what the producer
+    // reused during the copy (floor is tail_ or history_)
+    uint64_t copyFrom(std::atomic<uint64_t>& floor, uint64_t from, uint64_t to, std::vector<T>& out) const {
+        uint64_t head = headSequence();
+        from = std::max(from, floor.load(std::memory_order_acquire));
+        to = std::min(to, head);
+        if (from >= to) return from;
+
+        size_t base = out.size();
+        size_t count = static_cast<size_t>(to - from);
+        size_t first = static_cast<size_t>(from & mask_);
+        size_t until_wrap = std::min(count, slots_.size() - first);
+        out.reserve(base + count);
+        PACKET_RING_SPECULATIVE_READ_BEGIN();
+        out.insert(out.end(), slots_.begin() + first, slots_.begin() + first + until_wrap);
+        out.insert(out.end(), slots_.begin(), slots_.begin() + (count - until_wrap));
+        PACKET_RING_SPECULATIVE_READ_END();
+
+        // Validate: anything now behind the floor may have been torn
+        uint64_t valid_from = floor.fetch_add(0, std::memory_order_acq_rel);
+        if (valid_from > from) {
+            size_t torn = static_cast<size_t>(std::min(valid_from, to) - from);
+            out.erase(out.begin() + base, out.begin() + base + torn);
+            from += torn;
+        }
+        return from;
+    }
+
+    void pin(uint64_t from) const {
+        pins_.fetch_add(1, std::memory_order_acq_rel);
+        uint64_t floor = pin_floor_.load(std::memory_order_relaxed);
+        while (from < floor && !pin_floor_.compare_exchange_weak(floor, from, std::memory_order_acq_rel)) {
+        }
+    }
+
+    void unpin() const {
+        if (pins_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            pin_floor_.store(UINT64_MAX, std::memory_order_release);
+        }
+    }
+
+    static size_t roundUpPowerOfTwo(size_t n) {
+        size_t cap = 1;
+        while (cap < n) cap <<= 1;
+        return cap;
+    }
+
+    std::vector<T> slots_;
+    size_t mask_;
+    std::atomic<uint64_t> head_{0};
+
+    // Mutable: readers re-check them with an RMW that never changes the value
+    mutable std::atomic<uint64_t> tail_{0};
+    mutable std::atomic<uint64_t> history_{0};     // Slots before this one have been reused
+
+    // Oldest sequence number any live View starts at (UINT64_MAX if none)
+    mutable std::atomic<uint32_t> pins_{0};
+    mutable std::atomic<uint64_t> pin_floor_{UINT64_MAX};
+};
@@ -0,0 +1,61 @@
+#ifndef PACKET_SINK_H
+#define PACKET_SINK_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <tsduck.h>
+
+/**
+ * PacketSink - Where the main loop writes the spliced TS stream
+ *
+ * FIFOOutput (named pipe to ffmpeg-rtmp-output) and RTMPOutput (in-process
+ * FLV remux + RTMP publish) implement it, so the main loop does not care
+ * which one is in use. Writes are batched by the sink: callers must
+ * flushIfDue() periodically and flush() before blocking elsewhere.
+ */
+class PacketSink {
+public:
+    virtual ~PacketSink() = default;
+
+    // Open the output (may block until the consumer is there)
+    virtual bool open() = 0;
+
+    // Close the output
+    virtual void close() = 0;
+
+    // Queue a single TS packet, flushing when the batch is due
+    virtual bool writePacket(const ts::TSPacket& packet) = 0;
+
+    // Write multiple TS packets
+    virtual bool writePackets(const ts::TSPacket* packets, size_t count) = 0;
+    bool writePackets(const std::vector<ts::TSPacket>& packets) {
+        return writePackets(packets.data(), packets.size());
+    }
+
+    // Room for `count` packets to be filled in place (nullptr on allocation
+    // failure). commit() queues them and flushes if due.
+    virtual ts::TSPacket* reserve(size_t count) = 0;
+    virtual bool commit(size_t count) = 0;
+
+    // Write all queued packets now
+    virtual bool flush() = 0;
+
+    // Write queued packets if the batch deadline has passed
+    virtual bool flushIfDue() = 0;
+
+    // Batch size and latency deadline (see OutputBatcher::configure)
+    virtual void setBatching(size_t flush_packets, int flush_deadline_ms) = 0;
+
+    // How long a caller may block before the next flushIfDue() is needed
+    virtual int getFlushWaitMs(int max_wait_ms) const = 0;
+
+    // Pipe descriptor for tee() passthrough, -1 if the sink has none
+    virtual int getFd() const { return -1; }
+
+    // TS packets / bytes accepted by the sink
+    virtual uint64_t getPacketsWritten() const = 0;
+    virtual uint64_t getBytesWritten() const = 0;
+};
+
+#endif // PACKET_SINK_H
@@ -0,0 +1,257 @@
+#include "RTMPOutput.h"
+#include <iostream>
+#include <algorithm>
+#include <new>
+#include <time.h>
+
+RTMPOutput::RTMPOutput(const std::string& url, const std::atomic<bool>& running)
+    : url_(url),
+      running_(running),
+      remuxer_([this](const FLVTag& tag) { collectTag(tag); }),
+      video_gap_(false),
+      publisher_(url),
+      has_video_config_(false),
+      has_audio_config_(false),
+      waiting_keyframe_(true),
+      queued_bytes_(0),
+      stopping_(false),
+      publishing_(false),
+      packets_written_(0),
+      bytes_written_(0),
+      rtmp_bytes_sent_(0),
+      send_calls_(0),
+      reconnect_attempts_(0),
+      frames_skipped_(0),
+      frames_dropped_(0),
+      sender_cpu_ns_(0) {
+}
+
+RTMPOutput::~RTMPOutput() {
+    close();
+}
+
+bool RTMPOutput::open() {
+    if (sender_.joinable()) {
+        std::cout << "[RTMPOutput] Already open" << std::endl;
+        return true;
+    }
+    if (!publisher_.isValidUrl()) {
+        std::cerr << "[RTMPOutput] Invalid RTMP URL: " << url_ << std::endl;
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = false;
+    }
+    has_video_config_ = false;
+    has_audio_config_ = false;
+    video_gap_ = false;
+    sender_ = std::thread(&RTMPOutput::senderLoop, this);
+    return true;
+}
+
+void RTMPOutput::close() {
+    if (sender_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        sender_.join();
+    }
+
+    if (publisher_.isPublishing()) {
+        std::cout << "[RTMPOutput] Unpublishing..." << std::endl;
+    }
+    publisher_.disconnect();
+    publishing_ = false;
+    remuxer_.reset();
+    collected_.clear();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.clear();
+        queued_bytes_ = 0;
+    }
+
+    std::cout << "[RTMPOutput] Statistics:" << std::endl;
+    std::cout << "  Packets written: " << packets_written_.load() << std::endl;
+    std::cout << "  Video frames: " << remuxer_.getVideoFrames()
+              << ", audio frames: " << remuxer_.getAudioFrames() << std::endl;
+    std::cout << "  Frames dropped (sender behind): " << frames_dropped_.load() << std::endl;
+    std::cout << "  RTMP bytes sent: " << publisher_.getBytesSent() << std::endl;
+}
+
+bool RTMPOutput::writePackets(const ts::TSPacket* packets, size_t count) {
+    remuxer_.feed(packets, count);
+    packets_written_ += count;
+    bytes_written_ += count * ts::PKT_SIZE;
+
+    if (!collected_.empty()) {
+        handOff();
+    }
+    return publishing_.load();
+}
+
+ts::TSPacket* RTMPOutput::reserve(size_t count) {
+    try {
+        staging_.resize(count);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+    return staging_.data();
+}
+
+bool RTMPOutput::commit(size_t count) {
+    return writePackets(staging_.data(), std::min(count, staging_.size()));
+}
+
+bool RTMPOutput::flush() {
+    return publishing_.load();
+}
+
+bool RTMPOutput::flushIfDue() {
+    return publishing_.load();
+}
+
+void RTMPOutput::collectTag(const FLVTag& tag) {
+    collected_.push_back(tag);
+}
+
+void RTMPOutput::handOff() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (FLVTag& tag : collected_) {
+            // Sequence headers always go through; they are tiny and rare
+            if (!tag.config) {
+                bool video = tag.type == FLVTag::VIDEO;
+                if ((video && video_gap_ && !tag.keyframe) ||
+                    queued_bytes_ + tag.data.size() > MAX_QUEUE_BYTES) {
+                    if (video) {
+                        video_gap_ = true;
+                    }
+                    frames_dropped_++;
+                    continue;
+                }
+                if (video) {
+                    video_gap_ = false;
+                }
+            }
+            queued_bytes_ += tag.data.size();
+            queue_.push_back(std::move(tag));
+        }
+    }
+    collected_.clear();
+    cv_.notify_one();
+}
+
+void RTMPOutput::senderLoop() {
+    std::deque<FLVTag> batch;
+    bool first_connect = true;
+    auto next_connect = std::chrono::steady_clock::now();
+    auto next_poll = next_connect;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (publisher_.isPublishing()) {
+            cv_.wait_until(lock, next_poll, [this] { return stopping_ || !queue_.empty(); });
+        } else {
+            // Frames queued meanwhile are dropped at the next attempt
+            cv_.wait_until(lock, next_connect, [this] { return stopping_; });
+        }
+        if (stopping_) {
+            break;
+        }
+        batch.swap(queue_);
+        queued_bytes_ = 0;
+        lock.unlock();
+
+        for (const FLVTag& tag : batch) {
+            sendTag(tag);
+        }
+        batch.clear();
+
+        auto now = std::chrono::steady_clock::now();
+        if (!publisher_.isPublishing() && now >= next_connect) {
+            if (!running_.load()) {
+                next_connect = now + std::chrono::milliseconds(RECONNECT_DELAY_MS);
+            } else {
+                if (first_connect) {
+                    std::cout << "[RTMPOutput] Connecting to " << url_ << std::endl;
+                    first_connect = false;
+                } else {
+                    uint64_t attempt = ++reconnect_attempts_;
+                    std::cout << "[RTMPOutput] Reconnecting to " << url_ << " (attempt " << attempt << ")" << std::endl;
+                }
+                if (!connectPublisher(CONNECT_TIMEOUT_MS)) {
+                    std::cout << "[RTMPOutput] Retrying in " << RECONNECT_DELAY_MS << " ms..." << std::endl;
+                }
+                now = std::chrono::steady_clock::now();
+            }
+        } else if (publisher_.isPublishing()) {
+            if (publisher_.getQueuedBytes() > 0) {
+                publisher_.flush();
+            }
+            if (publisher_.isPublishing() && now >= next_poll) {
+                publisher_.poll();
+                next_poll = now + std::chrono::milliseconds(POLL_INTERVAL_MS);
+            }
+        }
+        if (!publisher_.isPublishing() && next_connect <= now) {
+            next_connect = now + std::chrono::milliseconds(RECONNECT_DELAY_MS);
+        }
+
+        updateSenderStats();
+        lock.lock();
+    }
+}
+
+void RTMPOutput::sendTag(const FLVTag& tag) {
+    // Keep the latest sequence headers for the next session, connected or not
+    if (tag.config) {
+        if (tag.type == FLVTag::VIDEO) {
+            video_config_ = tag;
+            has_video_config_ = true;
+        } else {
+            audio_config_ = tag;
+            has_audio_config_ = true;
+        }
+    }
+    if (!publisher_.isPublishing()) {
+        return;
+    }
+    if (tag.type == FLVTag::VIDEO && !tag.config) {
+        if (waiting_keyframe_ && !tag.keyframe) {
+            frames_skipped_++;
+            return;
+        }
+        waiting_keyframe_ = false;
+    }
+    publisher_.queueTag(tag);
+}
+
+bool RTMPOutput::connectPublisher(int timeout_ms) {
+    if (!publisher_.connect(timeout_ms)) {
+        return false;
+    }
+
+    // A new session needs the decoder configuration before any frame
+    waiting_keyframe_ = true;
+    if (has_video_config_) {
+        publisher_.queueTag(video_config_);
+    }
+    if (has_audio_config_) {
+        publisher_.queueTag(audio_config_);
+    }
+    return publisher_.flush();
+}
+
+void RTMPOutput::updateSenderStats() {
+    publishing_ = publisher_.isPublishing();
+    rtmp_bytes_sent_ = publisher_.getBytesSent();
+    send_calls_ = publisher_.getSendCalls();
+
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    sender_cpu_ns_ = static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
@@ -0,0 +1,131 @@
+#ifndef RTMP_OUTPUT_H
+#define RTMP_OUTPUT_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <tsduck.h>
+#include "PacketSink.h"
+#include "FLVRemuxer.h"
+#include "RTMPPublisher.h"
+
+/**
+ * RTMPOutput - Publishes the spliced stream over RTMP in-process
+ *
+ * Alternative to FIFOOutput + the ffmpeg-rtmp-output container: TS packets
+ * are remuxed to FLV (FLVRemuxer) and pushed with RTMPPublisher. That
+ * saves the pipe hop, a second demux/mux process and its CPU, and lets a
+ * frame go out the moment its PES is complete.
+ *
+ * The writing thread only remuxes: every writePackets() call feeds the
+ * remuxer and hands the frames it completed to a sender thread, which owns
+ * the publisher and does everything that can block (connect, send, the
+ * reconnect timeouts). The hand-off queue is bounded by MAX_QUEUE_BYTES;
+ * when the sender falls that far behind, new frames are dropped and video
+ * resumes at the next keyframe. If the server goes away, frames keep being
+ * remuxed (parameter sets and timeline stay current) but are dropped until
+ * a reconnect succeeds; the sender retries every RECONNECT_DELAY_MS, then
+ * re-sends the sequence headers and resumes video at the next keyframe.
+ *
+ * Thread-safety: writes (writePackets, reserve/commit, flush) from one
+ * thread; statistics from any thread.
+ */
+class RTMPOutput : public PacketSink {
+public:
+    RTMPOutput(const std::string& url, const std::atomic<bool>& running);
+    ~RTMPOutput() override;
+
+    // Start the sender thread, which connects and publishes in the background
+    bool open() override;
+
+    // Stop the sender thread, unpublish and disconnect
+    void close() override;
+
+    bool writePacket(const ts::TSPacket& packet) override { return writePackets(&packet, 1); }
+    bool writePackets(const ts::TSPacket* packets, size_t count) override;
+    using PacketSink::writePackets;
+
+    // Staging area for in-place fills (snapshots); commit() remuxes them
+    ts::TSPacket* reserve(size_t count) override;
+    bool commit(size_t count) override;
+
+    // Frames are handed off as they complete; these only report the connection
+    bool flush() override;
+    bool flushIfDue() override;
+    void setBatching(size_t, int) override {}
+    int getFlushWaitMs(int max_wait_ms) const override { return max_wait_ms; }
+
+    bool isPublishing() const { return publishing_.load(); }
+
+    // Statistics
+    uint64_t getPacketsWritten() const override { return packets_written_.load(); }
+    uint64_t getBytesWritten() const override { return bytes_written_.load(); }
+    uint64_t getRTMPBytesSent() const { return rtmp_bytes_sent_.load(); }
+    uint64_t getSendCalls() const { return send_calls_.load(); }
+    uint64_t getReconnectAttempts() const { return reconnect_attempts_.load(); }
+    uint64_t getFramesSkipped() const { return frames_skipped_.load(); }
+    uint64_t getFramesDropped() const { return frames_dropped_.load(); }   // Queue full
+    double getSenderCpuSeconds() const { return sender_cpu_ns_.load() / 1e9; }   // Since open()
+    const FLVRemuxer& getRemuxer() const { return remuxer_; }
+
+private:
+    // Tag callback from the remuxer (writing thread)
+    void collectTag(const FLVTag& tag);
+
+    // Move the collected tags into the sender queue, dropping on overflow
+    void handOff();
+
+    void senderLoop();
+
+    // Sender thread: publisher side
+    void sendTag(const FLVTag& tag);
+    bool connectPublisher(int timeout_ms);
+    void updateSenderStats();
+
+    std::string url_;
+    const std::atomic<bool>& running_;
+
+    // Writing thread
+    FLVRemuxer remuxer_;
+    std::vector<ts::TSPacket> staging_;
+    std::vector<FLVTag> collected_;
+    bool video_gap_;                // A video frame was dropped; wait for a keyframe
+
+    // Sender thread
+    RTMPPublisher publisher_;
+    FLVTag video_config_;           // Latest sequence headers, re-sent on every connect
+    FLVTag audio_config_;
+    bool has_video_config_;
+    bool has_audio_config_;
+    bool waiting_keyframe_;         // Video resumes at a keyframe after (re)connecting
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<FLVTag> queue_;      // Guarded by mutex_
+    size_t queued_bytes_;           // Guarded by mutex_
+    bool stopping_;                 // Guarded by mutex_
+    std::thread sender_;
+
+    std::atomic<bool> publishing_;
+    std::atomic<uint64_t> packets_written_;
+    std::atomic<uint64_t> bytes_written_;
+    std::atomic<uint64_t> rtmp_bytes_sent_;
+    std::atomic<uint64_t> send_calls_;
+    std::atomic<uint64_t> reconnect_attempts_;
+    std::atomic<uint64_t> frames_skipped_;
+    std::atomic<uint64_t> frames_dropped_;
+    std::atomic<uint64_t> sender_cpu_ns_;
+
+    static constexpr int CONNECT_TIMEOUT_MS = 5000;
+    static constexpr int RECONNECT_DELAY_MS = 2000;
+    static constexpr int POLL_INTERVAL_MS = 100;
+    static constexpr size_t MAX_QUEUE_BYTES = 4 * 1024 * 1024;   // ~5 s at 6 Mbps
+};
+
+#endif // RTMP_OUTPUT_H
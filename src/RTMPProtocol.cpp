@@ -0,0 +1,387 @@
+#include "RTMPProtocol.h"
+#include <algorithm>
+#include <cstring>
+
+namespace rtmp {
+
+namespace {
+
+enum AMFMarker : uint8_t {
+    AMF_NUMBER = 0x00,
+    AMF_BOOLEAN = 0x01,
+    AMF_STRING = 0x02,
+    AMF_OBJECT = 0x03,
+    AMF_NULL = 0x05,
+    AMF_UNDEFINED = 0x06,
+    AMF_ECMA_ARRAY = 0x08,
+    AMF_OBJECT_END = 0x09,
+    AMF_STRICT_ARRAY = 0x0A,
+    AMF_LONG_STRING = 0x0C
+};
+
+constexpr int MAX_AMF_DEPTH = 16;
+
+bool readString(const uint8_t*& p, const uint8_t* end, size_t len_bytes, std::string& out) {
+    if (static_cast<size_t>(end - p) < len_bytes) {
+        return false;
+    }
+    size_t len = len_bytes == 2 ? getBE16(p) : getBE32(p);
+    p += len_bytes;
+    if (static_cast<size_t>(end - p) < len) {
+        return false;
+    }
+    out.assign(reinterpret_cast<const char*>(p), len);
+    p += len;
+    return true;
+}
+
+bool readValue(const uint8_t*& p, const uint8_t* end, AMFValue& out, int depth);
+
+// Key/value pairs up to the 00 00 09 end marker
+bool readProperties(const uint8_t*& p, const uint8_t* end, AMFValue& out, int depth) {
+    while (true) {
+        if (end - p >= 3 && p[0] == 0 && p[1] == 0 && p[2] == AMF_OBJECT_END) {
+            p += 3;
+            return true;
+        }
+        std::string key;
+        AMFValue value;
+        if (!readString(p, end, 2, key) || !readValue(p, end, value, depth + 1)) {
+            return false;
+        }
+        out.keys.push_back(std::move(key));
+        out.values.push_back(std::move(value));
+    }
+}
+
+bool readValue(const uint8_t*& p, const uint8_t* end, AMFValue& out, int depth) {
+    if (p >= end || depth > MAX_AMF_DEPTH) {
+        return false;
+    }
+    uint8_t marker = *p++;
+    switch (marker) {
+        case AMF_NUMBER: {
+            if (end - p < 8) {
+                return false;
+            }
+            uint64_t bits = (static_cast<uint64_t>(getBE32(p)) << 32) | getBE32(p + 4);
+            std::memcpy(&out.number, &bits, sizeof(bits));
+            out.type = AMFValue::NUMBER;
+            p += 8;
+            return true;
+        }
+        case AMF_BOOLEAN:
+            if (p >= end) {
+                return false;
+            }
+            out.type = AMFValue::BOOLEAN;
+            out.boolean = *p++ != 0;
+            return true;
+        case AMF_STRING:
+            out.type = AMFValue::STRING;
+            return readString(p, end, 2, out.string);
+        case AMF_LONG_STRING:
+            out.type = AMFValue::STRING;
+            return readString(p, end, 4, out.string);
+        case AMF_OBJECT:
+            out.type = AMFValue::OBJECT;
+            return readProperties(p, end, out, depth);
+        case AMF_ECMA_ARRAY:
+            if (end - p < 4) {
+                return false;
+            }
+            p += 4;     // Count is advisory, the end marker terminates
+            out.type = AMFValue::OBJECT;
+            return readProperties(p, end, out, depth);
+        case AMF_STRICT_ARRAY: {
+            if (end - p < 4) {
+                return false;
+            }
+            uint32_t count = getBE32(p);
+            p += 4;
+            out.type = AMFValue::ARRAY;
+            for (uint32_t i = 0; i < count; i++) {
+                AMFValue element;
+                if (!readValue(p, end, element, depth + 1)) {
+                    return false;
+                }
+                out.values.push_back(std::move(element));
+            }
+            return true;
+        }
+        case AMF_NULL:
+            out.type = AMFValue::NULL_VALUE;
+            return true;
+        case AMF_UNDEFINED:
+            out.type = AMFValue::UNDEFINED;
+            return true;
+        default:
+            out.type = AMFValue::UNSUPPORTED;
+            return false;
+    }
+}
+
+void writeBasicHeader(std::vector<uint8_t>& out, uint8_t fmt, uint32_t csid) {
+    if (csid < 64) {
+        out.push_back(static_cast<uint8_t>((fmt << 6) | csid));
+    } else if (csid < 320) {
+        out.push_back(static_cast<uint8_t>(fmt << 6));
+        out.push_back(static_cast<uint8_t>(csid - 64));
+    } else {
+        out.push_back(static_cast<uint8_t>((fmt << 6) | 1));
+        out.push_back(static_cast<uint8_t>((csid - 64) & 0xFF));
+        out.push_back(static_cast<uint8_t>((csid - 64) >> 8));
+    }
+}
+
+} // namespace
+
+// ---- AMF0 ----
+
+const AMFValue* AMFValue::find(const std::string& key) const {
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (keys[i] == key) {
+            return &values[i];
+        }
+    }
+    return nullptr;
+}
+
+std::string AMFValue::getString(const std::string& key, const std::string& def) const {
+    const AMFValue* v = find(key);
+    return (v && v->type == STRING) ? v->string : def;
+}
+
+double AMFValue::getNumber(const std::string& key, double def) const {
+    const AMFValue* v = find(key);
+    return (v && v->type == NUMBER) ? v->number : def;
+}
+
+void amfWriteNumber(std::vector<uint8_t>& out, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    out.push_back(AMF_NUMBER);
+    putBE32(out, static_cast<uint32_t>(bits >> 32));
+    putBE32(out, static_cast<uint32_t>(bits));
+}
+
+void amfWriteBoolean(std::vector<uint8_t>& out, bool value) {
+    out.push_back(AMF_BOOLEAN);
+    out.push_back(value ? 1 : 0);
+}
+
+void amfWriteString(std::vector<uint8_t>& out, const std::string& value) {
+    if (value.size() > 0xFFFF) {
+        out.push_back(AMF_LONG_STRING);
+        putBE32(out, static_cast<uint32_t>(value.size()));
+    } else {
+        out.push_back(AMF_STRING);
+        putBE16(out, static_cast<uint16_t>(value.size()));
+    }
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+void amfWriteNull(std::vector<uint8_t>& out) {
+    out.push_back(AMF_NULL);
+}
+
+void amfWriteObjectStart(std::vector<uint8_t>& out) {
+    out.push_back(AMF_OBJECT);
+}
+
+void amfWriteEcmaArrayStart(std::vector<uint8_t>& out, uint32_t count) {
+    out.push_back(AMF_ECMA_ARRAY);
+    putBE32(out, count);
+}
+
+void amfWriteKey(std::vector<uint8_t>& out, const std::string& key) {
+    putBE16(out, static_cast<uint16_t>(key.size()));
+    out.insert(out.end(), key.begin(), key.end());
+}
+
+void amfWriteObjectEnd(std::vector<uint8_t>& out) {
+    out.push_back(0);
+    out.push_back(0);
+    out.push_back(AMF_OBJECT_END);
+}
+
+std::vector<AMFValue> amfReadAll(const uint8_t* data, size_t size) {
+    std::vector<AMFValue> values;
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    while (p < end) {
+        AMFValue value;
+        if (!readValue(p, end, value, 0)) {
+            break;
+        }
+        values.push_back(std::move(value));
+    }
+    return values;
+}
+
+// ---- Chunking ----
+
+void ChunkWriter::write(std::vector<uint8_t>& out, uint32_t chunk_stream_id, uint8_t type,
+                        uint32_t timestamp, uint32_t stream_id, const uint8_t* payload, size_t size) const {
+    bool extended = timestamp >= 0xFFFFFF;
+
+    writeBasicHeader(out, 0, chunk_stream_id);
+    putBE24(out, extended ? 0xFFFFFF : timestamp);
+    putBE24(out, static_cast<uint32_t>(size));
+    out.push_back(type);
+    // Message stream ID is little-endian
+    out.push_back(static_cast<uint8_t>(stream_id));
+    out.push_back(static_cast<uint8_t>(stream_id >> 8));
+    out.push_back(static_cast<uint8_t>(stream_id >> 16));
+    out.push_back(static_cast<uint8_t>(stream_id >> 24));
+    if (extended) {
+        putBE32(out, timestamp);
+    }
+
+    size_t offset = 0;
+    while (true) {
+        size_t n = std::min(chunk_size_, size - offset);
+        out.insert(out.end(), payload + offset, payload + offset + n);
+        offset += n;
+        if (offset >= size) {
+            break;
+        }
+        writeBasicHeader(out, 3, chunk_stream_id);
+        if (extended) {
+            putBE32(out, timestamp);
+        }
+    }
+}
+
+bool ChunkReader::readMessage(Message& out) {
+    while (!failed_) {
+        const uint8_t* p = buffer_.data() + pos_;
+        size_t avail = buffer_.size() - pos_;
+        if (avail < 1) {
+            break;
+        }
+
+        // Basic header
+        uint8_t fmt = p[0] >> 6;
+        uint32_t csid = p[0] & 0x3F;
+        size_t header = 1;
+        if (csid == 0) {
+            if (avail < 2) {
+                break;
+            }
+            csid = 64 + p[1];
+            header = 2;
+        } else if (csid == 1) {
+            if (avail < 3) {
+                break;
+            }
+            csid = 64 + p[1] + (static_cast<uint32_t>(p[2]) << 8);
+            header = 3;
+        }
+
+        // Message header (parsed into locals, committed once the chunk is complete)
+        static constexpr size_t MESSAGE_HEADER_SIZE[4] = {11, 7, 3, 0};
+        if (avail < header + MESSAGE_HEADER_SIZE[fmt]) {
+            break;
+        }
+        ChunkStream& cs = streams_[csid];
+        const uint8_t* mh = p + header;
+        uint32_t ts_field = 0;
+        uint32_t length = cs.length;
+        uint8_t type = cs.type;
+        uint32_t stream_id = cs.stream_id;
+        if (fmt <= 2) {
+            ts_field = getBE24(mh);
+        }
+        if (fmt <= 1) {
+            length = getBE24(mh + 3);
+            type = mh[6];
+        }
+        if (fmt == 0) {
+            stream_id = mh[7] | (uint32_t(mh[8]) << 8) | (uint32_t(mh[9]) << 16) | (uint32_t(mh[10]) << 24);
+        }
+        header += MESSAGE_HEADER_SIZE[fmt];
+
+        bool extended = (fmt <= 2) ? ts_field == 0xFFFFFF : cs.extended;
+        uint32_t ext_ts = 0;
+        if (extended) {
+            if (avail < header + 4) {
+                break;
+            }
+            ext_ts = getBE32(p + header);
+            header += 4;
+        }
+        if (extended && fmt <= 2) {
+            ts_field = ext_ts;
+        }
+
+        if (length > MAX_MESSAGE_SIZE) {
+            failed_ = true;
+            break;
+        }
+
+        // A new header mid-message abandons the partial one
+        bool continuing = fmt == 3 && !cs.payload.empty();
+        size_t have = continuing ? cs.payload.size() : 0;
+        size_t n = std::min(chunk_size_, static_cast<size_t>(length) - have);
+        if (avail < header + n) {
+            break;
+        }
+
+        // Commit the header
+        if (fmt == 0) {
+            cs.timestamp = ts_field;
+            cs.delta = 0;
+        } else if (fmt <= 2) {
+            cs.delta = ts_field;
+            cs.timestamp += ts_field;
+        } else if (!continuing) {
+            cs.timestamp += cs.delta;
+        }
+        if (fmt <= 2) {
+            cs.extended = extended;
+        }
+        cs.length = length;
+        cs.type = type;
+        cs.stream_id = stream_id;
+        if (!continuing) {
+            cs.payload.clear();
+        }
+
+        cs.payload.insert(cs.payload.end(), p + header, p + header + n);
+        pos_ += header + n;
+        bytes_consumed_ += header + n;
+
+        if (cs.payload.size() == cs.length) {
+            out.type = cs.type;
+            out.timestamp = cs.timestamp;
+            out.stream_id = cs.stream_id;
+            out.payload = std::move(cs.payload);
+            cs.payload.clear();
+            if (out.type == SET_CHUNK_SIZE && out.payload.size() >= 4) {
+                chunk_size_ = std::max<size_t>(1, getBE32(out.payload.data()) & 0x7FFFFFFF);
+            }
+            return true;
+        }
+    }
+
+    // Keep only the unparsed tail
+    buffer_.erase(buffer_.begin(), buffer_.begin() + static_cast<std::ptrdiff_t>(pos_));
+    pos_ = 0;
+    return false;
+}
+
+std::vector<uint8_t> uint32Payload(uint32_t value) {
+    std::vector<uint8_t> payload;
+    putBE32(payload, value);
+    return payload;
+}
+
+std::vector<uint8_t> userControlPayload(uint16_t event, uint32_t value) {
+    std::vector<uint8_t> payload;
+    putBE16(payload, event);
+    putBE32(payload, value);
+    return payload;
+}
+
+} // namespace rtmp
@@ -0,0 +1,168 @@
+#ifndef RTMP_PROTOCOL_H
+#define RTMP_PROTOCOL_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * RTMP wire format: message types, AMF0 and chunking
+ *
+ * Only what a publisher (and a test server) needs: AMF0 numbers, booleans,
+ * strings, objects, ECMA arrays and null; the chunk stream with fmt 0
+ * headers on the way out and all four header formats on the way in.
+ * No socket handling here, see RTMPPublisher.
+ */
+namespace rtmp {
+
+enum MessageType : uint8_t {
+    SET_CHUNK_SIZE = 1,
+    ABORT = 2,
+    ACKNOWLEDGEMENT = 3,
+    USER_CONTROL = 4,
+    WINDOW_ACK_SIZE = 5,
+    SET_PEER_BANDWIDTH = 6,
+    AUDIO = 8,
+    VIDEO = 9,
+    DATA_AMF0 = 18,
+    COMMAND_AMF0 = 20
+};
+
+// User control events
+constexpr uint16_t PING_REQUEST = 6;
+constexpr uint16_t PING_RESPONSE = 7;
+
+constexpr size_t HANDSHAKE_SIZE = 1536;
+constexpr uint8_t VERSION = 3;
+constexpr size_t DEFAULT_CHUNK_SIZE = 128;
+constexpr size_t MAX_MESSAGE_SIZE = 16 * 1024 * 1024;  // Sanity limit for incoming messages
+
+struct Message {
+    uint8_t type = 0;
+    uint32_t timestamp = 0;
+    uint32_t stream_id = 0;
+    std::vector<uint8_t> payload;
+};
+
+// ---- AMF0 ----
+
+struct AMFValue {
+    enum Type { NUMBER, BOOLEAN, STRING, OBJECT, NULL_VALUE, UNDEFINED, ARRAY, UNSUPPORTED };
+
+    Type type = NULL_VALUE;
+    double number = 0.0;
+    bool boolean = false;
+    std::string string;
+    std::vector<std::string> keys;      // OBJECT and ECMA array: keys[i] names values[i]
+    std::vector<AMFValue> values;       // ... and the elements of a strict array
+
+    // Property lookup (nullptr when absent)
+    const AMFValue* find(const std::string& key) const;
+
+    // Property as string / number, or the default when absent or another type
+    std::string getString(const std::string& key, const std::string& def = "") const;
+    double getNumber(const std::string& key, double def = 0.0) const;
+};
+
+void amfWriteNumber(std::vector<uint8_t>& out, double value);
+void amfWriteBoolean(std::vector<uint8_t>& out, bool value);
+void amfWriteString(std::vector<uint8_t>& out, const std::string& value);
+void amfWriteNull(std::vector<uint8_t>& out);
+
+// Objects and ECMA arrays: start, then key + value pairs, then end
+void amfWriteObjectStart(std::vector<uint8_t>& out);
+void amfWriteEcmaArrayStart(std::vector<uint8_t>& out, uint32_t count);
+void amfWriteKey(std::vector<uint8_t>& out, const std::string& key);
+void amfWriteObjectEnd(std::vector<uint8_t>& out);
+
+// Decode every value in a command / data message. Stops at the first value
+// that cannot be decoded.
+std::vector<AMFValue> amfReadAll(const uint8_t* data, size_t size);
+
+// ---- Chunking ----
+
+/**
+ * Splits messages into chunks. Every message starts with a fmt 0 header
+ * (absolute timestamp), continuation chunks use fmt 3.
+ */
+class ChunkWriter {
+public:
+    // Outgoing chunk size; announce it with a SET_CHUNK_SIZE message first
+    void setChunkSize(size_t size) { chunk_size_ = size; }
+    size_t getChunkSize() const { return chunk_size_; }
+
+    // Append the chunks of one message to `out`
+    void write(std::vector<uint8_t>& out, uint32_t chunk_stream_id, uint8_t type,
+               uint32_t timestamp, uint32_t stream_id, const uint8_t* payload, size_t size) const;
+
+private:
+    size_t chunk_size_ = DEFAULT_CHUNK_SIZE;
+};
+
+/**
+ * Reassembles messages from the incoming chunk stream. Fed raw bytes as
+ * they arrive; partial chunks stay buffered until complete. SET_CHUNK_SIZE
+ * from the peer is applied here (and still returned to the caller).
+ */
+class ChunkReader {
+public:
+    void append(const uint8_t* data, size_t size) { buffer_.insert(buffer_.end(), data, data + size); }
+
+    // Next complete message, false when more bytes are needed
+    bool readMessage(Message& out);
+
+    // Protocol error (bad chunk stream / oversized message): drop the connection
+    bool failed() const { return failed_; }
+
+    uint64_t getBytesConsumed() const { return bytes_consumed_; }
+
+private:
+    struct ChunkStream {
+        uint32_t timestamp = 0;
+        uint32_t delta = 0;
+        uint32_t length = 0;
+        uint8_t type = 0;
+        uint32_t stream_id = 0;
+        bool extended = false;          // Header carried an extended timestamp
+        std::vector<uint8_t> payload;   // Message being reassembled
+    };
+
+    std::vector<uint8_t> buffer_;
+    size_t pos_ = 0;
+    std::map<uint32_t, ChunkStream> streams_;
+    size_t chunk_size_ = DEFAULT_CHUNK_SIZE;
+    bool failed_ = false;
+    uint64_t bytes_consumed_ = 0;
+};
+
+// ---- Helpers ----
+
+inline void putBE16(std::vector<uint8_t>& out, uint16_t v) {
+    out.push_back(static_cast<uint8_t>(v >> 8));
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+inline void putBE24(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back(static_cast<uint8_t>(v >> 16));
+    out.push_back(static_cast<uint8_t>(v >> 8));
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+inline void putBE32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back(static_cast<uint8_t>(v >> 24));
+    putBE24(out, v);
+}
+
+inline uint32_t getBE16(const uint8_t* p) { return (uint32_t(p[0]) << 8) | p[1]; }
+inline uint32_t getBE24(const uint8_t* p) { return (uint32_t(p[0]) << 16) | (uint32_t(p[1]) << 8) | p[2]; }
+inline uint32_t getBE32(const uint8_t* p) { return (uint32_t(p[0]) << 24) | getBE24(p + 1); }
+
+// Protocol control / user control message payloads
+std::vector<uint8_t> uint32Payload(uint32_t value);
+std::vector<uint8_t> userControlPayload(uint16_t event, uint32_t value);
+
+} // namespace rtmp
+
+#endif // RTMP_PROTOCOL_H
@@ -0,0 +1,460 @@
+#include "RTMPPublisher.h"
+#include <iostream>
+#include <cstring>
+#include <random>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+
+RTMPPublisher::RTMPPublisher(const std::string& url)
+    : url_(url),
+      port_(DEFAULT_PORT),
+      fd_(-1),
+      publishing_(false),
+      stream_id_(0),
+      window_ack_size_(0),
+      bytes_received_(0),
+      last_ack_(0),
+      bytes_sent_(0),
+      messages_sent_(0),
+      send_calls_(0) {
+    // rtmp://host[:port]/app/stream - the stream name may carry a ?query
+    const std::string scheme = "rtmp://";
+    if (url.compare(0, scheme.size(), scheme) != 0) {
+        std::cerr << "[RTMPPublisher] Unsupported URL (rtmp:// only): " << url << std::endl;
+        return;
+    }
+    std::string rest = url.substr(scheme.size());
+    size_t slash = rest.find('/');
+    size_t app_end = (slash == std::string::npos) ? std::string::npos : rest.find('/', slash + 1);
+    if (app_end == std::string::npos) {
+        std::cerr << "[RTMPPublisher] URL needs an app and a stream name: " << url << std::endl;
+        return;
+    }
+
+    std::string authority = rest.substr(0, slash);
+    size_t colon = authority.rfind(':');
+    if (colon != std::string::npos) {
+        port_ = static_cast<uint16_t>(std::stoi(authority.substr(colon + 1)));
+        authority.resize(colon);
+    }
+    host_ = authority;
+    app_ = rest.substr(slash + 1, app_end - slash - 1);
+    stream_ = rest.substr(app_end + 1);
+    tc_url_ = scheme + host_ + ":" + std::to_string(port_) + "/" + app_;
+}
+
+RTMPPublisher::~RTMPPublisher() {
+    closeSocket();
+}
+
+bool RTMPPublisher::connect(int timeout_ms) {
+    if (!isValidUrl()) {
+        return false;
+    }
+    closeSocket();
+    auto deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+
+    if (!openSocket(deadline) || !handshake(deadline)) {
+        closeSocket();
+        return false;
+    }
+
+    // Large chunks: one header per 4KB instead of per 128 bytes
+    queueMessage(CSID_CONTROL, rtmp::SET_CHUNK_SIZE, 0, 0, rtmp::uint32Payload(CHUNK_SIZE));
+    writer_.setChunkSize(CHUNK_SIZE);
+
+    std::vector<uint8_t> connect;
+    rtmp::amfWriteString(connect, "connect");
+    rtmp::amfWriteNumber(connect, 1);
+    rtmp::amfWriteObjectStart(connect);
+    rtmp::amfWriteKey(connect, "app");
+    rtmp::amfWriteString(connect, app_);
+    rtmp::amfWriteKey(connect, "type");
+    rtmp::amfWriteString(connect, "nonprivate");
+    rtmp::amfWriteKey(connect, "flashVer");
+    rtmp::amfWriteString(connect, "FMLE/3.0 (compatible; latestrelayer)");
+    rtmp::amfWriteKey(connect, "tcUrl");
+    rtmp::amfWriteString(connect, tc_url_);
+    rtmp::amfWriteObjectEnd(connect);
+    queueMessage(CSID_COMMAND, rtmp::COMMAND_AMF0, 0, 0, connect);
+
+    std::vector<rtmp::AMFValue> result;
+    if (!flush() || !waitForResponse(1, deadline, result) || result[0].string != "_result") {
+        std::cerr << "[RTMPPublisher] connect to app '" << app_ << "' rejected" << std::endl;
+        closeSocket();
+        return false;
+    }
+
+    queueCommand("releaseStream", 2, 0, {stream_});
+    queueCommand("FCPublish", 3, 0, {stream_});
+    queueCommand("createStream", 4, 0, {});
+    if (!flush() || !waitForResponse(4, deadline, result) || result[0].string != "_result" ||
+        result.size() < 4 || result[3].type != rtmp::AMFValue::NUMBER) {
+        std::cerr << "[RTMPPublisher] createStream failed" << std::endl;
+        closeSocket();
+        return false;
+    }
+    stream_id_ = static_cast<uint32_t>(result[3].number);
+
+    queueCommand("publish", 5, stream_id_, {stream_, "live"});
+    if (!flush()) {
+        closeSocket();
+        return false;
+    }
+    while (true) {
+        if (!waitForResponse(5, deadline, result)) {
+            std::cerr << "[RTMPPublisher] No answer to publish" << std::endl;
+            closeSocket();
+            return false;
+        }
+        if (result[0].string != "onStatus") {
+            continue;
+        }
+        std::string code = result.size() >= 4 ? result[3].getString("code") : "";
+        if (code == "NetStream.Publish.Start") {
+            break;
+        }
+        if (result.size() >= 4 && result[3].getString("level") == "error") {
+            std::cerr << "[RTMPPublisher] publish '" << stream_ << "' failed: " << code
+                      << " " << result[3].getString("description") << std::endl;
+            closeSocket();
+            return false;
+        }
+    }
+
+    // Stream metadata: codec IDs only, the sequence headers carry the rest
+    std::vector<uint8_t> metadata;
+    rtmp::amfWriteString(metadata, "@setDataFrame");
+    rtmp::amfWriteString(metadata, "onMetaData");
+    rtmp::amfWriteEcmaArrayStart(metadata, 3);
+    rtmp::amfWriteKey(metadata, "videocodecid");
+    rtmp::amfWriteNumber(metadata, 7);     // AVC
+    rtmp::amfWriteKey(metadata, "audiocodecid");
+    rtmp::amfWriteNumber(metadata, 10);    // AAC
+    rtmp::amfWriteKey(metadata, "encoder");
+    rtmp::amfWriteString(metadata, "latestrelayer");
+    rtmp::amfWriteObjectEnd(metadata);
+    queueMessage(CSID_DATA, rtmp::DATA_AMF0, 0, stream_id_, metadata);
+
+    publishing_ = true;
+    if (!flush()) {
+        return false;
+    }
+    std::cout << "[RTMPPublisher] Publishing to " << tc_url_ << "/" << stream_ << " (stream " << stream_id_ << ")"
+              << std::endl;
+    return true;
+}
+
+void RTMPPublisher::disconnect() {
+    if (publishing_) {
+        queueCommand("FCUnpublish", 6, 0, {stream_});
+        std::vector<uint8_t> delete_stream;
+        rtmp::amfWriteString(delete_stream, "deleteStream");
+        rtmp::amfWriteNumber(delete_stream, 7);
+        rtmp::amfWriteNull(delete_stream);
+        rtmp::amfWriteNumber(delete_stream, stream_id_);
+        queueMessage(CSID_COMMAND, rtmp::COMMAND_AMF0, 0, 0, delete_stream);
+        flush();
+    }
+    closeSocket();
+}
+
+void RTMPPublisher::queueTag(const FLVTag& tag) {
+    uint32_t csid = (tag.type == FLVTag::AUDIO) ? CSID_AUDIO : CSID_VIDEO;
+    writer_.write(out_, csid, tag.type, tag.timestamp_ms, stream_id_, tag.data.data(), tag.data.size());
+    messages_sent_++;
+}
+
+bool RTMPPublisher::flush() {
+    if (out_.empty()) {
+        return fd_ >= 0;
+    }
+    bool ok = sendAll(out_.data(), out_.size());
+    out_.clear();
+    if (!ok) {
+        closeSocket();
+    }
+    return ok;
+}
+
+bool RTMPPublisher::poll() {
+    if (fd_ < 0) {
+        return false;
+    }
+
+    uint8_t buf[4096];
+    while (true) {
+        ssize_t n = ::recv(fd_, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) {
+            reader_.append(buf, static_cast<size_t>(n));
+            bytes_received_ += n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        std::cerr << "[RTMPPublisher] Server closed the connection" << std::endl;
+        closeSocket();
+        return false;
+    }
+
+    rtmp::Message msg;
+    while (reader_.readMessage(msg)) {
+        handleMessage(msg);
+    }
+    if (reader_.failed()) {
+        std::cerr << "[RTMPPublisher] Protocol error from server" << std::endl;
+        closeSocket();
+        return false;
+    }
+
+    // While publishing, the only command that matters is a failed stream
+    while (!commands_.empty()) {
+        rtmp::Message cmd = std::move(commands_.front());
+        commands_.pop_front();
+        std::vector<rtmp::AMFValue> values = rtmp::amfReadAll(cmd.payload.data(), cmd.payload.size());
+        if (values.size() >= 4 && values[0].string == "onStatus" && values[3].getString("level") == "error") {
+            std::cerr << "[RTMPPublisher] Server: " << values[3].getString("code") << " "
+                      << values[3].getString("description") << std::endl;
+            closeSocket();
+            return false;
+        }
+    }
+    return flush();
+}
+
+bool RTMPPublisher::openSocket(Clock::time_point deadline) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* addrs = nullptr;
+    int rc = getaddrinfo(host_.c_str(), std::to_string(port_).c_str(), &hints, &addrs);
+    if (rc != 0) {
+        std::cerr << "[RTMPPublisher] Cannot resolve " << host_ << ": " << gai_strerror(rc) << std::endl;
+        return false;
+    }
+
+    for (struct addrinfo* ai = addrs; ai != nullptr && fd_ < 0; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            continue;
+        }
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) < 0 && errno != EINPROGRESS) {
+            ::close(fd);
+            continue;
+        }
+        struct pollfd pfd = {fd, POLLOUT, 0};
+        int wait_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - Clock::now()).count());
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (wait_ms <= 0 || ::poll(&pfd, 1, wait_ms) != 1 ||
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+            ::close(fd);
+            continue;
+        }
+        fd_ = fd;
+    }
+    freeaddrinfo(addrs);
+
+    if (fd_ < 0) {
+        std::cerr << "[RTMPPublisher] Cannot connect to " << host_ << ":" << port_ << std::endl;
+        return false;
+    }
+
+    // Blocking sends bounded by a timeout; frames go out as soon as they are queued
+    int flags = fcntl(fd_, F_GETFL, 0);
+    fcntl(fd_, F_SETFL, flags & ~O_NONBLOCK);
+    struct timeval tv = {SEND_TIMEOUT_MS / 1000, (SEND_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(fd_, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    int bufsize = SEND_BUFFER_SIZE;
+    setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+
+    reader_ = rtmp::ChunkReader();
+    writer_ = rtmp::ChunkWriter();
+    commands_.clear();
+    window_ack_size_ = 0;
+    bytes_received_ = 0;
+    last_ack_ = 0;
+    return true;
+}
+
+bool RTMPPublisher::handshake(Clock::time_point deadline) {
+    // C0 + C1: version, time, zero, random
+    std::vector<uint8_t> c0c1(1 + rtmp::HANDSHAKE_SIZE, 0);
+    c0c1[0] = rtmp::VERSION;
+    std::mt19937 rng(std::random_device{}());
+    for (size_t i = 9; i < c0c1.size(); i++) {
+        c0c1[i] = static_cast<uint8_t>(rng());
+    }
+    if (!sendAll(c0c1.data(), c0c1.size())) {
+        return false;
+    }
+
+    // S0 + S1 + S2, raw bytes before the chunk stream starts
+    std::vector<uint8_t> s(1 + 2 * rtmp::HANDSHAKE_SIZE);
+    size_t have = 0;
+    bool sent_c2 = false;
+    while (have < s.size()) {
+        struct pollfd pfd = {fd_, POLLIN, 0};
+        int wait_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - Clock::now()).count());
+        if (wait_ms <= 0 || ::poll(&pfd, 1, wait_ms) != 1) {
+            std::cerr << "[RTMPPublisher] Handshake timed out" << std::endl;
+            return false;
+        }
+        ssize_t n = ::recv(fd_, s.data() + have, s.size() - have, 0);
+        if (n <= 0) {
+            std::cerr << "[RTMPPublisher] Handshake failed: connection closed" << std::endl;
+            return false;
+        }
+        have += n;
+
+        // C2 echoes S1 as soon as it is complete
+        if (!sent_c2 && have >= 1 + rtmp::HANDSHAKE_SIZE) {
+            if (s[0] != rtmp::VERSION) {
+                std::cerr << "[RTMPPublisher] Unsupported RTMP version " << int(s[0]) << std::endl;
+                return false;
+            }
+            if (!sendAll(s.data() + 1, rtmp::HANDSHAKE_SIZE)) {
+                return false;
+            }
+            sent_c2 = true;
+        }
+    }
+    return true;
+}
+
+bool RTMPPublisher::sendAll(const uint8_t* data, size_t size) {
+    if (fd_ < 0) {
+        return false;
+    }
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = ::send(fd_, data + sent, size - sent, MSG_NOSIGNAL);
+        send_calls_++;
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "[RTMPPublisher] Send failed: "
+                      << (errno == EAGAIN ? "timed out" : strerror(errno)) << std::endl;
+            return false;
+        }
+        sent += n;
+    }
+    bytes_sent_ += size;
+    return true;
+}
+
+bool RTMPPublisher::receive(Clock::time_point deadline) {
+    struct pollfd pfd = {fd_, POLLIN, 0};
+    int wait_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - Clock::now()).count());
+    if (fd_ < 0 || wait_ms <= 0 || ::poll(&pfd, 1, wait_ms) != 1) {
+        return false;
+    }
+    uint8_t buf[4096];
+    ssize_t n = ::recv(fd_, buf, sizeof(buf), 0);
+    if (n <= 0) {
+        return false;
+    }
+    reader_.append(buf, static_cast<size_t>(n));
+    bytes_received_ += n;
+
+    rtmp::Message msg;
+    while (reader_.readMessage(msg)) {
+        handleMessage(msg);
+    }
+    return !reader_.failed() && flush();
+}
+
+void RTMPPublisher::closeSocket() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    if (publishing_) {
+        std::cout << "[RTMPPublisher] Disconnected from " << tc_url_ << std::endl;
+    }
+    publishing_ = false;
+    out_.clear();
+}
+
+void RTMPPublisher::queueMessage(uint32_t chunk_stream_id, uint8_t type, uint32_t timestamp, uint32_t stream_id,
+                                 const std::vector<uint8_t>& payload) {
+    writer_.write(out_, chunk_stream_id, type, timestamp, stream_id, payload.data(), payload.size());
+}
+
+void RTMPPublisher::queueCommand(const std::string& name, double transaction, uint32_t stream_id,
+                                 const std::vector<std::string>& args) {
+    std::vector<uint8_t> payload;
+    rtmp::amfWriteString(payload, name);
+    rtmp::amfWriteNumber(payload, transaction);
+    rtmp::amfWriteNull(payload);
+    for (const std::string& arg : args) {
+        rtmp::amfWriteString(payload, arg);
+    }
+    queueMessage(CSID_COMMAND, rtmp::COMMAND_AMF0, 0, stream_id, payload);
+}
+
+bool RTMPPublisher::waitForResponse(double transaction, Clock::time_point deadline,
+                                    std::vector<rtmp::AMFValue>& result) {
+    while (true) {
+        while (!commands_.empty()) {
+            rtmp::Message cmd = std::move(commands_.front());
+            commands_.pop_front();
+            result = rtmp::amfReadAll(cmd.payload.data(), cmd.payload.size());
+            if (result.size() < 2 || result[0].type != rtmp::AMFValue::STRING) {
+                continue;
+            }
+            const std::string& name = result[0].string;
+            if (name == "onStatus" ||
+                ((name == "_result" || name == "_error") && result[1].number == transaction)) {
+                return true;
+            }
+        }
+        if (!receive(deadline)) {
+            return false;
+        }
+    }
+}
+
+void RTMPPublisher::handleMessage(rtmp::Message& msg) {
+    switch (msg.type) {
+        case rtmp::WINDOW_ACK_SIZE:
+            if (msg.payload.size() >= 4) {
+                window_ack_size_ = rtmp::getBE32(msg.payload.data());
+            }
+            break;
+        case rtmp::USER_CONTROL:
+            if (msg.payload.size() >= 6 && rtmp::getBE16(msg.payload.data()) == rtmp::PING_REQUEST) {
+                queueMessage(CSID_CONTROL, rtmp::USER_CONTROL, 0, 0,
+                             rtmp::userControlPayload(rtmp::PING_RESPONSE, rtmp::getBE32(msg.payload.data() + 2)));
+            }
+            break;
+        case rtmp::COMMAND_AMF0:
+            commands_.push_back(std::move(msg));
+            break;
+        default:
+            break;      // Chunk size (applied by the reader), peer bandwidth, acks, data
+    }
+
+    if (window_ack_size_ > 0 && bytes_received_ - last_ack_ >= window_ack_size_) {
+        queueMessage(CSID_CONTROL, rtmp::ACKNOWLEDGEMENT, 0, 0,
+                     rtmp::uint32Payload(static_cast<uint32_t>(bytes_received_)));
+        last_ack_ = bytes_received_;
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef RTMP_PUBLISHER_H
+#define RTMP_PUBLISHER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <cstdint>
+#include "RTMPProtocol.h"
+#include "FLVRemuxer.h"
+
+/**
+ * RTMPPublisher - Minimal RTMP publish client
+ *
+ * Speaks just enough RTMP to push a live stream into SRS / nginx-rtmp:
+ * simple handshake (C0/C1/C2), connect, releaseStream, FCPublish,
+ * createStream, publish ("live"), @setDataFrame onMetaData, then audio and
+ * video messages built from FLV tags. No RTMPS, no authentication beyond
+ * what the URL's stream name carries.
+ *
+ * connect() blocks (up to its timeout). While publishing, queueTag() only
+ * appends to a send buffer; flush() writes it with one blocking send()
+ * bounded by a send timeout (a stalled server drops the connection instead
+ * of stalling the sender forever). poll() answers pings and
+ * acknowledgements without blocking. Any error leaves the publisher
+ * disconnected; the owner decides when to reconnect.
+ *
+ * Thread-safety: none, used from RTMPOutput's sender thread only.
+ */
+class RTMPPublisher {
+public:
+    // url: rtmp://host[:port]/app/stream
+    explicit RTMPPublisher(const std::string& url);
+    ~RTMPPublisher();
+
+    RTMPPublisher(const RTMPPublisher&) = delete;
+    RTMPPublisher& operator=(const RTMPPublisher&) = delete;
+
+    // URL parsed into host / port / app / stream
+    bool isValidUrl() const { return !host_.empty() && !app_.empty() && !stream_.empty(); }
+
+    // TCP connect, handshake and publish. Blocks up to timeout_ms.
+    bool connect(int timeout_ms);
+
+    // Unpublish (best effort) and close
+    void disconnect();
+
+    bool isPublishing() const { return publishing_; }
+
+    // Append one FLV tag to the send buffer as an audio / video message
+    void queueTag(const FLVTag& tag);
+
+    // Send the buffer. False (and disconnected) on error.
+    bool flush();
+
+    // Bytes waiting in the send buffer
+    size_t getQueuedBytes() const { return out_.size(); }
+
+    // Handle pending control messages without blocking. False (and
+    // disconnected) if the server closed the connection or failed the stream.
+    bool poll();
+
+    const std::string& getHost() const { return host_; }
+    uint16_t getPort() const { return port_; }
+    const std::string& getApp() const { return app_; }
+    const std::string& getStream() const { return stream_; }
+
+    // Statistics
+    uint64_t getBytesSent() const { return bytes_sent_; }
+    uint64_t getMessagesSent() const { return messages_sent_; }
+    uint64_t getSendCalls() const { return send_calls_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    bool openSocket(Clock::time_point deadline);
+    bool handshake(Clock::time_point deadline);
+    bool sendAll(const uint8_t* data, size_t size);
+    bool receive(Clock::time_point deadline);      // One recv() into the reader
+    void closeSocket();
+
+    void queueMessage(uint32_t chunk_stream_id, uint8_t type, uint32_t timestamp, uint32_t stream_id,
+                      const std::vector<uint8_t>& payload);
+    // name, transaction, null command object, string arguments
+    void queueCommand(const std::string& name, double transaction, uint32_t stream_id,
+                      const std::vector<std::string>& args);
+
+    // Read until _result / _error for `transaction` or an onStatus arrives
+    bool waitForResponse(double transaction, Clock::time_point deadline, std::vector<rtmp::AMFValue>& result);
+
+    // Control messages; commands are queued for waitForResponse()
+    void handleMessage(rtmp::Message& msg);
+
+    std::string url_;
+    std::string host_;
+    uint16_t port_;
+    std::string app_;
+    std::string stream_;
+    std::string tc_url_;
+
+    int fd_;
+    bool publishing_;
+    uint32_t stream_id_;
+
+    rtmp::ChunkWriter writer_;
+    rtmp::ChunkReader reader_;
+    std::vector<uint8_t> out_;
+    std::deque<rtmp::Message> commands_;
+
+    uint32_t window_ack_size_;
+    uint64_t bytes_received_;
+    uint64_t last_ack_;
+
+    uint64_t bytes_sent_;
+    uint64_t messages_sent_;
+    uint64_t send_calls_;
+
+    static constexpr uint16_t DEFAULT_PORT = 1935;
+    static constexpr uint32_t CHUNK_SIZE = 4096;
+    static constexpr int SEND_TIMEOUT_MS = 3000;
+    static constexpr int SEND_BUFFER_SIZE = 2 * 1024 * 1024;   // 2MB, like TCPOutput
+    static constexpr uint32_t CSID_CONTROL = 2;
+    static constexpr uint32_t CSID_COMMAND = 3;
+    static constexpr uint32_t CSID_AUDIO = 4;
+    static constexpr uint32_t CSID_DATA = 5;
+    static constexpr uint32_t CSID_VIDEO = 6;
+};
+
+#endif // RTMP_PUBLISHER_H
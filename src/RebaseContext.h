@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * RebaseContext - Per-source mapping from source timestamps to the output timeline
+ *
+ * One context per input (fallback, camera, drone). StreamSplicer::beginSegment()
+ * points it at the current end of the output timeline when a source goes on
+ * air; after that every packet from that source goes through it, the
+ * snapshot as well as steady-state packets.
+ *
+ * Source timestamps wrap: PTS/DTS are 33-bit 90 kHz (~26.5 hours), PCR is
+ * 33-bit base * 300 + 9-bit extension at 27 MHz (same period). Each map call
+ * unwraps the source value against a forward-moving anchor, so the offset
+ * from the base stays right across any number of wraps. Output values are
+ * kept unwrapped (64-bit) and only reduced modulo the field size when they
+ * are written into a packet.
+ *
+ * PTS and DTS of all PIDs share the program clock and hence one anchor;
+ * PCR has its own.
+ *
+ * Thread-safety: none, used from the main loop only.
+ */
+class RebaseContext {
+public:
+    static constexpr uint64_t PTS_MODULUS = 1ULL << 33;
+    static constexpr uint64_t PCR_MODULUS = PTS_MODULUS * 300;
+
+    /**
+     * Start mapping a source onto the output timeline
+     * @param pts_base Source PTS (90 kHz) that maps to pts_offset
+     * @param pcr_base Source PCR (27 MHz) that maps to pcr_offset
+     * @param pcr_pts_alignment Source PCR-to-PTS gap (27 MHz), informational
+     * @param pts_offset Output PTS at the splice point (unwrapped)
+     * @param pcr_offset Output PCR at the splice point (unwrapped)
+     */
+    void reset(uint64_t pts_base, uint64_t pcr_base, int64_t pcr_pts_alignment,
+               uint64_t pts_offset, uint64_t pcr_offset) {
+        pts_base_ = pts_base % PTS_MODULUS;
+        pcr_base_ = pcr_base % PCR_MODULUS;
+        pcr_pts_alignment_ = pcr_pts_alignment;
+        pts_offset_ = pts_offset;
+        pcr_offset_ = pcr_offset;
+        pts_anchor_src_ = pts_base_;
+        pts_anchor_rel_ = 0;
+        pcr_anchor_src_ = pcr_base_;
+        pcr_anchor_rel_ = 0;
+        identity_ = (pts_offset % PTS_MODULUS) == pts_base_ &&
+                    (pcr_offset % PCR_MODULUS) == pcr_base_;
+        active_ = true;
+    }
+
+    bool isActive() const { return active_; }
+
+    // Every timestamp maps onto itself (modulo the field size): the source
+    // is on air on its own timeline and its packets need no rewrite. True for
+    // the first segment and for any segment StreamSplicer::beginSegmentAtSource()
+    // put back on the source's own timestamps.
+    bool isIdentity() const { return identity_; }
+
+    // Map a source PTS/DTS to the output timeline (unwrapped, 90 kHz)
+    uint64_t mapPTS(uint64_t src_pts) {
+        int64_t rel = pts_anchor_rel_ + wrapDelta(src_pts, pts_anchor_src_, PTS_MODULUS);
+        if (rel > pts_anchor_rel_) {
+            pts_anchor_src_ = src_pts;
+            pts_anchor_rel_ = rel;
+        }
+        return static_cast<uint64_t>(static_cast<int64_t>(pts_offset_) + rel);
+    }
+
+    // Map a source PCR to the output timeline (unwrapped, 27 MHz)
+    uint64_t mapPCR(uint64_t src_pcr) {
+        int64_t rel = pcr_anchor_rel_ + wrapDelta(src_pcr, pcr_anchor_src_, PCR_MODULUS);
+        if (rel > pcr_anchor_rel_) {
+            pcr_anchor_src_ = src_pcr;
+            pcr_anchor_rel_ = rel;
+        }
+        return static_cast<uint64_t>(static_cast<int64_t>(pcr_offset_) + rel);
+    }
+
+    uint64_t getPTSBase() const { return pts_base_; }
+    uint64_t getPCRBase() const { return pcr_base_; }
+    uint64_t getPTSOffset() const { return pts_offset_; }
+    uint64_t getPCROffset() const { return pcr_offset_; }
+    int64_t getPCRPTSAlignment() const { return pcr_pts_alignment_; }
+
+private:
+    // Signed distance from `from` to `to` on a clock of the given modulus,
+    // taking the short way round (|delta| < modulus / 2)
+    static int64_t wrapDelta(uint64_t to, uint64_t from, uint64_t modulus) {
+        uint64_t d = (to % modulus + modulus - from) % modulus;
+        return d >= modulus / 2 ? static_cast<int64_t>(d) - static_cast<int64_t>(modulus)
+                                : static_cast<int64_t>(d);
+    }
+
+    uint64_t pts_base_ = 0;
+    uint64_t pcr_base_ = 0;
+    int64_t pcr_pts_alignment_ = 0;
+    uint64_t pts_offset_ = 0;
+    uint64_t pcr_offset_ = 0;
+
+    // Most recent forward-most source value and its distance from the base
+    uint64_t pts_anchor_src_ = 0;
+    int64_t pts_anchor_rel_ = 0;
+    uint64_t pcr_anchor_src_ = 0;
+    int64_t pcr_anchor_rel_ = 0;
+
+    bool active_ = false;
+    bool identity_ = false;
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <time.h>
+
+/**
+ * SequenceStamps - When packets of a sequence-numbered stream got somewhere
+ *
+ * A fixed ring of (end_seq, time) pairs: "every packet before end_seq had
+ * arrived / been written by time_ns". One stamp per read() or per write
+ * instead of per packet, so the cost is one clock read per batch. Looking
+ * up a packet finds the first stamp that covers it.
+ *
+ * Thread-safety: stamp() belongs to one writer thread; lookup() may run on
+ * any thread concurrently. Each entry is guarded like a seqlock (end_seq is
+ * invalidated while its time is rewritten), so a reader racing the writer
+ * sees either the old pair, the new one, or a miss - never a mix.
+ */
+class SequenceStamps {
+public:
+    static constexpr size_t CAPACITY = 4096;    // Power of two
+
+    enum class Lookup {
+        FOUND,      // time_ns is set
+        PENDING,    // Not stamped yet
+        EXPIRED     // Older than the stamps kept
+    };
+
+    // Packets before end_seq are complete at time_ns (end_seq non-decreasing)
+    void stamp(uint64_t end_seq, int64_t time_ns) {
+        uint64_t n = count_.load(std::memory_order_relaxed);
+        if (n > 0 && entries_[(n - 1) & (CAPACITY - 1)].end_seq.load(std::memory_order_relaxed) >= end_seq) {
+            return;     // Nothing new since the last stamp
+        }
+        Entry& e = entries_[n & (CAPACITY - 1)];
+        e.end_seq.store(INVALID, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        e.time_ns.store(time_ns, std::memory_order_relaxed);
+        e.end_seq.store(end_seq, std::memory_order_release);
+        count_.store(n + 1, std::memory_order_release);
+    }
+
+    // CLOCK_MONOTONIC in nanoseconds, the clock stamps are taken with
+    static int64_t nowNs() {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+    }
+
+    // Time the packet with sequence number seq was covered by a stamp
+    Lookup lookup(uint64_t seq, int64_t& time_ns) const {
+        uint64_t n = count_.load(std::memory_order_acquire);
+        if (n == 0) {
+            return Lookup::PENDING;
+        }
+        uint64_t lo = n > CAPACITY ? n - CAPACITY + 1 : 0;    // Oldest slot may be mid-rewrite
+        uint64_t hi = n;
+
+        uint64_t newest_seq;
+        int64_t newest_time;
+        if (!read(n - 1, newest_seq, newest_time) || newest_seq <= seq) {
+            return Lookup::PENDING;
+        }
+
+        // First stamp with end_seq > seq
+        while (lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            uint64_t end_seq;
+            int64_t t;
+            if (!read(mid, end_seq, t) || end_seq <= seq) {
+                lo = mid + 1;   // A torn slot is the oldest one being reused: too old
+            } else {
+                hi = mid;
+            }
+        }
+        uint64_t oldest = n > CAPACITY ? n - CAPACITY + 1 : 0;
+        if (lo == oldest && oldest > 0) {
+            return Lookup::EXPIRED;     // Could belong to an overwritten stamp
+        }
+        uint64_t end_seq;
+        if (lo >= n || !read(lo, end_seq, time_ns) || end_seq <= seq) {
+            return Lookup::EXPIRED;
+        }
+        // The writer may have lapped the search. Slots are rewritten in order,
+        // so if this one was, the one before it was too and no longer ends at
+        // or before seq.
+        uint64_t prev_end;
+        int64_t prev_time;
+        if (lo > 0 && (!read(lo - 1, prev_end, prev_time) || prev_end > seq)) {
+            return Lookup::EXPIRED;
+        }
+        return Lookup::FOUND;
+    }
+
+private:
+    static constexpr uint64_t INVALID = UINT64_MAX;
+
+    struct Entry {
+        std::atomic<uint64_t> end_seq{INVALID};
+        std::atomic<int64_t> time_ns{0};
+    };
+
+    bool read(uint64_t index, uint64_t& end_seq, int64_t& time_ns) const {
+        const Entry& e = entries_[index & (CAPACITY - 1)];
+        uint64_t before = e.end_seq.load(std::memory_order_acquire);
+        time_ns = e.time_ns.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        end_seq = e.end_seq.load(std::memory_order_relaxed);
+        return before != INVALID && before == end_seq;
+    }
+
+    std::array<Entry, CAPACITY> entries_;
+    std::atomic<uint64_t> count_{0};
+};
@@ -0,0 +1,280 @@
+#include "SrtInput.h"
+#include <iostream>
+#include <cstring>
+#include <mutex>
+#include <chrono>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+
+SrtInput::SrtInput(const std::string& name, const std::string& address, uint16_t port)
+    : StreamInput(name),
+      address_(address),
+      port_(port),
+      latency_ms_(DEFAULT_LATENCY_MS),
+      rcvbuf_bytes_(DEFAULT_RCVBUF_BYTES),
+      listener_(SRT_INVALID_SOCK),
+      caller_(SRT_INVALID_SOCK),
+      epoll_id_(-1),
+      event_fd_(-1),
+      watching_(false),
+      retransmitted_total_(0) {
+    // libsrt's global state is never torn down; it lives as long as the process
+    static std::once_flag srt_started;
+    std::call_once(srt_started, [] { srt_startup(); });
+}
+
+SrtInput::~SrtInput() {
+    // Normally the reactor closed us already
+    if (event_fd_ >= 0) {
+        closeSource(event_fd_);
+    }
+    closeListener();
+}
+
+StreamInput::OpenResult SrtInput::openSource(int& fd) {
+    // The listener stays bound across callers; only the first open binds it
+    if (listener_ == SRT_INVALID_SOCK && !openListener()) {
+        return OpenResult::FAILED;
+    }
+
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd_ < 0) {
+        std::cerr << "[" << name_ << "] Failed to create SRT wakeup: " << strerror(errno) << std::endl;
+        return OpenResult::FAILED;
+    }
+
+    caller_ = SRT_INVALID_SOCK;
+    retransmitted_total_ = 0;
+    watching_ = true;
+    watcher_ = std::thread(&SrtInput::watcherLoop, this);
+
+    std::cout << "[" << name_ << "] SRT listener ready (latency " << latency_ms_ << " ms), waiting for caller..."
+              << std::endl;
+    fd = event_fd_;
+    return OpenResult::READY;
+}
+
+bool SrtInput::openListener() {
+    std::cout << "[" << name_ << "] Opening SRT listener on " << address_ << ":" << port_ << std::endl;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port_);
+    if (inet_pton(AF_INET, address_.c_str(), &addr.sin_addr) != 1) {
+        std::cerr << "[" << name_ << "] Invalid IPv4 address: " << address_ << std::endl;
+        return false;
+    }
+
+    listener_ = srt_create_socket();
+    if (listener_ == SRT_INVALID_SOCK) {
+        std::cerr << "[" << name_ << "] Failed to create SRT socket: " << srt_getlasterror_str() << std::endl;
+        return false;
+    }
+
+    // Live mode first (it resets the other options to live defaults), then
+    // nonblocking receive; accepted sockets inherit all of these
+    SRT_TRANSTYPE transtype = SRTT_LIVE;
+    bool no = false;
+    if (srt_setsockflag(listener_, SRTO_TRANSTYPE, &transtype, sizeof(transtype)) == SRT_ERROR ||
+        srt_setsockflag(listener_, SRTO_RCVSYN, &no, sizeof(no)) == SRT_ERROR) {
+        std::cerr << "[" << name_ << "] Failed to set live mode: " << srt_getlasterror_str() << std::endl;
+        closeListener();
+        return false;
+    }
+    if (srt_setsockflag(listener_, SRTO_LATENCY, &latency_ms_, sizeof(latency_ms_)) == SRT_ERROR) {
+        std::cerr << "[" << name_ << "] Latency " << latency_ms_ << " ms refused, using the default: "
+                  << srt_getlasterror_str() << std::endl;
+    }
+    if (srt_setsockflag(listener_, SRTO_RCVBUF, &rcvbuf_bytes_, sizeof(rcvbuf_bytes_)) == SRT_ERROR) {
+        std::cerr << "[" << name_ << "] Receive buffer of " << rcvbuf_bytes_ << " bytes refused, using the default: "
+                  << srt_getlasterror_str() << std::endl;
+    }
+    // An unusable passphrase (libsrt takes 10 to 79 characters) must not
+    // leave the listener silently unencrypted
+    if (!passphrase_.empty() &&
+        srt_setsockflag(listener_, SRTO_PASSPHRASE, passphrase_.c_str(),
+                        static_cast<int>(passphrase_.size())) == SRT_ERROR) {
+        std::cerr << "[" << name_ << "] SRT passphrase refused (" << passphrase_.size()
+                  << " characters, needs 10-79): " << srt_getlasterror_str() << std::endl;
+        closeListener();
+        return false;
+    }
+
+    if (srt_bind(listener_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == SRT_ERROR ||
+        srt_listen(listener_, 1) == SRT_ERROR) {
+        std::cerr << "[" << name_ << "] Failed to listen on " << address_ << ":" << port_
+                  << ": " << srt_getlasterror_str() << std::endl;
+        closeListener();
+        return false;
+    }
+
+    epoll_id_ = srt_epoll_create();
+    int events = SRT_EPOLL_IN | SRT_EPOLL_ERR;
+    if (epoll_id_ < 0 || srt_epoll_add_usock(epoll_id_, listener_, &events) == SRT_ERROR) {
+        std::cerr << "[" << name_ << "] Failed to set up SRT wakeups: " << srt_getlasterror_str() << std::endl;
+        closeListener();
+        return false;
+    }
+    return true;
+}
+
+void SrtInput::closeListener() {
+    if (epoll_id_ >= 0) {
+        srt_epoll_release(epoll_id_);
+        epoll_id_ = -1;
+    }
+    if (listener_ != SRT_INVALID_SOCK) {
+        srt_close(listener_);
+        listener_ = SRT_INVALID_SOCK;
+    }
+}
+
+ssize_t SrtInput::readSource(int fd, uint8_t* buf, size_t len) {
+    // Consume the wakeup before draining, so a signal racing with the
+    // drain below leaves the eventfd readable
+    uint64_t count;
+    ssize_t ret = ::read(fd, &count, sizeof(count));
+    (void)ret;
+
+    SRTSOCKET caller = caller_.load();
+    if (caller == SRT_INVALID_SOCK) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    // One live-mode message per call; stop while a full one still fits
+    size_t total = 0;
+    bool lost = false;
+    while (len - total >= static_cast<size_t>(SRT_LIVE_MAX_PLSIZE)) {
+        int n = srt_recvmsg(caller, reinterpret_cast<char*>(buf + total), static_cast<int>(len - total));
+        if (n > 0) {
+            total += n;
+            continue;
+        }
+        if (srt_getlasterror(nullptr) != SRT_EASYNCRCV) {
+            lost = true;
+        }
+        break;
+    }
+
+    if (lost) {
+        std::cout << "[" << name_ << "] SRT caller disconnected: " << srt_getlasterror_str() << std::endl;
+        if (total == 0) {
+            return 0;   // EOF: the reactor closes and reopens the listener
+        }
+        signalReadable();   // Deliver what we have; EOF on the next call
+    } else if (len - total < static_cast<size_t>(SRT_LIVE_MAX_PLSIZE)) {
+        signalReadable();   // Buffer full, more may be queued (edge-triggered)
+    }
+
+    if (total == 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    return static_cast<ssize_t>(total);
+}
+
+void SrtInput::closeSource(int fd) {
+    watching_ = false;
+    if (watcher_.joinable()) {
+        watcher_.join();
+    }
+
+    // srt_close() also takes the caller out of the epoll set. The listener
+    // stays: libsrt frees a closed listener's port asynchronously, so
+    // re-binding it right away (the reactor reopens a lost connection at
+    // once) can fail, and a new caller can queue in the backlog meanwhile.
+    SRTSOCKET caller = caller_.exchange(SRT_INVALID_SOCK);
+    if (caller != SRT_INVALID_SOCK) {
+        srt_close(caller);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    event_fd_ = -1;
+}
+
+void SrtInput::signalReadable() {
+    uint64_t one = 1;
+    ssize_t ret = ::write(event_fd_, &one, sizeof(one));
+    (void)ret;
+}
+
+void SrtInput::acceptCaller() {
+    struct sockaddr_in peer;
+    int peer_len = sizeof(peer);
+    SRTSOCKET s = srt_accept(listener_, reinterpret_cast<struct sockaddr*>(&peer), &peer_len);
+    if (s == SRT_INVALID_SOCK) {
+        return;
+    }
+
+    char peer_str[INET_ADDRSTRLEN] = "?";
+    inet_ntop(AF_INET, &peer.sin_addr, peer_str, sizeof(peer_str));
+
+    if (caller_.load() != SRT_INVALID_SOCK) {
+        std::cerr << "[" << name_ << "] Refusing second SRT caller from " << peer_str << std::endl;
+        srt_close(s);
+        return;
+    }
+
+    int events = SRT_EPOLL_IN | SRT_EPOLL_ERR | SRT_EPOLL_ET;
+    srt_epoll_add_usock(epoll_id_, s, &events);
+    caller_ = s;
+    std::cout << "[" << name_ << "] SRT caller connected from " << peer_str << ":" << ntohs(peer.sin_port) << std::endl;
+    signalReadable();   // Data may have arrived before the socket was added
+}
+
+void SrtInput::pollStats() {
+    SRTSOCKET caller = caller_.load();
+    if (caller == SRT_INVALID_SOCK) {
+        return;
+    }
+
+    // clear = 1 resets the interval counters; retransmissions only exist as one
+    SRT_TRACEBSTATS perf;
+    if (srt_bstats(caller, &perf, 1) == SRT_ERROR) {
+        return;
+    }
+    retransmitted_total_ += perf.pktRcvRetrans;
+
+    TransportStats stats;
+    stats.valid = true;
+    stats.rtt_ms = perf.msRTT;
+    stats.retransmitted_packets = retransmitted_total_;
+    stats.lost_packets = perf.pktRcvLossTotal;
+    stats.dropped_packets = perf.pktRcvDropTotal;
+    stats.rcv_buffer_ms = perf.msRcvBuf;
+    int capacity = perf.byteRcvBuf + perf.byteAvailRcvBuf;
+    stats.rcv_buffer_fill = capacity > 0 ? static_cast<double>(perf.byteRcvBuf) / capacity : 0.0;
+    healthMetrics().recordTransportStats(stats);
+}
+
+void SrtInput::watcherLoop() {
+    auto next_stats = std::chrono::steady_clock::now();
+    SRT_EPOLL_EVENT ready[2];
+
+    while (watching_.load()) {
+        int n = srt_epoll_uwait(epoll_id_, ready, 2, WATCH_TIMEOUT_MS);
+        for (int i = 0; i < n; i++) {
+            if (ready[i].fd == listener_) {
+                acceptCaller();
+            } else if (ready[i].fd == caller_.load()) {
+                if (ready[i].events & SRT_EPOLL_ERR) {
+                    // Keep the broken socket out of the set; readSource() reports EOF
+                    srt_epoll_remove_usock(epoll_id_, ready[i].fd);
+                }
+                signalReadable();
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_stats) {
+            pollStats();
+            next_stats = now + std::chrono::milliseconds(STATS_INTERVAL_MS);
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef SRT_INPUT_H
+#define SRT_INPUT_H
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <srt/srt.h>
+#include "StreamInput.h"
+
+/**
+ * SrtInput - Built-in SRT listener for MPEG-TS (requires libsrt, HAVE_LIBSRT)
+ *
+ * Replaces the SRT -> ffmpeg -> named pipe -> FIFOInput chain with one
+ * in-process hop: the encoder connects as an SRT caller and its live-mode
+ * messages (7 TS packets each) go straight into the StreamInput pipeline.
+ *
+ * SRT sockets are not kernel descriptors, so the InputReactor cannot watch
+ * them directly. A small watcher thread waits in srt_epoll (edge-triggered)
+ * for the listener and the connection, and signals an eventfd; the eventfd
+ * is the descriptor the reactor watches, and readSource() drains the SRT
+ * socket with nonblocking srt_recvmsg(). The same thread accepts the caller
+ * (one at a time; others are refused) and polls srt_bstats() once a second
+ * into StreamHealthMetrics (RTT, retransmissions, loss, receive buffer).
+ *
+ * When the caller disconnects, readSource() reports EOF and the reactor
+ * closes and reopens the input. The listener itself is bound once and kept
+ * until destruction (see closeSource()); callers that connect while the
+ * input is closed wait in its backlog.
+ */
+class SrtInput : public StreamInput {
+public:
+    // address: local address to listen on ("0.0.0.0" for any)
+    SrtInput(const std::string& name, const std::string& address, uint16_t port);
+    ~SrtInput() override;
+
+    OpenResult openSource(int& fd) override;
+    ssize_t readSource(int fd, uint8_t* buf, size_t len) override;
+    void closeSource(int fd) override;
+    int getReconnectDelayMs() const override { return SRT_RECONNECT_DELAY_MS; }
+
+    // The descriptor is only a wakeup; the data comes from the SRT socket
+    bool allowsDirectRead() const override { return false; }
+
+    // Configuration (before the reactor opens the listener)
+    void setLatencyMs(int latency_ms) { latency_ms_ = latency_ms; }
+    void setReceiveBufferSize(int bytes) { rcvbuf_bytes_ = bytes; }
+    void setPassphrase(const std::string& passphrase) { passphrase_ = passphrase; }
+
+private:
+    bool openListener();
+    void closeListener();
+    void watcherLoop();
+    void acceptCaller();
+    void pollStats();
+    void signalReadable();
+
+    std::string address_;
+    uint16_t port_;
+    int latency_ms_;
+    int rcvbuf_bytes_;
+    std::string passphrase_;
+
+    SRTSOCKET listener_;
+    std::atomic<SRTSOCKET> caller_;     // Connected caller, or SRT_INVALID_SOCK
+    int epoll_id_;
+    int event_fd_;
+    std::thread watcher_;
+    std::atomic<bool> watching_;
+
+    // Totals for the connection (srt_bstats() interval counters, summed)
+    uint64_t retransmitted_total_;
+
+    static constexpr int SRT_RECONNECT_DELAY_MS = 1000;
+    static constexpr int DEFAULT_LATENCY_MS = 80;
+    static constexpr int DEFAULT_RCVBUF_BYTES = 8 * 1024 * 1024;   // 8MB
+    static constexpr int WATCH_TIMEOUT_MS = 100;
+    static constexpr int STATS_INTERVAL_MS = 1000;
+};
+
+#endif // SRT_INPUT_H
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstdint>
+#include <cstdlib>
 #include <atomic>
-#include <deque>
 #include <mutex>
 
 /**
@@ -18,78 +21,140 @@ struct StreamHealthConfig {
     
     // Window size for bitrate calculation (seconds)
     int bitrate_window_seconds = 3;
+    
+    // Longest gap between reads allowed within the window (ms)
+    // 0 = disabled
+    int64_t max_gap_ms = 0;
+    
+    // Lowest transport (TR 101 290) score, 0-100, for a healthy stream
+    // 0 = disabled
+    int min_transport_score = 0;
+};
+
+/**
+ * Transport-level statistics for inputs whose protocol has them (SRT).
+ * Counters are totals for the current connection.
+ */
+struct TransportStats {
+    bool valid = false;                 // false for pipes / TCP / UDP
+    double rtt_ms = 0.0;                // Smoothed round-trip time
+    uint64_t retransmitted_packets = 0; // Retransmissions received
+    uint64_t lost_packets = 0;          // Detected as lost (may be recovered)
+    uint64_t dropped_packets = 0;       // Too late / unrecoverable, never delivered
+    int rcv_buffer_ms = 0;              // Data held in the receive buffer (latency budget in use)
+    double rcv_buffer_fill = 0.0;       // Receive buffer occupancy, 0..1
 };
 
 /**
  * Tracks stream health metrics for an input source.
- * Thread-safe for concurrent read/write access.
+ * Thread-safe for concurrent read/write access without locks: one writer
+ * (the reactor thread) records, any thread queries.
  * 
- * Monitors two key health indicators:
- * 1. Data freshness - time since last packet received
- * 2. Bitrate - rolling average of bytes per second
+ * Monitors:
+ * 1. Data freshness - time since last data received
+ * 2. Bitrate / packet rate - over the last bitrate_window_seconds
+ * 3. Arrival regularity - longest gap between reads in the window, and
+ *    jitter (smoothed variation between consecutive gaps, as in RFC 3550)
+ * 
+ * Rates come from a time wheel of BUCKET_MS buckets built on relaxed
+ * atomics: recording touches one bucket, a query sums the window's buckets
+ * (a fixed count), neither takes a lock. A bucket being recycled while a
+ * query reads it is either skipped or counted - the estimate may be off by
+ * one bucket for that one query.
  * 
  * Usage:
  *   health_metrics_.configure(config);
  *   // On data received:
- *   health_metrics_.recordDataReceived(num_bytes);
+ *   health_metrics_.recordDataReceived(num_bytes, num_packets);
  *   // Check health:
  *   if (!health_metrics_.isHealthy()) { switch_to_fallback(); }
  */
 class StreamHealthMetrics {
 public:
+    static constexpr int64_t BUCKET_MS = 100;
+    static constexpr size_t WHEEL_BUCKETS = 256;    // Longest window: 25.6 s
+    
     StreamHealthMetrics() = default;
     
-    // Configure thresholds (call once at setup)
+    // Configure thresholds (call once at setup, before data flows)
     void configure(const StreamHealthConfig& config) {
         config_ = config;
+        int64_t max_seconds = static_cast<int64_t>(WHEEL_BUCKETS - 1) * BUCKET_MS / 1000;
+        config_.bitrate_window_seconds = static_cast<int>(
+            std::clamp<int64_t>(config.bitrate_window_seconds, 1, max_seconds));
     }
     
-    // Called when data is received
-    void recordDataReceived(size_t bytes) {
-        auto now = std::chrono::steady_clock::now();
-        last_data_time_.store(now, std::memory_order_relaxed);
+    // Called when data is received (writer thread only)
+    void recordDataReceived(size_t bytes, size_t packets) {
+        int64_t now_ns = nowNs();
         total_bytes_received_.fetch_add(bytes, std::memory_order_relaxed);
         
-        // Record in rolling window for bitrate calculation
-        std::lock_guard<std::mutex> lock(window_mutex_);
-        data_window_.push_back({now, bytes});
+        // Inter-arrival gap and its jitter
+        int64_t gap_us = 0;
+        int64_t last_ns = last_data_ns_.load(std::memory_order_relaxed);
+        if (last_ns != 0) {
+            gap_us = (now_ns - last_ns) / 1000;
+            if (has_last_gap_) {
+                // J += (|D| - J) / 16, kept scaled by 16 so small variations aren't truncated away
+                int64_t jitter16 = jitter_us16_.load(std::memory_order_relaxed);
+                jitter16 += std::llabs(gap_us - last_gap_us_) - ((jitter16 + 8) >> 4);
+                jitter_us16_.store(jitter16, std::memory_order_relaxed);
+            }
+            last_gap_us_ = gap_us;
+            has_last_gap_ = true;
+        }
+        last_data_ns_.store(now_ns, std::memory_order_relaxed);
         
-        // Trim old entries outside the window
-        auto cutoff = now - std::chrono::seconds(config_.bitrate_window_seconds);
-        while (!data_window_.empty() && data_window_.front().time < cutoff) {
-            data_window_.pop_front();
+        // Time wheel: recycle the bucket if it still holds an older period
+        uint64_t epoch = static_cast<uint64_t>(now_ns / (BUCKET_MS * 1000000));
+        Bucket& bucket = wheel_[epoch % WHEEL_BUCKETS];
+        if (bucket.epoch.load(std::memory_order_relaxed) != epoch) {
+            bucket.bytes.store(0, std::memory_order_relaxed);
+            bucket.packets.store(0, std::memory_order_relaxed);
+            bucket.max_gap_us.store(0, std::memory_order_relaxed);
+            bucket.epoch.store(epoch, std::memory_order_release);
+        }
+        bucket.bytes.store(bucket.bytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+        bucket.packets.store(bucket.packets.load(std::memory_order_relaxed) + packets, std::memory_order_relaxed);
+        if (gap_us > bucket.max_gap_us.load(std::memory_order_relaxed)) {
+            bucket.max_gap_us.store(gap_us, std::memory_order_relaxed);
         }
     }
     
     // Get time since last data in milliseconds
     int64_t getMsSinceLastData() const {
-        auto last = last_data_time_.load(std::memory_order_relaxed);
-        if (last == std::chrono::steady_clock::time_point{}) {
+        int64_t last_ns = last_data_ns_.load(std::memory_order_relaxed);
+        if (last_ns == 0) {
             return -1;  // No data received yet
         }
-        auto now = std::chrono::steady_clock::now();
-        return std::chrono::duration_cast<std::chrono::milliseconds>(now - last).count();
+        return (nowNs() - last_ns) / 1000000;
     }
     
     // Get current bitrate in bytes per second (rolling average)
     uint64_t getCurrentBitrateBps() const {
-        std::lock_guard<std::mutex> lock(window_mutex_);
-        
-        if (data_window_.empty()) {
-            return 0;
-        }
-        
-        auto now = std::chrono::steady_clock::now();
-        auto window_start = now - std::chrono::seconds(config_.bitrate_window_seconds);
-        
-        uint64_t total_bytes = 0;
-        for (const auto& entry : data_window_) {
-            if (entry.time >= window_start) {
-                total_bytes += entry.bytes;
-            }
+        WindowTotals totals = windowTotals();
+        return totals.bytes * 1000 / totals.span_ms;
+    }
+    
+    // TS packets per second (rolling average)
+    uint64_t getPacketRate() const {
+        WindowTotals totals = windowTotals();
+        return totals.packets * 1000 / totals.span_ms;
+    }
+    
+    // Longest gap between reads within the window, including the one still
+    // open since the last read (ms). -1 before any data.
+    int64_t getMaxGapMs() const {
+        int64_t since_last = getMsSinceLastData();
+        if (since_last < 0) {
+            return -1;
         }
-        
-        return total_bytes / config_.bitrate_window_seconds;
+        return std::max(windowTotals().max_gap_us / 1000, since_last);
+    }
+    
+    // Smoothed variation between consecutive inter-arrival gaps (microseconds)
+    int64_t getJitterUs() const {
+        return jitter_us16_.load(std::memory_order_relaxed) >> 4;
     }
     
     // Check if data is fresh (within max_data_age_ms)
@@ -107,9 +172,17 @@ public:
         return getCurrentBitrateBps() >= config_.min_bitrate_bps;
     }
     
+    // Check that no gap within the window exceeded max_gap_ms
+    bool isGapHealthy() const {
+        if (config_.max_gap_ms == 0) {
+            return true;  // Gap check disabled
+        }
+        return getMaxGapMs() <= config_.max_gap_ms;
+    }
+    
     // Combined health check
     bool isHealthy() const {
-        return isDataFresh() && isBitrateHealthy();
+        return isDataFresh() && isBitrateHealthy() && isGapHealthy();
     }
     
     // Get total bytes received
@@ -117,24 +190,82 @@ public:
         return total_bytes_received_.load(std::memory_order_relaxed);
     }
     
-    // Reset all metrics (for reconnection scenarios)
+    // Latest transport statistics (from the input's own stats poll)
+    void recordTransportStats(const TransportStats& stats) {
+        std::lock_guard<std::mutex> lock(transport_mutex_);
+        transport_stats_ = stats;
+    }
+    
+    TransportStats getTransportStats() const {
+        std::lock_guard<std::mutex> lock(transport_mutex_);
+        return transport_stats_;
+    }
+    
+    // Reset all metrics (for reconnection scenarios; writer thread)
     void reset() {
-        last_data_time_.store({}, std::memory_order_relaxed);
+        last_data_ns_.store(0, std::memory_order_relaxed);
         total_bytes_received_.store(0, std::memory_order_relaxed);
-        std::lock_guard<std::mutex> lock(window_mutex_);
-        data_window_.clear();
+        jitter_us16_.store(0, std::memory_order_relaxed);
+        has_last_gap_ = false;
+        last_gap_us_ = 0;
+        for (Bucket& bucket : wheel_) {
+            bucket.epoch.store(NO_EPOCH, std::memory_order_release);
+        }
+        std::lock_guard<std::mutex> lock(transport_mutex_);
+        transport_stats_ = TransportStats();
     }
     
 private:
-    struct DataPoint {
-        std::chrono::steady_clock::time_point time;
-        size_t bytes;
+    struct Bucket {
+        std::atomic<uint64_t> epoch{NO_EPOCH};      // now / BUCKET_MS when last recycled
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> packets{0};
+        std::atomic<int64_t> max_gap_us{0};
     };
     
+    struct WindowTotals {
+        uint64_t bytes = 0;
+        uint64_t packets = 0;
+        int64_t max_gap_us = 0;
+        uint64_t span_ms = 1;       // Time the buckets cover, the current one only in part
+    };
+    
+    // Sum of the buckets inside the window (the current one included)
+    WindowTotals windowTotals() const {
+        WindowTotals totals;
+        int64_t now_ns = nowNs();
+        uint64_t now_epoch = static_cast<uint64_t>(now_ns / (BUCKET_MS * 1000000));
+        uint64_t count = static_cast<uint64_t>(config_.bitrate_window_seconds) * 1000 / BUCKET_MS;
+        totals.span_ms = (count - 1) * BUCKET_MS + static_cast<uint64_t>(now_ns / 1000000 % BUCKET_MS) + 1;
+        for (uint64_t i = 0; i < count; i++) {
+            uint64_t epoch = now_epoch - i;
+            const Bucket& bucket = wheel_[epoch % WHEEL_BUCKETS];
+            if (bucket.epoch.load(std::memory_order_acquire) != epoch) {
+                continue;   // Nothing recorded in that period
+            }
+            totals.bytes += bucket.bytes.load(std::memory_order_relaxed);
+            totals.packets += bucket.packets.load(std::memory_order_relaxed);
+            totals.max_gap_us = std::max(totals.max_gap_us, bucket.max_gap_us.load(std::memory_order_relaxed));
+        }
+        return totals;
+    }
+    
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    
+    static constexpr uint64_t NO_EPOCH = UINT64_MAX;
+    
     StreamHealthConfig config_;
-    std::atomic<std::chrono::steady_clock::time_point> last_data_time_{};
+    std::atomic<int64_t> last_data_ns_{0};
     std::atomic<uint64_t> total_bytes_received_{0};
+    std::atomic<int64_t> jitter_us16_{0};  // Jitter x16
+    int64_t last_gap_us_ = 0;       // Writer thread only
+    bool has_last_gap_ = false;
+    
+    std::array<Bucket, WHEEL_BUCKETS> wheel_;
     
-    mutable std::mutex window_mutex_;
-    std::deque<DataPoint> data_window_;
+    mutable std::mutex transport_mutex_;
+    TransportStats transport_stats_;
 };
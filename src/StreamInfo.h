@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <tsduck.h>
+
+// Stream information extracted from TS stream
+struct StreamInfo {
+    ts::PID video_pid = ts::PID_NULL;
+    ts::PID audio_pid = ts::PID_NULL;
+    ts::PID pcr_pid = ts::PID_NULL;
+    ts::PID pmt_pid = ts::PID_NULL;
+    uint16_t program_number = 0;
+    uint8_t video_stream_type = 0;
+    uint8_t audio_stream_type = 0;
+    bool initialized = false;
+};
+
+// A ring position where output can start cleanly: the PES carrying an IDR
+// access unit, and the first audio PES after it. Indices are PacketRing
+// sequence numbers. Timestamps and parameter sets are captured by the
+// reader thread as the packets arrive, so a switch never re-scans the ring.
+struct CleanPoint {
+    uint64_t idr_index = 0;
+    uint64_t audio_index = 0;       // == idr_index when the stream has no audio
+    std::chrono::steady_clock::time_point detected_at;
+
+    uint64_t video_pts = 0;         // PTS of the IDR PES
+    uint64_t audio_pts = 0;         // PTS of the audio PES at audio_index
+    uint64_t pcr = 0;               // First PCR at or after the IDR PES
+    bool has_video_pts = false;
+    bool has_audio_pts = false;
+    bool has_pcr = false;
+    std::vector<uint8_t> sps;       // Most recent parameter sets at this IDR
+    std::vector<uint8_t> pps;
+};
@@ -0,0 +1,1139 @@
+#include "StreamInput.h"
+#include "TSStreamReassembler.h"
+#include "NALParser.h"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <cstdlib>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+
+// Helper function to extract PTS from PES header
+static bool extractPTS(const uint8_t* pes, size_t size, uint64_t& pts) {
+    if (size < 14) return false;
+    if (pes[0] != 0x00 || pes[1] != 0x00 || pes[2] != 0x01) return false;
+    
+    uint8_t pts_dts_flags = (pes[7] >> 6) & 0x03;
+    if (pts_dts_flags == 0x02 || pts_dts_flags == 0x03) {
+        pts = ((uint64_t)(pes[9] & 0x0E) << 29) |
+              ((uint64_t)(pes[10]) << 22) |
+              ((uint64_t)(pes[11] & 0xFE) << 14) |
+              ((uint64_t)(pes[12]) << 7) |
+              ((uint64_t)(pes[13] >> 1));
+        return true;
+    }
+    return false;
+}
+
+static constexpr uint64_t PTS_MODULUS = 1ULL << 33;
+
+// Signed distance from b to a on the 33-bit PTS clock
+static int64_t ptsDelta(uint64_t a, uint64_t b) {
+    int64_t delta = static_cast<int64_t>((a - b) & (PTS_MODULUS - 1));
+    return delta >= static_cast<int64_t>(PTS_MODULUS / 2) ? delta - static_cast<int64_t>(PTS_MODULUS) : delta;
+}
+
+namespace {
+
+// PAT/PMT handler
+class StreamAnalyzer : public ts::TableHandlerInterface {
+public:
+    StreamInfo& info;
+    bool& foundPAT;
+    bool& foundPMT;
+    ts::DuckContext& duck;
+    
+    StreamAnalyzer(StreamInfo& si, bool& pat, bool& pmt, ts::DuckContext& d)
+        : info(si), foundPAT(pat), foundPMT(pmt), duck(d) {}
+    
+    virtual void handleTable(ts::SectionDemux&, const ts::BinaryTable& table) override {
+        if (table.tableId() == ts::TID_PAT && !foundPAT) {
+            ts::PAT pat(duck, table);
+            if (pat.isValid() && !pat.pmts.empty()) {
+                auto it = pat.pmts.begin();
+                info.program_number = it->first;
+                info.pmt_pid = it->second;
+                foundPAT = true;
+            }
+        }
+        else if (table.tableId() == ts::TID_PMT && !foundPMT) {
+            ts::PMT pmt(duck, table);
+            if (pmt.isValid()) {
+                info.pcr_pid = pmt.pcr_pid;
+                for (const auto& stream : pmt.streams) {
+                    if (stream.second.stream_type == 0x1B || stream.second.stream_type == 0x24) {
+                        info.video_pid = stream.first;
+                        info.video_stream_type = stream.second.stream_type;
+                    } else if (stream.second.stream_type == 0x0F ||
+                             stream.second.stream_type == 0x03 ||
+                             stream.second.stream_type == 0x81) {
+                        info.audio_pid = stream.first;
+                        info.audio_stream_type = stream.second.stream_type;
+                    }
+                }
+                foundPMT = true;
+            }
+        }
+    }
+};
+
+} // namespace
+
+// Parsing state for one connection. Lived on the reader thread's stack
+// while every input had its own thread; now it has to survive between reads.
+struct StreamInput::IngestState {
+    ts::DuckContext duck;
+    ts::SectionDemux demux;
+    bool foundPAT = false;
+    bool foundPMT = false;
+    StreamAnalyzer analyzer;
+    NALStartCodeScanner idr_scanner;
+    TSStreamReassembler reassembler;
+    size_t total_packets_in_connection = 0;
+    size_t sync_losses_seen = 0;    // Reassembler's count at the last read
+    uint64_t pes_start_index = 0;
+    
+    // Timestamps of the current video PES, captured as it arrives so each
+    // clean point carries its own bases (see extractTimestampBases)
+    uint64_t pes_pts = 0;
+    bool pes_has_pts = false;
+    uint64_t pes_pcr = 0;           // First PCR at or after the PES start
+    bool pes_has_pcr = false;
+    bool clean_point_needs_pcr = false;
+    NALParser param_parser;         // Keeps the most recent SPS/PPS
+    std::vector<uint8_t> access_unit;
+    bool frame_indexed = false;     // Current video PES is the newest frame index entry
+    
+    explicit IngestState(StreamInfo& info)
+        : demux(duck),
+          analyzer(info, foundPAT, foundPMT, duck) {
+        demux.setTableHandler(&analyzer);
+        demux.addPID(ts::PID_PAT);
+    }
+};
+
+StreamInput::StreamInput(const std::string& name)
+    : name_(name),
+      connected_(false),
+      pids_ready_(false),
+      idr_ready_(false),
+      audio_ready_(false),
+      audio_sync_ready_(false),
+      first_packet_received_(false),
+      rolling_buffer_(RING_CAPACITY),
+      idr_found_(false),
+      idr_index_(0),
+      latest_idr_index_(0),
+      audio_sync_index_(0),
+      clean_point_policy_(CleanPointPolicy::NEWEST),
+      target_latency_ms_(DEFAULT_TARGET_LATENCY_MS),
+      added_latency_ms_(-1),
+      clean_point_pending_(false),
+      consume_index_(0),
+      last_snapshot_end_(0),
+      max_buffer_packets_(MAX_BUFFER_PACKETS),
+      pts_base_(0),
+      audio_pts_base_(0),
+      pcr_base_(0),
+      pcr_pts_alignment_offset_(0),
+      total_packets_received_(0),
+      last_progress_report_(std::chrono::steady_clock::now()),
+      passthrough_requested_(false),
+      passthrough_active_(false),
+      passthrough_disabled_(false),
+      passthrough_start_seq_(0),
+      passthrough_end_seq_(0),
+      passthrough_flushed_seq_(UINT64_MAX),
+      passthrough_bytes_(0),
+      passthrough_target_fd_(-1),
+      tee_in_fd_(-1),
+      tee_partial_(0),
+      last_passthrough_count_(0),
+      latency_tracking_(false),
+      last_batch_seq_(0) {
+}
+
+StreamInput::~StreamInput() = default;
+
+bool StreamInput::finishOpen(int) {
+    return true;
+}
+
+ssize_t StreamInput::readSource(int fd, uint8_t* buf, size_t len) {
+    return ::read(fd, buf, len);
+}
+
+void StreamInput::closeSource(int fd) {
+    ::close(fd);
+}
+
+void StreamInput::handleOpened() {
+    // Reset state for new connection
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        rolling_buffer_.clear();
+        uint64_t start = rolling_buffer_.headSequence();
+        idr_found_ = false;
+        idr_index_ = start;
+        latest_idr_index_ = start;
+        audio_sync_index_ = start;
+        clean_points_.clear();
+        clean_point_pending_ = false;
+        frame_index_.clear();
+        // consume_index_ belongs to the main loop; it is clamped to the
+        // (now empty) ring on its next receivePackets()
+    }
+    pids_ready_ = false;
+    idr_ready_ = false;
+    audio_ready_ = false;
+    audio_sync_ready_ = false;
+    first_packet_received_ = false;
+    
+    // Reset health metrics for new connection
+    health_metrics_.reset();
+    transport_analyzer_.reset(SequenceStamps::nowNs());
+    
+    ingest_ = std::make_unique<IngestState>(discovered_info_);
+    last_progress_report_ = std::chrono::steady_clock::now();
+    connection_start_time_ = std::chrono::steady_clock::now();
+}
+
+bool StreamInput::handleReadable(int fd, uint8_t* scratch, size_t scratch_size) {
+    size_t batch_packets = 0;
+    bool open = true;
+    
+    // Level-triggered: whatever is left after the cap is picked up on the
+    // reactor's next pass, after the other inputs had their turn
+    for (int reads = 0; reads < MAX_READS_PER_WAKEUP; reads++) {
+        size_t want = scratch_size;
+        std::unique_lock<std::mutex> tee_lock;
+        if (passthrough_requested_.load()) {
+            tee_lock = std::unique_lock<std::mutex>(tee_mutex_);
+            if (!prepareTee(fd, want)) break;
+        }
+        
+        ssize_t n = readSource(fd, scratch, want);
+        
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            std::cerr << "[" << name_ << "] Read error: " << strerror(errno) << std::endl;
+            open = false;
+            break;
+        }
+        
+        if (n == 0) {
+            // EOF - writer closed the pipe / peer closed the connection
+            std::cout << "[" << name_ << "] EOF (writer disconnected)" << std::endl;
+            open = false;
+            break;
+        }
+        
+        batch_packets += ingestBytes(scratch, n);
+        
+        // A short read means the source is drained; skip the EAGAIN round trip
+        if ((size_t)n < want) break;
+    }
+    
+    // One wakeup per readiness event, and only if the main loop is waiting
+    if (batch_packets > 0) {
+        data_signal_.notify();
+    }
+    return open;
+}
+
+void StreamInput::handleData(const uint8_t* data, size_t len) {
+    if (ingestBytes(data, len) > 0) {
+        data_signal_.notify();
+    }
+}
+
+size_t StreamInput::ingestBytes(const uint8_t* data, size_t len) {
+    IngestState& st = *ingest_;
+    
+    if (!connected_.load()) {
+        connected_ = true;
+    }
+    
+    int64_t read_ns = SequenceStamps::nowNs();
+    
+    // Feed data to reassembler. Aligned packets are handed to the
+    // callback straight out of the read buffer, without an intermediate copy
+    size_t packets_in = 0;
+    st.reassembler.addData(data, len, [&](const ts::TSPacket* packets, size_t count) {
+        packets_in += count;
+        for (size_t i = 0; i < count; i++) {
+            transport_analyzer_.feedPacket(packets[i].b, read_ns);
+            processPacket(packets[i], st);
+        }
+    });
+    if (latency_tracking_.load(std::memory_order_relaxed) && packets_in > 0) {
+        ingest_stamps_.stamp(rolling_buffer_.headSequence(), read_ns);
+    }
+    
+    size_t sync_losses = st.reassembler.getSyncLosses();
+    transport_analyzer_.recordRead(read_ns, sync_losses - st.sync_losses_seen,
+                                   st.reassembler.getCurrentState() == TSStreamReassembler::State::SYNCED);
+    st.sync_losses_seen = sync_losses;
+    
+    // Record data received for health monitoring
+    health_metrics_.recordDataReceived(len, packets_in);
+    return packets_in;
+}
+
+void StreamInput::handleClosed() {
+    {
+        std::lock_guard<std::mutex> lock(tee_mutex_);
+        if (passthrough_active_.load()) {
+            // The rest of a split packet will never arrive
+            completeTeePacket(-1);
+            endPassthrough("source closed");
+        }
+    }
+    connected_ = false;
+    if (ingest_) {
+        std::cout << "[" << name_ << "] Stream processing ended" << std::endl;
+        std::cout << "[" << name_ << "] Total packets in connection: "
+                  << ingest_->total_packets_in_connection << std::endl;
+        ingest_.reset();
+    }
+}
+
+// Called with tee_mutex_ held before each read while passthrough is
+// requested. Narrows want to what the read may consume; false = nothing to
+// read now.
+bool StreamInput::prepareTee(int fd, size_t& want) {
+    if (!passthrough_active_.load()) {
+        if (!passthrough_requested_.load()) {
+            return true;
+        }
+        
+        const TSStreamReassembler& reassembler = ingest_->reassembler;
+        size_t pending = reassembler.getPendingBytes();
+        bool synced = reassembler.getCurrentState() == TSStreamReassembler::State::SYNCED;
+        
+        // Take over only on a packet boundary, with the main loop's output
+        // complete up to the ring head
+        if (!synced || pending != 0 ||
+            passthrough_flushed_seq_.load() != rolling_buffer_.headSequence()) {
+            // Read up to a packet boundary so one comes up
+            int avail = 0;
+            if (synced && ioctl(fd, FIONREAD, &avail) == 0 && avail > 0) {
+                size_t limit = std::min(want, static_cast<size_t>(avail));
+                size_t aligned = (pending + limit) / ts::PKT_SIZE * ts::PKT_SIZE;
+                if (aligned > pending) {
+                    want = aligned - pending;
+                }
+            }
+            return true;
+        }
+        
+        passthrough_start_seq_ = rolling_buffer_.headSequence();
+        passthrough_end_seq_ = UINT64_MAX;
+        tee_in_fd_ = fd;
+        tee_partial_ = 0;
+        passthrough_active_ = true;
+        std::cout << "[" << name_ << "] Passthrough started at packet " << passthrough_start_seq_.load()
+                  << " (tee into output pipe)" << std::endl;
+    }
+    
+    // Duplicate what is about to be read into the output, then read exactly that
+    ssize_t t = tee(fd, passthrough_target_fd_, want, SPLICE_F_NONBLOCK);
+    if (t > 0) {
+        tee_partial_ = (tee_partial_ + t) % ts::PKT_SIZE;
+        passthrough_bytes_ += t;
+        want = static_cast<size_t>(t);
+        return true;
+    }
+    if (t == 0) {
+        return true;    // EOF, the read reports it
+    }
+    
+    int err = errno;
+    if (err == EINTR) {
+        return false;   // Level-triggered: picked up on the next pass
+    }
+    if (err == EAGAIN) {
+        int avail = 0;
+        if (ioctl(fd, FIONREAD, &avail) != 0 || avail <= 0) {
+            return false;   // Input drained
+        }
+        // Output pipe full. Hand it back rather than stall every input on
+        // the reactor thread; the main loop absorbs the backpressure.
+        completeTeePacket(fd);
+        endPassthrough("output pipe full");
+        return true;
+    }
+    
+    if (err == EINVAL) {
+        passthrough_disabled_ = true;   // Not a pipe; don't try again
+    }
+    completeTeePacket(fd);
+    endPassthrough(strerror(err));
+    return true;
+}
+
+// Finish a packet whose first bytes were already tee'd, so the output stays
+// packet-aligned when the main loop takes over. Waits briefly for the rest;
+// failing that (or with fd < 0) the packet is padded with 0xFF and the
+// stray copy is skipped when it arrives. tee_mutex_ held.
+bool StreamInput::completeTeePacket(int fd) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(TEE_COMPLETE_TIMEOUT_MS);
+    uint8_t rest[ts::PKT_SIZE];
+    
+    while (fd >= 0 && tee_partial_ != 0) {
+        size_t need = ts::PKT_SIZE - tee_partial_;
+        ssize_t t = tee(fd, passthrough_target_fd_, need, SPLICE_F_NONBLOCK);
+        if (t > 0) {
+            // tee() does not consume: read the same bytes before the next one
+            ssize_t n = readSource(fd, rest, static_cast<size_t>(t));
+            if (n != t) {
+                break;
+            }
+            passthrough_bytes_ += t;
+            tee_partial_ = (tee_partial_ + t) % ts::PKT_SIZE;
+            if (ingestBytes(rest, static_cast<size_t>(n)) > 0) {
+                data_signal_.notify();
+            }
+            continue;
+        }
+        if (t == 0 || (errno != EAGAIN && errno != EINTR)) {
+            break;
+        }
+        
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            break;
+        }
+        struct pollfd fds[2] = {{fd, POLLIN, 0}, {passthrough_target_fd_, POLLOUT, 0}};
+        poll(fds, 2, static_cast<int>(left.count()));
+    }
+    
+    if (tee_partial_ == 0) {
+        return true;
+    }
+    
+    size_t pad = ts::PKT_SIZE - tee_partial_;
+    std::memset(rest, 0xFF, pad);
+    size_t written = 0;
+    while (written < pad) {
+        ssize_t w = ::write(passthrough_target_fd_, rest + written, pad - written);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) break;
+        written += w;
+    }
+    std::cerr << "[" << name_ << "] Passthrough ended mid-packet, padded "
+              << pad << " bytes" << std::endl;
+    return false;
+}
+
+// Hand the output back to the main loop. tee_mutex_ held.
+void StreamInput::endPassthrough(const char* reason) {
+    // A padded packet went out already; its real bytes are still to be read
+    uint64_t end = rolling_buffer_.headSequence() + (tee_partial_ != 0 ? 1 : 0);
+    passthrough_end_seq_ = end;
+    tee_partial_ = 0;
+    tee_in_fd_ = -1;
+    passthrough_active_ = false;
+    passthrough_requested_ = false;
+    std::cout << "[" << name_ << "] Passthrough ended at packet " << end << " (" << reason << "), "
+              << (end - passthrough_start_seq_.load()) << " packets tee'd" << std::endl;
+}
+
+bool StreamInput::startPassthrough(int output_fd) {
+    if (!supportsPassthrough() || passthrough_disabled_.load() || output_fd < 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(tee_mutex_);
+    passthrough_target_fd_ = output_fd;
+    passthrough_flushed_seq_ = UINT64_MAX;
+    passthrough_requested_ = true;
+    return true;
+}
+
+void StreamInput::stopPassthrough() {
+    std::lock_guard<std::mutex> lock(tee_mutex_);
+    if (passthrough_active_.load()) {
+        completeTeePacket(tee_in_fd_);
+        endPassthrough("switch");
+    }
+    passthrough_requested_ = false;
+}
+
+// Consumption restarts (a switch): packets tee'd by an earlier passthrough
+// may be consumed again and must be written this time
+void StreamInput::forgetPassthroughRange() {
+    if (!passthrough_requested_.load()) {
+        passthrough_start_seq_ = 0;
+        passthrough_end_seq_ = 0;
+    }
+}
+
+void StreamInput::markOutputFlushed() {
+    if (passthrough_requested_.load() && !passthrough_active_.load()) {
+        passthrough_flushed_seq_ = consume_index_;
+    }
+}
+
+void StreamInput::processPacket(const ts::TSPacket& pkt, IngestState& st) {
+    st.total_packets_in_connection++;
+    
+    if (!first_packet_received_.load()) {
+        first_packet_received_ = true;
+        std::cout << "[" << name_ << "] Receiving data..." << std::endl;
+    }
+    
+    // Periodic progress reporting
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - last_progress_report_).count();
+    if (elapsed >= 5) {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        std::string status;
+        if (!pids_ready_.load()) {
+            if (!st.foundPAT) status = "searching for PAT/PMT...";
+            else if (!st.foundPMT) status = "PAT found, searching for PMT...";
+            else status = "PMT found, waiting for signal...";
+        } else if (!idr_ready_.load()) {
+            status = "waiting for IDR frame...";
+        } else {
+            status = "ready";
+        }
+        std::cout << "[" << name_ << "] Progress: " << rolling_buffer_.size()
+                  << " packets buffered, " << status << std::endl;
+        last_progress_report_ = now;
+    }
+    
+    // Phase 1: Parse PAT/PMT
+    if (!pids_ready_.load()) {
+        if (st.foundPAT && !st.demux.hasPID(discovered_info_.pmt_pid)) {
+            st.demux.addPID(discovered_info_.pmt_pid);
+        }
+        
+        st.demux.feedPacket(pkt);
+        
+        if (st.foundPAT && st.foundPMT) {
+            std::lock_guard<std::mutex> lock(buffer_mutex_);
+            discovered_info_.initialized = true;
+            std::cout << "[" << name_ << "] PAT/PMT discovery complete!" << std::endl;
+            std::cout << "[" << name_ << "] Video PID=" << discovered_info_.video_pid
+                      << ", Audio PID=" << discovered_info_.audio_pid
+                      << ", PCR PID=" << discovered_info_.pcr_pid << std::endl;
+            pids_ready_ = true;
+            cv_.notify_all();
+            transport_analyzer_.setPids(discovered_info_.pmt_pid, discovered_info_.pcr_pid,
+                                        discovered_info_.video_pid, discovered_info_.audio_pid,
+                                        SequenceStamps::nowNs());
+        }
+    }
+    
+    // Phase 2: Detect IDR
+    if (pids_ready_.load()) {
+        bool is_video = pkt.getPID() == discovered_info_.video_pid && pkt.hasPayload();
+        size_t header_size = pkt.getHeaderSize();
+        const uint8_t* payload = pkt.b + header_size;
+        size_t payload_size = ts::PKT_SIZE - header_size;
+        
+        if (is_video && pkt.getPUSI()) {
+            if (st.frame_indexed) {
+                // The indexed access unit ends where the next PES starts
+                std::lock_guard<std::mutex> lock(buffer_mutex_);
+                if (!frame_index_.empty() && frame_index_.back().begin_seq == st.pes_start_index) {
+                    frame_index_.back().end_seq = rolling_buffer_.headSequence();
+                }
+                st.frame_indexed = false;
+            }
+            st.pes_start_index = rolling_buffer_.headSequence();
+            st.idr_scanner.beginPES();
+            st.pes_has_pts = extractPTS(payload, payload_size, st.pes_pts);
+            st.pes_has_pcr = false;
+        }
+        
+        if (pkt.getPID() == discovered_info_.pcr_pid && pkt.hasPCR()) {
+            if (!st.pes_has_pcr) {
+                st.pes_pcr = pkt.getPCR();
+                st.pes_has_pcr = true;
+            }
+            if (st.clean_point_needs_pcr) {
+                std::lock_guard<std::mutex> lock(buffer_mutex_);
+                CleanPoint& point = clean_point_pending_ ? pending_clean_point_ : clean_points_.back();
+                point.pcr = pkt.getPCR();
+                point.has_pcr = true;
+                st.clean_point_needs_pcr = false;
+            }
+        }
+        
+        // Classify the PES by its first slice NAL as the payload arrives
+        if (is_video && payload_size > 0 && st.idr_scanner.scanning() &&
+            st.idr_scanner.feed(payload, payload_size) == NALStartCodeScanner::Result::IDR_SLICE) {
+            // Parameter sets travel in front of the IDR slice in the same
+            // PES; its packets are still in the ring (this thread owns it)
+            if (st.idr_scanner.sawNAL(NALUnitType::SPS) || st.idr_scanner.sawNAL(NALUnitType::PPS)) {
+                st.access_unit.clear();
+                for (uint64_t seq = st.pes_start_index; seq < rolling_buffer_.headSequence(); seq++) {
+                    const ts::TSPacket& prev = rolling_buffer_.at(seq);
+                    if (prev.getPID() == discovered_info_.video_pid && prev.hasPayload()) {
+                        size_t prev_header = prev.getHeaderSize();
+                        st.access_unit.insert(st.access_unit.end(), prev.b + prev_header, prev.b + ts::PKT_SIZE);
+                    }
+                }
+                st.access_unit.insert(st.access_unit.end(), payload, payload + payload_size);
+                FrameInfo unused;
+                st.param_parser.parseNALUnits(st.access_unit.data(), st.access_unit.size(), unused);
+            }
+            
+            std::lock_guard<std::mutex> lock(buffer_mutex_);
+            
+            latest_idr_index_ = st.pes_start_index;
+            
+            // Every IDR is a candidate switch point once its audio is in
+            pending_clean_point_ = CleanPoint();
+            pending_clean_point_.idr_index = st.pes_start_index;
+            pending_clean_point_.audio_index = st.pes_start_index;
+            pending_clean_point_.detected_at = now;
+            pending_clean_point_.video_pts = st.pes_pts;
+            pending_clean_point_.has_video_pts = st.pes_has_pts;
+            pending_clean_point_.pcr = st.pes_pcr;
+            pending_clean_point_.has_pcr = st.pes_has_pcr;
+            pending_clean_point_.sps = st.param_parser.getLastSPS();
+            pending_clean_point_.pps = st.param_parser.getLastPPS();
+            st.clean_point_needs_pcr = !st.pes_has_pcr;
+            
+            if (frame_index_enabled_ && st.pes_has_pts) {
+                IndexedFrame frame;
+                frame.begin_seq = st.pes_start_index;
+                frame.pts = st.pes_pts;
+                if (!st.idr_scanner.sawNAL(NALUnitType::SPS)) {
+                    frame.sps = pending_clean_point_.sps;
+                }
+                if (!st.idr_scanner.sawNAL(NALUnitType::PPS)) {
+                    frame.pps = pending_clean_point_.pps;
+                }
+                indexFrame(std::move(frame), now);
+                st.frame_indexed = true;
+            }
+            
+            if (discovered_info_.audio_pid == ts::PID_NULL) {
+                addCleanPoint(pending_clean_point_);
+            } else {
+                clean_point_pending_ = true;
+            }
+            
+            if (!idr_ready_.load()) {
+                idr_found_ = true;
+                idr_index_ = st.pes_start_index;
+                std::cout << "[" << name_ << "] Initial IDR frame detected at index " << idr_index_ << std::endl;
+                    
+                if (discovered_info_.audio_pid == ts::PID_NULL) {
+                    std::cout << "[" << name_ << "] No audio stream, marking ready" << std::endl;
+                    idr_ready_ = true;
+                    cv_.notify_all();
+                } else {
+                    std::cout << "[" << name_ << "] Waiting for first audio PES..." << std::endl;
+                }
+            }
+        }
+    }
+    
+    // Complete the pending clean point at the first audio PES after its IDR.
+    // Done before Phase 3 so the point is indexed by the time waiters wake.
+    if (clean_point_pending_ && pkt.getPID() == discovered_info_.audio_pid &&
+        pkt.getPUSI() && pkt.hasPayload()) {
+        size_t header_size = pkt.getHeaderSize();
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        pending_clean_point_.audio_index = rolling_buffer_.headSequence();
+        pending_clean_point_.has_audio_pts = extractPTS(pkt.b + header_size, ts::PKT_SIZE - header_size,
+                                                        pending_clean_point_.audio_pts);
+        addCleanPoint(pending_clean_point_);
+        clean_point_pending_ = false;
+    }
+    
+    // Phase 3: Wait for first audio PES after IDR
+    if (pids_ready_.load() && idr_found_ && !idr_ready_.load() &&
+        discovered_info_.audio_pid != ts::PID_NULL && !audio_ready_.load()) {
+        if (pkt.getPID() == discovered_info_.audio_pid && pkt.getPUSI() && pkt.hasPayload()) {
+            std::lock_guard<std::mutex> lock(buffer_mutex_);
+            audio_sync_index_ = rolling_buffer_.headSequence();
+            std::cout << "[" << name_ << "] First audio PES at index " << audio_sync_index_ << std::endl;
+            audio_ready_ = true;
+            audio_sync_ready_ = true;
+            idr_ready_ = true;
+            cv_.notify_all();
+        }
+    }
+    
+    // Phase 3b: Continue tracking audio sync
+    if (pids_ready_.load() && idr_ready_.load() && !audio_sync_ready_.load() &&
+        discovered_info_.audio_pid != ts::PID_NULL) {
+        if (pkt.getPID() == discovered_info_.audio_pid && pkt.getPUSI() && pkt.hasPayload()) {
+            std::lock_guard<std::mutex> lock(buffer_mutex_);
+            audio_sync_index_ = rolling_buffer_.headSequence();
+            audio_sync_ready_ = true;
+            std::cout << "[" << name_ << "] Audio sync updated at index " << audio_sync_index_ << std::endl;
+            cv_.notify_all();
+        }
+    }
+    
+    // Always buffer (lock-free, this thread is the only producer)
+    rolling_buffer_.push(pkt);
+    
+    // Trim buffer if too large - O(1), indices are absolute sequence
+    // numbers and are clamped to the ring tail when read
+    if (rolling_buffer_.size() > max_buffer_packets_ && idr_ready_.load()) {
+        rolling_buffer_.trimTo(rolling_buffer_.headSequence() - max_buffer_packets_);
+    }
+    
+    total_packets_received_++;
+}
+
+void StreamInput::waitForStreamInfo() {
+    std::cout << "[" << name_ << "] Waiting for stream info..." << std::endl;
+    std::unique_lock<std::mutex> lock(buffer_mutex_);
+    cv_.wait(lock, [this]{ return pids_ready_.load(); });
+    std::cout << "[" << name_ << "] Stream info ready" << std::endl;
+}
+
+void StreamInput::waitForIDR() {
+    std::unique_lock<std::mutex> lock(buffer_mutex_);
+    cv_.wait(lock, [this]{ return idr_ready_.load(); });
+}
+
+void StreamInput::waitForAudioSync() {
+    std::cout << "[" << name_ << "] Waiting for audio sync point..." << std::endl;
+    std::unique_lock<std::mutex> lock(buffer_mutex_);
+    
+    auto timeout = std::chrono::seconds(5);
+    bool found = cv_.wait_for(lock, timeout, [this]{ return audio_sync_ready_.load(); });
+    
+    if (found) {
+        std::cout << "[" << name_ << "] Audio sync ready at index " << audio_sync_index_ << std::endl;
+    } else {
+        std::cerr << "[" << name_ << "] Warning: Audio sync timeout - using IDR as fallback" << std::endl;
+        audio_sync_index_ = idr_index_;
+        audio_sync_ready_ = true;
+    }
+}
+
+void StreamInput::resetForNewLoop() {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    idr_ready_ = false;
+    audio_ready_ = false;
+    audio_sync_ready_ = false;
+    idr_found_ = false;
+    idr_index_ = rolling_buffer_.headSequence();
+    audio_sync_index_ = rolling_buffer_.headSequence();
+    added_latency_ms_ = 0;  // Starts at the next IDR, i.e. live
+    std::cout << "[" << name_ << "] Reset for new loop - waiting for next IDR and audio sync" << std::endl;
+}
+
+void StreamInput::addCleanPoint(const CleanPoint& point) {
+    // Caller holds buffer_mutex_
+    clean_points_.push_back(point);
+    if (clean_points_.size() > CLEAN_POINT_HISTORY) {
+        clean_points_.pop_front();
+    }
+}
+
+bool StreamInput::parseCleanPointPolicy(const std::string& name, CleanPointPolicy& policy) {
+    if (name == "oldest") {
+        policy = CleanPointPolicy::OLDEST;
+    } else if (name == "newest") {
+        policy = CleanPointPolicy::NEWEST;
+    } else if (name == "target_latency") {
+        policy = CleanPointPolicy::TARGET_LATENCY;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* StreamInput::cleanPointPolicyName(CleanPointPolicy policy) {
+    switch (policy) {
+        case CleanPointPolicy::OLDEST: return "oldest";
+        case CleanPointPolicy::NEWEST: return "newest";
+        case CleanPointPolicy::TARGET_LATENCY: return "target_latency";
+    }
+    return "unknown";
+}
+
+void StreamInput::setCleanPointPolicy(CleanPointPolicy policy, int target_latency_ms) {
+    clean_point_policy_ = policy;
+    target_latency_ms_ = std::max(target_latency_ms, 0);
+    std::cout << "[" << name_ << "] Clean point policy: " << cleanPointPolicyName(policy);
+    if (policy == CleanPointPolicy::TARGET_LATENCY) {
+        std::cout << " (" << target_latency_ms_.load() << " ms behind live)";
+    }
+    std::cout << std::endl;
+}
+
+bool StreamInput::selectCleanPoint() {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    
+    CleanPointPolicy policy = clean_point_policy_.load();
+    int64_t target_ms = target_latency_ms_.load();
+    auto now = std::chrono::steady_clock::now();
+    
+    // Points are oldest first; only those whose IDR is still buffered qualify
+    const CleanPoint* point = nullptr;
+    int64_t age_ms = 0;
+    for (const CleanPoint& candidate : clean_points_) {
+        if (!rolling_buffer_.contains(candidate.idr_index)) {
+            continue;
+        }
+        int64_t candidate_age_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now - candidate.detected_at).count();
+        bool better;
+        switch (policy) {
+            case CleanPointPolicy::OLDEST:
+                better = (point == nullptr);
+                break;
+            case CleanPointPolicy::TARGET_LATENCY:
+                better = (point == nullptr) ||
+                         std::llabs(candidate_age_ms - target_ms) <= std::llabs(age_ms - target_ms);
+                break;
+            case CleanPointPolicy::NEWEST:
+            default:
+                better = true;
+                break;
+        }
+        if (better) {
+            point = &candidate;
+            age_ms = candidate_age_ms;
+        }
+    }
+    if (!point) {
+        return false;
+    }
+    
+    idr_index_ = point->idr_index;
+    audio_sync_index_ = point->audio_index;
+    idr_found_ = true;
+    audio_sync_ready_ = true;
+    added_latency_ms_ = age_ms;
+    
+    std::cout << "[" << name_ << "] Using " << cleanPointPolicyName(policy) << " clean point: IDR at " << idr_index_
+              << ", audio sync at " << audio_sync_index_
+              << " (" << (rolling_buffer_.headSequence() - idr_index_) << " packets, "
+              << age_ms << " ms behind live)" << std::endl;
+    return true;
+}
+
+size_t StreamInput::getCleanPointCount() {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    return clean_points_.size();
+}
+
+StreamInput::PacketSnapshot StreamInput::getSnapshotFromAudioSync() {
+    uint64_t start_index;
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        start_index = idr_index_;
+        if (audio_sync_ready_.load()) {
+            std::cout << "[" << name_ << "] IDR at " << idr_index_ << ", audio sync at " << audio_sync_index_ << std::endl;
+        }
+    }
+    
+    // Pinning and reading the ring need no lock; the reactor thread keeps going
+    PacketSnapshot snapshot = rolling_buffer_.view(start_index, rolling_buffer_.headSequence());
+    last_snapshot_end_ = snapshot.endSequence();
+    return snapshot;
+}
+
+std::vector<ts::TSPacket> StreamInput::receivePackets(size_t maxPackets, int timeoutMs) {
+    std::vector<ts::TSPacket> result;
+    result.reserve(maxPackets);
+    last_passthrough_count_ = 0;
+    
+    // Only block when the ring is empty; the reader thread wakes us once per batch
+    if (drainPackets(maxPackets, result) == 0) {
+        data_signal_.prepareWait();
+        if (rolling_buffer_.headSequence() > consume_index_) {
+            data_signal_.cancelWait();
+        } else {
+            data_signal_.wait(timeoutMs);
+        }
+        drainPackets(maxPackets, result);
+    }
+    
+    return result;
+}
+
+size_t StreamInput::drainPackets(size_t maxPackets, std::vector<ts::TSPacket>& out) {
+    uint64_t head = rolling_buffer_.headSequence();
+    if (consume_index_ >= head || out.size() >= maxPackets) {
+        return 0;
+    }
+    
+    // Packets overwritten before we got to them are skipped
+    size_t before = out.size();
+    uint64_t to = std::min<uint64_t>(head, consume_index_ + (maxPackets - before));
+    uint64_t first = rolling_buffer_.copyRange(consume_index_, to, out);
+    size_t copied = out.size() - before;
+    if (before == 0) {
+        last_batch_seq_ = first;
+    }
+    consume_index_ = std::max(consume_index_, first + copied);
+    
+    // Packets the reactor already tee'd into the output
+    uint64_t tee_from = std::max(first, passthrough_start_seq_.load());
+    uint64_t tee_to = std::min(first + copied, passthrough_end_seq_.load());
+    if (tee_to > tee_from) {
+        last_passthrough_count_ += static_cast<size_t>(tee_to - tee_from);
+    }
+    return copied;
+}
+
+void StreamInput::initConsumptionFromIndex(uint64_t index) {
+    consume_index_ = index;
+    forgetPassthroughRange();
+    std::cout << "[" << name_ << "] Consumption started at index " << consume_index_ << std::endl;
+}
+
+void StreamInput::initConsumptionFromCurrentPosition() {
+    consume_index_ = rolling_buffer_.headSequence();
+    forgetPassthroughRange();
+    std::cout << "[" << name_ << "] Consumption started at current position " << consume_index_ << std::endl;
+}
+
+bool StreamInput::extractTimestampBases() {
+    CleanPoint point;
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        
+        // The point the IDR index was taken from: indexed, or still waiting
+        // for audio when waitForAudioSync() timed out
+        const CleanPoint* found = nullptr;
+        for (auto it = clean_points_.rbegin(); it != clean_points_.rend(); ++it) {
+            if (it->idr_index == idr_index_) {
+                found = &*it;
+                break;
+            }
+        }
+        if (!found && clean_point_pending_ && pending_clean_point_.idr_index == idr_index_) {
+            found = &pending_clean_point_;
+        }
+        if (!found) {
+            std::cerr << "[" << name_ << "] Warning: No clean point indexed for IDR at " << idr_index_ << std::endl;
+            return false;
+        }
+        point = *found;
+    }
+    
+    if (!point.sps.empty() && !point.pps.empty()) {
+        sps_data_ = point.sps;
+        pps_data_ = point.pps;
+    }
+    
+    if (point.has_video_pts) {
+        std::cout << "[" << name_ << "] Video PTS base: " << point.video_pts << std::endl;
+    }
+    if (point.has_audio_pts) {
+        std::cout << "[" << name_ << "] Audio PTS base: " << point.audio_pts << std::endl;
+    }
+    
+    // Use minimum of video and audio PTS as base
+    if (point.has_video_pts && point.has_audio_pts) {
+        pts_base_ = std::min(point.video_pts, point.audio_pts);
+        audio_pts_base_ = point.audio_pts;
+        std::cout << "[" << name_ << "] Using minimum PTS base: " << pts_base_ << std::endl;
+    } else if (point.has_video_pts) {
+        pts_base_ = point.video_pts;
+        audio_pts_base_ = point.video_pts;
+    } else if (point.has_audio_pts) {
+        pts_base_ = point.audio_pts;
+        audio_pts_base_ = point.audio_pts;
+    } else {
+        std::cerr << "[" << name_ << "] Warning: No PTS found!" << std::endl;
+        return false;
+    }
+    
+    // Calculate PCR/PTS alignment offset
+    if (point.has_pcr && point.pcr > 0) {
+        pcr_base_ = point.pcr;
+        pcr_pts_alignment_offset_ = (int64_t)(pts_base_ * 300) - (int64_t)point.pcr;
+        std::cout << "[" << name_ << "] PCR base: " << pcr_base_ << std::endl;
+        std::cout << "[" << name_ << "] PCR/PTS alignment offset: " << pcr_pts_alignment_offset_ << std::endl;
+    } else {
+        pcr_base_ = pts_base_ * 300;
+        std::cout << "[" << name_ << "] PCR not found, using PTS-derived: " << pcr_base_ << std::endl;
+    }
+    
+    return pts_base_ > 0;
+}
+
+bool StreamInput::validateFirstAudioADTS(const std::vector<ts::TSPacket>& packets) const {
+    // Find first audio packet with PUSI
+    for (const auto& pkt : packets) {
+        if (pkt.getPID() == discovered_info_.audio_pid && pkt.getPUSI() && pkt.hasPayload()) {
+            size_t header_size = pkt.getHeaderSize();
+            const uint8_t* payload = pkt.b + header_size;
+            size_t payload_size = ts::PKT_SIZE - header_size;
+            
+            if (payload_size < 9) return false;
+            
+            // Check PES start code
+            if (payload[0] != 0x00 || payload[1] != 0x00 || payload[2] != 0x01) return false;
+            
+            // Get PES header length
+            uint8_t pes_header_data_length = payload[8];
+            size_t audio_data_start = 9 + pes_header_data_length;
+            
+            if (audio_data_start >= payload_size) {
+                // ADTS in continuation packets - OK
+                return true;
+            }
+            
+            // Look for ADTS sync word (0xFFF)
+            size_t remaining = payload_size - audio_data_start;
+            const uint8_t* audio_data = payload + audio_data_start;
+            
+            for (size_t i = 0; i + 1 < remaining; i++) {
+                if (audio_data[i] == 0xFF && (audio_data[i+1] & 0xF0) == 0xF0) {
+                    std::cout << "[" << name_ << "] Valid ADTS sync at offset " << (audio_data_start + i) << std::endl;
+                    return true;
+                }
+            }
+            
+            std::cout << "[" << name_ << "] ADTS not in first packet - trusting PES boundary" << std::endl;
+            return true;
+        }
+    }
+    
+    // No audio or no audio PID
+    if (discovered_info_.audio_pid == ts::PID_NULL) return true;
+    
+    std::cerr << "[" << name_ << "] No audio PUSI packet found" << std::endl;
+    return false;
+}
+
+void StreamInput::enableFrameIndex(size_t history_bytes, int window_seconds) {
+    // Largest power of two within the budget, never smaller than the default ring
+    size_t packets = RING_CAPACITY;
+    while (packets * 2 * sizeof(ts::TSPacket) <= history_bytes) {
+        packets *= 2;
+    }
+    rolling_buffer_.resize(packets);
+    frame_index_window_ = std::chrono::seconds(std::max(window_seconds, 1));
+    frame_index_enabled_ = true;
+    std::cout << "[" << name_ << "] Frame index: IDRs of the last " << frame_index_window_.count()
+              << " s, ring of " << packets << " packets ("
+              << packets * sizeof(ts::TSPacket) / (1024 * 1024) << " MB)" << std::endl;
+}
+
+void StreamInput::stampOutputPTS(IndexedFrame& frame) const {
+    // Caller holds buffer_mutex_. IDRs before the segment's base never went out.
+    int64_t delta = ptsDelta(frame.pts, output_pts_base_);
+    if (output_timeline_active_ && delta >= 0) {
+        frame.output_pts = output_pts_offset_ + static_cast<uint64_t>(delta);
+        frame.on_air = true;
+    }
+}
+
+void StreamInput::indexFrame(IndexedFrame frame, std::chrono::steady_clock::time_point now) {
+    // Caller holds buffer_mutex_
+    stampOutputPTS(frame);
+    frame_index_.push_back(std::move(frame));
+    
+    // Drop what fell out of the window, what the ring has overwritten since
+    // (a ring too small for the window), and anything over the entry cap
+    uint64_t history = rolling_buffer_.historySequence();
+    while (!frame_index_.empty() &&
+           (frame_index_.size() > FRAME_INDEX_MAX_ENTRIES ||
+            now - frame_index_.front().detected_at > frame_index_window_ ||
+            frame_index_.front().begin_seq < history)) {
+        frame_index_.pop_front();
+    }
+}
+
+void StreamInput::setOutputTimeline(uint64_t pts_base, uint64_t pts_offset) {
+    if (!frame_index_enabled_) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    output_timeline_active_ = true;
+    output_pts_base_ = pts_base % PTS_MODULUS;
+    output_pts_offset_ = pts_offset;
+    
+    // The segment starts from a buffered clean point: IDRs indexed from
+    // there on go out with it
+    for (IndexedFrame& frame : frame_index_) {
+        if (!frame.on_air) {
+            stampOutputPTS(frame);
+        }
+    }
+}
+
+void StreamInput::endOutputTimeline() {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    output_timeline_active_ = false;
+}
+
+bool StreamInput::grabFrame(bool latest, uint64_t pts, uint64_t& output_pts, std::vector<uint8_t>& data) {
+    IndexedFrame frame;
+    ts::PID video_pid = ts::PID_NULL;
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        const IndexedFrame* best = nullptr;
+        uint64_t best_distance = UINT64_MAX;
+        for (const IndexedFrame& entry : frame_index_) {
+            if (!entry.on_air || entry.end_seq == 0) {
+                continue;   // Never aired, or still arriving
+            }
+            // Latest: highest output PTS. Else the closest at or before pts.
+            uint64_t distance = latest ? UINT64_MAX - entry.output_pts
+                                       : (pts - entry.output_pts) & (PTS_MODULUS - 1);
+            if (!latest && distance >= PTS_MODULUS / 2) {
+                continue;   // After pts
+            }
+            if (distance < best_distance) {
+                best = &entry;
+                best_distance = distance;
+            }
+        }
+        if (!best) {
+            return false;
+        }
+        frame = *best;
+        video_pid = discovered_info_.video_pid;
+    }
+    
+    // Outside the lock: the packets may be trimmed already, but are still in
+    // their slots unless the reactor has lapped the ring since
+    std::vector<ts::TSPacket> packets;
+    if (rolling_buffer_.copyHistory(frame.begin_seq, frame.end_seq, packets) != frame.begin_seq) {
+        return false;
+    }
+    
+    static const uint8_t START_CODE[] = {0x00, 0x00, 0x00, 0x01};
+    data.clear();
+    for (const std::vector<uint8_t>* nal : {&frame.sps, &frame.pps}) {
+        if (!nal->empty()) {
+            data.insert(data.end(), START_CODE, START_CODE + sizeof(START_CODE));
+            data.insert(data.end(), nal->begin(), nal->end());
+        }
+    }
+    
+    for (const ts::TSPacket& pkt : packets) {
+        if (pkt.getPID() != video_pid || !pkt.hasPayload()) {
+            continue;
+        }
+        size_t offset = pkt.getHeaderSize();
+        if (pkt.getPUSI()) {
+            // Skip the PES header
+            const uint8_t* pes = pkt.b + offset;
+            if (offset + 9 > ts::PKT_SIZE || pes[0] != 0x00 || pes[1] != 0x00 || pes[2] != 0x01) {
+                return false;
+            }
+            offset += 9 + pes[8];
+            if (offset > ts::PKT_SIZE) {
+                return false;
+            }
+        }
+        data.insert(data.end(), pkt.b + offset, pkt.b + ts::PKT_SIZE);
+    }
+    
+    output_pts = frame.output_pts;
+    return true;
+}
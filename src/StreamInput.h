@@ -0,0 +1,413 @@
+#ifndef STREAM_INPUT_H
+#define STREAM_INPUT_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <sys/types.h>
+#include <tsduck.h>
+#include "StreamInfo.h"
+#include "StreamHealthMetrics.h"
+#include "PacketRing.h"
+#include "WakeupSignal.h"
+#include "SequenceStamps.h"
+#include "TransportAnalyzer.h"
+
+/**
+ * StreamInput - Base class for MPEG-TS inputs (named pipe, TCP, ...)
+ *
+ * Holds everything that does not depend on the transport: TS packet
+ * reassembly, PAT/PMT discovery, IDR / audio sync detection, the clean
+ * point index, the packet ring and the main loop's consumption API.
+ *
+ * Subclasses only open, read and close a nonblocking descriptor. They do
+ * not own a thread: an InputReactor watches every input's descriptor with
+ * one epoll loop and calls handleReadable() when data is available, so
+ * adding inputs adds no threads.
+ *
+ * Threads:
+ * - Reactor thread: openSource() / finishOpen() / readSource() /
+ *   closeSource() and the handle*() callbacks
+ * - Main loop: everything else
+ */
+class StreamInput {
+public:
+    // Pinned, read-only view of buffered packets (see PacketRing::View)
+    using PacketSnapshot = PacketRing<ts::TSPacket>::View;
+
+    // Which indexed clean point a switch to this input starts from
+    enum class CleanPointPolicy {
+        OLDEST,         // Oldest still buffered: most history, most added latency
+        NEWEST,         // Newest: least added latency
+        TARGET_LATENCY  // The one closest to the target latency behind live
+    };
+
+    // "oldest" / "newest" / "target_latency"
+    static bool parseCleanPointPolicy(const std::string& name, CleanPointPolicy& policy);
+    static const char* cleanPointPolicyName(CleanPointPolicy policy);
+
+    static constexpr int DEFAULT_TARGET_LATENCY_MS = 500;
+
+    enum class OpenResult {
+        READY,          // Descriptor open, watch it for input
+        IN_PROGRESS,    // Connect pending, watch it for writability then call finishOpen()
+        FAILED          // Retry after getReconnectDelayMs()
+    };
+
+    explicit StreamInput(const std::string& name);
+    virtual ~StreamInput();
+
+    StreamInput(const StreamInput&) = delete;
+    StreamInput& operator=(const StreamInput&) = delete;
+
+    const std::string& getName() const { return name_; }
+
+    // ---- Transport (reactor thread) ----
+
+    // Open the source without blocking. On READY / IN_PROGRESS, fd receives
+    // a nonblocking descriptor.
+    virtual OpenResult openSource(int& fd) = 0;
+
+    // Complete an IN_PROGRESS open once fd is writable. false = failed.
+    virtual bool finishOpen(int fd);
+
+    // Read up to len bytes: >0 bytes read, 0 when the peer closed, -1 with errno
+    virtual ssize_t readSource(int fd, uint8_t* buf, size_t len);
+
+    virtual void closeSource(int fd);
+
+    // Delay before retrying a failed open
+    virtual int getReconnectDelayMs() const = 0;
+
+    // Whether a plain read() on the descriptor is all readSource() does, so
+    // the reactor may issue the reads itself (io_uring backend)
+    virtual bool allowsDirectRead() const { return true; }
+
+    // Whether the descriptor is a pipe that tee() can duplicate straight into
+    // the output pipe (see startPassthrough())
+    virtual bool supportsPassthrough() const { return false; }
+
+    // ---- Reactor callbacks (reactor thread) ----
+
+    // A new connection: reset discovery state and the ring
+    void handleOpened();
+
+    // Drain fd (bounded, so one busy input cannot starve the others).
+    // Returns false when the source closed or failed.
+    bool handleReadable(int fd, uint8_t* scratch, size_t scratch_size);
+
+    // Bytes the reactor read itself (io_uring backend). len > 0.
+    void handleData(const uint8_t* data, size_t len);
+
+    // The connection is gone
+    void handleClosed();
+
+    // ---- Main loop ----
+
+    // Wait for stream info (PAT/PMT) to be discovered
+    void waitForStreamInfo();
+
+    // Wait for IDR frame to be detected
+    void waitForIDR();
+
+    // Wait for audio sync point (first audio PUSI after IDR)
+    void waitForAudioSync();
+
+    // Reset for new loop - triggers fresh IDR and audio detection
+    void resetForNewLoop();
+
+    // Position the IDR/audio sync indices on the indexed clean point the
+    // policy picks among those still in the ring. Never blocks; returns false
+    // if there is none.
+    bool selectCleanPoint();
+
+    // Clean point policy; may be changed from any thread, applies to the next switch
+    void setCleanPointPolicy(CleanPointPolicy policy, int target_latency_ms);
+    CleanPointPolicy getCleanPointPolicy() const { return clean_point_policy_.load(); }
+    int getTargetLatencyMs() const { return target_latency_ms_.load(); }
+
+    // How far behind live the last switch to this input started, i.e. the
+    // latency it added to the output (ms). -1 before the first switch.
+    int64_t getAddedLatencyMs() const { return added_latency_ms_.load(); }
+
+    // Number of indexed clean points (including ones already trimmed from the ring)
+    size_t getCleanPointCount();
+
+    // Get stream information
+    StreamInfo getStreamInfo() const { return discovered_info_; }
+
+    // Load timestamp bases and SPS/PPS from the clean point at the IDR index.
+    // O(1): the values were captured at ingest.
+    bool extractTimestampBases();
+
+    // View buffered packets from the IDR (so including the audio sync point)
+    // to the newest packet without copying them. Hold it only briefly: it
+    // keeps the reader thread from trimming the ring.
+    PacketSnapshot getSnapshotFromAudioSync();
+
+    // Receive packets from current position. Lock-free; only blocks (up to
+    // timeoutMs) when no packets are available.
+    std::vector<ts::TSPacket> receivePackets(size_t maxPackets, int timeoutMs);
+
+    // Initialize consumption from specific sequence number
+    void initConsumptionFromIndex(uint64_t index);
+
+    // Initialize consumption from current buffer position
+    void initConsumptionFromCurrentPosition();
+
+    // Get last snapshot end (sequence number one past the last snapshot packet)
+    uint64_t getLastSnapshotEnd() const { return last_snapshot_end_; }
+
+    // Timestamp bases
+    uint64_t getPTSBase() const { return pts_base_; }
+    uint64_t getAudioPTSBase() const { return audio_pts_base_; }
+    uint64_t getPCRBase() const { return pcr_base_; }
+    int64_t getPCRPTSAlignmentOffset() const { return pcr_pts_alignment_offset_; }
+
+    // SPS/PPS data for splice injection
+    std::vector<uint8_t> getSPSData() const { return sps_data_; }
+    std::vector<uint8_t> getPPSData() const { return pps_data_; }
+
+    // Validate first audio packet has valid ADTS header
+    bool validateFirstAudioADTS(const std::vector<ts::TSPacket>& packets) const;
+
+    // Connection status (true once data arrives on the current connection)
+    bool isConnected() const { return connected_.load(); }
+    bool isStreamReady() const { return pids_ready_.load() && idr_ready_.load(); }
+
+    // Health checking methods
+    bool isHealthy() const {
+        return connected_.load() && health_metrics_.isHealthy() && isTransportHealthy();
+    }
+    bool isDataFresh(int64_t maxAgeMs = 0) const {
+        if (maxAgeMs > 0) {
+            return health_metrics_.getMsSinceLastData() < maxAgeMs;
+        }
+        return health_metrics_.isDataFresh();
+    }
+    int64_t getMsSinceLastData() const { return health_metrics_.getMsSinceLastData(); }
+    uint64_t getCurrentBitrateBps() const { return health_metrics_.getCurrentBitrateBps(); }
+    uint64_t getPacketRate() const { return health_metrics_.getPacketRate(); }
+    int64_t getJitterUs() const { return health_metrics_.getJitterUs(); }
+    int64_t getMaxGapMs() const { return health_metrics_.getMaxGapMs(); }
+    void configureHealthThresholds(const StreamHealthConfig& config) {
+        health_metrics_.configure(config);
+        min_transport_score_ = config.min_transport_score;
+    }
+    // TR 101 290 style score of the TS itself, 0-100 (see TransportAnalyzer)
+    int getTransportScore() const { return transport_analyzer_.getScore(); }
+    void getTransportReport(TransportAnalyzer::Report& out) const { transport_analyzer_.report(out); }
+    bool isTransportHealthy() const {
+        return min_transport_score_ == 0 || transport_analyzer_.getScore() >= min_transport_score_;
+    }
+    TransportStats getTransportStats() const { return health_metrics_.getTransportStats(); }
+
+    // Statistics
+    uint64_t getPacketsReceived() const { return total_packets_received_.load(); }
+
+    // ---- Latency tracking ----
+    //
+    // When enabled, every read() stamps the ring sequence it completed, so
+    // the main loop can tell when a dequeued packet was read (see
+    // LatencyTracker). Off by default; disabled it costs one relaxed load per read.
+
+    void setLatencyTracking(bool enabled) { latency_tracking_ = enabled; }
+
+    // When the packet with ring sequence seq was read (CLOCK_MONOTONIC ns)
+    bool getIngestTimeNs(uint64_t seq, int64_t& time_ns) const {
+        return ingest_stamps_.lookup(seq, time_ns) == SequenceStamps::Lookup::FOUND;
+    }
+
+    // Ring sequence of the first packet the last receivePackets() returned (main loop)
+    uint64_t getLastBatchSequence() const { return last_batch_seq_; }
+
+    // ---- Passthrough (main loop) ----
+    //
+    // While the main loop would write this input's packets out unchanged, the
+    // reactor can tee() the input pipe straight into the output pipe so the
+    // payload never passes through user space on its way out. The reactor
+    // still reads the same bytes afterwards to index and buffer them, so
+    // switches, clean points and health keep working.
+    //
+    // Handover happens on packet boundaries: startPassthrough() only requests
+    // it; the reactor takes over once the main loop has flushed everything up
+    // to the ring head (markOutputFlushed()). From then on, packets returned
+    // by receivePackets() were already written; getLastPassthroughCount()
+    // says how many of them (always a prefix of the batch). stopPassthrough()
+    // hands the output back, completing a partially tee'd packet first.
+
+    // Request passthrough into output_fd (a pipe). false if unsupported.
+    bool startPassthrough(int output_fd);
+
+    // End passthrough; on return the main loop owns the output again
+    void stopPassthrough();
+
+    // Main loop has written and flushed every packet it received so far
+    void markOutputFlushed();
+
+    bool isPassthroughRequested() const { return passthrough_requested_.load(); }
+    bool isPassthroughActive() const { return passthrough_active_.load(); }
+
+    // Leading packets of the last receivePackets() batch already written by tee()
+    size_t getLastPassthroughCount() const { return last_passthrough_count_; }
+
+    // Bytes written to the output by tee() (all connections)
+    uint64_t getPassthroughBytes() const { return passthrough_bytes_.load(); }
+
+    // ---- Frame index ----
+    //
+    // When enabled, the reactor notes where each IDR access unit of the last
+    // window seconds sits in the ring (sequence range and PTS) and the ring
+    // is enlarged to keep that much history past the trim point. Nothing is
+    // copied at ingest: grabFrame() reads the packets back out of the ring
+    // and fails if the producer has reused them since. Memory is the ring,
+    // so history_bytes bounds it; the window shrinks to what fits.
+    //
+    // Entries are keyed by output PTS. The main loop publishes the mapping
+    // of the segment on air (setOutputTimeline()); IDRs at or after its
+    // base are stamped with their output PTS, the rest were never aired.
+
+    // Before the reactor starts. Off by default.
+    void enableFrameIndex(size_t history_bytes, int window_seconds);
+    bool isFrameIndexEnabled() const { return frame_index_enabled_; }
+
+    // Main loop: this input is on air with source PTS pts_base mapped to
+    // output PTS pts_offset (unwrapped, see RebaseContext); ended when it goes off air
+    void setOutputTimeline(uint64_t pts_base, uint64_t pts_offset);
+    void endOutputTimeline();
+
+    // Any thread: the aired IDR access unit with the latest output PTS, or
+    // the last one at or before output PTS pts (33-bit), as Annex B with
+    // SPS/PPS in front. output_pts receives its output PTS (unwrapped).
+    bool grabFrame(bool latest, uint64_t pts, uint64_t& output_pts, std::vector<uint8_t>& data);
+
+protected:
+    // For subclasses that report transport statistics
+    StreamHealthMetrics& healthMetrics() { return health_metrics_; }
+    
+    // Configuration
+    std::string name_;
+
+private:
+    // Per-connection parsing state (demux, reassembler, IDR scanner, ...)
+    struct IngestState;
+
+    size_t ingestBytes(const uint8_t* data, size_t len);
+    void processPacket(const ts::TSPacket& pkt, IngestState& st);
+    size_t drainPackets(size_t maxPackets, std::vector<ts::TSPacket>& out);
+    void addCleanPoint(const CleanPoint& point);
+    bool prepareTee(int fd, size_t& want);
+    bool completeTeePacket(int fd);
+    void endPassthrough(const char* reason);
+    void forgetPassthroughRange();
+
+    std::unique_ptr<IngestState> ingest_;   // Reactor thread only
+    std::atomic<bool> connected_;
+
+    // Stream discovery state
+    std::atomic<bool> pids_ready_;
+    std::atomic<bool> idr_ready_;
+    std::atomic<bool> audio_ready_;
+    std::atomic<bool> audio_sync_ready_;
+    std::atomic<bool> first_packet_received_;
+
+    // Buffer management
+    // All indices are absolute PacketRing sequence numbers. The ring itself is
+    // lock-free (reactor thread produces, main loop consumes); buffer_mutex_ only
+    // guards the index bookkeeping and the stream discovery condition variable.
+    std::mutex buffer_mutex_;
+    std::condition_variable cv_;
+    PacketRing<ts::TSPacket> rolling_buffer_;
+    WakeupSignal data_signal_;      // Wakes receivePackets() when the ring was empty
+    std::atomic<bool> idr_found_;   // Initial IDR located (idr_index_ valid)
+    uint64_t idr_index_;            // Initial IDR index for first connection
+    uint64_t latest_idr_index_;     // Most recent IDR index (continuously updated)
+    uint64_t audio_sync_index_;
+    std::deque<CleanPoint> clean_points_;   // Oldest first, at most CLEAN_POINT_HISTORY
+    std::atomic<CleanPointPolicy> clean_point_policy_;
+    std::atomic<int> target_latency_ms_;
+    std::atomic<int64_t> added_latency_ms_;
+    CleanPoint pending_clean_point_;        // IDR seen, waiting for audio (reactor thread only)
+    bool clean_point_pending_;
+    uint64_t consume_index_;        // Main loop only
+    uint64_t last_snapshot_end_;    // Main loop only
+    size_t max_buffer_packets_;
+
+    // Discovered stream info
+    StreamInfo discovered_info_;
+
+    // Timestamp bases
+    uint64_t pts_base_;
+    uint64_t audio_pts_base_;
+    uint64_t pcr_base_;
+    int64_t pcr_pts_alignment_offset_;
+
+    // SPS/PPS data
+    std::vector<uint8_t> sps_data_;
+    std::vector<uint8_t> pps_data_;
+
+    // Statistics
+    std::atomic<uint64_t> total_packets_received_;
+    std::chrono::steady_clock::time_point last_progress_report_;
+    std::chrono::steady_clock::time_point connection_start_time_;
+
+    // Health monitoring
+    StreamHealthMetrics health_metrics_;
+    TransportAnalyzer transport_analyzer_;  // Fed by the reactor thread
+    int min_transport_score_ = 0;           // Set before the reactor starts
+    
+    // Passthrough. tee_mutex_ makes tee + read + ingest atomic with respect
+    // to stopPassthrough(); the sequence numbers are ring sequence numbers.
+    std::mutex tee_mutex_;
+    std::atomic<bool> passthrough_requested_;
+    std::atomic<bool> passthrough_active_;
+    std::atomic<bool> passthrough_disabled_;        // Output is not a pipe
+    std::atomic<uint64_t> passthrough_start_seq_;   // First tee'd packet
+    std::atomic<uint64_t> passthrough_end_seq_;     // One past the last tee'd packet
+    std::atomic<uint64_t> passthrough_flushed_seq_; // Main loop output complete up to here
+    std::atomic<uint64_t> passthrough_bytes_;
+    int passthrough_target_fd_;     // Guarded by tee_mutex_
+    int tee_in_fd_;                 // Input descriptor while active (tee_mutex_)
+    size_t tee_partial_;            // Bytes of the current packet already tee'd (tee_mutex_)
+    size_t last_passthrough_count_; // Main loop only
+
+    // Latency tracking
+    std::atomic<bool> latency_tracking_;
+    SequenceStamps ingest_stamps_;  // Written by the reactor thread
+    uint64_t last_batch_seq_;       // Main loop only
+
+    // Frame index, guarded by buffer_mutex_ (the two settings are fixed before start)
+    struct IndexedFrame {
+        uint64_t begin_seq = 0;     // PES start
+        uint64_t end_seq = 0;       // Next video PES start, 0 while still arriving
+        uint64_t pts = 0;           // Source PTS
+        uint64_t output_pts = 0;    // Unwrapped, valid if on_air
+        bool on_air = false;
+        std::vector<uint8_t> sps;   // Only when the PES carries none
+        std::vector<uint8_t> pps;
+        std::chrono::steady_clock::time_point detected_at;
+    };
+    void indexFrame(IndexedFrame frame, std::chrono::steady_clock::time_point now);
+    void stampOutputPTS(IndexedFrame& frame) const;
+    bool frame_index_enabled_ = false;
+    std::chrono::seconds frame_index_window_{0};
+    std::deque<IndexedFrame> frame_index_;  // Oldest first
+    bool output_timeline_active_ = false;
+    uint64_t output_pts_base_ = 0;
+    uint64_t output_pts_offset_ = 0;
+
+    // Constants
+    static constexpr size_t MAX_BUFFER_PACKETS = 1500;  // ~3 seconds at 2Mbps
+    static constexpr size_t RING_CAPACITY = 2048;       // Power of two >= MAX_BUFFER_PACKETS
+    static constexpr size_t CLEAN_POINT_HISTORY = 8;
+    static constexpr size_t FRAME_INDEX_MAX_ENTRIES = 1024; // Guards against IDR-only streams
+    static constexpr int MAX_READS_PER_WAKEUP = 16;     // Fairness cap per handleReadable()
+    static constexpr int TEE_COMPLETE_TIMEOUT_MS = 100; // Wait for the rest of a split packet
+};
+
+#endif // STREAM_INPUT_H
@@ -1,10 +1,14 @@
 #include "StreamSplicer.h"
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 
 StreamSplicer::StreamSplicer()
     : global_pts_offset_(0),
-      global_pcr_offset_(0) {
+      global_pcr_offset_(0),
+      unchanged_run_(0),
+      max_realign_gap_(DEFAULT_MAX_REALIGN_GAP) {
+    continuity_counters_.fill(CC_UNSET);
 }
 
 void StreamSplicer::initializeWithAlignmentOffset(int64_t alignment_offset) {
@@ -20,81 +24,218 @@ void StreamSplicer::initializeWithAlignmentOffset(int64_t alignment_offset) {
               << ", PCR offset: " << global_pcr_offset_ << std::endl;
 }
 
-void StreamSplicer::rebasePacket(ts::TSPacket& packet, 
+void StreamSplicer::initializeAtSource(uint64_t pts_base, uint64_t pcr_base) {
+    global_pts_offset_ = pts_base;
+    global_pcr_offset_ = pcr_base;
+    
+    std::cout << "[StreamSplicer] Output timeline starts on the source's own: PTS " << global_pts_offset_
+              << ", PCR " << global_pcr_offset_ << std::endl;
+}
+
+namespace {
+
+// Decode a 33-bit PTS/DTS from its 5-byte PES encoding
+inline uint64_t readTimestamp(const uint8_t* p) {
+    return ((uint64_t)(p[0] & 0x0E) << 29) |
+           ((uint64_t)(p[1]) << 22) |
+           ((uint64_t)(p[2] & 0xFE) << 14) |
+           ((uint64_t)(p[3]) << 7) |
+           ((uint64_t)(p[4] >> 1));
+}
+
+// Re-encode a 33-bit PTS/DTS in place, keeping the prefix and marker bits
+inline void writeTimestamp(uint8_t* p, uint64_t ts) {
+    p[0] = (p[0] & 0xF1) | ((ts >> 29) & 0x0E);
+    p[1] = (ts >> 22) & 0xFF;
+    p[2] = (p[2] & 0x01) | ((ts >> 14) & 0xFE);
+    p[3] = (ts >> 7) & 0xFF;
+    p[4] = (p[4] & 0x01) | ((ts << 1) & 0xFE);
+}
+
+// TS header + adaptation field size, same as TSPacket::getHeaderSize()
+inline size_t headerSize(const uint8_t* b) {
+    if (!(b[3] & 0x20)) {
+        return 4;
+    }
+    return std::min<size_t>(ts::PKT_SIZE, 5 + b[4]);
+}
+
+} // namespace
+
+void StreamSplicer::beginSegment(RebaseContext& context,
                                  uint64_t pts_base, uint64_t pcr_base,
                                  int64_t pcr_pts_alignment) {
-    ts::PID pid = packet.getPID();
+    context.reset(pts_base, pcr_base, pcr_pts_alignment, global_pts_offset_, global_pcr_offset_);
+    unchanged_run_ = 0;
     
-    // Rebase PCR if present
-    if (packet.hasPCR()) {
-        uint64_t pcr = packet.getPCR();
-        uint64_t rebased_pcr = (pcr - pcr_base) + global_pcr_offset_;
-        packet.setPCR(rebased_pcr);
+    std::cout << "[StreamSplicer] New segment: source PTS " << pts_base << " -> " << global_pts_offset_
+              << ", source PCR " << pcr_base << " -> " << global_pcr_offset_ << std::endl;
+}
+
+bool StreamSplicer::beginSegmentAtSource(RebaseContext& context,
+                                         uint64_t pts_base, uint64_t pcr_base,
+                                         int64_t pcr_pts_alignment) {
+    // Forward distance from the end of the output timeline to the source's
+    // own timestamps, on each clock
+    uint64_t pts_gap = (pts_base % RebaseContext::PTS_MODULUS + RebaseContext::PTS_MODULUS -
+                        global_pts_offset_ % RebaseContext::PTS_MODULUS) % RebaseContext::PTS_MODULUS;
+    uint64_t pcr_gap = (pcr_base % RebaseContext::PCR_MODULUS + RebaseContext::PCR_MODULUS -
+                        global_pcr_offset_ % RebaseContext::PCR_MODULUS) % RebaseContext::PCR_MODULUS;
+    
+    if (pts_gap > max_realign_gap_ || pcr_gap > max_realign_gap_ * 300) {
+        beginSegment(context, pts_base, pcr_base, pcr_pts_alignment);
+        return false;
     }
     
-    // Rebase PTS/DTS if this is a PES packet start
-    if (packet.getPUSI() && packet.hasPayload()) {
-        size_t header_size = packet.getHeaderSize();
-        uint8_t* payload = packet.b + header_size;
+    global_pts_offset_ += pts_gap;
+    global_pcr_offset_ += pcr_gap;
+    context.reset(pts_base, pcr_base, pcr_pts_alignment, global_pts_offset_, global_pcr_offset_);
+    unchanged_run_ = 0;
+    
+    std::cout << "[StreamSplicer] New segment on the source's own timestamps: PTS " << pts_base
+              << " (+" << pts_gap / 90 << " ms), PCR " << pcr_base << std::endl;
+    return true;
+}
+
+ts::TSPacket StreamSplicer::createContinuityReset(ts::PID pid, uint8_t next_cc) {
+    uint8_t cc = (next_cc - 1) & 0x0F;
+    continuity_counters_[pid & 0x1FFF] = cc;
+    
+    ts::TSPacket packet;
+    uint8_t* b = packet.b;
+    std::memset(b, 0xFF, ts::PKT_SIZE);
+    b[0] = 0x47;
+    b[1] = (pid >> 8) & 0x1F;
+    b[2] = pid & 0xFF;
+    b[3] = 0x20 | cc;                   // Adaptation field only: CC does not advance
+    b[4] = ts::PKT_SIZE - 5;            // Adaptation field length, rest is stuffing
+    b[5] = 0x80;                        // discontinuity_indicator, no other flags
+    return packet;
+}
+
+void StreamSplicer::rebasePacket(ts::TSPacket& packet, RebaseContext& context) {
+    rebaseHeader(packet.b, headerSize(packet.b), context);
+}
+
+void StreamSplicer::fixContinuityCounter(ts::TSPacket& packet) {
+    setNextCC(packet.b);
+}
+
+void StreamSplicer::rebaseAndFixContinuity(ts::TSPacket& packet, RebaseContext& context) {
+    uint8_t source_cc = packet.b[3];
+    rebaseHeader(packet.b, headerSize(packet.b), context);
+    setNextCC(packet.b);
+    unchanged_run_ = (context.isIdentity() && packet.b[3] == source_cc) ? unchanged_run_ + 1 : 0;
+}
+
+void StreamSplicer::fixContinuityCounters(std::span<ts::TSPacket> packets) {
+    for (auto& packet : packets) {
+        setNextCC(packet.b);
+    }
+}
+
+void StreamSplicer::rebaseAndFixContinuity(std::span<ts::TSPacket> packets, RebaseContext& context) {
+    bool identity = context.isIdentity();
+    for (auto& packet : packets) {
+        uint8_t source_cc = packet.b[3];
+        rebaseHeader(packet.b, headerSize(packet.b), context);
+        setNextCC(packet.b);
+        unchanged_run_ = (identity && packet.b[3] == source_cc) ? unchanged_run_ + 1 : 0;
+    }
+}
+
+void StreamSplicer::seedContinuity(ts::PID pid, uint8_t next_cc) {
+    uint8_t& cc = continuity_counters_[pid & 0x1FFF];
+    if (cc == CC_UNSET) {
+        cc = (next_cc - 1) & 0x0F;
+    }
+}
+
+bool StreamSplicer::trackPassthrough(std::span<ts::TSPacket> packets, RebaseContext& context) {
+    // An identity context never writes, so the packets stay as they went out
+    bool unchanged = context.isIdentity();
+    for (auto& packet : packets) {
+        uint8_t* b = packet.b;
+        rebaseHeader(b, headerSize(b), context);
+        if (b[3] & 0x10) {
+            ts::PID pid = ((b[1] & 0x1F) << 8) | b[2];
+            uint8_t source_cc = b[3] & 0x0F;
+            unchanged = unchanged && getNextCC(pid) == source_cc;
+            continuity_counters_[pid] = source_cc;
+        }
+    }
+    unchanged_run_ = unchanged ? unchanged_run_ + packets.size() : 0;
+    return unchanged;
+}
+
+void StreamSplicer::rebaseHeader(uint8_t* b, size_t header_size, RebaseContext& context) {
+    // Identity mappings still advance the anchors and the global offsets,
+    // but leave the bytes alone (including the PCR reserved bits)
+    bool rewrite = !context.isIdentity();
+    
+    // Rebase PCR if present (adaptation field with PCR_flag, at least 7 bytes)
+    if ((b[3] & 0x20) && b[4] >= 7 && (b[5] & 0x10)) {
+        uint64_t pcr_b = ((uint64_t)b[6] << 25) | ((uint64_t)b[7] << 17) |
+                         ((uint64_t)b[8] << 9) | ((uint64_t)b[9] << 1) | (b[10] >> 7);
+        uint64_t pcr_ext = ((uint64_t)(b[10] & 0x01) << 8) | b[11];
+        
+        uint64_t rebased_pcr = context.mapPCR(pcr_b * 300 + pcr_ext);
+        global_pcr_offset_ = std::max(global_pcr_offset_, rebased_pcr);
+        
+        if (rewrite) {
+            rebased_pcr %= RebaseContext::PCR_MODULUS;  // 42-bit field wrap
+            pcr_b = rebased_pcr / 300;
+            pcr_ext = rebased_pcr % 300;
+            b[6] = (pcr_b >> 25) & 0xFF;
+            b[7] = (pcr_b >> 17) & 0xFF;
+            b[8] = (pcr_b >> 9) & 0xFF;
+            b[9] = (pcr_b >> 1) & 0xFF;
+            b[10] = ((pcr_b & 0x01) << 7) | 0x7E | ((pcr_ext >> 8) & 0x01);
+            b[11] = pcr_ext & 0xFF;
+        }
+    }
+    
+    // Rebase PTS/DTS if this is a PES packet start (PUSI + payload)
+    if ((b[1] & 0x40) && (b[3] & 0x10) && header_size + 14 <= ts::PKT_SIZE) {
+        uint8_t* payload = b + header_size;
         size_t payload_size = ts::PKT_SIZE - header_size;
         
         // Check for PES start code
-        if (payload_size >= 14 && payload[0] == 0x00 && payload[1] == 0x00 && payload[2] == 0x01) {
+        if (payload[0] == 0x00 && payload[1] == 0x00 && payload[2] == 0x01) {
             uint8_t pts_dts_flags = (payload[7] >> 6) & 0x03;
             
             // Rebase PTS
             if (pts_dts_flags == 0x02 || pts_dts_flags == 0x03) {
-                uint64_t pts = ((uint64_t)(payload[9] & 0x0E) << 29) |
-                              ((uint64_t)(payload[10]) << 22) |
-                              ((uint64_t)(payload[11] & 0xFE) << 14) |
-                              ((uint64_t)(payload[12]) << 7) |
-                              ((uint64_t)(payload[13] >> 1));
-                
-                pts = (pts - pts_base) + global_pts_offset_;
-                pts &= 0x1FFFFFFFF;  // 33-bit wrap
-                
-                payload[9] = (payload[9] & 0xF1) | ((pts >> 29) & 0x0E);
-                payload[10] = (pts >> 22) & 0xFF;
-                payload[11] = (payload[11] & 0x01) | ((pts >> 14) & 0xFE);
-                payload[12] = (pts >> 7) & 0xFF;
-                payload[13] = (payload[13] & 0x01) | ((pts << 1) & 0xFE);
+                uint64_t pts = context.mapPTS(readTimestamp(payload + 9));
+                global_pts_offset_ = std::max(global_pts_offset_, pts);
+                if (rewrite) {
+                    writeTimestamp(payload + 9, pts & 0x1FFFFFFFF);  // 33-bit wrap
+                }
             }
             
             // Rebase DTS
             if (pts_dts_flags == 0x03 && payload_size >= 19) {
-                uint64_t dts = ((uint64_t)(payload[14] & 0x0E) << 29) |
-                              ((uint64_t)(payload[15]) << 22) |
-                              ((uint64_t)(payload[16] & 0xFE) << 14) |
-                              ((uint64_t)(payload[17]) << 7) |
-                              ((uint64_t)(payload[18] >> 1));
-                
-                dts = (dts - pts_base) + global_pts_offset_;
-                dts &= 0x1FFFFFFFF;  // 33-bit wrap
-                
-                payload[14] = (payload[14] & 0xF1) | ((dts >> 29) & 0x0E);
-                payload[15] = (dts >> 22) & 0xFF;
-                payload[16] = (payload[16] & 0x01) | ((dts >> 14) & 0xFE);
-                payload[17] = (dts >> 7) & 0xFF;
-                payload[18] = (payload[18] & 0x01) | ((dts << 1) & 0xFE);
+                uint64_t dts = context.mapPTS(readTimestamp(payload + 14));
+                if (rewrite) {
+                    writeTimestamp(payload + 14, dts & 0x1FFFFFFFF);  // 33-bit wrap
+                }
             }
         }
     }
 }
 
-void StreamSplicer::fixContinuityCounter(ts::TSPacket& packet) {
+void StreamSplicer::setNextCC(uint8_t* b) {
     // Only update CC for packets with payload
-    if (packet.hasPayload()) {
-        packet.setCC(getNextCC(packet.getPID()));
+    if (b[3] & 0x10) {
+        ts::PID pid = ((b[1] & 0x1F) << 8) | b[2];
+        b[3] = (b[3] & 0xF0) | getNextCC(pid);
     }
 }
 
 uint8_t StreamSplicer::getNextCC(ts::PID pid) {
-    if (continuity_counters_.find(pid) == continuity_counters_.end()) {
-        continuity_counters_[pid] = 0;
-        return 0;
-    }
-    continuity_counters_[pid] = (continuity_counters_[pid] + 1) & 0x0F;
-    return continuity_counters_[pid];
+    uint8_t& cc = continuity_counters_[pid & 0x1FFF];
+    cc = (cc == CC_UNSET) ? 0 : ((cc + 1) & 0x0F);
+    return cc;
 }
 
 ts::TSPacket StreamSplicer::createPAT(uint16_t program_number, ts::PID pmt_pid) {
@@ -221,15 +362,3 @@ std::vector<ts::TSPacket> StreamSplicer::createSPSPPSPackets(
     
     return packets;
 }
-
-void StreamSplicer::updateOffsetsFromMaxTimestamps(uint64_t max_pts, uint64_t max_pcr) {
-    if (max_pts > 0) {
-        global_pts_offset_ = max_pts;
-    }
-    if (max_pcr > 0) {
-        global_pcr_offset_ = max_pcr;
-    }
-    
-    std::cout << "[StreamSplicer] Updated offsets: PTS=" << global_pts_offset_
-              << ", PCR=" << global_pcr_offset_ << std::endl;
-}
\ No newline at end of file
@@ -2,19 +2,26 @@
 #define STREAM_SPLICER_H
 
 #include <cstdint>
-#include <map>
+#include <array>
+#include <span>
 #include <vector>
 #include <tsduck.h>
+#include "RebaseContext.h"
 
 /**
  * StreamSplicer - Handle clean splicing with timestamp rebasing
  * 
  * Based on multi2/src/tcp_main.cpp splice logic:
  * - Maintains global PTS/PCR offsets for continuous timeline
- * - Rebases timestamps using relative calculation
+ * - Rebases timestamps using relative calculation (per-source RebaseContext,
+ *   applied to every packet, wrap-safe)
  * - Manages continuity counters across all PIDs
  * - Creates PAT/PMT with TSDuck
  * - Creates SPS/PPS injection packets
+ *
+ * The per-packet paths (rebase, CC) work on the raw TS header bytes and a
+ * flat 8192-entry PID table; rebaseAndFixContinuity() does both in a single
+ * header/adaptation-field parse and has a std::span batch form.
  */
 class StreamSplicer {
 public:
@@ -23,14 +30,61 @@ public:
     // Initialize with PCR/PTS alignment offset (from first stream)
     void initializeWithAlignmentOffset(int64_t alignment_offset);
     
+    // Start the output timeline on the first stream's own timestamps. Keeps
+    // the same PCR/PTS gap as initializeWithAlignmentOffset(), and leaves the
+    // first segment an identity mapping (eligible for passthrough).
+    void initializeAtSource(uint64_t pts_base, uint64_t pcr_base);
+    
+    // Put a source on air: map its bases onto the current end of the output timeline
+    void beginSegment(RebaseContext& context,
+                      uint64_t pts_base, uint64_t pcr_base,
+                      int64_t pcr_pts_alignment);
+    
+    // Put a source back on air on its own timestamps (identity mapping,
+    // eligible for passthrough) when they are at or at most the realign gap
+    // ahead of the end of the output timeline; the output skips the gap.
+    // Otherwise same as beginSegment(). Returns true for identity: the
+    // caller must then realign each PID's CC with createContinuityReset().
+    bool beginSegmentAtSource(RebaseContext& context,
+                              uint64_t pts_base, uint64_t pcr_base,
+                              int64_t pcr_pts_alignment);
+    
+    // Largest forward jump (90 kHz) beginSegmentAtSource() may put in the output
+    void setMaxRealignGap(uint64_t pts_ticks) { max_realign_gap_ = pts_ticks; }
+    uint64_t getMaxRealignGap() const { return max_realign_gap_; }
+    
+    // Adaptation-field-only packet on `pid` with the discontinuity_indicator
+    // set, whose CC makes next_cc the next one in sequence; the next payload
+    // packet on the PID gets next_cc. Lets a source's own counters (and, on
+    // the PCR PID, its time base) carry on into the output.
+    ts::TSPacket createContinuityReset(ts::PID pid, uint8_t next_cc);
+    
     // Rebase packet timestamps
-    void rebasePacket(ts::TSPacket& packet, 
-                     uint64_t pts_base, uint64_t pcr_base,
-                     int64_t pcr_pts_alignment);
+    void rebasePacket(ts::TSPacket& packet, RebaseContext& context);
     
     // Fix continuity counter for packet
     void fixContinuityCounter(ts::TSPacket& packet);
     
+    // Rebase + fix CC in one pass over the header (same result as calling both)
+    void rebaseAndFixContinuity(ts::TSPacket& packet, RebaseContext& context);
+    
+    // Batch forms for whole reads/snapshots
+    void fixContinuityCounters(std::span<ts::TSPacket> packets);
+    void rebaseAndFixContinuity(std::span<ts::TSPacket> packets, RebaseContext& context);
+    
+    // Make the next CC on a PID that has not been output yet equal next_cc,
+    // so a source's own counters can carry on unchanged
+    void seedContinuity(ts::PID pid, uint8_t next_cc);
+    
+    // Packets in a row that rebaseAndFixContinuity() left byte-for-byte
+    // unchanged (identity mapping, source CC already in phase)
+    uint64_t getUnchangedRun() const { return unchanged_run_; }
+    
+    // Account for packets that reached the output without passing through
+    // here (passthrough): track their timestamps and adopt their CCs.
+    // Returns false if any of them would have been rewritten.
+    bool trackPassthrough(std::span<ts::TSPacket> packets, RebaseContext& context);
+    
     // Create PAT packet
     ts::TSPacket createPAT(uint16_t program_number, ts::PID pmt_pid);
     
@@ -46,26 +100,37 @@ public:
         ts::PID video_pid,
         uint64_t pts);
     
-    // Update global offsets after processing a segment
-    void updateOffsetsFromMaxTimestamps(uint64_t max_pts, uint64_t max_pcr);
-    
-    // Get current global offsets
+    // Get current global offsets (end of the output timeline so far, unwrapped)
     uint64_t getGlobalPTSOffset() const { return global_pts_offset_; }
     uint64_t getGlobalPCROffset() const { return global_pcr_offset_; }
     
 private:
-    // Global timestamp offsets
+    // Global timestamp offsets: highest PTS/PCR written so far (unwrapped),
+    // where the next segment starts
     uint64_t global_pts_offset_;
     uint64_t global_pcr_offset_;
     
-    // Continuity counter state for all PIDs
-    std::map<ts::PID, uint8_t> continuity_counters_;
+    // Continuity counter state for all PIDs, indexed by PID (CC_UNSET = not seen yet)
+    static constexpr uint8_t CC_UNSET = 0xFF;
+    std::array<uint8_t, ts::PID_MAX> continuity_counters_;
+    
+    // See getUnchangedRun()
+    uint64_t unchanged_run_;
+    
+    // See setMaxRealignGap()
+    uint64_t max_realign_gap_;
     
     // TSDuck context for table generation
     ts::DuckContext duck_;
     
+    static constexpr uint64_t DEFAULT_MAX_REALIGN_GAP = 45000;    // 500 ms
+    
     // Helper: Get next continuity counter for PID
     uint8_t getNextCC(ts::PID pid);
+    
+    // Raw-byte kernels shared by the single-packet and batch entry points
+    void rebaseHeader(uint8_t* b, size_t header_size, RebaseContext& context);
+    void setNextCC(uint8_t* b);
 };
 
 #endif // STREAM_SPLICER_H
\ No newline at end of file
@@ -67,7 +67,7 @@ bool TCPOutput::connect() {
         if (ret != 0) {
             std::cerr << "[TCPOutput] Failed to resolve hostname '" << host_ << "': "
                       << gai_strerror(ret) << std::endl;
-            close(sockfd_);
+            ::close(sockfd_);
             sockfd_ = -1;
             
             if (!running_.load()) {
@@ -92,7 +92,7 @@ bool TCPOutput::connect() {
         
         if (!connection_success) {
             std::cerr << "[TCPOutput] Connection failed: " << strerror(errno) << std::endl;
-            close(sockfd_);
+            ::close(sockfd_);
             sockfd_ = -1;
             
             if (!running_.load()) {
@@ -120,7 +120,7 @@ void TCPOutput::disconnect() {
     if (sockfd_ >= 0) {
         std::cout << "[TCPOutput] Disconnecting..." << std::endl;
         shutdown(sockfd_, SHUT_RDWR);
-        close(sockfd_);
+        ::close(sockfd_);
         sockfd_ = -1;
     }
     connected_ = false;
@@ -131,22 +131,78 @@ void TCPOutput::disconnect() {
 }
 
 bool TCPOutput::writePacket(const ts::TSPacket& packet) {
+    if (batcher_.stage(packet)) {
+        return flush();
+    }
+    return true;
+}
+
+bool TCPOutput::writePackets(const std::vector<ts::TSPacket>& packets) {
+    return writePackets(packets.data(), packets.size());
+}
+
+bool TCPOutput::writePackets(const ts::TSPacket* packets, size_t count) {
+    // A full batch's worth: write queued + caller packets with one writev, no copy
+    if (batcher_.stagedPackets() + count >= batcher_.flushPackets()) {
+        return flushWith(packets, count);
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        batcher_.stage(packets[i]);
+    }
+    return flushIfDue();
+}
+
+bool TCPOutput::commit(size_t count) {
+    if (batcher_.commit(count)) {
+        return flush();
+    }
+    return true;
+}
+
+bool TCPOutput::flush() {
+    return flushWith(nullptr, 0);
+}
+
+bool TCPOutput::flushIfDue() {
+    if (batcher_.isFlushDue()) {
+        return flush();
+    }
+    return true;
+}
+
+void TCPOutput::setBatching(size_t flush_packets, int flush_deadline_ms) {
+    flush();
+    batcher_.configure(flush_packets, flush_deadline_ms);
+    std::cout << "[TCPOutput] Batching: flush at " << batcher_.flushPackets()
+              << " packets or " << flush_deadline_ms << " ms" << std::endl;
+}
+
+bool TCPOutput::flushWith(const ts::TSPacket* extra, size_t count) {
+    size_t expected = batcher_.stagedPackets() + count;
+    if (expected == 0) {
+        return true;
+    }
+    
     // Auto-reconnect if not connected
     if (!connected_.load()) {
         std::cout << "[TCPOutput] Not connected - attempting to reconnect..." << std::endl;
         if (!connect()) {
             // connect() failed (likely shutdown requested)
+            batcher_.discard();
             return false;
         }
     }
     
-    // Write 188-byte TS packet
-    ssize_t written = write(sockfd_, packet.b, ts::PKT_SIZE);
+    size_t written = 0;
+    int err = batcher_.flush(sockfd_, extra, count, written);
     
-    if (written != ts::PKT_SIZE) {
-        int err = errno;
-        std::cerr << "[TCPOutput] Write failed - expected " << ts::PKT_SIZE
-                  << " bytes, wrote " << written << " bytes, errno=" << err
+    packets_written_ += written;
+    bytes_written_ += written * ts::PKT_SIZE;
+    
+    if (err != 0) {
+        std::cerr << "[TCPOutput] Write failed - expected " << expected
+                  << " packets, wrote " << written << " packets, errno=" << err
                   << " (" << strerror(err) << ")" << std::endl;
         
         // Connection lost - cleanup and reconnect
@@ -158,22 +214,11 @@ bool TCPOutput::writePacket(const ts::TSPacket& packet) {
             return false;
         }
         
-        // Successfully reconnected but this packet is lost
-        std::cout << "[TCPOutput] Reconnected - packet dropped during reconnection" << std::endl;
+        // Successfully reconnected but the rest of this batch is lost
+        std::cout << "[TCPOutput] Reconnected - " << (expected - written)
+                  << " packets dropped during reconnection" << std::endl;
         return false;
     }
     
-    packets_written_++;
-    bytes_written_ += ts::PKT_SIZE;
-    
     return true;
 }
-
-bool TCPOutput::writePackets(const std::vector<ts::TSPacket>& packets) {
-    for (const auto& packet : packets) {
-        if (!writePacket(packet)) {
-            return false;
-        }
-    }
-    return true;
-}
\ No newline at end of file
@@ -2,20 +2,25 @@
 #define TCP_OUTPUT_H
 
 #include <string>
+#include <vector>
 #include <atomic>
 #include <cstdint>
 #include <tsduck.h>
+#include "OutputBatcher.h"
+#include "PacketSink.h"
 
 /**
  * TCPOutput - Simple TCP client for writing TS packets
  * 
  * Connects to FFmpeg TCP server (listen mode) and writes MPEG-TS packets.
  * Uses 2MB send buffer matching ffmpeg-fallback settings.
+ * Packets are batched (see OutputBatcher) and written with writev().
+ * As a PacketSink, open() / close() are connect() / disconnect().
  */
-class TCPOutput {
+class TCPOutput : public PacketSink {
 public:
     TCPOutput(const std::string& host, uint16_t port, const std::atomic<bool>& running);
-    ~TCPOutput();
+    ~TCPOutput() override;
     
     // Connect to FFmpeg TCP server
     bool connect();
@@ -23,20 +28,45 @@ public:
     // Disconnect and cleanup
     void disconnect();
     
-    // Write a single TS packet
-    bool writePacket(const ts::TSPacket& packet);
+    bool open() override { return connect(); }
+    void close() override { disconnect(); }
     
-    // Write multiple TS packets
+    // Queue a single TS packet, flushing when the batch is due
+    bool writePacket(const ts::TSPacket& packet) override;
+    
+    // Write multiple TS packets (large batches go straight to writev without copying)
     bool writePackets(const std::vector<ts::TSPacket>& packets);
+    bool writePackets(const ts::TSPacket* packets, size_t count) override;
+    
+    // Room for `count` packets in the output batch, to be filled in place
+    // (nullptr on allocation failure). commit() queues them and flushes if due.
+    ts::TSPacket* reserve(size_t count) override { return batcher_.reserve(count); }
+    bool commit(size_t count) override;
+    
+    // Write all queued packets now
+    bool flush() override;
+    
+    // Write queued packets if the batch deadline has passed
+    bool flushIfDue() override;
+    
+    // Batch size and latency deadline (see OutputBatcher::configure)
+    void setBatching(size_t flush_packets, int flush_deadline_ms) override;
+    
+    // How long a caller may block before the next flushIfDue() is needed
+    int getFlushWaitMs(int max_wait_ms) const override { return batcher_.msUntilDeadline(max_wait_ms); }
     
     // Connection status
     bool isConnected() const { return connected_.load(); }
     
     // Statistics
-    uint64_t getPacketsWritten() const { return packets_written_.load(); }
-    uint64_t getBytesWritten() const { return bytes_written_.load(); }
+    uint64_t getPacketsWritten() const override { return packets_written_.load(); }
+    uint64_t getBytesWritten() const override { return bytes_written_.load(); }
+    uint64_t getWriteCalls() const { return batcher_.getWriteCallCount(); }
     
 private:
+    // Write queued packets plus `count` caller packets in one writev pass
+    bool flushWith(const ts::TSPacket* extra, size_t count);
+    
     std::string host_;
     uint16_t port_;
     int sockfd_;
@@ -46,6 +76,8 @@ private:
     std::atomic<uint64_t> packets_written_;
     std::atomic<uint64_t> bytes_written_;
     
+    OutputBatcher batcher_;
+    
     static constexpr int TCP_SEND_BUFFER_SIZE = 2 * 1024 * 1024;  // 2MB
     static constexpr int TCP_RECONNECT_DELAY_MS = 2000;  // 2 seconds
 };
@@ -1,27 +1,44 @@
 #ifndef TS_STREAM_REASSEMBLER_H
 #define TS_STREAM_REASSEMBLER_H
 
-#include <deque>
 #include <vector>
 #include <atomic>
 #include <cstring>
+#include <cstdint>
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <tsduck.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TS_REASSEMBLER_X86 1
+#endif
+
 /**
  * TSStreamReassembler - MPEG-TS Stream Reassembly from Arbitrary Byte Chunks
- * 
- * Handles reassembly of MPEG-TS packets from UDP datagrams that may:
+ *
+ * Handles reassembly of MPEG-TS packets from UDP datagrams / pipe or TCP
+ * reads that may:
  * - Split TS packets across datagram boundaries
  * - Contain partial packets at the start/end
  * - Arrive with arbitrary sizes
- * 
+ *
  * Uses a 3-state sync verification algorithm:
  * 1. SEARCHING: Scan for sync byte (0x47)
  * 2. VERIFYING: Verify 3 consecutive packets at 188-byte intervals
  * 3. SYNCED: Extract aligned packets, verify each sync byte
- * 
+ *
+ * Performance notes:
+ * - Pending bytes live in one contiguous buffer (no per-byte deque inserts)
+ * - SEARCHING uses SSE2/AVX2 (scalar fallback elsewhere) to find offsets
+ *   where 0x47 repeats at a 188-byte stride, so junk is skipped 16/32 bytes
+ *   at a time
+ * - Once SYNCED, aligned packets are handed out straight from the caller's
+ *   read buffer without copying (see the addData overload with a handler)
+ *
+ * Shared by src/ (multiplexer) and multi2/ (ts_tcp_splicer).
+ *
  * Thread-safety: addData/getPackets should be called from single thread.
  * Statistics are atomic for safe cross-thread reads.
  */
@@ -38,79 +55,47 @@ public:
      * @param requiredSyncPackets Number of consecutive packets to verify (default: 3)
      * @param maxBufferSize Maximum buffer size in bytes (default: 1MB)
      */
-    explicit TSStreamReassembler(size_t requiredSyncPackets = 3, 
+    explicit TSStreamReassembler(size_t requiredSyncPackets = 3,
                                   size_t maxBufferSize = 1024 * 1024)
-        : requiredSyncPackets_(requiredSyncPackets)
-        , maxBufferSize_(maxBufferSize) {}
+        : requiredSyncPackets_(std::max<size_t>(requiredSyncPackets, 1))
+        , maxBufferSize_(maxBufferSize) {
+        buffer_.reserve(std::min<size_t>(maxBufferSize_, 256 * 1024));
+    }
 
     /**
-     * Add raw bytes from UDP datagram
+     * Add raw bytes and receive complete packets through a callback
+     *
+     * The handler is called as handler(const ts::TSPacket* packets, size_t count)
+     * one or more times. The pointer is only valid during the call: when the
+     * stream is aligned it points directly into `data`.
+     *
      * @param data Pointer to raw bytes
      * @param length Number of bytes
+     * @param handler Callback receiving runs of complete packets
      */
-    void addData(const uint8_t* data, size_t length) {
+    template <typename Handler>
+    void addData(const uint8_t* data, size_t length, Handler&& handler) {
         totalBytesReceived_ += length;
         datagramCount_++;
-        
-        // Append data to buffer
-        buffer_.insert(buffer_.end(), data, data + length);
-        
-        // Enforce buffer size limit
-        if (buffer_.size() > maxBufferSize_) {
-            size_t rawDiscard = buffer_.size() - maxBufferSize_;
-            
-            // CRITICAL FIX: Discard in multiples of TS_PACKET_SIZE to maintain alignment!
-            // If we were synced, round UP to next packet boundary to avoid losing sync
-            size_t toDiscard;
-            if (state_ == State::SYNCED) {
-                // Round UP to maintain packet alignment
-                toDiscard = ((rawDiscard + TS_PACKET_SIZE - 1) / TS_PACKET_SIZE) * TS_PACKET_SIZE;
-            } else {
-                // Not synced anyway, just discard what we need
-                toDiscard = rawDiscard;
-            }
-            
-            // Make sure we don't discard more than buffer size
-            if (toDiscard > buffer_.size()) {
-                toDiscard = (buffer_.size() / TS_PACKET_SIZE) * TS_PACKET_SIZE;
-            }
-            
-            // DEBUG: Log overflow event with context
-            if (overflowEvents_ < 5 || overflowEvents_ % 100 == 0) {
-                std::cerr << "[REASSEMBLER] OVERFLOW #" << (overflowEvents_ + 1)
-                          << ": buffer=" << buffer_.size() << " bytes"
-                          << ", rawDiscard=" << rawDiscard
-                          << ", alignedDiscard=" << toDiscard
-                          << " (" << (toDiscard / TS_PACKET_SIZE) << " packets)"
-                          << ", state=" << stateToString(state_)
-                          << ", packetsOutput=" << packetsOutput_.load() << "\n";
-            }
-            overflowEvents_++;
-            
-            if (toDiscard > 0) {
-                buffer_.erase(buffer_.begin(), buffer_.begin() + toDiscard);
-                bytesDiscarded_ += toDiscard;
-                packetsDiscarded_ += toDiscard / TS_PACKET_SIZE;
-            }
-            
-            // If we were synced and discarded aligned packets, we should STAY synced!
-            // Only lose sync if we couldn't maintain alignment
-            if (state_ == State::SYNCED && (toDiscard % TS_PACKET_SIZE) != 0) {
-                syncLosses_++;
-                state_ = State::SEARCHING;
-                syncOffset_ = 0;
-            }
-            // If synced and aligned discard, stay synced - the next byte should still be 0x47
+
+        if (state_ == State::SYNCED) {
+            size_t consumed = consumeSyncedInput(data, length, handler);
+            data += consumed;
+            length -= consumed;
         }
-        
-        // Process buffer through state machine
-        processBuffer();
-        
+
+        if (length > 0) {
+            appendToBuffer(data, length);
+            processBuffer(handler);
+        }
+
+        compactBuffer();
+
         // DEBUG: Periodically log processing stats
         if (datagramCount_ % 500 == 0) {
             std::cerr << "[REASSEMBLER] Stats after " << datagramCount_ << " datagrams:\n"
                       << "  - Total bytes received: " << totalBytesReceived_ << "\n"
-                      << "  - Pending buffer: " << buffer_.size() << " bytes\n"
+                      << "  - Pending buffer: " << pendingBytes() << " bytes\n"
                       << "  - State: " << stateToString(state_) << "\n"
                       << "  - Packets output: " << packetsOutput_.load() << "\n"
                       << "  - Overflow events: " << overflowEvents_ << "\n"
@@ -118,6 +103,18 @@ public:
         }
     }
 
+    /**
+     * Add raw bytes from UDP datagram / read() chunk
+     * Complete packets are queued for getPackets()
+     * @param data Pointer to raw bytes
+     * @param length Number of bytes
+     */
+    void addData(const uint8_t* data, size_t length) {
+        addData(data, length, [this](const ts::TSPacket* packets, size_t count) {
+            outputQueue_.insert(outputQueue_.end(), packets, packets + count);
+        });
+    }
+
     /**
      * Get complete TS packets extracted from stream
      * Clears internal output queue
@@ -133,7 +130,7 @@ public:
     size_t getBytesDiscarded() const { return bytesDiscarded_.load(); }
     size_t getSyncLosses() const { return syncLosses_.load(); }
     size_t getPacketsOutput() const { return packetsOutput_.load(); }
-    size_t getPendingBytes() const { return buffer_.size(); }
+    size_t getPendingBytes() const { return pendingBytes(); }
     State getCurrentState() const { return state_; }
 
     /**
@@ -141,20 +138,53 @@ public:
      */
     void reset() {
         buffer_.clear();
+        readPos_ = 0;
         outputQueue_.clear();
         state_ = State::SEARCHING;
         syncOffset_ = 0;
         verifyCount_ = 0;
     }
 
+    /**
+     * Find the first offset i in data[0, length) where a sync byte repeats
+     * `stride_count` times at 188-byte intervals. Only offsets whose whole
+     * stride fits in the buffer are considered.
+     * @return Offset of the candidate, or length if none
+     */
+    static size_t findStrideSync(const uint8_t* data, size_t length, size_t stride_count) {
+        size_t span = (stride_count - 1) * TS_PACKET_SIZE;
+        if (length <= span) return length;
+        size_t limit = length - span;  // candidates are [0, limit)
+        size_t i = 0;
+
+#ifdef TS_REASSEMBLER_X86
+        if (cpuHasAVX2() && findStrideSyncAVX2(data, limit, stride_count, i)) {
+            return i;
+        }
+        if (findStrideSyncSSE2(data, limit, stride_count, i)) {
+            return i;
+        }
+#endif
+
+        for (; i < limit; i++) {
+            bool match = true;
+            for (size_t k = 0; k < stride_count && match; k++) {
+                match = data[i + k * TS_PACKET_SIZE] == TS_SYNC_BYTE;
+            }
+            if (match) return i;
+        }
+        return length;
+    }
+
 private:
     static constexpr size_t TS_PACKET_SIZE = 188;
     static constexpr uint8_t TS_SYNC_BYTE = 0x47;
 
-    std::deque<uint8_t> buffer_;            // Raw byte accumulator
-    std::vector<ts::TSPacket> outputQueue_; // Ready packets
+    std::vector<uint8_t> buffer_;           // Contiguous pending bytes [readPos_, size)
+    size_t readPos_ = 0;                    // Start of unconsumed data in buffer_
+    std::vector<ts::TSPacket> outputQueue_; // Ready packets (getPackets() API)
     State state_ = State::SEARCHING;
-    size_t syncOffset_ = 0;                 // Current sync position in buffer
+    size_t syncOffset_ = 0;                 // Current sync position (relative to readPos_)
     size_t verifyCount_ = 0;                // Packets verified in VERIFYING state
     const size_t requiredSyncPackets_;
     const size_t maxBufferSize_;
@@ -163,14 +193,15 @@ private:
     std::atomic<size_t> bytesDiscarded_{0};
     std::atomic<size_t> syncLosses_{0};
     std::atomic<size_t> packetsOutput_{0};
-    
+
     // Debug counters
     size_t datagramCount_{0};
     size_t totalBytesReceived_{0};
     size_t overflowEvents_{0};
     size_t falseVerifyAttempts_{0};
     size_t packetsDiscarded_{0};
-    
+    size_t syncLockCount_{0};
+
     const char* stateToString(State s) const {
         switch (s) {
             case State::SEARCHING: return "SEARCHING";
@@ -180,241 +211,328 @@ private:
         }
     }
 
+    size_t pendingBytes() const { return buffer_.size() - readPos_; }
+    const uint8_t* pending() const { return buffer_.data() + readPos_; }
+
+    void discard(size_t bytes) {
+        readPos_ += bytes;
+        bytesDiscarded_ += bytes;
+    }
+
+    // TSPacket is a plain 188-byte array, so aligned input can be viewed in place
+    static const ts::TSPacket* asPackets(const uint8_t* data) {
+        return reinterpret_cast<const ts::TSPacket*>(data);
+    }
+
     /**
-     * Check if byte at offset is a sync byte
+     * Count consecutive packets starting at data that carry a sync byte
      */
-    bool isSyncByte(size_t offset) const {
-        return offset < buffer_.size() && buffer_[offset] == TS_SYNC_BYTE;
+    static size_t countAlignedPackets(const uint8_t* data, size_t length) {
+        size_t count = 0;
+        while ((count + 1) * TS_PACKET_SIZE <= length && data[count * TS_PACKET_SIZE] == TS_SYNC_BYTE) {
+            count++;
+        }
+        return count;
     }
-    
+
     /**
-     * Extract PID from packet header at given offset
-     * PID is 13 bits: 5 bits from byte 1 (bits 4-0) + 8 bits from byte 2
+     * SYNCED fast path: finish a partial packet left in the buffer, then emit
+     * aligned packets directly from the caller's data.
+     * @return Number of input bytes consumed
      */
-    uint16_t extractPID(size_t offset) const {
-        if (offset + 2 >= buffer_.size()) return 0xFFFF; // Invalid
-        uint16_t pid = ((buffer_[offset + 1] & 0x1F) << 8) | buffer_[offset + 2];
-        return pid;
+    template <typename Handler>
+    size_t consumeSyncedInput(const uint8_t* data, size_t length, Handler& handler) {
+        size_t consumed = 0;
+        size_t pendingLen = pendingBytes();
+
+        if (pendingLen > 0) {
+            if (pendingLen >= TS_PACKET_SIZE) {
+                return 0;  // Let the buffered path drain first
+            }
+            // Complete the partial packet with bytes from this read
+            size_t need = TS_PACKET_SIZE - pendingLen;
+            if (length < need) {
+                return 0;
+            }
+            appendToBuffer(data, need);
+            consumed = need;
+            if (pending()[0] != TS_SYNC_BYTE) {
+                return consumed;  // processBuffer() handles the sync loss
+            }
+            handler(asPackets(pending()), 1);
+            packetsOutput_++;
+            readPos_ += TS_PACKET_SIZE;
+        }
+
+        size_t count = countAlignedPackets(data + consumed, length - consumed);
+        if (count > 0) {
+            handler(asPackets(data + consumed), count);
+            packetsOutput_ += count;
+            consumed += count * TS_PACKET_SIZE;
+        }
+
+        return consumed;
+    }
+
+    void appendToBuffer(const uint8_t* data, size_t length) {
+        buffer_.insert(buffer_.end(), data, data + length);
+
+        // Enforce buffer size limit
+        if (pendingBytes() > maxBufferSize_) {
+            size_t rawDiscard = pendingBytes() - maxBufferSize_;
+
+            // CRITICAL FIX: Discard in multiples of TS_PACKET_SIZE to maintain alignment!
+            // If we were synced, round UP to next packet boundary to avoid losing sync
+            size_t toDiscard;
+            if (state_ == State::SYNCED) {
+                toDiscard = ((rawDiscard + TS_PACKET_SIZE - 1) / TS_PACKET_SIZE) * TS_PACKET_SIZE;
+            } else {
+                toDiscard = rawDiscard;
+            }
+
+            // Make sure we don't discard more than buffer size
+            if (toDiscard > pendingBytes()) {
+                toDiscard = (pendingBytes() / TS_PACKET_SIZE) * TS_PACKET_SIZE;
+            }
+
+            // DEBUG: Log overflow event with context
+            if (overflowEvents_ < 5 || overflowEvents_ % 100 == 0) {
+                std::cerr << "[REASSEMBLER] OVERFLOW #" << (overflowEvents_ + 1)
+                          << ": buffer=" << pendingBytes() << " bytes"
+                          << ", rawDiscard=" << rawDiscard
+                          << ", alignedDiscard=" << toDiscard
+                          << " (" << (toDiscard / TS_PACKET_SIZE) << " packets)"
+                          << ", state=" << stateToString(state_)
+                          << ", packetsOutput=" << packetsOutput_.load() << "\n";
+            }
+            overflowEvents_++;
+
+            if (toDiscard > 0) {
+                discard(toDiscard);
+                packetsDiscarded_ += toDiscard / TS_PACKET_SIZE;
+            }
+
+            // If we were synced and discarded aligned packets, we stay synced
+            if (state_ == State::SYNCED && (toDiscard % TS_PACKET_SIZE) != 0) {
+                syncLosses_++;
+                state_ = State::SEARCHING;
+                syncOffset_ = 0;
+            }
+            if (state_ == State::VERIFYING) {
+                state_ = State::SEARCHING;
+            }
+        }
     }
-    
+
     /**
-     * Check if a packet at offset has a valid TS header (sync byte + valid PID)
-     * Valid PIDs are 0x0000-0x1FFF (8191)
+     * Drop consumed bytes from the front once they dominate the buffer
      */
-    bool isValidTSHeader(size_t offset) const {
-        if (!isSyncByte(offset)) return false;
-        if (offset + 2 >= buffer_.size()) return false;
-        uint16_t pid = extractPID(offset);
-        // PID must be in valid range (0x0000-0x1FFF)
-        // Note: PID 0x1FFF is null packet, which is valid
-        return pid <= 0x1FFF;
+    void compactBuffer() {
+        if (readPos_ == buffer_.size()) {
+            buffer_.clear();
+            readPos_ = 0;
+        } else if (readPos_ > 64 * 1024 && readPos_ > buffer_.size() / 2) {
+            buffer_.erase(buffer_.begin(), buffer_.begin() + readPos_);
+            readPos_ = 0;
+        }
     }
 
     /**
      * Process buffer through state machine
      */
-    void processBuffer() {
+    template <typename Handler>
+    void processBuffer(Handler& handler) {
         bool continueProcessing = true;
-        
+
         while (continueProcessing) {
             switch (state_) {
                 case State::SEARCHING:
                     continueProcessing = processSearching();
                     break;
-                
+
                 case State::VERIFYING:
                     continueProcessing = processVerifying();
                     break;
-                
+
                 case State::SYNCED:
-                    continueProcessing = processSynced();
+                    continueProcessing = processSynced(handler);
                     break;
             }
         }
     }
 
     /**
-     * SEARCHING state: Scan for sync byte with valid PID
+     * SEARCHING state: Skip to the next plausible sync position
      * @return true if state changed and processing should continue
      */
     bool processSearching() {
-        // Scan buffer for sync byte with valid PID
-        while (buffer_.size() >= TS_PACKET_SIZE) {
-            if (isValidTSHeader(0)) {
-                // Found potential sync with valid PID
-                syncOffset_ = 0;
-                verifyCount_ = 0;
-                state_ = State::VERIFYING;
-                
-                // DEBUG: Log valid sync candidate found
-                static size_t validCandidates = 0;
-                validCandidates++;
-                if (validCandidates <= 5 || validCandidates % 100 == 0) {
-                    uint16_t pid = extractPID(0);
-                    std::cerr << "[REASSEMBLER] Found valid sync candidate #" << validCandidates
-                              << ": PID=" << pid << " (0x" << std::hex << pid << std::dec << ")\n";
-                }
-                
-                return true; // State changed, continue processing
-            }
-            
-            // Not a valid sync position (either not 0x47 or invalid PID)
-            // DEBUG: Log rejected candidates
-            if (buffer_[0] == TS_SYNC_BYTE) {
-                // It was 0x47 but invalid PID - this is the false sync we're catching!
-                static size_t rejectedFalseSync = 0;
-                rejectedFalseSync++;
-                if (rejectedFalseSync <= 10 || rejectedFalseSync % 500 == 0) {
-                    uint16_t badPid = extractPID(0);
-                    std::cerr << "[REASSEMBLER] Rejected false sync #" << rejectedFalseSync
-                              << ": byte=0x47 but PID=" << badPid
-                              << " (0x" << std::hex << badPid << std::dec << ") > 8191\n";
-                }
-            }
-            
-            buffer_.pop_front();
-            bytesDiscarded_++;
+        size_t available = pendingBytes();
+        if (available < TS_PACKET_SIZE) {
+            return false; // Need more data
         }
-        
-        return false; // Need more data
+
+        // Prefer offsets where the sync byte already repeats at a 188-byte stride
+        size_t candidate = findStrideSync(pending(), available, requiredSyncPackets_);
+        if (candidate == available) {
+            // Not enough lookahead for a full stride check near the end:
+            // fall back to the first plain sync byte past the scanned region
+            size_t span = (requiredSyncPackets_ - 1) * TS_PACKET_SIZE;
+            size_t from = available > span ? available - span : 0;
+            const void* hit = std::memchr(pending() + from, TS_SYNC_BYTE, available - from);
+            candidate = hit ? static_cast<size_t>(static_cast<const uint8_t*>(hit) - pending()) : available;
+        }
+
+        discard(candidate);
+        if (pendingBytes() == 0) {
+            return false; // Need more data
+        }
+
+        syncOffset_ = 0;
+        verifyCount_ = 0;
+        state_ = State::VERIFYING;
+        return true; // State changed, continue processing
     }
 
     /**
-     * VERIFYING state: Verify consecutive sync bytes with valid PIDs at 188-byte intervals
+     * VERIFYING state: Verify consecutive sync bytes at 188-byte intervals
      * @return true if state changed and processing should continue
      */
     bool processVerifying() {
-        // Check if we have enough data to verify next packet
-        size_t nextPacketOffset = syncOffset_ + (verifyCount_ * TS_PACKET_SIZE);
-        
-        if (nextPacketOffset + TS_PACKET_SIZE > buffer_.size()) {
-            return false; // Need more data
-        }
-        
-        // Check for valid TS header (sync byte + valid PID) at expected position
-        if (!isValidTSHeader(nextPacketOffset)) {
-            // Verification failed - not a valid sync pattern
-            falseVerifyAttempts_++;
-            
-            // DEBUG: Log verification failures (first few and periodically)
-            if (falseVerifyAttempts_ <= 5 || falseVerifyAttempts_ % 100 == 0) {
-                uint8_t byte0 = buffer_[nextPacketOffset];
-                uint16_t pid = extractPID(nextPacketOffset);
-                std::cerr << "[REASSEMBLER] Verify FAILED #" << falseVerifyAttempts_
-                          << ": at offset " << nextPacketOffset
-                          << ", byte=0x" << std::hex << std::setfill('0') << std::setw(2) << (int)byte0
-                          << ", PID=" << std::dec << pid << " (0x" << std::hex << pid << std::dec << ")"
-                          << ", verifyCount=" << verifyCount_
-                          << ", bufferSize=" << buffer_.size() << "\n";
+        while (verifyCount_ < requiredSyncPackets_) {
+            // Check if we have enough data to verify next packet
+            size_t nextPacketOffset = syncOffset_ + (verifyCount_ * TS_PACKET_SIZE);
+
+            if (nextPacketOffset + TS_PACKET_SIZE > pendingBytes()) {
+                return false; // Need more data
             }
-            
-            // Discard the candidate sync byte and search again
-            buffer_.pop_front();
-            bytesDiscarded_++;
-            state_ = State::SEARCHING;
-            return true; // State changed, continue processing
-        }
-        
-        // Valid TS header verified at this position
-        verifyCount_++;
-        
-        if (verifyCount_ >= requiredSyncPackets_) {
-            // Successfully verified required number of packets
-            // DEBUG: Log successful sync lock
-            static size_t syncLockCount = 0;
-            syncLockCount++;
-            if (syncLockCount <= 3 || syncLockCount % 50 == 0) {
-                std::cerr << "[REASSEMBLER] SYNC LOCKED #" << syncLockCount
-                          << " after verifying " << verifyCount_ << " packets"
-                          << ", buffer=" << buffer_.size() << " bytes\n";
+
+            if (pending()[nextPacketOffset] != TS_SYNC_BYTE) {
+                // Verification failed - not a valid sync pattern
+                falseVerifyAttempts_++;
+
+                // DEBUG: Log verification failures (first few and periodically)
+                if (falseVerifyAttempts_ <= 5 || falseVerifyAttempts_ % 100 == 0) {
+                    std::cerr << "[REASSEMBLER] Verify FAILED #" << falseVerifyAttempts_
+                              << ": at offset " << nextPacketOffset
+                              << ", byte=0x" << std::hex << std::setfill('0') << std::setw(2)
+                              << (int)pending()[nextPacketOffset] << std::dec
+                              << ", verifyCount=" << verifyCount_
+                              << ", bufferSize=" << pendingBytes() << "\n";
+                }
+
+                // Discard the candidate sync byte and search again
+                discard(1);
+                state_ = State::SEARCHING;
+                return true; // State changed, continue processing
             }
-            state_ = State::SYNCED;
-            return true; // State changed, continue processing
+
+            verifyCount_++;
+        }
+
+        // Successfully verified required number of packets
+        syncLockCount_++;
+        if (syncLockCount_ <= 3 || syncLockCount_ % 50 == 0) {
+            std::cerr << "[REASSEMBLER] SYNC LOCKED #" << syncLockCount_
+                      << " after verifying " << verifyCount_ << " packets"
+                      << ", buffer=" << pendingBytes() << " bytes\n";
         }
-        
-        return false; // Need more data to verify next packet
+        state_ = State::SYNCED;
+        return true; // State changed, continue processing
     }
 
     /**
-     * SYNCED state: Extract aligned packets
+     * SYNCED state: Extract aligned packets from the buffer in runs
      * @return true if state changed and processing should continue
      */
-    bool processSynced() {
-        // Check if we have a complete packet
-        if (buffer_.size() < TS_PACKET_SIZE) {
+    template <typename Handler>
+    bool processSynced(Handler& handler) {
+        if (pendingBytes() < TS_PACKET_SIZE) {
             return false; // Need more data
         }
-        
-        // Verify we still have a valid TS header (sync byte + valid PID)
-        if (!isValidTSHeader(0)) {
-            // Lost sync!
-            size_t prevSyncLosses = syncLosses_.load();
-            syncLosses_++;
-            
-            // DEBUG: Log sync loss with context
-            if (prevSyncLosses < 10 || prevSyncLosses % 100 == 0) {
-                uint16_t pid = extractPID(0);
-                std::cerr << "[REASSEMBLER] SYNC LOST #" << (prevSyncLosses + 1)
-                          << ": byte0=0x" << std::hex << std::setfill('0') << std::setw(2)
-                          << (int)buffer_[0] << ", PID=" << std::dec << pid
-                          << " (0x" << std::hex << pid << std::dec << ")"
-                          << ", packetsOutput=" << packetsOutput_.load()
-                          << ", bufferSize=" << buffer_.size() << "\n";
-                
-                // Show context: first 20 bytes of buffer
-                std::cerr << "[REASSEMBLER] Buffer context: ";
-                for (size_t i = 0; i < std::min(buffer_.size(), size_t(20)); i++) {
-                    std::cerr << std::hex << std::setfill('0') << std::setw(2)
-                              << (int)buffer_[i] << " ";
-                }
-                std::cerr << std::dec << "\n";
-                
-                // Check where next valid TS header is
-                for (size_t i = 1; i < std::min(buffer_.size(), size_t(600)); i++) {
-                    if (isValidTSHeader(i)) {
-                        uint16_t nextPid = extractPID(i);
-                        std::cerr << "[REASSEMBLER] Next valid header at offset " << i
-                                  << " (" << (i % TS_PACKET_SIZE) << " bytes from packet boundary)"
-                                  << ", PID=" << nextPid << "\n";
-                        break;
-                    }
-                }
-            }
-            
-            state_ = State::SEARCHING;
-            return true; // State changed, continue processing
+
+        size_t count = countAlignedPackets(pending(), pendingBytes());
+        if (count > 0) {
+            handler(asPackets(pending()), count);
+            packetsOutput_ += count;
+            readPos_ += count * TS_PACKET_SIZE;
+            return true; // Extracted packets, check what follows
         }
-        
-        // Extract complete packet
-        ts::TSPacket pkt;
-        // Deque doesn't have .data(), so copy element by element
-        for (size_t i = 0; i < TS_PACKET_SIZE; i++) {
-            pkt.b[i] = buffer_[i];
+
+        // Lost sync!
+        size_t prevSyncLosses = syncLosses_.load();
+        syncLosses_++;
+
+        // DEBUG: Log sync loss with context
+        if (prevSyncLosses < 10 || prevSyncLosses % 100 == 0) {
+            std::cerr << "[REASSEMBLER] SYNC LOST #" << (prevSyncLosses + 1)
+                      << ": byte0=0x" << std::hex << std::setfill('0') << std::setw(2)
+                      << (int)pending()[0] << std::dec
+                      << ", packetsOutput=" << packetsOutput_.load()
+                      << ", bufferSize=" << pendingBytes() << "\n";
+
+            // Show context: first 20 bytes of buffer
+            std::cerr << "[REASSEMBLER] Buffer context: ";
+            for (size_t i = 0; i < std::min(pendingBytes(), size_t(20)); i++) {
+                std::cerr << std::hex << std::setfill('0') << std::setw(2)
+                          << (int)pending()[i] << " ";
+            }
+            std::cerr << std::dec << "\n";
         }
-        buffer_.erase(buffer_.begin(), buffer_.begin() + TS_PACKET_SIZE);
-        
-        // DEBUG: Validate extracted packet
-        size_t pktCount = packetsOutput_.load();
-        if (pkt.b[0] != TS_SYNC_BYTE) {
-            std::cerr << "[REASSEMBLER] ERROR: Extracted packet #" << (pktCount + 1)
-                      << " has invalid sync byte 0x" << std::hex << (int)pkt.b[0] << std::dec << "!\n";
+
+        state_ = State::SEARCHING;
+        return true; // State changed, continue processing
+    }
+
+#ifdef TS_REASSEMBLER_X86
+    static bool cpuHasAVX2() {
+#if defined(__GNUC__) || defined(__clang__)
+        static const bool has_avx2 = __builtin_cpu_supports("avx2");
+        return has_avx2;
+#else
+        return false;
+#endif
+    }
+
+    // SSE2 is part of the x86-64 baseline. Scans candidates [i, limit) in
+    // blocks of 16; on a hit i is the match, otherwise the first unscanned offset.
+    static bool findStrideSyncSSE2(const uint8_t* data, size_t limit, size_t stride_count, size_t& i) {
+        const __m128i sync = _mm_set1_epi8(static_cast<char>(TS_SYNC_BYTE));
+        for (; i + 16 <= limit; i += 16) {
+            __m128i match = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), sync);
+            for (size_t k = 1; k < stride_count; k++) {
+                __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + k * TS_PACKET_SIZE));
+                match = _mm_and_si128(match, _mm_cmpeq_epi8(next, sync));
+            }
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(match));
+            if (mask != 0) {
+                i += static_cast<size_t>(__builtin_ctz(mask));
+                return true;
+            }
         }
-        
-        // DEBUG: Log packet extraction periodically
-        if (pktCount < 5 || (pktCount < 200 && pktCount % 50 == 0) || pktCount % 1000 == 0) {
-            ts::PID pid = pkt.getPID();
-            std::cerr << "[REASSEMBLER] Extracted packet #" << (pktCount + 1)
-                      << ": sync=0x" << std::hex << (int)pkt.b[0]
-                      << ", PID=" << std::dec << pid
-                      << ", CC=" << (int)(pkt.b[3] & 0x0F)
-                      << ", pending=" << buffer_.size() << " bytes\n";
+        return false;  // Remaining candidates are left to the scalar loop
+    }
+
+#if defined(__GNUC__) || defined(__clang__)
+    __attribute__((target("avx2")))
+#endif
+    // Same contract as findStrideSyncSSE2, 32 candidates per iteration
+    static bool findStrideSyncAVX2(const uint8_t* data, size_t limit, size_t stride_count, size_t& i) {
+        const __m256i sync = _mm256_set1_epi8(static_cast<char>(TS_SYNC_BYTE));
+        for (; i + 32 <= limit; i += 32) {
+            __m256i match = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), sync);
+            for (size_t k = 1; k < stride_count; k++) {
+                __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + k * TS_PACKET_SIZE));
+                match = _mm256_and_si256(match, _mm256_cmpeq_epi8(next, sync));
+            }
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(match));
+            if (mask != 0) {
+                i += static_cast<size_t>(__builtin_ctz(mask));
+                return true;
+            }
         }
-        
-        outputQueue_.push_back(pkt);
-        packetsOutput_++;
-        
-        return true; // Extracted packet, continue to check for more
+        return false;  // Remaining candidates are left to the SSE2/scalar loops
     }
+#endif
 };
 
-#endif // TS_STREAM_REASSEMBLER_H
\ No newline at end of file
+#endif // TS_STREAM_REASSEMBLER_H
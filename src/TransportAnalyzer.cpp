@@ -0,0 +1,384 @@
+#include "TransportAnalyzer.h"
+#include <algorithm>
+#include <cstdlib>
+#include <time.h>
+
+namespace {
+
+constexpr size_t PACKET_SIZE = 188;
+constexpr int64_t PCR_HZ = 27000000;
+constexpr int64_t PCR_WRAP = (1LL << 33) * 300;
+constexpr int64_t NS_PER_MS = 1000000;
+
+// CC state per PID: low nibble = last counter, DUPLICATE = one repeat seen
+constexpr uint8_t CC_UNSEEN = 0xFF;
+constexpr uint8_t CC_DUPLICATE = 0x10;
+
+// Offset of the payload, PACKET_SIZE if the packet has none
+size_t payloadOffset(const uint8_t* b) {
+    if (!(b[3] & 0x10)) {
+        return PACKET_SIZE;
+    }
+    size_t offset = 4;
+    if (b[3] & 0x20) {
+        offset += 1 + b[4];
+    }
+    return std::min(offset, PACKET_SIZE);
+}
+
+// table_id of the section starting in a PUSI packet, -1 if none
+int sectionTableId(const uint8_t* b) {
+    size_t offset = payloadOffset(b);
+    if (!(b[1] & 0x40) || offset >= PACKET_SIZE) {
+        return -1;
+    }
+    size_t table = offset + 1 + b[offset];     // Skip pointer_field
+    return table < PACKET_SIZE ? b[table] : -1;
+}
+
+}  // namespace
+
+TransportAnalyzer::TransportAnalyzer()
+    : last_packet_ns_(0),
+      synced_(true),
+      pts_stalled_(false),
+      pcr_jitter_us16_(0),
+      pmt_pid_(NO_PID),
+      pcr_pid_(NO_PID),
+      video_pid_(NO_PID),
+      audio_pid_(NO_PID),
+      last_pcr_(-1),
+      last_pcr_ns_(0),
+      last_video_pts_(0),
+      has_video_pts_(false),
+      video_pts_changed_ns_(0) {
+    for (auto& count : errors_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    deadlines_[PAT_TIMER].period_ns = TABLE_TIMEOUT_MS * NS_PER_MS;
+    deadlines_[PAT_TIMER].indicator = PAT;
+    deadlines_[PMT_TIMER].period_ns = TABLE_TIMEOUT_MS * NS_PER_MS;
+    deadlines_[PMT_TIMER].indicator = PMT;
+    deadlines_[VIDEO_PID_TIMER].period_ns = PID_TIMEOUT_MS * NS_PER_MS;
+    deadlines_[VIDEO_PID_TIMER].indicator = PID;
+    deadlines_[AUDIO_PID_TIMER].period_ns = PID_TIMEOUT_MS * NS_PER_MS;
+    deadlines_[AUDIO_PID_TIMER].indicator = PID;
+    deadlines_[VIDEO_PTS_TIMER].period_ns = PTS_TIMEOUT_MS * NS_PER_MS;
+    deadlines_[VIDEO_PTS_TIMER].indicator = PTS_REPETITION;
+    deadlines_[AUDIO_PTS_TIMER].period_ns = PTS_TIMEOUT_MS * NS_PER_MS;
+    deadlines_[AUDIO_PTS_TIMER].indicator = PTS_REPETITION;
+    cc_state_.fill(CC_UNSEEN);
+}
+
+void TransportAnalyzer::reset(int64_t now_ns) {
+    for (auto& count : errors_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    for (Deadline& deadline : deadlines_) {
+        deadline.at.store(DISARMED, std::memory_order_relaxed);
+    }
+    for (ScoreBucket& bucket : score_wheel_) {
+        bucket.epoch.store(UINT64_MAX, std::memory_order_relaxed);
+    }
+    last_packet_ns_.store(0, std::memory_order_relaxed);
+    synced_.store(true, std::memory_order_relaxed);
+    pts_stalled_.store(false, std::memory_order_relaxed);
+    pcr_jitter_us16_.store(0, std::memory_order_relaxed);
+
+    pmt_pid_ = pcr_pid_ = video_pid_ = audio_pid_ = NO_PID;
+    cc_state_.fill(CC_UNSEEN);
+    last_pcr_ = -1;
+    has_video_pts_ = false;
+    arm(PAT_TIMER, now_ns);
+}
+
+void TransportAnalyzer::setPids(uint16_t pmt_pid, uint16_t pcr_pid, uint16_t video_pid, uint16_t audio_pid,
+                                int64_t now_ns) {
+    pmt_pid_ = pmt_pid;
+    pcr_pid_ = pcr_pid;
+    video_pid_ = video_pid;
+    audio_pid_ = audio_pid;
+    video_pts_changed_ns_ = now_ns;
+
+    arm(PMT_TIMER, now_ns);
+    if (video_pid != NO_PID) {
+        arm(VIDEO_PID_TIMER, now_ns);
+        arm(VIDEO_PTS_TIMER, now_ns);
+    }
+    if (audio_pid != NO_PID) {
+        arm(AUDIO_PID_TIMER, now_ns);
+        arm(AUDIO_PTS_TIMER, now_ns);
+    }
+}
+
+void TransportAnalyzer::recordRead(int64_t now_ns, size_t sync_losses, bool synced) {
+    if (sync_losses > 0) {
+        countError(SYNC_LOSS, now_ns, sync_losses);
+    }
+    synced_.store(synced, std::memory_order_relaxed);
+    last_packet_ns_.store(now_ns, std::memory_order_relaxed);
+}
+
+void TransportAnalyzer::feedPacket(const uint8_t* b, int64_t now_ns) {
+    if (b[1] & 0x80) {
+        countError(TRANSPORT, now_ns);
+        return;     // Nothing else in the packet can be trusted
+    }
+
+    uint16_t pid = static_cast<uint16_t>(((b[1] & 0x1F) << 8) | b[2]);
+    bool has_af = (b[3] & 0x20) != 0;
+    bool discontinuity = has_af && b[4] > 0 && (b[5] & 0x80);
+    bool pusi = (b[1] & 0x40) != 0;
+
+    if (pid != NO_PID) {
+        checkContinuity(b, pid, discontinuity, now_ns);
+    }
+
+    for (Deadline& deadline : deadlines_) {
+        if (now_ns > deadline.at.load(std::memory_order_relaxed) && now_ns > deadline.next_error_ns) {
+            countError(deadline.indicator, now_ns);
+            deadline.next_error_ns = now_ns + deadline.period_ns;
+        }
+    }
+
+    if (pid == 0 && pusi && sectionTableId(b) == 0x00) {
+        arm(PAT_TIMER, now_ns);
+    } else if (pid == pmt_pid_ && pusi && sectionTableId(b) == 0x02) {
+        arm(PMT_TIMER, now_ns);
+    }
+    if (pid == video_pid_) {
+        arm(VIDEO_PID_TIMER, now_ns);
+        if (pusi) {
+            checkPTS(b, true, now_ns);
+        }
+    } else if (pid == audio_pid_) {
+        arm(AUDIO_PID_TIMER, now_ns);
+        if (pusi) {
+            checkPTS(b, false, now_ns);
+        }
+    }
+    if (pid == pcr_pid_ && has_af && b[4] >= 7 && (b[5] & 0x10)) {
+        checkPCR(b, discontinuity, now_ns);
+    }
+}
+
+void TransportAnalyzer::checkContinuity(const uint8_t* b, uint16_t pid, bool discontinuity, int64_t now_ns) {
+    if (!(b[3] & 0x10)) {
+        return;     // Counter only advances on packets with payload
+    }
+    uint8_t cc = b[3] & 0x0F;
+    uint8_t& state = cc_state_[pid];
+    if (state == CC_UNSEEN || discontinuity) {
+        state = cc;
+        return;
+    }
+
+    uint8_t last = state & 0x0F;
+    if (cc == last) {
+        // A single repeat is a legal duplicate packet, a second one is not
+        if (state & CC_DUPLICATE) {
+            countError(CC, now_ns);
+        }
+        state = cc | CC_DUPLICATE;
+        return;
+    }
+    if (cc != ((last + 1) & 0x0F)) {
+        countError(CC, now_ns);
+    }
+    state = cc;
+}
+
+void TransportAnalyzer::checkPCR(const uint8_t* b, bool discontinuity, int64_t now_ns) {
+    int64_t base = (static_cast<int64_t>(b[6]) << 25) | (static_cast<int64_t>(b[7]) << 17) |
+                   (static_cast<int64_t>(b[8]) << 9) | (static_cast<int64_t>(b[9]) << 1) | (b[10] >> 7);
+    int64_t ext = (static_cast<int64_t>(b[10] & 0x01) << 8) | b[11];
+    int64_t pcr = base * 300 + ext;
+
+    if (last_pcr_ >= 0 && !discontinuity) {
+        int64_t delta = pcr - last_pcr_;
+        if (delta < -PCR_WRAP / 2) {
+            delta += PCR_WRAP;
+        } else if (delta > PCR_WRAP / 2) {
+            delta -= PCR_WRAP;
+        }
+
+        if (delta < 0 || delta > PCR_DISCONTINUITY_MS * (PCR_HZ / 1000)) {
+            countError(PCR_DISCONTINUITY, now_ns);
+        } else {
+            if (delta > PCR_REPETITION_MS * (PCR_HZ / 1000)) {
+                countError(PCR_REPETITION, now_ns);
+            }
+            // How far arrival strays from the PCR's own clock
+            int64_t pcr_ns = delta * 1000 / (PCR_HZ / 1000000);
+            int64_t deviation_ns = std::llabs((now_ns - last_pcr_ns_) - pcr_ns);
+            int64_t jitter16 = pcr_jitter_us16_.load(std::memory_order_relaxed);
+            jitter16 += deviation_ns / 1000 - ((jitter16 + 8) >> 4);
+            pcr_jitter_us16_.store(jitter16, std::memory_order_relaxed);
+            if (deviation_ns > PCR_JITTER_ERROR_MS * NS_PER_MS) {
+                countError(PCR_JITTER, now_ns);
+            }
+        }
+    }
+    last_pcr_ = pcr;
+    last_pcr_ns_ = now_ns;
+}
+
+void TransportAnalyzer::checkPTS(const uint8_t* b, bool video, int64_t now_ns) {
+    size_t offset = payloadOffset(b);
+    if (offset + 14 > PACKET_SIZE) {
+        return;
+    }
+    const uint8_t* pes = b + offset;
+    if (pes[0] != 0x00 || pes[1] != 0x00 || pes[2] != 0x01 || !(pes[7] & 0x80)) {
+        return;     // Not a PES start, or no PTS
+    }
+    uint64_t pts = (static_cast<uint64_t>(pes[9] & 0x0E) << 29) | (static_cast<uint64_t>(pes[10]) << 22) |
+                   (static_cast<uint64_t>(pes[11] & 0xFE) << 14) | (static_cast<uint64_t>(pes[12]) << 7) |
+                   (static_cast<uint64_t>(pes[13]) >> 1);
+    arm(video ? VIDEO_PTS_TIMER : AUDIO_PTS_TIMER, now_ns);
+    if (!video) {
+        return;
+    }
+
+    // Frozen encoder: video PES keep coming but the picture never changes
+    if (!has_video_pts_ || pts != last_video_pts_) {
+        last_video_pts_ = pts;
+        has_video_pts_ = true;
+        video_pts_changed_ns_ = now_ns;
+        pts_stalled_.store(false, std::memory_order_relaxed);
+    } else if (now_ns - video_pts_changed_ns_ > PTS_STALL_MS * NS_PER_MS &&
+               !pts_stalled_.load(std::memory_order_relaxed)) {
+        countError(PTS_STALL, now_ns);
+        pts_stalled_.store(true, std::memory_order_relaxed);
+    }
+}
+
+void TransportAnalyzer::countError(Indicator indicator, int64_t now_ns, uint64_t count) {
+    errors_[indicator].store(errors_[indicator].load(std::memory_order_relaxed) + count,
+                             std::memory_order_relaxed);
+
+    uint64_t second = static_cast<uint64_t>(now_ns / 1000000000);
+    ScoreBucket& bucket = score_wheel_[second % SCORE_BUCKETS];
+    if (bucket.epoch.load(std::memory_order_relaxed) != second) {
+        bucket.errored.store(0, std::memory_order_relaxed);
+        bucket.epoch.store(second, std::memory_order_release);
+    }
+    bucket.errored.store(bucket.errored.load(std::memory_order_relaxed) | (1u << indicator),
+                         std::memory_order_relaxed);
+}
+
+void TransportAnalyzer::arm(Timer timer, int64_t now_ns) {
+    Deadline& deadline = deadlines_[timer];
+    deadline.at.store(now_ns + deadline.period_ns, std::memory_order_relaxed);
+    deadline.next_error_ns = 0;
+}
+
+bool TransportAnalyzer::deadlinePassed(Timer timer, int64_t at_ns) const {
+    return at_ns > deadlines_[timer].at.load(std::memory_order_relaxed);
+}
+
+int TransportAnalyzer::weight(Indicator indicator) {
+    switch (indicator) {
+        case SYNC_LOSS:
+        case PAT:
+        case CC:
+        case PMT:
+        case PID:
+        case PTS_STALL:
+            return 10;
+        case PCR_JITTER:
+            return 1;
+        default:
+            return 3;
+    }
+}
+
+int TransportAnalyzer::getScore() const {
+    return activeOutages() != 0 ? 0 : windowScore();
+}
+
+void TransportAnalyzer::report(Report& out) const {
+    for (size_t i = 0; i < INDICATOR_COUNT; i++) {
+        out.errors[i] = errors_[i].load(std::memory_order_relaxed);
+    }
+    out.pcr_jitter_us = pcr_jitter_us16_.load(std::memory_order_relaxed) >> 4;
+
+    uint32_t active = activeOutages();
+    out.active.clear();
+    for (int indicator = 0; indicator < INDICATOR_COUNT; indicator++) {
+        if (active & (1u << indicator)) {
+            out.active.push_back(static_cast<Indicator>(indicator));
+        }
+    }
+    out.score = active != 0 ? 0 : windowScore();
+}
+
+uint32_t TransportAnalyzer::activeOutages() const {
+    // Judged at the last read, so an input that went quiet isn't one
+    int64_t last_packet_ns = last_packet_ns_.load(std::memory_order_relaxed);
+    if (last_packet_ns == 0) {
+        return 0;
+    }
+    uint32_t active = 0;
+    if (!synced_.load(std::memory_order_relaxed)) {
+        active |= 1u << SYNC_LOSS;
+    }
+    if (deadlinePassed(PAT_TIMER, last_packet_ns)) {
+        active |= 1u << PAT;
+    }
+    if (deadlinePassed(PMT_TIMER, last_packet_ns)) {
+        active |= 1u << PMT;
+    }
+    if (deadlinePassed(VIDEO_PID_TIMER, last_packet_ns) || deadlinePassed(AUDIO_PID_TIMER, last_packet_ns)) {
+        active |= 1u << PID;
+    }
+    if (deadlinePassed(VIDEO_PTS_TIMER, last_packet_ns) || deadlinePassed(AUDIO_PTS_TIMER, last_packet_ns)) {
+        active |= 1u << PTS_REPETITION;
+    }
+    if (pts_stalled_.load(std::memory_order_relaxed)) {
+        active |= 1u << PTS_STALL;
+    }
+    return active;
+}
+
+int TransportAnalyzer::windowScore() const {
+    // Errored seconds in the window, the current one included
+    uint64_t now_second = static_cast<uint64_t>(nowNs() / 1000000000);
+    int cost = 0;
+    for (uint64_t i = 0; i < static_cast<uint64_t>(SCORE_WINDOW_S); i++) {
+        const ScoreBucket& bucket = score_wheel_[(now_second - i) % SCORE_BUCKETS];
+        if (bucket.epoch.load(std::memory_order_acquire) != now_second - i) {
+            continue;
+        }
+        uint32_t errored = bucket.errored.load(std::memory_order_relaxed);
+        for (int indicator = 0; indicator < INDICATOR_COUNT; indicator++) {
+            if (errored & (1u << indicator)) {
+                cost += weight(static_cast<Indicator>(indicator));
+            }
+        }
+    }
+    return std::max(0, 100 - cost);
+}
+
+const char* TransportAnalyzer::indicatorName(Indicator indicator) {
+    switch (indicator) {
+        case SYNC_LOSS: return "sync_loss";
+        case PAT: return "pat";
+        case CC: return "cc";
+        case PMT: return "pmt";
+        case PID: return "pid";
+        case TRANSPORT: return "transport";
+        case PCR_REPETITION: return "pcr_repetition";
+        case PCR_DISCONTINUITY: return "pcr_discontinuity";
+        case PCR_JITTER: return "pcr_jitter";
+        case PTS_REPETITION: return "pts_repetition";
+        case PTS_STALL: return "pts_stall";
+        default: return "unknown";
+    }
+}
+
+int64_t TransportAnalyzer::nowNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
@@ -0,0 +1,173 @@
+#ifndef TRANSPORT_ANALYZER_H
+#define TRANSPORT_ANALYZER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * TransportAnalyzer - In-line TR 101 290 style checks on an input's TS
+ *
+ * Byte rate and data age say nothing about what the bytes are: an encoder
+ * that sends corrupt or frozen TS at full rate looks healthy to them. This
+ * follows every packet as it is read and counts the priority 1 and 2
+ * indicators a viewer would notice:
+ *
+ *   1.1 sync_loss          reassembler lost packet sync
+ *   1.3 pat                no PAT section for over 500 ms
+ *   1.4 cc                 continuity counter error (one duplicate allowed)
+ *   1.5 pmt                no PMT section for over 500 ms
+ *   1.6 pid                video or audio PID absent for over PID_TIMEOUT_MS
+ *   2.1 transport          transport_error_indicator set
+ *   2.3 pcr_repetition     PCRs more than 40 ms apart
+ *   2.3 pcr_discontinuity  PCR jump over 100 ms or backwards, not flagged
+ *   2.4 pcr_jitter         PCR arrival strays over PCR_JITTER_ERROR_MS from
+ *                          the PCR's own clock (an arrival-side stand-in
+ *                          for PCR accuracy, which needs the mux bitrate;
+ *                          reads deliver packets in bursts, so the limit
+ *                          is loose)
+ *   2.5 pts_repetition     no PTS on the video or audio PID for over 700 ms
+ *       pts_stall          video PES keep coming with an unchanged PTS for
+ *                          over PTS_STALL_MS (frozen encoder)
+ *
+ * CRC_error is not checked: sections are only reassembled during discovery.
+ *
+ * Score: errored seconds over the last SCORE_WINDOW_S seconds. Each second
+ * in which an indicator fired costs its weight (priority 1 and stalls 10,
+ * priority 2 3, PCR jitter 1) however often it fired, so a stream that is
+ * persistently a little out of spec degrades the score without zeroing it.
+ * 100 minus the cost, floored at 0, and 0 outright while an outage is
+ * ongoing: sync lost, a stalled PTS, or packets still arriving past a
+ * PAT / PMT / PID / PTS deadline. An input that simply stops sending is
+ * left to the data age checks.
+ *
+ * Thread-safety: feedPacket(), recordRead(), setPids() and reset() belong to
+ * the reactor thread; getScore() and report() may run on any thread. No
+ * locks: counters and deadlines are relaxed atomics.
+ */
+class TransportAnalyzer {
+public:
+    enum Indicator {
+        SYNC_LOSS,
+        PAT,
+        CC,
+        PMT,
+        PID,
+        TRANSPORT,
+        PCR_REPETITION,
+        PCR_DISCONTINUITY,
+        PCR_JITTER,
+        PTS_REPETITION,
+        PTS_STALL,
+        INDICATOR_COUNT
+    };
+
+    struct Report {
+        int score = 100;
+        std::array<uint64_t, INDICATOR_COUNT> errors{};     // This connection
+        std::vector<Indicator> active;                      // Outages ongoing now
+        int64_t pcr_jitter_us = 0;                          // Smoothed PCR arrival jitter
+    };
+
+    static constexpr int SCORE_WINDOW_S = 10;
+    static constexpr int64_t TABLE_TIMEOUT_MS = 500;
+    static constexpr int64_t PID_TIMEOUT_MS = 1000;
+    static constexpr int64_t PTS_TIMEOUT_MS = 700;
+    static constexpr int64_t PTS_STALL_MS = 1000;
+    static constexpr int64_t PCR_REPETITION_MS = 40;
+    static constexpr int64_t PCR_DISCONTINUITY_MS = 100;
+    static constexpr int64_t PCR_JITTER_ERROR_MS = 250;
+
+    TransportAnalyzer();
+
+    TransportAnalyzer(const TransportAnalyzer&) = delete;
+    TransportAnalyzer& operator=(const TransportAnalyzer&) = delete;
+
+    // New connection: forget everything, PAT expected from now_ns on
+    void reset(int64_t now_ns);
+
+    // PIDs from PAT/PMT discovery (PID_NULL = 0x1FFF for none); arms the
+    // PMT, PID and PTS deadlines
+    void setPids(uint16_t pmt_pid, uint16_t pcr_pid, uint16_t video_pid, uint16_t audio_pid, int64_t now_ns);
+
+    // Once per read: new sync losses since the last read, sync state after it
+    void recordRead(int64_t now_ns, size_t sync_losses, bool synced);
+
+    // Every 188-byte packet, in order
+    void feedPacket(const uint8_t* packet, int64_t now_ns);
+
+    int getScore() const;
+
+    // Fill a caller-owned report; `active` is cleared and refilled, keeping
+    // its capacity, so a report reused across health checks doesn't allocate
+    void report(Report& out) const;
+
+    static const char* indicatorName(Indicator indicator);
+
+private:
+    static constexpr uint16_t NO_PID = 0x1FFF;
+    static constexpr int64_t DISARMED = INT64_MAX;
+    static constexpr size_t SCORE_BUCKETS = 16;     // > SCORE_WINDOW_S, 1 s each
+
+    // Deadline checks: an error per period that passes without the thing
+    enum Timer {
+        PAT_TIMER,
+        PMT_TIMER,
+        VIDEO_PID_TIMER,
+        AUDIO_PID_TIMER,
+        VIDEO_PTS_TIMER,
+        AUDIO_PTS_TIMER,
+        TIMER_COUNT
+    };
+
+    struct Deadline {
+        std::atomic<int64_t> at{DISARMED};  // Last seen + period
+        int64_t next_error_ns = 0;          // While overdue, one error per period
+        int64_t period_ns = 0;
+        Indicator indicator = PAT;
+    };
+
+    struct ScoreBucket {
+        std::atomic<uint64_t> epoch{UINT64_MAX};    // Second it covers
+        std::atomic<uint32_t> errored{0};           // Bit per indicator that fired
+    };
+
+    void countError(Indicator indicator, int64_t now_ns, uint64_t count = 1);
+    void arm(Timer timer, int64_t now_ns);
+    void checkContinuity(const uint8_t* packet, uint16_t pid, bool discontinuity, int64_t now_ns);
+    void checkPCR(const uint8_t* packet, bool discontinuity, int64_t now_ns);
+    void checkPTS(const uint8_t* packet, bool video, int64_t now_ns);
+    bool deadlinePassed(Timer timer, int64_t at_ns) const;
+    static int weight(Indicator indicator);
+
+    // Bit per Indicator with an outage ongoing at the last read
+    uint32_t activeOutages() const;
+
+    // 100 minus the weighted errored seconds in the window
+    int windowScore() const;
+    static int64_t nowNs();
+
+    std::array<std::atomic<uint64_t>, INDICATOR_COUNT> errors_;
+    std::array<Deadline, TIMER_COUNT> deadlines_;
+    std::array<ScoreBucket, SCORE_BUCKETS> score_wheel_;
+    std::atomic<int64_t> last_packet_ns_;
+    std::atomic<bool> synced_;
+    std::atomic<bool> pts_stalled_;
+    std::atomic<int64_t> pcr_jitter_us16_;          // Jitter x16 (RFC 3550 smoothing)
+
+    // Reactor thread only
+    uint16_t pmt_pid_;
+    uint16_t pcr_pid_;
+    uint16_t video_pid_;
+    uint16_t audio_pid_;
+    std::array<uint8_t, 8192> cc_state_;            // Per PID, see checkContinuity
+    int64_t last_pcr_;                              // 27 MHz, -1 = none yet
+    int64_t last_pcr_ns_;
+    uint64_t last_video_pts_;
+    bool has_video_pts_;
+    int64_t video_pts_changed_ns_;
+};
+
+#endif // TRANSPORT_ANALYZER_H
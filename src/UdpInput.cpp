@@ -0,0 +1,174 @@
+#include "UdpInput.h"
+#include <iostream>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+
+UdpInput::UdpInput(const std::string& name, const std::string& address, uint16_t port,
+                   const std::string& interface_address)
+    : StreamInput(name),
+      address_(address),
+      port_(port),
+      interface_address_(interface_address),
+      rcvbuf_bytes_(DEFAULT_RCVBUF_BYTES),
+      gro_(false),
+      gro_active_(false),
+      recv_batch_(DEFAULT_RECV_BATCH),
+      msgs_(MAX_RECV_BATCH),
+      iovecs_(MAX_RECV_BATCH),
+      control_(MAX_RECV_BATCH * CONTROL_SLOT),
+      datagrams_received_(0),
+      recv_calls_(0),
+      kernel_drops_(0),
+      truncated_(0),
+      last_drop_counter_(0) {
+}
+
+StreamInput::OpenResult UdpInput::openSource(int& fd) {
+    std::cout << "[" << name_ << "] Opening UDP socket on " << address_ << ":" << port_ << std::endl;
+
+    // Numeric addresses only: name resolution would block the reactor
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port_);
+    if (inet_pton(AF_INET, address_.c_str(), &addr.sin_addr) != 1) {
+        std::cerr << "[" << name_ << "] Invalid IPv4 address: " << address_ << std::endl;
+        return OpenResult::FAILED;
+    }
+    bool multicast = IN_MULTICAST(ntohl(addr.sin_addr.s_addr));
+
+    fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        std::cerr << "[" << name_ << "] Failed to create socket: " << strerror(errno) << std::endl;
+        return OpenResult::FAILED;
+    }
+
+    // Several receivers may listen to the same group
+    int flag = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+
+    // Large receive buffer absorbs bursts (an IDR arrives as one). FORCE
+    // ignores rmem_max but needs CAP_NET_ADMIN.
+    int bufsize = rcvbuf_bytes_;
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &bufsize, sizeof(bufsize)) < 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+    }
+    int actual = 0;
+    socklen_t optlen = sizeof(actual);
+    getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &actual, &optlen);
+    if (actual / 2 < rcvbuf_bytes_) {
+        std::cerr << "[" << name_ << "] Warning: receive buffer is " << actual / 2 << " bytes (wanted "
+                  << rcvbuf_bytes_ << "); raise net.core.rmem_max" << std::endl;
+    }
+
+    // Kernel drop counter arrives with each datagram
+    setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &flag, sizeof(flag));
+
+    gro_active_ = false;
+#ifdef UDP_GRO
+    if (gro_) {
+        gro_active_ = setsockopt(fd, IPPROTO_UDP, UDP_GRO, &flag, sizeof(flag)) == 0;
+        if (!gro_active_) {
+            std::cerr << "[" << name_ << "] Warning: UDP GRO not available: " << strerror(errno) << std::endl;
+        }
+    }
+#endif
+
+    // Multicast: bind the group address so only its traffic is delivered here
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::cerr << "[" << name_ << "] Failed to bind " << address_ << ":" << port_
+                  << ": " << strerror(errno) << std::endl;
+        close(fd);
+        fd = -1;
+        return OpenResult::FAILED;
+    }
+
+    if (multicast) {
+        struct ip_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        mreq.imr_multiaddr = addr.sin_addr;
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (!interface_address_.empty() &&
+            inet_pton(AF_INET, interface_address_.c_str(), &mreq.imr_interface) != 1) {
+            std::cerr << "[" << name_ << "] Invalid interface address: " << interface_address_ << std::endl;
+        }
+        if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+            std::cerr << "[" << name_ << "] Failed to join multicast group " << address_
+                      << ": " << strerror(errno) << std::endl;
+            close(fd);
+            fd = -1;
+            return OpenResult::FAILED;
+        }
+        std::cout << "[" << name_ << "] Joined multicast group " << address_
+                  << (interface_address_.empty() ? "" : " on " + interface_address_) << std::endl;
+    }
+
+    last_drop_counter_ = 0;
+    std::cout << "[" << name_ << "] UDP socket ready (fd=" << fd << ", rcvbuf=" << actual
+              << ", batch=" << recv_batch_ << (gro_active_ ? ", GRO" : "") << ")" << std::endl;
+    return OpenResult::READY;
+}
+
+ssize_t UdpInput::readSource(int fd, uint8_t* buf, size_t len) {
+    // One slot per datagram, laid out back to back in buf
+    size_t slot = gro_active_ ? GRO_SLOT : DATAGRAM_SLOT;
+    size_t count = std::min(recv_batch_, len / slot);
+    if (count == 0) {
+        count = 1;
+        slot = len;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        iovecs_[i].iov_base = buf + i * slot;
+        iovecs_[i].iov_len = slot;
+        struct msghdr& hdr = msgs_[i].msg_hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_iov = &iovecs_[i];
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = control_.data() + i * CONTROL_SLOT;
+        hdr.msg_controllen = CONTROL_SLOT;
+    }
+
+    int n = recvmmsg(fd, msgs_.data(), static_cast<unsigned>(count), MSG_DONTWAIT, nullptr);
+    if (n <= 0) {
+        if (n == 0) {
+            errno = EAGAIN;     // 0 would read as EOF
+        }
+        return -1;
+    }
+    recv_calls_++;
+    datagrams_received_ += n;
+
+    // Close the gaps between slots so the caller sees one byte stream
+    size_t total = 0;
+    for (int i = 0; i < n; i++) {
+        const struct msghdr& hdr = msgs_[i].msg_hdr;
+        size_t bytes = msgs_[i].msg_len;
+        if (hdr.msg_flags & MSG_TRUNC) {
+            truncated_++;
+        }
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr;
+             cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&hdr), cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+                uint32_t dropped;
+                memcpy(&dropped, CMSG_DATA(cmsg), sizeof(dropped));
+                kernel_drops_ += dropped - last_drop_counter_;     // Cumulative per socket
+                last_drop_counter_ = dropped;
+            }
+        }
+        if (total != i * slot) {
+            memmove(buf + total, buf + i * slot, bytes);
+        }
+        total += bytes;
+    }
+
+    if (total == 0) {
+        errno = EAGAIN;     // Only empty datagrams
+        return -1;
+    }
+    return static_cast<ssize_t>(total);
+}
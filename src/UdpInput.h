@@ -0,0 +1,89 @@
+#ifndef UDP_INPUT_H
+#define UDP_INPUT_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <sys/socket.h>
+#include "StreamInput.h"
+
+/**
+ * UdpInput - Native UDP / multicast MPEG-TS receiver
+ *
+ * Receives TS over UDP (typically 7 packets per datagram) without an
+ * ffmpeg hop in front of a named pipe. Datagrams are fetched in batches
+ * with recvmmsg() straight into the reactor's read buffer and compacted in
+ * place, so one system call covers up to getRecvBatch() datagrams and the
+ * bytes go into the same reassembler / indexing pipeline as pipe input.
+ *
+ * Socket setup:
+ * - Large receive buffer (SO_RCVBUFFORCE when permitted, else SO_RCVBUF,
+ *   which the kernel caps at net.core.rmem_max)
+ * - Multicast group join when the address is a multicast address,
+ *   optionally on a given interface address
+ * - Optional UDP GRO: the kernel coalesces consecutive datagrams into one
+ *   receive of up to 64 KB. Each recvmmsg() slot then has to hold 64 KB,
+ *   so fewer slots fit; worth it on NICs that do UDP GRO, not on loopback.
+ *
+ * Kernel drops (socket buffer overflow) are reported through SO_RXQ_OVFL.
+ * UDP has no connection: the socket stays open, and a silent sender shows
+ * up in the health metrics (data age / bitrate) instead.
+ */
+class UdpInput : public StreamInput {
+public:
+    // address: group or local address to bind ("0.0.0.0" for any).
+    // interface_address: local interface for the multicast join ("" = default).
+    UdpInput(const std::string& name, const std::string& address, uint16_t port,
+             const std::string& interface_address = "");
+
+    OpenResult openSource(int& fd) override;
+    ssize_t readSource(int fd, uint8_t* buf, size_t len) override;
+    int getReconnectDelayMs() const override { return UDP_RETRY_DELAY_MS; }
+
+    // recvmmsg() does more than read(): the reactor must go through readSource()
+    bool allowsDirectRead() const override { return false; }
+
+    // Configuration (before the reactor opens the socket)
+    void setReceiveBufferSize(int bytes) { rcvbuf_bytes_ = bytes; }
+    void setGro(bool enable) { gro_ = enable; }
+    void setRecvBatch(size_t datagrams) { recv_batch_ = std::max<size_t>(1, std::min(datagrams, MAX_RECV_BATCH)); }
+    size_t getRecvBatch() const { return recv_batch_; }
+
+    // Statistics
+    uint64_t getDatagramsReceived() const { return datagrams_received_.load(); }
+    uint64_t getRecvCalls() const { return recv_calls_.load(); }
+    uint64_t getKernelDrops() const { return kernel_drops_.load(); }       // Socket buffer overflows
+    uint64_t getTruncatedDatagrams() const { return truncated_.load(); }
+
+private:
+    std::string address_;
+    uint16_t port_;
+    std::string interface_address_;
+    int rcvbuf_bytes_;
+    bool gro_;
+    bool gro_active_;           // GRO enabled on the current socket
+    size_t recv_batch_;
+
+    // recvmmsg() headers, reused for every call (reactor thread only)
+    std::vector<struct mmsghdr> msgs_;
+    std::vector<struct iovec> iovecs_;
+    std::vector<uint8_t> control_;
+
+    std::atomic<uint64_t> datagrams_received_;
+    std::atomic<uint64_t> recv_calls_;
+    std::atomic<uint64_t> kernel_drops_;
+    std::atomic<uint64_t> truncated_;
+    uint32_t last_drop_counter_;
+
+    static constexpr int UDP_RETRY_DELAY_MS = 2000;
+    static constexpr int DEFAULT_RCVBUF_BYTES = 8 * 1024 * 1024;   // 8MB
+    static constexpr size_t DEFAULT_RECV_BATCH = 32;
+    static constexpr size_t MAX_RECV_BATCH = 64;
+    static constexpr size_t DATAGRAM_SLOT = 2048;       // >= 1500-byte MTU
+    static constexpr size_t GRO_SLOT = 65536;           // Largest coalesced receive
+    static constexpr size_t CONTROL_SLOT = 64;          // Room for SO_RXQ_OVFL + UDP_GRO cmsgs
+};
+
+#endif // UDP_INPUT_H
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/**
+ * WakeupSignal - Batched producer -> consumer wakeup over an eventfd
+ *
+ * Pairs with PacketRing for the reader-thread -> main-loop handoff.
+ * The consumer only sleeps when it found the ring empty; the producer
+ * only pays for a write() syscall when a consumer is actually asleep,
+ * and at most once per batch (one read() worth of packets).
+ *
+ * Consumer:
+ *   if (nothing available) {
+ *       signal.prepareWait();
+ *       if (!still nothing available) signal.cancelWait();
+ *       else signal.wait(timeout_ms);
+ *   }
+ *
+ * Producer (after publishing a batch):
+ *   signal.notify();
+ */
+class WakeupSignal {
+public:
+    WakeupSignal() : efd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+    ~WakeupSignal() {
+        if (efd_ >= 0) ::close(efd_);
+    }
+
+    WakeupSignal(const WakeupSignal&) = delete;
+    WakeupSignal& operator=(const WakeupSignal&) = delete;
+
+    // Consumer: announce intent to sleep, then re-check the queue
+    void prepareWait() {
+        waiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    // Consumer: the re-check found data, don't sleep
+    void cancelWait() {
+        waiting_.store(false, std::memory_order_relaxed);
+    }
+
+    // Consumer: sleep until notified or timeout. Returns true if notified.
+    bool wait(int timeout_ms) {
+        bool notified = false;
+        if (efd_ >= 0) {
+            struct pollfd pfd;
+            pfd.fd = efd_;
+            pfd.events = POLLIN;
+            int ret = poll(&pfd, 1, timeout_ms);
+            if (ret > 0) {
+                uint64_t value;
+                notified = ::read(efd_, &value, sizeof(value)) == sizeof(value);
+            }
+        }
+        waiting_.store(false, std::memory_order_relaxed);
+        return notified;
+    }
+
+    // Producer: wake the consumer if (and only if) it is sleeping
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_relaxed) &&
+            waiting_.exchange(false, std::memory_order_relaxed)) {
+            uint64_t one = 1;
+            ssize_t ret;
+            do {
+                ret = ::write(efd_, &one, sizeof(one));
+            } while (ret < 0 && errno == EINTR);
+            wakeups_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Number of wakeup syscalls issued (for diagnostics)
+    uint64_t getWakeupCount() const { return wakeups_.load(std::memory_order_relaxed); }
+
+private:
+    int efd_;
+    std::atomic<bool> waiting_{false};
+    std::atomic<uint64_t> wakeups_{0};
+};
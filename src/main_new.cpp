@@ -6,9 +6,18 @@
  * Architecture:
  * - FIFOInput for camera input (/pipe/camera.ts)
  * - FIFOInput for fallback input (/pipe/fallback.ts)
+ * - UdpInput instead of a camera/drone pipe when CAMERA_UDP / DRONE_UDP is set
+ * - SrtInput (built-in SRT listener) when CAMERA_SRT / DRONE_SRT is set
+ * - InputReactor reads all inputs from one epoll thread
  * - StreamSplicer for timestamp rebasing and splice logic
  * - FIFOOutput to ffmpeg-rtmp-output (/pipe/ts_output.pipe)
  * - FFmpeg publishes to srs
+ * - RTMPOutput (in-process FLV remux + RTMP publish) instead of the pipe and
+ *   ffmpeg when RTMP_OUTPUT_URL is set
+ * - FanoutOutput feeds extra sinks (TCP, recorder, HTTP-TS) from the same
+ *   spliced stream, each on its own thread with its own backpressure policy
+ * - OutputPacer releases the output against its PCR (OUTPUT_PACING=1), so a
+ *   switch doesn't push a buffered GOP downstream in one burst
  *
  * Switching logic:
  * - Start with fallback stream
@@ -18,10 +27,24 @@
  */
 
 #include "FIFOInput.h"
+#include "UdpInput.h"
+#ifdef HAVE_LIBSRT
+#include "SrtInput.h"
+#endif
+#include "InputReactor.h"
 #include "FIFOOutput.h"
+#include "RTMPOutput.h"
+#include "TCPOutput.h"
+#include "FileOutput.h"
+#include "FanoutOutput.h"
+#include "HttpTsServer.h"
+#include "OutputPacer.h"
+#include "LatencyTracker.h"
 #include "StreamSplicer.h"
 #include "HttpServer.h"
 #include "InputSourceManager.h"
+#include "LatencyHistogram.h"
+#include "OutputModeUsage.h"
 #include <iostream>
 #include <csignal>
 #include <atomic>
@@ -60,6 +83,283 @@ void signal_handler(int signum) {
     g_running = false;
 }
 
+// Position a reader on the indexed clean point (IDR + audio sync) its policy
+// picks. Only blocks when the reader has none yet, e.g. right after it reconnected.
+static void positionAtCleanPoint(StreamInput& reader, PacketSink& output) {
+    if (reader.selectCleanPoint()) {
+        return;
+    }
+    
+    std::cout << "[Main] No clean point indexed yet - waiting for the next IDR" << std::endl;
+    output.flush();  // Don't hold queued output across the blocking waits below
+    reader.resetForNewLoop();
+    reader.waitForStreamInfo();
+    reader.waitForIDR();
+    reader.waitForAudioSync();
+}
+
+// Most PIDs a realigned snapshot hands its CCs over on (PAT, PMT, A/V, SI)
+static constexpr size_t MAX_HANDOVER_PIDS = 32;
+
+// Copy a snapshot out of the reader's ring into the output batch, `lead_in`
+// packets in, leaving room for packets that must go out ahead of it. The
+// copy is validated: only the `count` packets at out + lead_in reach the
+// output. Returns the start of the reserved run, nullptr on failure.
+static ts::TSPacket* copySnapshot(const StreamInput::PacketSnapshot& snapshot, PacketSink& output,
+                                  size_t lead_in, size_t& count) {
+    count = 0;
+    ts::TSPacket* out = output.reserve(lead_in + snapshot.size());
+    if (!out) {
+        std::cerr << "[Main] Failed to reserve " << lead_in + snapshot.size() << " output packets" << std::endl;
+        return nullptr;
+    }
+    count = snapshot.copyTo(out + lead_in);
+    return out;
+}
+
+// First CC of each PID that carries payload, in order of appearance
+static std::vector<std::pair<ts::PID, uint8_t>> firstContinuityCounters(std::span<const ts::TSPacket> packets) {
+    std::vector<std::pair<ts::PID, uint8_t>> first;
+    std::map<ts::PID, bool> seen;
+    for (const ts::TSPacket& pkt : packets) {
+        if (!(pkt.b[3] & 0x10) || seen[pkt.getPID()]) {
+            continue;   // No payload (CC does not advance), or done
+        }
+        seen[pkt.getPID()] = true;
+        first.emplace_back(pkt.getPID(), pkt.b[3] & 0x0F);
+    }
+    return first;
+}
+
+// Rebase a snapshot from the reader's ring straight into the output batch
+// (one copy, no intermediate vector). The ring pin is dropped on return.
+// With cc_handover (see beginSourceSegment), each PID's first packet is
+// preceded by a discontinuity-flagged packet that hands its CC over to the
+// source's, taken from the validated copy.
+static size_t writeSnapshot(StreamInput::PacketSnapshot snapshot, StreamSplicer& splicer,
+                            RebaseContext& rebase, PacketSink& output, bool cc_handover = false) {
+    size_t lead_in = cc_handover ? MAX_HANDOVER_PIDS : 0;
+    size_t count = 0;
+    ts::TSPacket* out = copySnapshot(snapshot, output, lead_in, count);
+    if (!out) {
+        return 0;
+    }
+    snapshot.release();
+    
+    size_t resets = 0;
+    if (cc_handover) {
+        auto first = firstContinuityCounters(std::span<const ts::TSPacket>(out + lead_in, count));
+        if (first.size() > MAX_HANDOVER_PIDS) {
+            std::cerr << "[Main] CC handover on the first " << MAX_HANDOVER_PIDS << " of "
+                      << first.size() << " PIDs only" << std::endl;
+            first.resize(MAX_HANDOVER_PIDS);
+        }
+        resets = first.size();
+        if (resets < lead_in) {
+            std::memmove(out + resets, out + lead_in, count * sizeof(ts::TSPacket));
+        }
+        for (size_t i = 0; i < resets; i++) {
+            out[i] = splicer.createContinuityReset(first[i].first, first[i].second);
+        }
+    }
+    splicer.rebaseAndFixContinuity(std::span<ts::TSPacket>(out + resets, count), rebase);
+    output.commit(resets + count);
+    return count;
+}
+
+// Put a source on air ahead of its snapshot. With passthrough on, a source
+// whose own timestamps are just ahead of the output timeline goes back onto
+// them, so the segment needs no rewrite and can be tee'd again; returns true
+// then, and the snapshot must be written with CC handover. Otherwise the
+// source is mapped onto the end of the timeline.
+static bool beginSourceSegment(StreamInput& reader, StreamSplicer& splicer, RebaseContext& rebase,
+                               bool at_source) {
+    if (!at_source) {
+        splicer.beginSegment(rebase, reader.getPTSBase(), reader.getPCRBase(), reader.getPCRPTSAlignmentOffset());
+        return false;
+    }
+    return splicer.beginSegmentAtSource(rebase, reader.getPTSBase(), reader.getPCRBase(),
+                                        reader.getPCRPTSAlignmentOffset());
+}
+
+// Live input: built-in SRT listener when <PREFIX>_SRT=[address:]port is set,
+// native UDP when <PREFIX>_UDP=address:port is set (multicast groups are
+// joined, on <PREFIX>_UDP_IFACE if given), else the named pipe
+static std::unique_ptr<StreamInput> makeLiveInput(const std::string& name, const std::string& pipe_path,
+                                                  const std::string& env_prefix) {
+    if (const char* srt = std::getenv((env_prefix + "_SRT").c_str())) {
+#ifdef HAVE_LIBSRT
+        std::string spec = srt;
+        size_t colon = spec.rfind(':');
+        std::string address = (colon == std::string::npos) ? "0.0.0.0" : spec.substr(0, colon);
+        uint16_t port = static_cast<uint16_t>(std::stoi(colon == std::string::npos ? spec : spec.substr(colon + 1)));
+        auto input = std::make_unique<SrtInput>(name, address, port);
+        if (const char* env = std::getenv("SRT_LATENCY_MS")) {
+            input->setLatencyMs(std::stoi(env));
+        }
+        if (const char* env = std::getenv("SRT_PASSPHRASE")) {
+            input->setPassphrase(env);
+        }
+        std::cout << "[Main] " << name << " input: SRT listener " << address << ":" << port << std::endl;
+        return input;
+#else
+        std::cerr << "[Main] " << env_prefix << "_SRT=" << srt << " ignored: built without libsrt" << std::endl;
+#endif
+    }
+    
+    const char* udp = std::getenv((env_prefix + "_UDP").c_str());
+    std::string spec = udp ? udp : "";
+    size_t colon = spec.rfind(':');
+    if (spec.empty() || colon == std::string::npos) {
+        if (!spec.empty()) {
+            std::cerr << "[Main] " << env_prefix << "_UDP must be address:port, using " << pipe_path << std::endl;
+        }
+        return std::make_unique<FIFOInput>(name, pipe_path);
+    }
+    
+    const char* iface = std::getenv((env_prefix + "_UDP_IFACE").c_str());
+    auto input = std::make_unique<UdpInput>(name, spec.substr(0, colon),
+                                            static_cast<uint16_t>(std::stoi(spec.substr(colon + 1))),
+                                            iface ? iface : "");
+    if (const char* env = std::getenv("UDP_RCVBUF_BYTES")) {
+        input->setReceiveBufferSize(std::stoi(env));
+    }
+    if (const char* env = std::getenv("UDP_GRO")) {
+        input->setGro(std::string(env) != "0");
+    }
+    if (const char* env = std::getenv("UDP_RECV_BATCH")) {
+        input->setRecvBatch(std::stoull(env));
+    }
+    std::cout << "[Main] " << name << " input: UDP " << spec << std::endl;
+    return input;
+}
+
+// Carry each PID's source continuity counters straight on into the output,
+// so packets only need a CC rewrite where something was injected: the next
+// CC on a PID is backdated by the packets injected ahead of the snapshot.
+// `packets` is the validated copy of the snapshot, as it will go out.
+static void seedContinuityFromSnapshot(std::span<const ts::TSPacket> packets,
+                                       const std::map<ts::PID, size_t>& injected,
+                                       StreamSplicer& splicer) {
+    for (const auto& [pid, cc] : firstContinuityCounters(packets)) {
+        auto it = injected.find(pid);
+        size_t ahead = (it != injected.end()) ? it->second : 0;
+        splicer.seedContinuity(pid, static_cast<uint8_t>((cc - ahead) & 0x0F));
+    }
+}
+
+// Fan-out defaults: ~12 MB of shared history, ~1.5 MB (a few seconds) of lag per sink
+static constexpr size_t FANOUT_RING_PACKETS = 65536;
+static constexpr size_t FANOUT_MAX_LAG_PACKETS = 8192;
+
+// Packets in a row that must go out unchanged before passthrough is tried
+static constexpr uint64_t PASSTHROUGH_MIN_RUN = 1000;
+
+// Hand the output over to tee() passthrough once the active source has been
+// going out unchanged for a while, and drive the handover: the reactor takes
+// over only with the output flushed up to the ring head.
+static void updatePassthrough(StreamInput& reader, StreamSplicer& splicer, PacketSink& output,
+                              uint64_t& run_mark) {
+    uint64_t run = splicer.getUnchangedRun();
+    if (run < run_mark) {
+        run_mark = 0;   // New segment
+    }
+    
+    if (!reader.isPassthroughRequested()) {
+        if (run - run_mark < PASSTHROUGH_MIN_RUN) {
+            return;
+        }
+        run_mark = run;     // Don't retry on every batch if refused
+        output.flush();
+        if (!reader.startPassthrough(output.getFd())) {
+            return;
+        }
+        std::cout << "[Main] " << run << " packets unchanged - requesting " << reader.getName()
+                  << " passthrough" << std::endl;
+    }
+    
+    if (!reader.isPassthroughActive()) {
+        output.flush();
+        reader.markOutputFlushed();
+    }
+}
+
+// Total bytes written to the output, by the main loop or by tee()
+static uint64_t outputBytes(const PacketSink& output, std::initializer_list<const StreamInput*> readers) {
+    uint64_t bytes = output.getBytesWritten();
+    for (const StreamInput* reader : readers) {
+        bytes += reader->getPassthroughBytes();
+    }
+    return bytes;
+}
+
+// Clean point policy for one input from <PREFIX>_SWITCH_POLICY
+// (oldest / newest / target_latency) and <PREFIX>_TARGET_LATENCY_MS
+static void configureSwitchPolicy(StreamInput& reader, const std::string& prefix) {
+    StreamInput::CleanPointPolicy policy = reader.getCleanPointPolicy();
+    int target_ms = reader.getTargetLatencyMs();
+    if (const char* env = std::getenv((prefix + "_SWITCH_POLICY").c_str()); env && *env) {
+        if (!StreamInput::parseCleanPointPolicy(env, policy)) {
+            std::cerr << "[Main] Unknown " << prefix << "_SWITCH_POLICY=" << env << ", using "
+                      << StreamInput::cleanPointPolicyName(policy) << std::endl;
+        }
+    }
+    if (const char* env = std::getenv((prefix + "_TARGET_LATENCY_MS").c_str())) {
+        target_ms = std::stoi(env);
+    }
+    reader.setCleanPointPolicy(policy, target_ms);
+}
+
+// Latency sample for a dequeued batch: its oldest rewritten packet (after
+// `teed` already written by tee()), about to become output packet out_seq
+static void trackBatchLatency(LatencyTracker& tracker, const StreamInput& reader, size_t teed,
+                              int64_t dequeue_ns, size_t source, uint64_t out_seq) {
+    int64_t ingest_ns;
+    if (reader.getIngestTimeNs(reader.getLastBatchSequence() + teed, ingest_ns)) {
+        tracker.recordBatch(source, ingest_ns, dequeue_ns, out_seq);
+    }
+}
+
+// "cc=3 pat=1 active=pts_stall" - the non-zero transport error counts
+static std::string transportErrorSummary(const TransportAnalyzer::Report& report) {
+    std::ostringstream out;
+    for (int i = 0; i < TransportAnalyzer::INDICATOR_COUNT; i++) {
+        if (report.errors[i] > 0) {
+            out << (out.tellp() > 0 ? " " : "")
+                << TransportAnalyzer::indicatorName(static_cast<TransportAnalyzer::Indicator>(i)) << "=" << report.errors[i];
+        }
+    }
+    for (size_t i = 0; i < report.active.size(); i++) {
+        out << (i == 0 ? (out.tellp() > 0 ? " active=" : "active=") : ",")
+            << TransportAnalyzer::indicatorName(report.active[i]);
+    }
+    return out.tellp() > 0 ? out.str() : "no errors";
+}
+
+// Fan-out sink policy from the environment (wait / drop_to_idr / disconnect)
+static FanoutOutput::Policy envPolicy(const char* name, FanoutOutput::Policy fallback) {
+    const char* env = std::getenv(name);
+    if (!env || !*env) {
+        return fallback;
+    }
+    FanoutOutput::Policy policy;
+    if (!FanoutOutput::parsePolicy(env, policy)) {
+        std::cerr << "[Main] Unknown " << name << "=" << env << ", using "
+                  << FanoutOutput::policyName(fallback) << std::endl;
+        return fallback;
+    }
+    return policy;
+}
+
+// Switch latency: from the switch decision until the new source's snapshot is written
+static void recordSwitchLatency(LatencyHistogram& histogram, std::chrono::steady_clock::time_point start) {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    histogram.record(elapsed);
+    std::cout << "[Main] Switch completed in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / 1000.0
+              << " ms" << std::endl;
+}
+
 int main(int argc, char* argv[]) {
     std::cout << "=== Streamlined Multiplexer (Camera + Fallback) ===" << std::endl;
     std::cout << "Based on multi2 TCP splicing pattern" << std::endl;
@@ -69,6 +369,9 @@ int main(int argc, char* argv[]) {
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     
+    // Output writes report EPIPE instead of killing the process when ffmpeg goes away
+    signal(SIGPIPE, SIG_IGN);
+    
     // Configuration
     const std::string CAMERA_PIPE = "/pipe/camera.ts";
     const std::string FALLBACK_PIPE = "/pipe/fallback.ts";
@@ -86,11 +389,49 @@ int main(int argc, char* argv[]) {
     if (const char* env = std::getenv("BITRATE_WINDOW_SECONDS")) {
         health_config.bitrate_window_seconds = std::stoi(env);
     }
+    if (const char* env = std::getenv("MAX_GAP_MS")) {
+        health_config.max_gap_ms = std::stoll(env);
+    }
+    if (const char* env = std::getenv("MIN_TRANSPORT_SCORE")) {
+        health_config.min_transport_score = std::clamp(std::stoi(env), 0, 100);
+    }
     
     std::cout << "[Main] Stream health config:" << std::endl;
     std::cout << "  max_data_age_ms: " << health_config.max_data_age_ms << std::endl;
     std::cout << "  min_bitrate_bps: " << health_config.min_bitrate_bps << std::endl;
     std::cout << "  bitrate_window_seconds: " << health_config.bitrate_window_seconds << std::endl;
+    std::cout << "  max_gap_ms: " << health_config.max_gap_ms << std::endl;
+    std::cout << "  min_transport_score: " << health_config.min_transport_score << std::endl;
+    
+    // Output batching: flush after N packets or after the deadline, whichever comes first
+    size_t output_flush_packets = OutputBatcher::DEFAULT_FLUSH_PACKETS;
+    int output_flush_deadline_ms = OutputBatcher::DEFAULT_FLUSH_DEADLINE_MS;
+    if (const char* env = std::getenv("OUTPUT_FLUSH_PACKETS")) {
+        output_flush_packets = std::stoull(env);
+    }
+    if (const char* env = std::getenv("OUTPUT_FLUSH_DEADLINE_MS")) {
+        output_flush_deadline_ms = std::stoi(env);
+    }
+    
+    // Input backend: io_uring when built with liburing, unless disabled
+    bool input_io_uring = true;
+    if (const char* env = std::getenv("INPUT_IO_URING")) {
+        input_io_uring = std::string(env) != "0";
+    }
+    
+    // tee() passthrough while the active source needs no rewrite, unless disabled
+    bool output_passthrough = true;
+    if (const char* env = std::getenv("OUTPUT_PASSTHROUGH")) {
+        output_passthrough = std::string(env) != "0";
+    }
+    // Largest timestamp gap a source may skip to go back on air on its own
+    // timestamps (and so become eligible for passthrough again)
+    uint64_t passthrough_realign_ms = 500;
+    if (const char* env = std::getenv("PASSTHROUGH_REALIGN_MS")) {
+        passthrough_realign_ms = std::stoull(env);
+    }
+    std::cout << "[Main] Output passthrough: " << (output_passthrough ? "enabled" : "disabled")
+              << ", realign gap up to " << passthrough_realign_ms << " ms" << std::endl;
     
     // Get controller URL from environment variable
     const char* controller_url_env = std::getenv("CONTROLLER_URL");
@@ -113,16 +454,159 @@ int main(int argc, char* argv[]) {
     }
     
     // Create components
-    std::cout << "[Main] Creating FIFO readers..." << std::endl;
-    FIFOInput camera_reader("Camera", CAMERA_PIPE);
+    std::cout << "[Main] Creating input readers..." << std::endl;
+    std::unique_ptr<StreamInput> camera_input = makeLiveInput("Camera", CAMERA_PIPE, "CAMERA");
     FIFOInput fallback_reader("Fallback", FALLBACK_PIPE);
-    FIFOInput drone_reader("Drone", DRONE_PIPE);
+    std::unique_ptr<StreamInput> drone_input = makeLiveInput("Drone", DRONE_PIPE, "DRONE");
+    StreamInput& camera_reader = *camera_input;
+    StreamInput& drone_reader = *drone_input;
+    
+    // Which buffered clean point a switch to each input starts from
+    configureSwitchPolicy(camera_reader, "CAMERA");
+    configureSwitchPolicy(fallback_reader, "FALLBACK");
+    configureSwitchPolicy(drone_reader, "DRONE");
+    
+    for (StreamInput* reader : {&camera_reader, static_cast<StreamInput*>(&fallback_reader), &drone_reader}) {
+        reader->configureHealthThresholds(health_config);
+    }
+    
+    // Frame grab index (GET /frame): FRAME_INDEX_MB of TS history per input, off unless set
+    size_t frame_index_mb = 0;
+    int frame_index_seconds = 30;
+    if (const char* env = std::getenv("FRAME_INDEX_MB")) {
+        frame_index_mb = std::stoull(env);
+    }
+    if (const char* env = std::getenv("FRAME_INDEX_SECONDS")) {
+        frame_index_seconds = std::stoi(env);
+    }
+    if (frame_index_mb > 0) {
+        for (StreamInput* reader : {&camera_reader, static_cast<StreamInput*>(&fallback_reader), &drone_reader}) {
+            reader->enableFrameIndex(frame_index_mb * 1024 * 1024, frame_index_seconds);
+        }
+    }
+    
+    // Declared after the readers so it stops before they are destroyed
+    InputReactor reactor;
+    reactor.setUseIoUring(input_io_uring);
+    reactor.addInput(camera_reader);
+    reactor.addInput(fallback_reader);
+    reactor.addInput(drone_reader);
+    
+    // Output: in-process FLV remux + RTMP publish when RTMP_OUTPUT_URL is set,
+    // else the named pipe to ffmpeg-rtmp-output
+    std::unique_ptr<PacketSink> output_sink;
+    std::string output_name;
+    RTMPOutput* rtmp_output = nullptr;
+    FIFOOutput* fifo_output = nullptr;
+    SequenceStamps egress_stamps;   // Outlives the output that writes it
+    if (const char* url = std::getenv("RTMP_OUTPUT_URL"); url && *url) {
+        std::cout << "[Main] Creating RTMP output (" << url << ")..." << std::endl;
+        auto rtmp = std::make_unique<RTMPOutput>(url, g_running);
+        rtmp_output = rtmp.get();
+        output_sink = std::move(rtmp);
+        output_name = "RTMP";
+    } else {
+        std::cout << "[Main] Creating FIFO output..." << std::endl;
+        auto fifo = std::make_unique<FIFOOutput>(OUTPUT_PIPE, g_running);
+        fifo_output = fifo.get();
+        output_sink = std::move(fifo);
+        output_name = "FIFO";
+    }
+    
+    // Fan-out: publish the spliced stream once into a shared ring and give every
+    // sink its own thread and cursor, so no sink can stall the splice loop.
+    // On with OUTPUT_FANOUT=1 or as soon as an extra sink is configured.
+    FanoutOutput* fanout = nullptr;
+    std::unique_ptr<HttpTsServer> http_ts_server;
+    const char* tcp_env = std::getenv("OUTPUT_TCP");
+    const char* record_env = std::getenv("OUTPUT_RECORD_PATH");
+    const char* http_ts_env = std::getenv("OUTPUT_HTTP_TS_PORT");
+    const char* fanout_env = std::getenv("OUTPUT_FANOUT");
+    bool fanout_enabled = (fanout_env && std::string(fanout_env) == "1") ||
+                          (tcp_env && *tcp_env) || (record_env && *record_env) || (http_ts_env && *http_ts_env);
+    if (fanout_enabled) {
+        size_t ring_packets = FANOUT_RING_PACKETS;
+        size_t max_lag_packets = FANOUT_MAX_LAG_PACKETS;
+        if (const char* env = std::getenv("OUTPUT_FANOUT_RING_PACKETS")) {
+            ring_packets = std::stoull(env);
+        }
+        if (const char* env = std::getenv("OUTPUT_MAX_LAG_PACKETS")) {
+            max_lag_packets = std::stoull(env);
+        }
+        
+        std::cout << "[Main] Creating output fan-out..." << std::endl;
+        auto fan = std::make_unique<FanoutOutput>(ring_packets, g_running);
+        fan->addSink(output_name, std::move(output_sink),
+                     envPolicy("OUTPUT_POLICY", FanoutOutput::Policy::WAIT), max_lag_packets);
+        rtmp_output = nullptr;  // Runs on its own thread now; see the fan-out statistics
+        fifo_output = nullptr;  // May skip packets, so its count no longer follows ours
+        
+        std::string tcp_spec = tcp_env ? tcp_env : "";
+        size_t colon = tcp_spec.rfind(':');
+        if (colon != std::string::npos) {
+            fan->addSink("TCP " + tcp_spec,
+                         std::make_unique<TCPOutput>(tcp_spec.substr(0, colon),
+                                                     static_cast<uint16_t>(std::stoi(tcp_spec.substr(colon + 1))),
+                                                     g_running),
+                         envPolicy("OUTPUT_TCP_POLICY", FanoutOutput::Policy::DROP_TO_IDR), max_lag_packets);
+        } else if (!tcp_spec.empty()) {
+            std::cerr << "[Main] OUTPUT_TCP must be host:port, ignoring " << tcp_spec << std::endl;
+        }
+        if (record_env && *record_env) {
+            fan->addSink(std::string("Recorder ") + record_env, std::make_unique<FileOutput>(record_env),
+                         envPolicy("OUTPUT_RECORD_POLICY", FanoutOutput::Policy::WAIT), max_lag_packets);
+        }
+        if (http_ts_env && *http_ts_env) {
+            http_ts_server = std::make_unique<HttpTsServer>(
+                static_cast<uint16_t>(std::stoi(http_ts_env)), *fan,
+                envPolicy("OUTPUT_HTTP_TS_POLICY", FanoutOutput::Policy::DISCONNECT), max_lag_packets);
+        }
+        fanout = fan.get();
+        output_sink = std::move(fan);
+    }
+    
+    // PCR pacing in front of whatever the output is: packets are queued and
+    // released on the PCR timeline from the pacer's own thread
+    OutputPacer* pacer = nullptr;
+    if (const char* env = std::getenv("OUTPUT_PACING"); env && std::string(env) == "1") {
+        int lead_ms = OutputPacer::DEFAULT_LEAD_MS;
+        int max_rate_pct = OutputPacer::DEFAULT_MAX_RATE_PCT;
+        if (const char* lead_env = std::getenv("OUTPUT_PACING_LEAD_MS")) {
+            lead_ms = std::stoi(lead_env);
+        }
+        if (const char* rate_env = std::getenv("OUTPUT_PACING_MAX_RATE")) {
+            max_rate_pct = std::stoi(rate_env);
+        }
+        auto paced = std::make_unique<OutputPacer>(std::move(output_sink), lead_ms, max_rate_pct);
+        pacer = paced.get();
+        output_sink = std::move(paced);
+        rtmp_output = nullptr;  // Written from the pacer thread now
+    }
     
-    std::cout << "[Main] Creating FIFO output..." << std::endl;
-    FIFOOutput fifo_output(OUTPUT_PIPE, g_running);
+    // Latency tracking (ingest -> dequeue -> egress), off unless LATENCY_TRACKING=1.
+    // Egress is stamped by the FIFO when it gets the stream in order (directly
+    // or through the pacer); other outputs only get ingest -> dequeue.
+    std::unique_ptr<LatencyTracker> latency_tracker;
+    if (const char* env = std::getenv("LATENCY_TRACKING"); env && std::string(env) == "1") {
+        if (fifo_output) {
+            fifo_output->setEgressStamps(&egress_stamps);
+        }
+        latency_tracker = std::make_unique<LatencyTracker>(
+            std::vector<std::string>{"fallback", "camera", "drone"}, fifo_output ? &egress_stamps : nullptr);
+        fallback_reader.setLatencyTracking(true);
+        camera_reader.setLatencyTracking(true);
+        drone_reader.setLatencyTracking(true);
+        std::cout << "[Main] Latency tracking: enabled ("
+                  << (fifo_output ? "ingest -> dequeue -> egress" : "ingest -> dequeue only") << ")" << std::endl;
+    }
+    PacketSink& output = *output_sink;
+    output.setBatching(output_flush_packets, output_flush_deadline_ms);
     
     std::cout << "[Main] Creating stream splicer..." << std::endl;
     StreamSplicer splicer;
+    splicer.setMaxRealignGap(passthrough_realign_ms * 90);
+    
+    LatencyHistogram switch_latency;
     
     // Create and start HTTP server for controller integration
     std::cout << "[Main] Creating HTTP server on port 8091..." << std::endl;
@@ -185,20 +669,129 @@ int main(int argc, char* argv[]) {
         metrics.fallback.connected = fallback_reader.isConnected();
         metrics.fallback.data_age_ms = fallback_reader.getMsSinceLastData();
         metrics.fallback.bitrate_bps = fallback_reader.getCurrentBitrateBps();
+        metrics.fallback.packet_rate = fallback_reader.getPacketRate();
+        metrics.fallback.jitter_us = fallback_reader.getJitterUs();
+        metrics.fallback.max_gap_ms = fallback_reader.getMaxGapMs();
+        fallback_reader.getTransportReport(metrics.fallback.ts_health);
         
         // Camera metrics
         metrics.camera.connected = camera_reader.isConnected();
         metrics.camera.data_age_ms = camera_reader.getMsSinceLastData();
         metrics.camera.bitrate_bps = camera_reader.getCurrentBitrateBps();
+        metrics.camera.packet_rate = camera_reader.getPacketRate();
+        metrics.camera.jitter_us = camera_reader.getJitterUs();
+        metrics.camera.max_gap_ms = camera_reader.getMaxGapMs();
+        camera_reader.getTransportReport(metrics.camera.ts_health);
+        metrics.camera.transport = camera_reader.getTransportStats();
         
         // Drone metrics
         metrics.drone.connected = drone_reader.isConnected();
         metrics.drone.data_age_ms = drone_reader.getMsSinceLastData();
         metrics.drone.bitrate_bps = drone_reader.getCurrentBitrateBps();
+        metrics.drone.packet_rate = drone_reader.getPacketRate();
+        metrics.drone.jitter_us = drone_reader.getJitterUs();
+        metrics.drone.max_gap_ms = drone_reader.getMaxGapMs();
+        drone_reader.getTransportReport(metrics.drone.ts_health);
+        metrics.drone.transport = drone_reader.getTransportStats();
         
         return metrics;
     });
     
+    // Register switch policy callbacks (per input, applied at its next switch)
+    http_server.setGetSwitchPoliciesCallback([&camera_reader, &fallback_reader, &drone_reader]() -> HttpServer::AllSwitchPolicies {
+        auto info = [](const StreamInput& reader) {
+            HttpServer::SwitchPolicyInfo i;
+            i.policy = StreamInput::cleanPointPolicyName(reader.getCleanPointPolicy());
+            i.target_latency_ms = reader.getTargetLatencyMs();
+            i.added_latency_ms = reader.getAddedLatencyMs();
+            return i;
+        };
+        return {info(fallback_reader), info(camera_reader), info(drone_reader)};
+    });
+    http_server.setSwitchPolicyCallback([&camera_reader, &fallback_reader, &drone_reader](
+            const std::string& source, const std::string& policy_name, int target_latency_ms) -> bool {
+        StreamInput* reader = source == "camera" ? &camera_reader :
+                              source == "fallback" ? static_cast<StreamInput*>(&fallback_reader) :
+                              source == "drone" ? &drone_reader : nullptr;
+        StreamInput::CleanPointPolicy policy;
+        if (!reader || !StreamInput::parseCleanPointPolicy(policy_name, policy)) {
+            return false;
+        }
+        reader->setCleanPointPolicy(policy, target_latency_ms >= 0 ? target_latency_ms : reader->getTargetLatencyMs());
+        return true;
+    });
+    
+    // Register /metrics callback: switch latency, output jitter and, when
+    // tracking, per-source residence histograms
+    LatencyTracker* tracker = latency_tracker.get();
+    http_server.setGetMetricsCallback([&switch_latency, pacer, tracker]() -> std::vector<HttpServer::HistogramMetric> {
+        std::vector<HttpServer::HistogramMetric> metrics;
+        metrics.push_back({"multiplexer_switch_latency_seconds",
+                           "Switch decision until the new source's first packets are written", "",
+                           switch_latency.snapshot()});
+        if (pacer) {
+            metrics.push_back({"multiplexer_output_jitter_seconds",
+                               "Output PCR interval vs wall-clock interval", "", pacer->getJitter()});
+        }
+        if (tracker) {
+            std::vector<LatencyTracker::SourceStats> sources = tracker->snapshot();
+            for (const auto& src : sources) {
+                metrics.push_back({"multiplexer_ingest_to_dequeue_seconds",
+                                   "Input read() until the main loop dequeues the packet",
+                                   "source=\"" + src.name + "\"", src.ingest_to_dequeue});
+            }
+            if (tracker->hasEgress()) {
+                for (const auto& src : sources) {
+                    metrics.push_back({"multiplexer_dequeue_to_egress_seconds",
+                                       "Main loop dequeue until the output write completes",
+                                       "source=\"" + src.name + "\"", src.dequeue_to_egress});
+                }
+                for (const auto& src : sources) {
+                    metrics.push_back({"multiplexer_residence_seconds",
+                                       "Input read() until the output write completes",
+                                       "source=\"" + src.name + "\"", src.residence});
+                }
+            }
+        }
+        return metrics;
+    });
+    
+    // Register frame grab callback: the best match across the inputs' indexes
+    if (frame_index_mb > 0) {
+        http_server.setGetFrameCallback([&camera_reader, &fallback_reader, &drone_reader](
+                bool latest, uint64_t pts, HttpServer::FrameGrab& frame) -> bool {
+            uint64_t best_pts = 0;
+            uint64_t best_distance = UINT64_MAX;
+            std::vector<uint8_t> data;
+            for (StreamInput* reader : {static_cast<StreamInput*>(&fallback_reader), &camera_reader, &drone_reader}) {
+                uint64_t output_pts;
+                if (!reader->grabFrame(latest, pts, output_pts, data)) {
+                    continue;
+                }
+                uint64_t distance = latest ? UINT64_MAX - output_pts
+                                           : (pts - output_pts) & (RebaseContext::PTS_MODULUS - 1);
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    best_pts = output_pts;
+                    frame.source = reader == &fallback_reader ? "fallback" : reader == &camera_reader ? "camera" : "drone";
+                    frame.data.assign(data.begin(), data.end());
+                }
+            }
+            frame.pts = best_pts % RebaseContext::PTS_MODULUS;
+            return best_distance != UINT64_MAX;
+        });
+    }
+    
+    // Register switch latency callback
+    http_server.setGetSwitchLatencyCallback([&switch_latency]() -> LatencyHistogram::Snapshot {
+        return switch_latency.snapshot();
+    });
+    
+    // Register output jitter callback (empty unless pacing is on)
+    http_server.setGetOutputJitterCallback([pacer]() -> LatencyHistogram::Snapshot {
+        return pacer ? pacer->getJitter() : LatencyHistogram::Snapshot{};
+    });
+    
     if (!http_server.start()) {
         std::cerr << "[Main] Failed to start HTTP server" << std::endl;
         return 1;
@@ -206,18 +799,11 @@ int main(int argc, char* argv[]) {
     
     // Start FIFO readers
     std::cout << "[Main] Starting FIFO readers..." << std::endl;
-    if (!camera_reader.start()) {
-        std::cerr << "[Main] Failed to start camera reader" << std::endl;
-        return 1;
-    }
-    if (!fallback_reader.start()) {
-        std::cerr << "[Main] Failed to start fallback reader" << std::endl;
-        return 1;
-    }
-    if (!drone_reader.start()) {
-        std::cerr << "[Main] Failed to start drone reader" << std::endl;
+    if (!reactor.start()) {
+        std::cerr << "[Main] Failed to start input reactor" << std::endl;
         return 1;
     }
+    std::cout << "[Main] Input backend: " << reactor.getBackendName() << std::endl;
     
     // Wait for fallback stream (required)
     std::cout << "[Main] Waiting for fallback stream..." << std::endl;
@@ -237,86 +823,93 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    // Initialize splicer with PCR/PTS alignment offset
-    splicer.initializeWithAlignmentOffset(fallback_reader.getPCRPTSAlignmentOffset());
+    // Start the output timeline on the fallback's own timestamps, so its
+    // first segment goes out with the source's PTS/PCR untouched
+    splicer.initializeAtSource(fallback_reader.getPTSBase(), fallback_reader.getPCRBase());
     
-    // Open named pipe output (will block until ffmpeg opens it for reading)
-    std::cout << "[Main] Opening named pipe for output..." << std::endl;
-    if (!fifo_output.open()) {
-        std::cerr << "[Main] Failed to open output pipe" << std::endl;
+    // Open the output (the named pipe blocks until ffmpeg opens it for
+    // reading; RTMP connects and the fan-out opens its sinks on their own
+    // threads, so both return right away)
+    std::cout << "[Main] Opening output..." << std::endl;
+    if (!output.open()) {
+        std::cerr << "[Main] Failed to open output" << std::endl;
         return 1;
     }
+    if (http_ts_server && !http_ts_server->start()) {
+        std::cerr << "[Main] HTTP-TS output disabled" << std::endl;
+        http_ts_server.reset();
+    }
     
-    // Write initial PAT/PMT
-    std::cout << "[Main] Writing initial PAT/PMT..." << std::endl;
+    // tee() needs a pipe on the output side
+    if (output_passthrough && output.getFd() < 0) {
+        std::cout << "[Main] Output passthrough: not available for this output" << std::endl;
+        output_passthrough = false;
+    }
+    
+    // Get initial buffered packets from fallback
+    auto initial_snapshot = fallback_reader.getSnapshotFromAudioSync();
+    std::cout << "[Main] Processing " << initial_snapshot.size() << " initial fallback packets" << std::endl;
+    
+    // Initial PAT/PMT
     ts::TSPacket pat = splicer.createPAT(fallback_info.program_number > 0 ? fallback_info.program_number : 1,
                                          ts::PID(4096));
-    splicer.fixContinuityCounter(pat);
-    fifo_output.writePacket(pat);
-    
     ts::TSPacket pmt = splicer.createPMT(fallback_info.program_number > 0 ? fallback_info.program_number : 1,
                                          fallback_info.video_pid,
                                          fallback_info.video_pid,
                                          fallback_info.audio_pid,
                                          fallback_info.video_stream_type,
                                          fallback_info.audio_stream_type);
-    splicer.fixContinuityCounter(pmt);
-    fifo_output.writePacket(pmt);
     
-    // Get initial buffered packets from fallback
-    auto initial_packets = fallback_reader.getBufferedPacketsFromAudioSync();
-    std::cout << "[Main] Processing " << initial_packets.size() << " initial fallback packets" << std::endl;
-    
-    // Inject SPS/PPS before first IDR
+    // SPS/PPS before first IDR
     std::vector<uint8_t> sps = fallback_reader.getSPSData();
     std::vector<uint8_t> pps = fallback_reader.getPPSData();
+    std::vector<ts::TSPacket> sps_pps_packets;
     if (!sps.empty() && !pps.empty()) {
         // Use global PTS offset as PTS for SPS/PPS
-        auto sps_pps_packets = splicer.createSPSPPSPackets(sps, pps, fallback_info.video_pid,
-                                                           splicer.getGlobalPTSOffset());
-        std::cout << "[Main] Injecting " << sps_pps_packets.size() << " camera SPS/PPS packets" << std::endl;
-        for (auto& pkt : sps_pps_packets) {
-            splicer.fixContinuityCounter(pkt);
-            fifo_output.writePacket(pkt);
-        }
+        sps_pps_packets = splicer.createSPSPPSPackets(sps, pps, fallback_info.video_pid,
+                                                      splicer.getGlobalPTSOffset());
     }
     
-    // Process initial fallback packets
-    uint64_t max_pts = 0;
-    uint64_t max_pcr = 0;
-    uint64_t pts_base = fallback_reader.getPTSBase();
-    uint64_t pcr_base = fallback_reader.getPCRBase();
-    int64_t pcr_pts_alignment = fallback_reader.getPCRPTSAlignmentOffset();
-    
-    for (auto& pkt : initial_packets) {
-        splicer.rebasePacket(pkt, pts_base, pcr_base, pcr_pts_alignment);
-        splicer.fixContinuityCounter(pkt);
-        fifo_output.writePacket(pkt);
-        
-        // Track max timestamps
-        if (pkt.hasPCR()) {
-            max_pcr = std::max(max_pcr, pkt.getPCR());
-        }
-        if (pkt.getPUSI() && pkt.hasPayload()) {
-            size_t header_size = pkt.getHeaderSize();
-            const uint8_t* payload = pkt.b + header_size;
-            size_t payload_size = ts::PKT_SIZE - header_size;
-            if (payload_size >= 14 && payload[0] == 0x00 && payload[1] == 0x00 && payload[2] == 0x01) {
-                uint8_t pts_dts_flags = (payload[7] >> 6) & 0x03;
-                if (pts_dts_flags == 0x02 || pts_dts_flags == 0x03) {
-                    uint64_t pts = ((uint64_t)(payload[9] & 0x0E) << 29) |
-                                  ((uint64_t)(payload[10]) << 22) |
-                                  ((uint8_t)(payload[11] & 0xFE) << 14) |
-                                  ((uint64_t)(payload[12]) << 7) |
-                                  ((uint64_t)(payload[13] >> 1));
-                    max_pts = std::max(max_pts, pts);
-                }
-            }
-        }
+    // Copy the snapshot first, behind room for PAT/PMT and SPS/PPS: the
+    // CCs those are backdated from must be the ones that go out
+    size_t lead_in = 2 + sps_pps_packets.size();
+    size_t initial_count = 0;
+    ts::TSPacket* initial_out = copySnapshot(initial_snapshot, output, lead_in, initial_count);
+    if (!initial_out) {
+        return 1;
     }
+    initial_snapshot.release();
     
-    // Update splicer offsets
-    splicer.updateOffsetsFromMaxTimestamps(max_pts, max_pcr);
+    std::map<ts::PID, size_t> injected;
+    injected[pat.getPID()]++;
+    injected[pmt.getPID()]++;
+    injected[fallback_info.video_pid] += sps_pps_packets.size();
+    seedContinuityFromSnapshot(std::span<const ts::TSPacket>(initial_out + lead_in, initial_count),
+                               injected, splicer);
+    
+    std::cout << "[Main] Writing initial PAT/PMT..." << std::endl;
+    splicer.fixContinuityCounter(pat);
+    initial_out[0] = pat;
+    splicer.fixContinuityCounter(pmt);
+    initial_out[1] = pmt;
+    
+    if (!sps_pps_packets.empty()) {
+        std::cout << "[Main] Injecting " << sps_pps_packets.size() << " camera SPS/PPS packets" << std::endl;
+        splicer.fixContinuityCounters(sps_pps_packets);
+        std::copy(sps_pps_packets.begin(), sps_pps_packets.end(), initial_out + 2);
+    }
+    
+    // Per-source timestamp mapping onto the output timeline. The active
+    // source's context is applied to every packet written, not just snapshots.
+    RebaseContext fallback_rebase;
+    RebaseContext camera_rebase;
+    RebaseContext drone_rebase;
+    
+    // Process initial fallback packets
+    splicer.beginSegment(fallback_rebase, fallback_reader.getPTSBase(),
+                         fallback_reader.getPCRBase(), fallback_reader.getPCRPTSAlignmentOffset());
+    splicer.rebaseAndFixContinuity(std::span<ts::TSPacket>(initial_out + lead_in, initial_count), fallback_rebase);
+    output.commit(lead_in + initial_count);
     
     // Start consuming from end of snapshot
     fallback_reader.initConsumptionFromIndex(fallback_reader.getLastSnapshotEnd());
@@ -324,20 +917,46 @@ int main(int argc, char* argv[]) {
     // Main loop state
     enum class Mode { FALLBACK, CAMERA, DRONE };
     Mode current_mode = Mode::FALLBACK;
-    FIFOInput* active_reader = &fallback_reader;
+    StreamInput* active_reader = &fallback_reader;
+    RebaseContext* active_rebase = &fallback_rebase;
     
     std::cout << "[Main] Entering main processing loop..." << std::endl;
     
     uint64_t packets_processed = 0;
     auto last_log = std::chrono::steady_clock::now();
+    
+    // Output mode (userspace / passthrough) accounting
+    auto total_output_bytes = [&]() {
+        return outputBytes(output, {&fallback_reader, &camera_reader, &drone_reader});
+    };
+    OutputModeUsage output_usage;
+    output_usage.start(total_output_bytes());
+    uint64_t passthrough_run_mark = 0;
     auto last_drone_check_log = std::chrono::steady_clock::now();
-
-    // CC verification tracking (like tcp_main.cpp)
-    std::map<ts::PID, uint8_t> last_cc_values;
-    size_t cc_discontinuities = 0;
-    size_t cc_verifications = 0;
     
+    // Segment mapping last published to the frame index
+    StreamInput* timeline_reader = nullptr;
+    uint64_t timeline_pts_base = 0;
+    uint64_t timeline_pts_offset = 0;
+
+    // Reused by the transport health logs, so they don't allocate per check
+    TransportAnalyzer::Report transport_report;
+
     while (g_running.load()) {
+        // Tell the frame index which input is on air and how its PTS map
+        // (every switch starts a segment, so this catches all of them)
+        if (frame_index_mb > 0 &&
+            (active_reader != timeline_reader || active_rebase->getPTSBase() != timeline_pts_base ||
+             active_rebase->getPTSOffset() != timeline_pts_offset)) {
+            if (timeline_reader && timeline_reader != active_reader) {
+                timeline_reader->endOutputTimeline();
+            }
+            timeline_reader = active_reader;
+            timeline_pts_base = active_rebase->getPTSBase();
+            timeline_pts_offset = active_rebase->getPTSOffset();
+            active_reader->setOutputTimeline(timeline_pts_base, timeline_pts_offset);
+        }
+        
         // Check for mode switch
         if (current_mode == Mode::FALLBACK) {
             // Determine which live source to try based on user selection
@@ -351,9 +970,9 @@ int main(int argc, char* argv[]) {
                         std::cout << "[Main] Camera became available - switching!" << std::endl;
                         std::cout << "[Main] =======================================" << std::endl;
                         
-                        camera_reader.waitForStreamInfo();
-                        camera_reader.waitForIDR();
-                        camera_reader.waitForAudioSync();
+                        active_reader->stopPassthrough();  // The output is ours again from here
+                        auto switch_start = std::chrono::steady_clock::now();
+                        positionAtCleanPoint(camera_reader, output);
                         
                         if (!camera_reader.extractTimestampBases()) {
                             std::cerr << "[Main] Failed to extract camera timestamp bases" << std::endl;
@@ -361,8 +980,8 @@ int main(int argc, char* argv[]) {
                         }
                         
                         // Get buffered packets from camera
-                        auto camera_packets = camera_reader.getBufferedPacketsFromAudioSync();
-                        std::cout << "[Main] Processing " << camera_packets.size() << " camera packets from audio sync" << std::endl;
+                        auto camera_snapshot = camera_reader.getSnapshotFromAudioSync();
+                        std::cout << "[Main] Processing " << camera_snapshot.size() << " camera packets from audio sync" << std::endl;
                         
                         // Inject SPS/PPS
                         std::vector<uint8_t> cam_sps = camera_reader.getSPSData();
@@ -373,51 +992,22 @@ int main(int argc, char* argv[]) {
                             auto sps_pps_pkt = splicer.createSPSPPSPackets(cam_sps, cam_pps, camera_info.video_pid,
                                                                             splicer.getGlobalPTSOffset());
                             std::cout << "[Main] Injecting " << sps_pps_pkt.size() << " camera SPS/PPS packets" << std::endl;
-                            for (auto& pkt : sps_pps_pkt) {
-                                splicer.fixContinuityCounter(pkt);
-                                fifo_output.writePacket(pkt);
-                            }
+                            splicer.fixContinuityCounters(sps_pps_pkt);
+                            output.writePackets(sps_pps_pkt);
                         }
                         
-                        // Update bases for camera stream
-                        pts_base = camera_reader.getPTSBase();
-                        pcr_base = camera_reader.getPCRBase();
-                        pcr_pts_alignment = camera_reader.getPCRPTSAlignmentOffset();
+                        // Map camera timestamps onto the output timeline from here on
+                        bool cc_handover = beginSourceSegment(camera_reader, splicer, camera_rebase, output_passthrough);
                         
-                        // Process camera packets
-                        uint64_t seg_max_pts = 0;
-                        uint64_t seg_max_pcr = 0;
-                        for (auto& pkt : camera_packets) {
-                            splicer.rebasePacket(pkt, pts_base, pcr_base, pcr_pts_alignment);
-                            splicer.fixContinuityCounter(pkt);
-                            fifo_output.writePacket(pkt);
-                            packets_processed++;
-                            
-                            // Track max timestamps
-                            if (pkt.hasPCR()) seg_max_pcr = std::max(seg_max_pcr, pkt.getPCR());
-                            if (pkt.getPUSI() && pkt.hasPayload()) {
-                                size_t header_size = pkt.getHeaderSize();
-                                const uint8_t* payload = pkt.b + header_size;
-                                size_t payload_size = ts::PKT_SIZE - header_size;
-                                if (payload_size >= 14 && payload[0] == 0x00 && payload[1] == 0x00 && payload[2] == 0x01) {
-                                    uint8_t pts_dts_flags = (payload[7] >> 6) & 0x03;
-                                    if (pts_dts_flags == 0x02 || pts_dts_flags == 0x03) {
-                                        uint64_t pts = ((uint64_t)(payload[9] & 0x0E) << 29) |
-                                                      ((uint64_t)(payload[10]) << 22) |
-                                                      ((uint64_t)(payload[11] & 0xFE) << 14) |
-                                                      ((uint64_t)(payload[12]) << 7) |
-                                                      ((uint64_t)(payload[13] >> 1));
-                                        seg_max_pts = std::max(seg_max_pts, pts);
-                                    }
-                                }
-                            }
-                        }
+                        // Rebase the camera snapshot straight into the output batch
+                        packets_processed += writeSnapshot(std::move(camera_snapshot), splicer, camera_rebase, output, cc_handover);
                         
-                        splicer.updateOffsetsFromMaxTimestamps(seg_max_pts, seg_max_pcr);
                         camera_reader.initConsumptionFromIndex(camera_reader.getLastSnapshotEnd());
+                        recordSwitchLatency(switch_latency, switch_start);
                         
                         current_mode = Mode::CAMERA;
                         active_reader = &camera_reader;
+                        active_rebase = &camera_rebase;
                         
                         // Track timestamp update when switching from fallback to camera
                         {
@@ -442,10 +1032,9 @@ int main(int argc, char* argv[]) {
                         std::cout << "[Main] Drone became available - switching!" << std::endl;
                         std::cout << "[Main] =======================================" << std::endl;
                         
-                        drone_reader.resetForNewLoop();
-                        drone_reader.waitForStreamInfo();
-                        drone_reader.waitForIDR();
-                        drone_reader.waitForAudioSync();
+                        active_reader->stopPassthrough();  // The output is ours again from here
+                        auto switch_start = std::chrono::steady_clock::now();
+                        positionAtCleanPoint(drone_reader, output);
                         
                         if (!drone_reader.extractTimestampBases()) {
                             std::cerr << "[Main] Failed to extract drone timestamp bases" << std::endl;
@@ -453,8 +1042,8 @@ int main(int argc, char* argv[]) {
                         }
                         
                         // Get buffered packets from drone
-                        auto drone_packets = drone_reader.getBufferedPacketsFromAudioSync();
-                        std::cout << "[Main] Processing " << drone_packets.size() << " drone packets from audio sync" << std::endl;
+                        auto drone_snapshot = drone_reader.getSnapshotFromAudioSync();
+                        std::cout << "[Main] Processing " << drone_snapshot.size() << " drone packets from audio sync" << std::endl;
                         
                         // Inject SPS/PPS
                         std::vector<uint8_t> drone_sps = drone_reader.getSPSData();
@@ -465,51 +1054,22 @@ int main(int argc, char* argv[]) {
                             auto sps_pps_pkt = splicer.createSPSPPSPackets(drone_sps, drone_pps, drone_info.video_pid,
                                                                             splicer.getGlobalPTSOffset());
                             std::cout << "[Main] Injecting " << sps_pps_pkt.size() << " drone SPS/PPS packets" << std::endl;
-                            for (auto& pkt : sps_pps_pkt) {
-                                splicer.fixContinuityCounter(pkt);
-                                fifo_output.writePacket(pkt);
-                            }
+                            splicer.fixContinuityCounters(sps_pps_pkt);
+                            output.writePackets(sps_pps_pkt);
                         }
                         
-                        // Update bases for drone stream
-                        pts_base = drone_reader.getPTSBase();
-                        pcr_base = drone_reader.getPCRBase();
-                        pcr_pts_alignment = drone_reader.getPCRPTSAlignmentOffset();
+                        // Map drone timestamps onto the output timeline from here on
+                        bool cc_handover = beginSourceSegment(drone_reader, splicer, drone_rebase, output_passthrough);
                         
-                        // Process drone packets
-                        uint64_t seg_max_pts = 0;
-                        uint64_t seg_max_pcr = 0;
-                        for (auto& pkt : drone_packets) {
-                            splicer.rebasePacket(pkt, pts_base, pcr_base, pcr_pts_alignment);
-                            splicer.fixContinuityCounter(pkt);
-                            fifo_output.writePacket(pkt);
-                            packets_processed++;
-                            
-                            // Track max timestamps
-                            if (pkt.hasPCR()) seg_max_pcr = std::max(seg_max_pcr, pkt.getPCR());
-                            if (pkt.getPUSI() && pkt.hasPayload()) {
-                                size_t header_size = pkt.getHeaderSize();
-                                const uint8_t* payload = pkt.b + header_size;
-                                size_t payload_size = ts::PKT_SIZE - header_size;
-                                if (payload_size >= 14 && payload[0] == 0x00 && payload[1] == 0x00 && payload[2] == 0x01) {
-                                    uint8_t pts_dts_flags = (payload[7] >> 6) & 0x03;
-                                    if (pts_dts_flags == 0x02 || pts_dts_flags == 0x03) {
-                                        uint64_t pts = ((uint64_t)(payload[9] & 0x0E) << 29) |
-                                                      ((uint64_t)(payload[10]) << 22) |
-                                                      ((uint64_t)(payload[11] & 0xFE) << 14) |
-                                                      ((uint64_t)(payload[12]) << 7) |
-                                                      ((uint64_t)(payload[13] >> 1));
-                                        seg_max_pts = std::max(seg_max_pts, pts);
-                                    }
-                                }
-                            }
-                        }
+                        // Rebase the drone snapshot straight into the output batch
+                        packets_processed += writeSnapshot(std::move(drone_snapshot), splicer, drone_rebase, output, cc_handover);
                         
-                        splicer.updateOffsetsFromMaxTimestamps(seg_max_pts, seg_max_pcr);
                         drone_reader.initConsumptionFromIndex(drone_reader.getLastSnapshotEnd());
+                        recordSwitchLatency(switch_latency, switch_start);
                         
                         current_mode = Mode::DRONE;
                         active_reader = &drone_reader;
+                        active_rebase = &drone_rebase;
                         
                         // Track timestamp update when switching from fallback to drone
                         {
@@ -553,6 +1113,19 @@ int main(int argc, char* argv[]) {
                     std::cout << "[Main] Camera bitrate too low (" << camera_reader.getCurrentBitrateBps()
                               << " bps < " << health_config.min_bitrate_bps << " bps) - switching back to fallback!" << std::endl;
                     std::cout << "[Main] =======================================" << std::endl;
+                } else if (health_config.max_gap_ms > 0 && camera_reader.getMaxGapMs() > health_config.max_gap_ms) {
+                    std::cout << "[Main] =======================================" << std::endl;
+                    std::cout << "[Main] Camera delivery gap too long (" << camera_reader.getMaxGapMs()
+                              << "ms > " << health_config.max_gap_ms << "ms, jitter " << camera_reader.getJitterUs()
+                              << "us) - switching back to fallback!" << std::endl;
+                    std::cout << "[Main] =======================================" << std::endl;
+                } else if (!camera_reader.isTransportHealthy()) {
+                    camera_reader.getTransportReport(transport_report);
+                    std::cout << "[Main] =======================================" << std::endl;
+                    std::cout << "[Main] Camera transport errors (score " << camera_reader.getTransportScore()
+                              << " < " << health_config.min_transport_score << ": "
+                              << transportErrorSummary(transport_report) << ") - switching back to fallback!" << std::endl;
+                    std::cout << "[Main] =======================================" << std::endl;
                 } else {
                     std::cout << "[Main] =======================================" << std::endl;
                     std::cout << "[Main] Camera unhealthy - switching back to fallback!" << std::endl;
@@ -575,23 +1148,30 @@ int main(int argc, char* argv[]) {
                     http_server.notifySceneChange("fallback", g_controller_url);
                 }
                 
-                // Reset for new loop
-                fallback_reader.resetForNewLoop();
-                fallback_reader.waitForStreamInfo();
-                fallback_reader.waitForIDR();
-                fallback_reader.waitForAudioSync();
+                // Resume fallback at its newest clean point
+                active_reader->stopPassthrough();  // The output is ours again from here
+                auto switch_start = std::chrono::steady_clock::now();
+                positionAtCleanPoint(fallback_reader, output);
                 
                 if (!fallback_reader.extractTimestampBases()) {
                     std::cerr << "[Main] Failed to extract fallback timestamp bases" << std::endl;
                     continue;
                 }
                 
+                // Resume fallback from its IDR, mapped onto the output timeline
+                auto fallback_snapshot = fallback_reader.getSnapshotFromAudioSync();
+                bool cc_handover = beginSourceSegment(fallback_reader, splicer, fallback_rebase, output_passthrough);
+                packets_processed += writeSnapshot(std::move(fallback_snapshot), splicer, fallback_rebase, output, cc_handover);
+                fallback_reader.initConsumptionFromIndex(fallback_reader.getLastSnapshotEnd());
+                recordSwitchLatency(switch_latency, switch_start);
+                
                 std::cout << "[Main] Switched to FALLBACK mode" << std::endl;
                 std::cout << "[Main] Camera packets received: " << camera_reader.getPacketsReceived() << std::endl;
                 http_server.notifySceneChange("fallback", g_controller_url);
                 
                 current_mode = Mode::FALLBACK;
                 active_reader = &fallback_reader;
+                active_rebase = &fallback_rebase;
             }
             // NEW: Check if user wants DRONE and drone is available (direct switch from CAMERA to DRONE)
             else if (g_requested_live_source.load() == RequestedLiveSource::DRONE &&
@@ -602,10 +1182,9 @@ int main(int argc, char* argv[]) {
                 std::cout << "[Main] User requested DRONE - switching from CAMERA!" << std::endl;
                 std::cout << "[Main] =======================================" << std::endl;
                 
-                drone_reader.resetForNewLoop();
-                drone_reader.waitForStreamInfo();
-                drone_reader.waitForIDR();
-                drone_reader.waitForAudioSync();
+                active_reader->stopPassthrough();  // The output is ours again from here
+                auto switch_start = std::chrono::steady_clock::now();
+                positionAtCleanPoint(drone_reader, output);
                 
                 if (!drone_reader.extractTimestampBases()) {
                     std::cerr << "[Main] Failed to extract drone timestamp bases" << std::endl;
@@ -613,8 +1192,8 @@ int main(int argc, char* argv[]) {
                 }
                 
                 // Get buffered packets from drone
-                auto drone_packets = drone_reader.getBufferedPacketsFromAudioSync();
-                std::cout << "[Main] Processing " << drone_packets.size() << " drone packets from audio sync" << std::endl;
+                auto drone_snapshot = drone_reader.getSnapshotFromAudioSync();
+                std::cout << "[Main] Processing " << drone_snapshot.size() << " drone packets from audio sync" << std::endl;
                 
                 // Inject SPS/PPS
                 std::vector<uint8_t> drone_sps = drone_reader.getSPSData();
@@ -625,51 +1204,22 @@ int main(int argc, char* argv[]) {
                     auto sps_pps_pkt = splicer.createSPSPPSPackets(drone_sps, drone_pps, drone_info.video_pid,
                                                                     splicer.getGlobalPTSOffset());
                     std::cout << "[Main] Injecting " << sps_pps_pkt.size() << " drone SPS/PPS packets" << std::endl;
-                    for (auto& pkt : sps_pps_pkt) {
-                        splicer.fixContinuityCounter(pkt);
-                        fifo_output.writePacket(pkt);
-                    }
+                    splicer.fixContinuityCounters(sps_pps_pkt);
+                    output.writePackets(sps_pps_pkt);
                 }
                 
-                // Update bases for drone stream
-                pts_base = drone_reader.getPTSBase();
-                pcr_base = drone_reader.getPCRBase();
-                pcr_pts_alignment = drone_reader.getPCRPTSAlignmentOffset();
+                // Map drone timestamps onto the output timeline from here on
+                bool cc_handover = beginSourceSegment(drone_reader, splicer, drone_rebase, output_passthrough);
                 
-                // Process drone packets
-                uint64_t seg_max_pts = 0;
-                uint64_t seg_max_pcr = 0;
-                for (auto& pkt : drone_packets) {
-                    splicer.rebasePacket(pkt, pts_base, pcr_base, pcr_pts_alignment);
-                    splicer.fixContinuityCounter(pkt);
-                    fifo_output.writePacket(pkt);
-                    packets_processed++;
-                    
-                    // Track max timestamps
-                    if (pkt.hasPCR()) seg_max_pcr = std::max(seg_max_pcr, pkt.getPCR());
-                    if (pkt.getPUSI() && pkt.hasPayload()) {
-                        size_t header_size = pkt.getHeaderSize();
-                        const uint8_t* payload = pkt.b + header_size;
-                        size_t payload_size = ts::PKT_SIZE - header_size;
-                        if (payload_size >= 14 && payload[0] == 0x00 && payload[1] == 0x00 && payload[2] == 0x01) {
-                            uint8_t pts_dts_flags = (payload[7] >> 6) & 0x03;
-                            if (pts_dts_flags == 0x02 || pts_dts_flags == 0x03) {
-                                uint64_t pts = ((uint64_t)(payload[9] & 0x0E) << 29) |
-                                              ((uint64_t)(payload[10]) << 22) |
-                                              ((uint64_t)(payload[11] & 0xFE) << 14) |
-                                              ((uint64_t)(payload[12]) << 7) |
-                                              ((uint64_t)(payload[13] >> 1));
-                                seg_max_pts = std::max(seg_max_pts, pts);
-                            }
-                        }
-                    }
-                }
+                // Rebase the drone snapshot straight into the output batch
+                packets_processed += writeSnapshot(std::move(drone_snapshot), splicer, drone_rebase, output, cc_handover);
                 
-                splicer.updateOffsetsFromMaxTimestamps(seg_max_pts, seg_max_pcr);
                 drone_reader.initConsumptionFromIndex(drone_reader.getLastSnapshotEnd());
+                recordSwitchLatency(switch_latency, switch_start);
                 
                 current_mode = Mode::DRONE;
                 active_reader = &drone_reader;
+                active_rebase = &drone_rebase;
                 std::cout << "[Main] Switched to DRONE mode" << std::endl;
                 std::cout << "[Main] Drone packets received: " << drone_reader.getPacketsReceived() << std::endl;
                 
@@ -713,6 +1263,19 @@ int main(int argc, char* argv[]) {
                     std::cout << "[Main] Drone bitrate too low (" << drone_reader.getCurrentBitrateBps()
                               << " bps < " << health_config.min_bitrate_bps << " bps) - switching to fallback!" << std::endl;
                     std::cout << "[Main] =======================================" << std::endl;
+                } else if (health_config.max_gap_ms > 0 && drone_reader.getMaxGapMs() > health_config.max_gap_ms) {
+                    std::cout << "[Main] =======================================" << std::endl;
+                    std::cout << "[Main] Drone delivery gap too long (" << drone_reader.getMaxGapMs()
+                              << "ms > " << health_config.max_gap_ms << "ms, jitter " << drone_reader.getJitterUs()
+                              << "us) - switching to fallback!" << std::endl;
+                    std::cout << "[Main] =======================================" << std::endl;
+                } else if (!drone_reader.isTransportHealthy()) {
+                    drone_reader.getTransportReport(transport_report);
+                    std::cout << "[Main] =======================================" << std::endl;
+                    std::cout << "[Main] Drone transport errors (score " << drone_reader.getTransportScore()
+                              << " < " << health_config.min_transport_score << ": "
+                              << transportErrorSummary(transport_report) << ") - switching to fallback!" << std::endl;
+                    std::cout << "[Main] =======================================" << std::endl;
                 } else {
                     std::cout << "[Main] =======================================" << std::endl;
                     std::cout << "[Main] Drone unhealthy - switching to fallback!" << std::endl;
@@ -735,32 +1298,69 @@ int main(int argc, char* argv[]) {
                     http_server.notifySceneChange("fallback", g_controller_url);
                 }
                 
-                // Reset for new loop
-                fallback_reader.resetForNewLoop();
-                fallback_reader.waitForStreamInfo();
-                fallback_reader.waitForIDR();
-                fallback_reader.waitForAudioSync();
+                // Resume fallback at its newest clean point
+                active_reader->stopPassthrough();  // The output is ours again from here
+                auto switch_start = std::chrono::steady_clock::now();
+                positionAtCleanPoint(fallback_reader, output);
                 
                 if (!fallback_reader.extractTimestampBases()) {
                     std::cerr << "[Main] Failed to extract fallback timestamp bases" << std::endl;
                     continue;
                 }
                 
+                // Resume fallback from its IDR, mapped onto the output timeline
+                auto fallback_snapshot = fallback_reader.getSnapshotFromAudioSync();
+                bool cc_handover = beginSourceSegment(fallback_reader, splicer, fallback_rebase, output_passthrough);
+                packets_processed += writeSnapshot(std::move(fallback_snapshot), splicer, fallback_rebase, output, cc_handover);
+                fallback_reader.initConsumptionFromIndex(fallback_reader.getLastSnapshotEnd());
+                recordSwitchLatency(switch_latency, switch_start);
+                
                 std::cout << "[Main] Switched to FALLBACK mode" << std::endl;
                 std::cout << "[Main] Camera packets received: " << camera_reader.getPacketsReceived() << std::endl;
                 http_server.notifySceneChange("fallback", g_controller_url);
 
                 current_mode = Mode::FALLBACK;
                 active_reader = &fallback_reader;
+                active_rebase = &fallback_rebase;
             }
         }
         
-        // Read and process packets from active reader
-        auto packets = active_reader->receivePackets(100, 10);
-        for (auto& pkt : packets) {
-            splicer.fixContinuityCounter(pkt);
-            fifo_output.writePacket(pkt);
-            packets_processed++;
+        // Read and process packets from active reader. Don't sleep past the
+        // output flush deadline while packets are queued.
+        auto packets = active_reader->receivePackets(100, output.getFlushWaitMs(10));
+        int64_t dequeue_ns = latency_tracker ? SequenceStamps::nowNs() : 0;
+        
+        // A leading run may already be out via tee(): only track it
+        size_t teed = active_reader->getLastPassthroughCount();
+        if (teed > 0 && !splicer.trackPassthrough(std::span<ts::TSPacket>(packets.data(), teed), *active_rebase)) {
+            // A source CC jump went out as is; rewrite from here on
+            std::cout << "[Main] Source continuity jump during passthrough" << std::endl;
+            active_reader->stopPassthrough();
+        }
+        std::span<ts::TSPacket> rewrite(packets.data() + teed, packets.size() - teed);
+        splicer.rebaseAndFixContinuity(rewrite, *active_rebase);
+        if (latency_tracker && !rewrite.empty()) {
+            trackBatchLatency(*latency_tracker, *active_reader, teed, dequeue_ns,
+                              active_reader == &camera_reader ? 1 : active_reader == &drone_reader ? 2 : 0,
+                              pacer ? pacer->getPacketsAccepted() : fifo_output ? fifo_output->getPacketsAccepted() : 0);
+        }
+        output.writePackets(rewrite.data(), rewrite.size());
+        if (latency_tracker) {
+            latency_tracker->poll();
+        }
+        output.flushIfDue();
+        packets_processed += packets.size();
+        
+        if (output_passthrough) {
+            updatePassthrough(*active_reader, splicer, output, passthrough_run_mark);
+        }
+        OutputModeUsage::Mode output_mode = active_reader->isPassthroughActive() ?
+            OutputModeUsage::PASSTHROUGH : OutputModeUsage::USERSPACE;
+        if (output_mode != output_usage.getMode()) {
+            output_usage.setMode(output_mode, total_output_bytes());
+            if (output_mode == OutputModeUsage::USERSPACE) {
+                passthrough_run_mark = splicer.getUnchangedRun();   // Wait for a fresh run
+            }
         }
         
         // Periodic logging
@@ -768,17 +1368,87 @@ int main(int argc, char* argv[]) {
         if (std::chrono::duration_cast<std::chrono::seconds>(now - last_log).count() >= 5) {
             std::cout << "[Main] Packets processed: " << packets_processed << std::endl;
             
+            output_usage.account(total_output_bytes());
+            std::cout << "[Main] Output modes (now " << (output_usage.getMode() == OutputModeUsage::PASSTHROUGH ?
+                                                       "passthrough" : "userspace") << "):" << std::endl;
+            output_usage.log(std::cout);
+            
             // Log health metrics for all inputs
             std::cout << "[Main] Input Health Metrics:" << std::endl;
             std::cout << "  Fallback: connected=" << fallback_reader.isConnected() 
                       << ", bitrate=" << (fallback_reader.getCurrentBitrateBps() / 1024) << " Kbps"
+                      << ", packets=" << fallback_reader.getPacketRate() << "/s"
+                      << ", max_gap=" << fallback_reader.getMaxGapMs() << " ms"
+                      << ", jitter=" << fallback_reader.getJitterUs() << " us"
                       << ", data_age=" << fallback_reader.getMsSinceLastData() << " ms" << std::endl;
             std::cout << "  Camera: connected=" << camera_reader.isConnected() 
                       << ", bitrate=" << (camera_reader.getCurrentBitrateBps() / 1024) << " Kbps"
+                      << ", packets=" << camera_reader.getPacketRate() << "/s"
+                      << ", max_gap=" << camera_reader.getMaxGapMs() << " ms"
+                      << ", jitter=" << camera_reader.getJitterUs() << " us"
                       << ", data_age=" << camera_reader.getMsSinceLastData() << " ms" << std::endl;
             std::cout << "  Drone: connected=" << drone_reader.isConnected() 
                       << ", bitrate=" << (drone_reader.getCurrentBitrateBps() / 1024) << " Kbps"
+                      << ", packets=" << drone_reader.getPacketRate() << "/s"
+                      << ", max_gap=" << drone_reader.getMaxGapMs() << " ms"
+                      << ", jitter=" << drone_reader.getJitterUs() << " us"
                       << ", data_age=" << drone_reader.getMsSinceLastData() << " ms" << std::endl;
+            std::cout << "[Main] Transport health (TR 101 290):";
+            for (const StreamInput* reader : std::initializer_list<const StreamInput*>{&fallback_reader, &camera_reader, &drone_reader}) {
+                reader->getTransportReport(transport_report);
+                std::cout << " " << reader->getName() << "=" << transport_report.score << " ("
+                          << transportErrorSummary(transport_report) << ")";
+            }
+            std::cout << std::endl;
+            std::cout << "[Main] Latency added by the last switch (clean point policy):";
+            for (const StreamInput* reader : std::initializer_list<const StreamInput*>{&fallback_reader, &camera_reader, &drone_reader}) {
+                std::cout << " " << reader->getName() << "=" << reader->getAddedLatencyMs() << " ms ("
+                          << StreamInput::cleanPointPolicyName(reader->getCleanPointPolicy()) << ")";
+            }
+            std::cout << std::endl;
+            if (rtmp_output) {
+                const FLVRemuxer& remuxer = rtmp_output->getRemuxer();
+                std::cout << "[Main] RTMP output: " << (rtmp_output->isPublishing() ? "publishing" : "disconnected")
+                          << ", video_frames=" << remuxer.getVideoFrames()
+                          << ", audio_frames=" << remuxer.getAudioFrames()
+                          << ", dropped=" << remuxer.getDroppedFrames() + rtmp_output->getFramesSkipped()
+                          << ", queue_drops=" << rtmp_output->getFramesDropped()
+                          << ", bytes_sent=" << rtmp_output->getRTMPBytesSent()
+                          << ", reconnect_attempts=" << rtmp_output->getReconnectAttempts() << std::endl;
+            }
+            if (fanout) {
+                for (const FanoutOutput::SinkStats& sink : fanout->getSinkStats()) {
+                    std::cout << "[Main] Sink " << sink.name << " (" << FanoutOutput::policyName(sink.policy) << "): "
+                              << (sink.open ? "open" : "closed")
+                              << ", lag=" << sink.lag_packets << " packets"
+                              << ", written=" << sink.packets_written
+                              << ", skipped=" << sink.packets_skipped
+                              << ", idr_skips=" << sink.idr_skips
+                              << ", overruns=" << sink.overruns
+                              << ", disconnects=" << sink.disconnects << std::endl;
+                }
+            }
+            if (pacer) {
+                LatencyHistogram::Snapshot jitter = pacer->getJitter();
+                std::cout << "[Main] Output pacing: backlog=" << pacer->getBacklogMs() << " ms"
+                          << ", queued=" << pacer->getQueuedPackets() << " packets"
+                          << ", jitter p50=" << jitter.quantileUs(0.5) << " us"
+                          << ", p99=" << jitter.quantileUs(0.99) << " us"
+                          << ", max=" << jitter.max_us << " us"
+                          << ", underruns=" << pacer->getUnderruns()
+                          << ", catch_ups=" << pacer->getCatchUps()
+                          << ", pcr_discontinuities=" << pacer->getPcrDiscontinuities() << std::endl;
+            }
+            for (const StreamInput* reader : {&camera_reader, &drone_reader}) {
+                TransportStats t = reader->getTransportStats();
+                if (t.valid) {
+                    std::cout << "  " << reader->getName() << " SRT: rtt=" << t.rtt_ms << " ms"
+                              << ", retransmitted=" << t.retransmitted_packets
+                              << ", lost=" << t.lost_packets << ", dropped=" << t.dropped_packets
+                              << ", rcv_buffer=" << t.rcv_buffer_ms << " ms ("
+                              << static_cast<int>(t.rcv_buffer_fill * 100) << "%)" << std::endl;
+                }
+            }
             
             last_log = now;
         }
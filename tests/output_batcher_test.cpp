@@ -0,0 +1,108 @@
+/*
+ * OutputBatcher / batched output test
+ *
+ * Outputs whose descriptor cannot be (re)opened must not keep staging
+ * packets: every failed flush drops the batch, and stage() never writes
+ * past the staging buffer. Writes many batches' worth of packets through
+ * each staging path (writePacket, small writePackets, reserve/commit)
+ * while the FIFO does not exist and the TCP output cannot reconnect.
+ * Most useful under AddressSanitizer (-fsanitize=address).
+ *
+ * Build: cmake -DBUILD_TESTS=ON .. && make output_batcher_test && ctest
+ */
+
+#include "OutputBatcher.h"
+#include "FIFOOutput.h"
+#include "TCPOutput.h"
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::cerr << "FAIL: " << what << std::endl;
+        failures++;
+    }
+}
+
+ts::TSPacket makePacket(size_t i) {
+    ts::TSPacket packet;
+    std::memset(packet.b, 0xFF, sizeof(packet.b));
+    packet.b[0] = 0x47;
+    packet.b[3] = static_cast<uint8_t>(0x10 | (i & 0x0F));
+    return packet;
+}
+
+constexpr size_t PACKETS = 20 * OutputBatcher::DEFAULT_FLUSH_PACKETS + 7;
+
+// Nobody flushes: stage() must drop instead of overrunning the buffer
+void testBatcherNeverFlushed() {
+    OutputBatcher batcher;
+    for (size_t i = 0; i < PACKETS; i++) {
+        batcher.stage(makePacket(i));
+    }
+    check(batcher.stagedPackets() <= OutputBatcher::MAX_FLUSH_PACKETS, "batcher staged past its buffer");
+    check(batcher.getDroppedCount() > 0, "batcher dropped nothing");
+    check(batcher.getDroppedCount() + batcher.stagedPackets() == PACKETS, "batcher lost count of packets");
+
+    batcher.discard();
+    check(batcher.empty(), "discard() left packets staged");
+}
+
+// Every staging path, against an output whose flushes all fail
+template <typename Output>
+void writeAll(Output& output) {
+    std::vector<ts::TSPacket> small(OutputBatcher::DEFAULT_FLUSH_PACKETS / 4);
+    for (size_t i = 0; i < small.size(); i++) small[i] = makePacket(i);
+
+    for (size_t i = 0; i < PACKETS; i++) {
+        output.writePacket(makePacket(i));
+    }
+    for (size_t i = 0; i < PACKETS / small.size(); i++) {
+        output.writePackets(small.data(), small.size());
+    }
+    for (size_t i = 0; i < PACKETS / 8; i++) {
+        ts::TSPacket* out = output.reserve(8);
+        check(out != nullptr, "reserve() failed");
+        if (!out) return;
+        for (size_t j = 0; j < 8; j++) out[j] = makePacket(j);
+        output.commit(8);
+    }
+    output.flush();
+}
+
+void testFifoCannotOpen() {
+    std::atomic<bool> running{true};
+    FIFOOutput output("/nonexistent/output_batcher_test.fifo", running);
+    writeAll(output);
+    check(output.getPacketsWritten() == 0, "FIFO wrote packets without a pipe");
+    check(output.getPacketsAccepted() > PACKETS, "FIFO did not accept the writes");
+}
+
+void testTcpCannotReconnect() {
+    // Not running: connect() gives up at once, like a shutdown mid-outage
+    std::atomic<bool> running{false};
+    TCPOutput output("127.0.0.1", 9, running);
+    writeAll(output);
+    check(output.getPacketsWritten() == 0, "TCP wrote packets without a connection");
+}
+
+}  // namespace
+
+int main() {
+    std::cout << "OutputBatcher test" << std::endl;
+    testBatcherNeverFlushed();
+    testFifoCannotOpen();
+    testTcpCannotReconnect();
+    if (failures > 0) {
+        std::cerr << failures << " failure(s)" << std::endl;
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}